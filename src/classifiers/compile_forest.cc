@@ -0,0 +1,86 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Compiles a forest exported by ml/forest.py for the FHE parameters of
+ * net/defs.hh, to be loaded by the forest server:
+ *
+ *   compile_forest <forest.txt> <model.cfm> [packing]
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <FHE.h>
+#include <EncryptedArray.h>
+#include <util/fhe_util.hh>
+
+#include <net/defs.hh>
+#include <tree/model_store.hh>
+#include <util/util.hh>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " <forest.txt> <model.cfm> [packing]" << endl;
+        return 1;
+    }
+    bool slot_packing = (argc > 3 && string(argv[3]) == "packing");
+
+    vector<Node<long>* > trees;
+    unsigned int n_classes;
+    vector<unsigned int> n_variables;
+    vector<vector<pair <long,long> > > criteria;
+
+    if (!read_forest_text(argv[1], trees, n_classes, n_variables, criteria)) {
+        cerr << "Unable to read the forest " << argv[1] << endl;
+        return 1;
+    }
+    cout << trees.size() << " trees, " << n_classes << " classes" << endl;
+
+    // same context as the server, the polynomials depend on the number of slots
+    FHEcontext *fhe_context = create_FHEContext(FHE_p,FHE_r,FHE_d,FHE_c,FHE_L,FHE_s,FHE_k,FHE_m);
+    ZZX G = makeIrredPoly(FHE_p, FHE_d);
+    EncryptedArray ea(*fhe_context, G);
+    cout << "Number of slots: " << ea.size() << endl;
+
+    if (n_classes > ea.size()) {
+        cerr << "Too many classes for " << ea.size() << " slots" << endl;
+        return 1;
+    }
+
+    Timer t;
+    Compiled_Forest model = compile_forest(trees, n_classes, n_variables, criteria, ea.size(), slot_packing);
+    cout << "Compiled in " << t.lap_ms() << " ms, " << model.packed_polys.size() << " ciphertexts" << endl;
+
+    for (size_t i = 0; i < trees.size(); i++) {
+        delete trees[i];
+    }
+    delete fhe_context;
+
+    if (!save_compiled_forest(model, argv[2])) {
+        cerr << "Unable to write " << argv[2] << endl;
+        return 1;
+    }
+
+    return 0;
+}
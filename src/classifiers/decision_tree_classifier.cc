@@ -52,7 +52,7 @@ Server_session* Decision_tree_Classifier_Server::create_new_server_session(tcp::
 //        // get the query
 //        vector<Ctxt> query;
 //        for (size_t i = 0; i < tree_server_->n_variables() ; i++) {
-//            query.push_back(read_fhe_ctxt_from_socket(socket_, *client_fhe_pk_));
+//            query.push_back(read_fhe_ctxt_from_socket(channel_, *client_fhe_pk_));
 //        }
 //        
 //        
@@ -64,7 +64,7 @@ Server_session* Decision_tree_Classifier_Server::create_new_server_session(tcp::
 //        Ctxt c_r = evalPoly_FHE(tree_server_->model_poly(), query,ea,useShallowCircuit);
 //        
 //        // send the result back to the client
-//        send_fhe_ctxt_to_socket(socket_, c_r);
+//        send_fhe_ctxt_to_socket(channel_, c_r);
 //        
 //    } catch (std::exception& e) {
 //        std::cout << "Exception: " << e.what() << std::endl;
@@ -78,57 +78,27 @@ void Decision_tree_Classifier_Server_session::run_session()
     try {
         exchange_keys();
         
-        bool useShallowCircuit = true;
         EncryptedArray ea(server_->fhe_context(), server_->fhe_G());
 
-        ScopedTimer *t;
         RESET_BYTE_COUNT
         RESET_BENCHMARK_TIMER
 
-        // get the query
-        vector<mpz_class> query;
-        query = read_int_array_from_socket(socket_);
-        
-        vector<pair <vector<long>,long> > criteria = tree_server_->criteria();
-
-        vector<mpz_class> node_values(tree_server_->n_variables());
-        
-        t = new ScopedTimer("Server: Compute dot product");
-        // compute all the dot products
-        for (size_t i = 0; i < node_values.size(); i++) {
-            node_values[i] = client_paillier_->dot_product(query, get<0>(criteria[i]));
-        }
-        delete t;
-
-        // compare
-        vector<mpz_class> c_b_gm(tree_server_->n_variables());
-        
-        t = new ScopedTimer("Server: Compare");
-        for (size_t i = 0; i < node_values.size(); i++) {
-            mpz_class c_treshold = client_paillier_->encrypt(get<1>(criteria[i]));
-            c_b_gm[i] = enc_comparison_enc_result(node_values[i],c_treshold,64,GC_PROTOCOL);
-        }
-        delete t;
-
-        // convert
-        vector<Ctxt> c_b_fhe;
-
-        t = new ScopedTimer("Server: Change encryption scheme");
-        for (size_t i = 0; i < node_values.size(); i++) {
-            // duplicate everything
-            vector<mpz_class> duplicates(ea.size(),c_b_gm[i]);
-            c_b_fhe.push_back(change_encryption_scheme(duplicates));
+        // the comparisons of a batch of queries are run together, then the
+        // queries are classified one after the other
+        // the criteria are dot products with the whole query
+        size_t query_size = tree_server_->criteria().empty() ? 0 : get<0>(tree_server_->criteria()[0]).size();
+        vector<vector<mpz_class> > queries;
+        while (read_query_batch(queries, query_size, query_size) > 0) {
+            Timer batch_timer;
+            double elapsed = 0;
+
+            vector<vector<mpz_class> > c_b_gm = compare(queries);
+            for (size_t q = 0; q < queries.size(); ++q) {
+                classify(c_b_gm[q], ea);
+                elapsed += batch_timer.lap_ms();
+                metrics_.add_query_latency(elapsed);
+            }
         }
-        delete t;
-
-        // evaluate the polynomial
-
-        t = new ScopedTimer("Server: Evaluation");
-        Ctxt c_r = evalPoly_FHE(tree_server_->model_poly(), c_b_fhe,ea,useShallowCircuit);
-        delete t;
-        
-        // send the result back to the client
-        send_fhe_ctxt_to_socket(socket_, c_r);
 
 #ifdef BENCHMARK
         cout << "Benchmark: " << GET_BENCHMARK_COMP_TIME << " ms (computation)" << endl;
@@ -145,6 +115,60 @@ void Decision_tree_Classifier_Server_session::run_session()
     delete this;
 }
 
+vector<vector<mpz_class> > Decision_tree_Classifier_Server_session::compare(const vector<vector<mpz_class> > &queries)
+{
+    vector<pair <vector<long>,long> > criteria = tree_server_->criteria();
+    size_t n_variables = tree_server_->n_variables();
+
+    vector<mpz_class> node_values, thresholds;
+    
+    ScopedTimer *t = new ScopedTimer("Server: Compute dot product");
+    // compute all the dot products
+    for (size_t q = 0; q < queries.size(); q++) {
+        for (size_t i = 0; i < n_variables; i++) {
+            node_values.push_back(client_paillier_->dot_product(queries[q], get<0>(criteria[i])));
+            thresholds.push_back(get<1>(criteria[i]));
+        }
+    }
+    delete t;
+
+    // compare, all the nodes of all the queries in a single batch
+    t = new ScopedTimer("Server: Compare");
+    vector<mpz_class> c_batch = batch_plain_comparison_enc_result(node_values, thresholds, 64);
+    delete t;
+
+    vector<vector<mpz_class> > c_b_gm(queries.size());
+    for (size_t q = 0; q < queries.size(); q++) {
+        c_b_gm[q] = vector<mpz_class>(c_batch.begin() + q*n_variables, c_batch.begin() + (q+1)*n_variables);
+    }
+    return c_b_gm;
+}
+
+void Decision_tree_Classifier_Server_session::classify(const vector<mpz_class> &c_b_gm, const EncryptedArray &ea)
+{
+    bool useShallowCircuit = true;
+
+    // convert
+    vector<Ctxt> c_b_fhe;
+
+    ScopedTimer *t = new ScopedTimer("Server: Change encryption scheme");
+    for (size_t i = 0; i < c_b_gm.size(); i++) {
+        // duplicate everything
+        vector<mpz_class> duplicates(ea.size(),c_b_gm[i]);
+        c_b_fhe.push_back(change_encryption_scheme(duplicates));
+    }
+    delete t;
+
+    // evaluate the polynomial
+
+    t = new ScopedTimer("Server: Evaluation");
+    Ctxt c_r = evalPoly_FHE(tree_server_->model_poly(), c_b_fhe,ea,useShallowCircuit);
+    delete t;
+    
+    // send the result back to the client
+    send_fhe_ctxt_to_socket(channel_, c_r);
+}
+
 Decision_tree_Classifier_Client::Decision_tree_Classifier_Client(boost::asio::io_service& io_service, gmp_randstate_t state, unsigned int keysize, vector<long> &query, unsigned int n_nodes)
 : Client(io_service,state,Decision_tree_Classifier_Server::key_deps_descriptor(),keysize,0), query_(query), n_nodes_(n_nodes)
 {
@@ -167,11 +191,11 @@ Decision_tree_Classifier_Client::Decision_tree_Classifier_Client(boost::asio::io
 //
 //    // send the query to the server ...
 //    for (size_t i = 0; i < query_.size(); i++) {
-//        send_fhe_ctxt_to_socket(socket_, c_b[i]);
+//        send_fhe_ctxt_to_socket(channel_, c_b[i]);
 //    }
 //    
 //    // ... and wait for the result
-//    Ctxt c_r = read_fhe_ctxt_from_socket(socket_,*fhe_sk_);
+//    Ctxt c_r = read_fhe_ctxt_from_socket(channel_,*fhe_sk_);
 //    
 //    // decrypt and test
 //    vector<long> res_bits;
@@ -187,6 +211,13 @@ Decision_tree_Classifier_Client::Decision_tree_Classifier_Client(boost::asio::io
 
 void Decision_tree_Classifier_Client::run()
 {
+    run(vector<vector<long> >(1, query_));
+}
+
+vector<long> Decision_tree_Classifier_Client::run(const vector<vector<long> > &queries, size_t batch_size)
+{
+    assert(batch_size > 0);
+    Session_Metrics::Binding metrics_binding(metrics_);
     RESET_BYTE_COUNT
     exchange_keys();
 #ifdef BENCHMARK
@@ -201,25 +232,51 @@ void Decision_tree_Classifier_Client::run()
     RESET_BYTE_COUNT
     RESET_BENCHMARK_TIMER
 
-    // send our query encrypted under paillier
-    vector<mpz_class> enc_query(query_.size());
-    for (size_t i = 0; i < query_.size(); i++) {
-        enc_query[i] = paillier_->encrypt(query_[i]);
-    }
-    
-    send_int_array_to_socket(socket_,enc_query);
-    
-    // the server computes the criteria for each node and needs our help
-    
-    t = new ScopedTimer("Client: Compute criteria");
-
-    for (unsigned int i = 0; i < n_nodes_; i++) {
+    vector<long> results;
+    for (size_t first = 0; first < queries.size(); first += batch_size) {
+        size_t n = min(batch_size, queries.size() - first);
+        Timer batch_timer;
+        double elapsed = 0;
+
+        // send our queries encrypted under paillier
+        vector<vector<mpz_class> > enc_queries(n);
+        for (size_t q = 0; q < n; q++) {
+            const vector<long> &query = queries[first + q];
+            for (size_t i = 0; i < query.size(); i++) {
+                enc_queries[q].push_back(paillier_->encrypt(query[i]));
+            }
+        }
+        send_query_batch(enc_queries);
+        
+        // the server computes the criteria for each node and needs our help
+        
+        t = new ScopedTimer("Client: Compute criteria");
         // for now, do it over 64 bits
-        help_enc_comparison_enc_result(64, GC_PROTOCOL);
+        help_batch_enc_comparison_enc_result(n*n_nodes_, 64);
+        delete t;
+
+        for (size_t q = 0; q < n; q++) {
+            results.push_back(classify(ea));
+            elapsed += batch_timer.lap_ms();
+            metrics_.add_query_latency(elapsed);
+            cout << "Classification result: " << results.back() << " (" << elapsed << " ms)" << endl;
+        }
     }
-    delete t;
+    end_queries();
+
+#ifdef BENCHMARK
+    cout << "Benchmark: " << GET_BENCHMARK_COMP_TIME << " ms (computation)" << endl;
+    cout << "Benchmark: " << GET_BENCHMARK_NET_TIME << " ms (network)" << endl;
+    cout << (IOBenchmark::byte_count()/to_kB) << " exchanged kB" << endl;
+    cout << IOBenchmark::interaction_count() << " interactions" << endl;
+#endif
+
+    return results;
+}
 
-    t = new ScopedTimer("Client: Change encryption scheme");
+long Decision_tree_Classifier_Client::classify(const EncryptedArray &ea)
+{
+    ScopedTimer *t = new ScopedTimer("Client: Change encryption scheme");
     // now he wants the booleans encrypted under FHE
     for (unsigned int i = 0; i < n_nodes_; i++) {
         run_change_encryption_scheme_slots_helper();
@@ -227,7 +284,7 @@ void Decision_tree_Classifier_Client::run()
     delete t;
     
     // we get the result and decrypt it
-    Ctxt c_r = read_fhe_ctxt_from_socket(socket_,*fhe_sk_);
+    Ctxt c_r = read_fhe_ctxt_from_socket(channel_,*fhe_sk_);
     // decrypt and test
     vector<long> res_bits;
     t = new ScopedTimer("Client: Decrypt result");
@@ -236,14 +293,7 @@ void Decision_tree_Classifier_Client::run()
     long v = bitSet_inv(res_bits);
     delete t;
 
-#ifdef BENCHMARK
-    cout << "Benchmark: " << GET_BENCHMARK_COMP_TIME << " ms (computation)" << endl;
-    cout << "Benchmark: " << GET_BENCHMARK_NET_TIME << " ms (network)" << endl;
-    cout << (IOBenchmark::byte_count()/to_kB) << " exchanged kB" << endl;
-    cout << IOBenchmark::interaction_count() << " interactions" << endl;
-#endif
-
-    cout << "Classification result: " << v << " " << res_bits.size() << endl;
+    return v;
 }
 
 
@@ -31,6 +31,8 @@
 #include <net/client.hh>
 #include <net/server.hh>
 
+#include <EncryptedArray.h>
+
 #include <tree/tree.hh>
 #include <tree/m_variate_poly.hh>
 
@@ -71,6 +73,10 @@ public:
     void run_session();
     
 protected:
+    /* encrypted comparison bits of the nodes of each query */
+    vector<vector<mpz_class> > compare(const vector<vector<mpz_class> > &queries);
+    void classify(const vector<mpz_class> &c_b_gm, const EncryptedArray &ea);
+
     Decision_tree_Classifier_Server *tree_server_;
 };
 
@@ -78,9 +84,14 @@ class Decision_tree_Classifier_Client : public Client{
 public:
     Decision_tree_Classifier_Client(boost::asio::io_service& io_service, gmp_randstate_t state, unsigned int keysize, vector<long> &query, unsigned int n_nodes);
     
+    /* classifies the query given to the constructor */
     void run();
+    /* see Random_forest_Classifier_Client::run */
+    vector<long> run(const vector<vector<long> > &queries, size_t batch_size = 1);
     
 protected:
+    long classify(const EncryptedArray &ea);
+
     vector<long> query_;
     unsigned int n_nodes_;
 };
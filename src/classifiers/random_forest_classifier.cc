@@ -19,6 +19,7 @@
  */
 
 #include <algorithm>
+#include <stdexcept>
 #include <classifiers/random_forest_classifier.hh>
 
 #include <protobuf/protobuf_conversion.hh>
@@ -32,19 +33,109 @@
 
 #include <util/util.hh>
 
-Random_forest_Classifier_Server::Random_forest_Classifier_Server(gmp_randstate_t state, unsigned int keysize, const vector<Node<long>* > &model, unsigned int n_trees, unsigned int n_classes, vector<unsigned int> n_variables, const vector<vector<pair <long,long> > > &criteria, bool plurality_vote)
-: Server(state, Random_forest_Classifier_Server::key_deps_descriptor(), keysize, 0), n_variables_(n_variables), criteria_(criteria), n_trees_(n_trees), n_classes_(n_classes), plurality_vote_(plurality_vote)
+Random_forest_Classifier_Server::Random_forest_Classifier_Server(gmp_randstate_t state, unsigned int keysize, const vector<Node<long>* > &model, unsigned int n_trees, unsigned int n_classes, vector<unsigned int> n_variables, const vector<vector<pair <long,long> > > &criteria, bool plurality_vote, unsigned int comparison_window, bool slot_packing, bool pad_sharing)
+: Server(state, Random_forest_Classifier_Server::key_deps_descriptor(), keysize, 0), plurality_vote_(plurality_vote), comparison_window_(comparison_window), pad_sharing_(pad_sharing)
 {
     EncryptedArray ea(*fhe_context_, fhe_G_);
+    assert(model.size() == n_trees);
 
-    model_poly_ = vector<Multivariate_poly< vector<long> > >(n_trees);
-    for(size_t tj = 0; tj < n_trees; ++tj) {
-        model_poly_[tj] = model[tj]->to_polynomial_with_slots(ea.size());
-        model_poly_[tj] = mergeRegroup(model_poly_[tj]);
+    set_model(compile_forest(model, n_classes, n_variables, criteria, ea.size(), slot_packing));
+}
+
+Random_forest_Classifier_Server::Random_forest_Classifier_Server(gmp_randstate_t state, unsigned int keysize, const Compiled_Forest &model, bool plurality_vote, unsigned int comparison_window, bool pad_sharing)
+: Server(state, Random_forest_Classifier_Server::key_deps_descriptor(), keysize, 0), plurality_vote_(plurality_vote), comparison_window_(comparison_window), pad_sharing_(pad_sharing)
+{
+    set_model(model);
+}
+
+void Random_forest_Classifier_Server::set_model(const Compiled_Forest &model)
+{
+    EncryptedArray ea(*fhe_context_, fhe_G_);
+    assert(model.n_classes > 0 && model.n_classes <= ea.size());
+
+    // the lanes and the leaf values depend on the number of slots
+    if (model.n_slots != ea.size()) {
+        throw std::runtime_error("Compiled forest for " + to_string(model.n_slots) + " slots, the FHE context has " + to_string(ea.size()));
     }
 
+    model_poly_ = model.tree_polys;
+    n_variables_ = model.n_variables;
+    criteria_ = model.criteria;
+    n_trees_ = model.n_trees();
+    n_classes_ = model.n_classes;
+    slot_packing_ = model.slot_packing;
+    trees_per_ciphertext_ = model.trees_per_ciphertext;
+    packed_poly_ = model.packed_polys;
+    packed_n_variables_ = model.packed_n_variables;
+
     cout << "Number of slots: " << ea.size() << endl;
+    if (slot_packing_) {
+        cout << trees_per_ciphertext_ << " trees per ciphertext, " << packed_poly_.size() << " ciphertexts" << endl;
+    }
+
+    compile_comparisons();
+}
+
+void Random_forest_Classifier_Server::compile_comparisons()
+{
+    map<pair <long,long>, size_t> comparison_ids;
+    comparison_index_ = vector<vector<size_t> >(n_trees_);
+    size_t n_nodes = 0;
+    for (size_t tj = 0; tj < n_trees_; ++tj) {
+        n_nodes += n_variables_[tj];
+        assert(criteria_[tj].size() >= n_variables_[tj]);
+        for (size_t i = 0; i < n_variables_[tj]; ++i) {
+            auto it = comparison_ids.insert(make_pair(criteria_[tj][i], comparisons_.size()));
+            if (it.second) {
+                comparisons_.push_back(criteria_[tj][i]);
+            }
+            comparison_index_[tj].push_back(it.first->second);
+        }
+    }
 
+    map<vector<size_t>, size_t> conversion_ids;
+    conversion_index_ = vector<vector<size_t> >(packed_poly_.size());
+    for (size_t c = 0; c < packed_poly_.size(); ++c) {
+        size_t first = c*trees_per_ciphertext_;
+        size_t n_packed = min<size_t>(trees_per_ciphertext_, n_trees_ - first);
+        for (size_t i = 0; i < packed_n_variables_[c]; ++i) {
+            vector<size_t> lanes(n_packed);
+            for (size_t k = 0; k < n_packed; ++k) {
+                // a tree with fewer nodes does not use variable i
+                size_t tj = first + k;
+                lanes[k] = comparison_index_[tj][(i < n_variables_[tj]) ? i : 0];
+            }
+            auto it = conversion_ids.insert(make_pair(lanes, conversion_lanes_.size()));
+            if (it.second) {
+                conversion_lanes_.push_back(lanes);
+            }
+            conversion_index_[c].push_back(it.first->second);
+        }
+    }
+
+    query_size_ = 0;
+    for (size_t k = 0; k < comparisons_.size(); ++k) {
+        assert(get<0>(comparisons_[k]) >= 0);
+        query_size_ = max<size_t>(query_size_, get<0>(comparisons_[k]) + 1);
+    }
+
+    cout << comparisons_.size() << " distinct comparisons, " << conversion_lanes_.size() << " conversions" << endl;
+
+    if (pad_sharing_) {
+        // the dummies repeat the first comparison and conversion, their
+        // results are never used
+        size_t n_packed_nodes = 0;
+        for (size_t c = 0; c < packed_poly_.size(); ++c) {
+            n_packed_nodes += packed_n_variables_[c];
+        }
+        if (!comparisons_.empty()) {
+            comparisons_.resize(n_nodes, comparisons_[0]);
+        }
+        if (!conversion_lanes_.empty()) {
+            conversion_lanes_.resize(n_packed_nodes, conversion_lanes_[0]);
+        }
+        cout << "Padded to " << comparisons_.size() << " comparisons, " << conversion_lanes_.size() << " conversions" << endl;
+    }
 }
 
 Server_session* Random_forest_Classifier_Server::create_new_server_session(tcp::socket &socket)
@@ -58,138 +149,201 @@ void Random_forest_Classifier_Server_session::run_session()
     try {
         exchange_keys();
 
-        bool useShallowCircuit = true;
         EncryptedArray ea(server_->fhe_context(), server_->fhe_G());
 
-        ScopedTimer *t;
         RESET_BYTE_COUNT
         RESET_BENCHMARK_TIMER
 
-        // get the query
-        vector<mpz_class> query;
-        query = read_int_array_from_socket(socket_);
+        // the comparisons of a batch of queries are run together, then the
+        // queries are classified one after the other
+        vector<vector<mpz_class> > queries;
+        for (;;) {
+            metrics_.set_phase("query");
+            if (read_query_batch(queries, forest_server_->query_size()) == 0) {
+                break;
+            }
+            Timer batch_timer;
+            double elapsed = 0;
+
+            vector<vector<mpz_class> > c_b_gm = compare(queries);
+            for (size_t q = 0; q < queries.size(); ++q) {
+                classify(c_b_gm[q], ea);
+                elapsed += batch_timer.lap_ms();
+                metrics_.add_query_latency(elapsed);
+            }
+        }
 
-        vector<vector<pair <long,long> > > criteria = forest_server_->criteria();
+#ifdef BENCHMARK
+        cout << "Benchmark: " << GET_BENCHMARK_COMP_TIME << " ms (computation)" << endl;
+        cout << "Benchmark: " << GET_BENCHMARK_NET_TIME << " ms (network)" << endl;
+        cout << IOBenchmark::byte_count() << " exchanged bytes" << endl;
+        cout << IOBenchmark::interaction_count() << " interactions" << endl;
+#endif
 
-        vector<vector<mpz_class> > node_values(forest_server_->n_trees()); // do it for every tree
+        
+    } catch (std::exception& e) {
+        std::cout << "Exception: " << e.what() << std::endl;
+    }
+    
+    delete this;
+}
 
-        t = new ScopedTimer("Server: Compute node values for every tree and node");
-        // for all trees, get necessary criteria
-        for(size_t tj = 0; tj < node_values.size(); ++tj) {
-            node_values[tj] = vector<mpz_class>(forest_server_->n_variables(tj));
-            for (size_t i = 0; i < node_values[tj].size(); ++i) {
-                // remove unnecessary dot product
-                node_values[tj][i] = query[get<0>(criteria[tj][i])]; // client_paillier_->dot_product(query, get<0>(criteria[i]));
-            }
+vector<vector<mpz_class> > Random_forest_Classifier_Server_session::compare(const vector<vector<mpz_class> > &queries)
+{
+    const vector<pair <long,long> > &comparisons = forest_server_->comparisons();
+    size_t n_comparisons = comparisons.size();
+
+    // the comparisons of each query are shuffled so that the client cannot tell which one is which
+    vector<vector<size_t> > indices(queries.size(), vector<size_t>(n_comparisons));
+    for (size_t q = 0; q < queries.size(); ++q) {
+        for (size_t k = 0; k < n_comparisons; ++k) {
+            indices[q][k] = k;
         }
-        delete t;
+        random_shuffle ( indices[q].begin(), indices[q].end() );
+    }
 
+    metrics_.set_phase("node_values");
+    ScopedTimer *t = new ScopedTimer("Server: Compute node values for every distinct comparison");
+    // remove unnecessary dot product
+    vector<mpz_class> batch_values, batch_tresholds;
+    for (size_t q = 0; q < queries.size(); ++q) {
+        for (size_t k = 0; k < n_comparisons; ++k) {
+            batch_values.push_back(queries[q][get<0>(comparisons[indices[q][k]])]);
+            batch_tresholds.push_back(get<1>(comparisons[indices[q][k]]));
+        }
+    }
+    delete t;
 
-        // compare all values
-        vector<vector<mpz_class> > c_b_gm(forest_server_->n_trees());
+    // now run shuffled comparisons, each distinct comparison once per query
+    metrics_.set_phase("compare");
+    t = new ScopedTimer("Server: Compare");
+    // all the comparisons are either garbled and sent in a single batch or
+    // pipelined, with comparison_window() of them in flight. The thresholds
+    // are compared in the clear, without being encrypted.
+    unsigned int window = forest_server_->comparison_window();
+    sendIntToSocket(channel_, batch_values.size());
+    sendIntToSocket(channel_, window);
+    
+    vector<mpz_class> c_batch;
+    if (window == 0) {
+        c_batch = batch_plain_comparison_enc_result(batch_values, batch_tresholds, 128);
+    }else{
+        c_batch = pipelined_plain_comparison_enc_result(batch_values, batch_tresholds, 128, window);
+    }
+    vector<vector<mpz_class> > c_b_gm(queries.size(), vector<mpz_class>(n_comparisons));
+    for (size_t q = 0; q < queries.size(); ++q) {
+        for (size_t k = 0; k < n_comparisons; ++k) {
+            c_b_gm[q][indices[q][k]] = c_batch[q*n_comparisons + k];
+        }
+    }
+    delete t;
 
-        // we would like to shuffle comparisons here
-        vector<pair <size_t, size_t> > indices;
-        for(size_t tj = 0; tj < c_b_gm.size(); ++tj) {
-            // initialize vector here
-            c_b_gm[tj] = vector<mpz_class>(forest_server_->n_variables(tj));
-            for (size_t i = 0; i < c_b_gm[tj].size(); ++i) {
-                pair<size_t, size_t> p = make_pair(tj, i);
-                indices.push_back(p);
-            }
+    return c_b_gm;
+}
+
+void Random_forest_Classifier_Server_session::classify(const vector<mpz_class> &c_b_gm, const EncryptedArray &ea)
+{
+    bool useShallowCircuit = true;
+    ScopedTimer *t;
+
+    // convert
+    unsigned int trees_per_ctxt = forest_server_->trees_per_ciphertext();
+    size_t lane_width = forest_server_->slot_packing() ? forest_server_->n_classes() : ea.size();
+    vector<Ctxt> c_converted;
+
+    metrics_.set_phase("change_encryption");
+    t = new ScopedTimer("Server: Change encryption scheme");
+    // the client has to know how many conversions and results to expect
+    sendIntToSocket(channel_, forest_server_->n_conversions());
+    sendIntToSocket(channel_, trees_per_ctxt);
+    // a comparison shared by several lanes or conversions is re-randomized,
+    // so that the client cannot tell which nodes use the same criterion
+    vector<bool> used(c_b_gm.size(), false);
+    for (size_t k = 0; k < forest_server_->n_conversions(); ++k) {
+        const vector<size_t> &lanes = forest_server_->conversion_lanes(k);
+        vector<mpz_class> c_lanes(lanes.size());
+        for (size_t j = 0; j < lanes.size(); ++j) {
+            c_lanes[j] = used[lanes[j]] ? client_gm_->reRand(c_b_gm[lanes[j]]) : c_b_gm[lanes[j]];
+            used[lanes[j]] = true;
         }
-        random_shuffle ( indices.begin(), indices.end() );
-
-        // now run shuffled comparisons
-        t = new ScopedTimer("Server: Compare");
-        for (vector<pair <size_t, size_t> >::iterator it=indices.begin(); it!=indices.end(); ++it) {
-            size_t tj = get<0>(*it);
-            size_t i = get<1>(*it);
-            mpz_class c_treshold = client_paillier_->encrypt(get<1>(criteria[tj][i]));
-            c_b_gm[tj][i] = enc_comparison_enc_result(node_values[tj][i], c_treshold, 128, GC_PROTOCOL);
+        // every slot of a lane gets the bit of its tree, the slots after
+        // the last lane are padded with the bits of the last tree
+        vector<mpz_class> slots(ea.size());
+        for (size_t s = 0; s < slots.size(); ++s) {
+            slots[s] = c_lanes[min<size_t>(s/lane_width, lanes.size() - 1)];
         }
-        delete t;
+        c_converted.push_back(change_encryption_scheme(slots));
+    }
+    vector<vector<Ctxt> > c_b_fhe(forest_server_->n_ciphertexts());
+    for(size_t c = 0; c < c_b_fhe.size(); ++c) {
+        for (size_t i = 0; i < forest_server_->packed_n_variables(c); ++i) {
+            c_b_fhe[c].push_back(c_converted[forest_server_->conversion_index(c, i)]);
+        }
+    }
+    delete t;
 
-        // convert
-        vector<vector<Ctxt> > c_b_fhe(forest_server_->n_trees());
+    // evaluate the polynomial
+    vector<Ctxt> c_r;
 
-        t = new ScopedTimer("Server: Change encryption scheme");
-        for(size_t tj = 0; tj < c_b_fhe.size(); ++tj) {
-            for (size_t i = 0; i < forest_server_->n_variables(tj); ++i) {
-                // duplicate everything
-                vector<mpz_class> duplicates(ea.size(), c_b_gm[tj][i]);
-                c_b_fhe[tj].push_back(change_encryption_scheme(duplicates));
-            }
+    metrics_.set_phase("evaluation");
+    t = new ScopedTimer("Server: Evaluation");
+    for(size_t c = 0; c < c_b_fhe.size(); ++c) {
+        if(forest_server_->packed_poly(c).degree() > FHE_L) {
+            cerr << "L parameter of FHE scheme is too small (" << FHE_L << ", but " << forest_server_->packed_poly(c).degree() << " multiplications needed)" << endl;
         }
-        delete t;
+        c_r.push_back(evalPoly_FHE(forest_server_->packed_poly(c), c_b_fhe[c], ea, useShallowCircuit));
+    }
+    delete t;
 
-        // evaluate the polynomial
-        vector<Ctxt> c_r;
+    if(forest_server_->majority_vote()) {
+        cout << "Performing majority vote protocol." << endl;
 
-        t = new ScopedTimer("Server: Evaluation");
-        for(size_t tj = 0; tj < forest_server_->n_trees(); ++tj) {
-            if(forest_server_->model_poly(tj).degree() > FHE_L) {
-                cerr << "L parameter of FHE scheme is too small (" << FHE_L << ", but " << forest_server_->model_poly(tj).degree() << " multiplications needed)" << endl;
+        // change back encryption scheme
+        vector<vector<mpz_class> > c_r_p(forest_server_->n_trees());
+
+        metrics_.set_phase("change_encryption_back");
+        t = new ScopedTimer("Server: Change encryption scheme back");
+        // this part is inefficient, since we probably have encryptions of all slots
+        size_t n_slots = forest_server_->n_classes(); // now only work with those slots we need
+        for (size_t c = 0; c < c_r.size(); ++c) {
+            Ctxt d(c_r[c]);
+            vector<mpz_class> c_slots = change_encryption_scheme_fhe_paillier(d);
+            for (size_t k = 0; k < trees_per_ctxt && c*trees_per_ctxt + k < c_r_p.size(); ++k) {
+                c_r_p[c*trees_per_ctxt + k] = vector<mpz_class>(c_slots.begin() + k*n_slots, c_slots.begin() + (k+1)*n_slots);
             }
-            c_r.push_back(evalPoly_FHE(forest_server_->model_poly(tj), c_b_fhe[tj], ea, useShallowCircuit));
         }
         delete t;
 
-        if(forest_server_->majority_vote()) {
-            cout << "Performing majority vote protocol." << endl;
-
-            // change back encryption scheme
-            vector<vector<mpz_class> > c_r_p(forest_server_->n_trees());
+        assert(forest_server_->n_trees() > 0);
+        // add all values
+        metrics_.set_phase("class_counts");
+        t = new ScopedTimer("Server: Compute class counts");
+        vector<mpz_class> c_p_counts = add_columns(c_r_p, n_slots);
+        delete t;
 
-            t = new ScopedTimer("Server: Change encryption scheme back");
-            // this part is inefficient, since we probably have encryptions of all slots
-            for (size_t tj = 0; tj < c_b_fhe.size(); ++tj) {
-                Ctxt d(c_r[tj]);
-                c_r_p[tj] = change_encryption_scheme_fhe_paillier(d);
-            }
-            delete t;
-
-            assert(forest_server_->n_trees() > 0);
-            size_t n_slots = forest_server_->n_classes(); // now only work with those slots we need
-            // add all values
-            t = new ScopedTimer("Server: Compute class counts");
-            vector<mpz_class> c_p_counts = add_columns(c_r_p, n_slots);
-            delete t;
-
-            // move encryptions to client
-            t = new ScopedTimer("Server: Move encryptions to client");
-            move_paillier_to_client(c_p_counts);
-            delete t;
-
-            // perform argmax
-            t = new ScopedTimer("Server: Reveal argmax to client");
-            Tree_EncArgmax_Helper helper(54 + max_bits(forest_server_->n_trees()), c_p_counts.size(),
-                                         forest_server_->paillier());
-            run_tree_enc_argmax(helper, GC_PROTOCOL);
-            delete t;
-        } else {
-            cout << "Sending plain data." << endl;
-
-            t = new ScopedTimer("Server: Sending results to the client");
-            for (size_t tj = 0; tj < forest_server_->n_trees(); ++tj) {
-                send_fhe_ctxt_to_socket(socket_, c_r[tj]);
-            }
-            delete t;
-        }
+        // move encryptions to client
+        metrics_.set_phase("move_encryptions");
+        t = new ScopedTimer("Server: Move encryptions to client");
+        move_paillier_to_client(c_p_counts);
+        delete t;
 
-#ifdef BENCHMARK
-        cout << "Benchmark: " << GET_BENCHMARK_COMP_TIME << " ms (computation)" << endl;
-        cout << "Benchmark: " << GET_BENCHMARK_NET_TIME << " ms (network)" << endl;
-        cout << IOBenchmark::byte_count() << " exchanged bytes" << endl;
-        cout << IOBenchmark::interaction_count() << " interactions" << endl;
-#endif
+        // perform argmax
+        metrics_.set_phase("argmax");
+        t = new ScopedTimer("Server: Reveal argmax to client");
+        Tree_EncArgmax_Helper helper(54 + max_bits(forest_server_->n_trees()), c_p_counts.size(),
+                                     forest_server_->paillier());
+        run_tree_enc_argmax(helper, GC_PROTOCOL);
+        delete t;
+    } else {
+        cout << "Sending plain data." << endl;
 
-        
-    } catch (std::exception& e) {
-        std::cout << "Exception: " << e.what() << std::endl;
+        metrics_.set_phase("send_results");
+        t = new ScopedTimer("Server: Sending results to the client");
+        for (size_t c = 0; c < c_r.size(); ++c) {
+            send_fhe_ctxt_to_socket(channel_, c_r[c]);
+        }
+        delete t;
     }
-    
-    delete this;
 }
 
 Random_forest_Classifier_Client::Random_forest_Classifier_Client(boost::asio::io_service& io_service, gmp_randstate_t state, unsigned int keysize, vector<long> &query, unsigned int n_nodes, unsigned int n_trees, unsigned int n_classes, bool plurality_vote)
@@ -200,6 +354,13 @@ Random_forest_Classifier_Client::Random_forest_Classifier_Client(boost::asio::io
 
 void Random_forest_Classifier_Client::run()
 {
+    run(vector<vector<long> >(1, query_));
+}
+
+vector<long> Random_forest_Classifier_Client::run(const vector<vector<long> > &queries, size_t batch_size)
+{
+    assert(batch_size > 0);
+    Session_Metrics::Binding metrics_binding(metrics_);
     RESET_BYTE_COUNT
     exchange_keys();
 #ifdef BENCHMARK
@@ -214,26 +375,77 @@ void Random_forest_Classifier_Client::run()
     RESET_BYTE_COUNT
     RESET_BENCHMARK_TIMER
 
-    // send our query encrypted under paillier
-    vector<mpz_class> enc_query(query_.size());
-    for (size_t i = 0; i < query_.size(); i++) {
-        enc_query[i] = paillier_->encrypt(query_[i]);
+    paillier_->set_batch_threads(n_threads_);
+    gm_->set_batch_threads(n_threads_);
+
+    vector<long> results;
+    for (size_t first = 0; first < queries.size(); first += batch_size) {
+        size_t n = min(batch_size, queries.size() - first);
+        Timer batch_timer;
+        double elapsed = 0;
+
+        // send our queries encrypted under paillier
+        metrics_.set_phase("query");
+        vector<vector<mpz_class> > enc_queries(n);
+        for (size_t q = 0; q < n; ++q) {
+            vector<mpz_class> enc_query(queries[first + q].begin(), queries[first + q].end());
+            enc_queries[q] = paillier_->encrypt_batch(enc_query);
+        }
+        send_query_batch(enc_queries);
+
+        // the server computes the criteria for each node of every query and needs our help
+        metrics_.set_phase("compare");
+        t = new ScopedTimer("Client: Compute criteria");
+        // the server tells us how many distinct comparisons it needs and how it runs them
+        unsigned int n_comparisons = readIntFromSocket(channel_).get_ui();
+        if (n_comparisons > n*n_nodes_) {
+            throw std::runtime_error("Server asked for " + to_string(n_comparisons) + " comparisons, at most " + to_string(n*n_nodes_) + " expected");
+        }
+        if (readIntFromSocket(channel_) == 0) {
+            help_batch_enc_comparison_enc_result(n_comparisons, 128);
+        }else{
+            help_pipelined_enc_comparison_enc_result(n_comparisons, 128);
+        }
+        delete t;
+
+        for (size_t q = 0; q < n; ++q) {
+            results.push_back(classify(ea));
+            elapsed += batch_timer.lap_ms();
+            metrics_.add_query_latency(elapsed);
+            cout << "Classification result: " << results.back() << " (" << elapsed << " ms)" << endl;
+        }
     }
+    end_queries();
     
-    send_int_array_to_socket(socket_,enc_query);
-    
-    // the server computes the criteria for each node and needs our help
-    
-    t = new ScopedTimer("Client: Compute criteria");
-    for (unsigned int tj = 0; tj < n_nodes_; ++tj) {
-        // for now, do it over 64 bits
-        help_enc_comparison_enc_result(128, GC_PROTOCOL);
-    }
-    delete t;
+#ifdef BENCHMARK
+    cout << "Benchmark: " << GET_BENCHMARK_COMP_TIME << " ms (computation)" << endl;
+    cout << "Benchmark: " << GET_BENCHMARK_NET_TIME << " ms (network)" << endl;
+    cout << (IOBenchmark::byte_count()/to_kB) << " exchanged kB" << endl;
+    cout << IOBenchmark::interaction_count() << " interactions" << endl;
+#endif
+
+    return results;
+}
 
+long Random_forest_Classifier_Client::classify(const EncryptedArray &ea)
+{
+    ScopedTimer *t;
+
+    metrics_.set_phase("change_encryption");
     t = new ScopedTimer("Client: Change encryption scheme");
     // now he wants the booleans encrypted under FHE
-    for (unsigned int tj = 0; tj < n_nodes_; ++tj) {
+    // (n_nodes_ of them, or less if the server packs several trees per ciphertext)
+    unsigned int n_conversions = readIntFromSocket(channel_).get_ui();
+    unsigned int trees_per_ctxt = readIntFromSocket(channel_).get_ui();
+    if (n_conversions > n_nodes_) {
+        throw std::runtime_error("Server asked for " + to_string(n_conversions) + " conversions, at most " + to_string(n_nodes_) + " expected");
+    }
+    // each tree needs a lane of n_classes_ slots
+    if (trees_per_ctxt < 1 || trees_per_ctxt > ea.size()/n_classes_) {
+        throw std::runtime_error("Server packs " + to_string(trees_per_ctxt) + " trees per ciphertext, between 1 and " + to_string(ea.size()/n_classes_) + " expected");
+    }
+    unsigned int n_ctxts = (n_trees_ + trees_per_ctxt - 1)/trees_per_ctxt;
+    for (unsigned int c = 0; c < n_conversions; ++c) {
         run_change_encryption_scheme_slots_helper();
     }
     delete t;
@@ -243,17 +455,20 @@ void Random_forest_Classifier_Client::run()
     if (plurality_vote_) {
         cout << "Performing majority vote protocol." << endl;
 
+        metrics_.set_phase("change_encryption_back");
         t = new ScopedTimer("Client: Change encryption scheme back");
-        for (unsigned int tj = 0; tj < n_trees_; ++tj) {
+        for (unsigned int c = 0; c < n_ctxts; ++c) {
             run_change_encryption_scheme_fhe_paillier_slots_helper();
         }
         delete t;
 
         // get encryptions from client
+        metrics_.set_phase("move_encryptions");
         t = new ScopedTimer("Client: Move encryptions from client");
         vector<mpz_class> c_p_counts = move_paillier_from_server();
         delete t;
 
+        metrics_.set_phase("argmax");
         t = new ScopedTimer("Client: Compute argmax");
         Tree_EncArgmax_Owner owner(c_p_counts, 54 + max_bits(n_trees_), *server_paillier_, rand_state_);
         v = run_tree_enc_argmax(owner, GC_PROTOCOL);
@@ -261,34 +476,33 @@ void Random_forest_Classifier_Client::run()
     } else {
         cout << "Receiving plain data." << endl;
 
+        metrics_.set_phase("receive_results");
         t = new ScopedTimer("Client: Receiving data from server");
         vector<Ctxt> c_r;
-        for (size_t tj = 0; tj < n_trees_; ++tj) {
-            c_r.push_back(read_fhe_ctxt_from_socket(socket_, *fhe_sk_));
+        for (size_t c = 0; c < n_ctxts; ++c) {
+            c_r.push_back(read_fhe_ctxt_from_socket(channel_, *fhe_sk_));
         }
         delete t;
 
+        metrics_.set_phase("decrypt");
         t = new ScopedTimer("Client: Decrypt result");
+        vector<long> res_bits;
         for (size_t tj = 0; tj < n_trees_; ++tj) {
-            vector<long> res_bits;
-            ea.decrypt(c_r[tj], *fhe_sk_, res_bits);
+            if (tj % trees_per_ctxt == 0) {
+                ea.decrypt(c_r[tj/trees_per_ctxt], *fhe_sk_, res_bits);
+            }
+
+            // the lane of the tree in its ciphertext
+            size_t offset = (tj % trees_per_ctxt)*n_classes_;
+            vector<long> lane(res_bits.begin() + offset, res_bits.begin() + offset + n_classes_);
 
             cout << "Tree " << tj << endl;
-            cout << bitSet_inv(res_bits) << endl;
-            v += bitSet_inv(res_bits);
+            cout << bitSet_inv(lane) << endl;
+            v += bitSet_inv(lane);
         }
         v /= n_trees_;
         delete t;
     }
-    
-#ifdef BENCHMARK
-    cout << "Benchmark: " << GET_BENCHMARK_COMP_TIME << " ms (computation)" << endl;
-    cout << "Benchmark: " << GET_BENCHMARK_NET_TIME << " ms (network)" << endl;
-    cout << (IOBenchmark::byte_count()/to_kB) << " exchanged kB" << endl;
-    cout << IOBenchmark::interaction_count() << " interactions" << endl;
-#endif
 
-    cout << "Classification result: " << v << endl;
+    return v;
 }
-
-
@@ -31,9 +31,13 @@
 #include <net/client.hh>
 #include <net/server.hh>
 
+#include <EncryptedArray.h>
+
 #include <tree/tree.hh>
 #include <tree/m_variate_poly.hh>
+#include <tree/model_store.hh>
 
+#include <map>
 #include <utility>
 
 using namespace std;
@@ -42,7 +46,9 @@ using namespace std;
 
 class Random_forest_Classifier_Server : public Server {
 public:
-    Random_forest_Classifier_Server(gmp_randstate_t state, unsigned int keysize, const vector<Node<long>* > &model, unsigned int n_trees, unsigned int n_classes, vector<unsigned int> n_variables, const vector<vector<pair <long,long> > > &criteria, bool plurality_vote);
+    Random_forest_Classifier_Server(gmp_randstate_t state, unsigned int keysize, const vector<Node<long>* > &model, unsigned int n_trees, unsigned int n_classes, vector<unsigned int> n_variables, const vector<vector<pair <long,long> > > &criteria, bool plurality_vote, unsigned int comparison_window = 0, bool slot_packing = false, bool pad_sharing = true);
+    // model compiled beforehand for the number of slots of the FHE context (see load_compiled_forest)
+    Random_forest_Classifier_Server(gmp_randstate_t state, unsigned int keysize, const Compiled_Forest &model, bool plurality_vote, unsigned int comparison_window = 0, bool pad_sharing = true);
   
     Server_session* create_new_server_session(tcp::socket &socket);
 
@@ -56,15 +62,61 @@ public:
     unsigned int n_trees() const { return n_trees_; }
     unsigned int n_classes() const { return n_classes_; }
     bool majority_vote() const { return plurality_vote_; }
+    // 0: all the comparisons in one batch, k > 0: k pipelined comparisons in flight
+    unsigned int comparison_window() const { return comparison_window_; }
     vector<vector<pair <long,long> >> criteria() const { return criteria_; }
 
+    // with slot packing, the slots of a ciphertext are split in lanes of n_classes() slots,
+    // one per tree: trees_per_ciphertext() trees are converted and evaluated at once.
+    // Otherwise, each tree uses all the slots of its own ciphertexts.
+    bool slot_packing() const { return slot_packing_; }
+    unsigned int trees_per_ciphertext() const { return trees_per_ciphertext_; }
+    unsigned int n_ciphertexts() const { return packed_poly_.size(); }
+    const Multivariate_poly< vector<long> >& packed_poly(const int c) const { return packed_poly_[c]; }
+    // number of node variables of ciphertext c, the maximum over its trees
+    unsigned int packed_n_variables(const int c) const { return packed_n_variables_[c]; }
+
+    // the criteria are compiled into a set of distinct (feature, threshold) pairs:
+    // each of them is compared once per query and its bit is shared by every node
+    // using it. Likewise, conversions with the same comparison in every lane are
+    // done once.
+    // The client learns how many comparisons and conversions are run, hence how
+    // much the trees share their criteria. Unless pad_sharing() is false, both
+    // are padded with dummies up to one per node variable, so that they only
+    // depend on the shape of the forest, at the cost of the savings above.
+    bool pad_sharing() const { return pad_sharing_; }
+    const vector<pair <long,long> >& comparisons() const { return comparisons_; }
+    // features a query must have: the largest feature compared, plus one
+    size_t query_size() const { return query_size_; }
+    size_t comparison_index(const int tree, const int i) const { return comparison_index_[tree][i]; }
+    // total number of ciphertexts converted from GM to FHE
+    unsigned int n_conversions() const { return conversion_lanes_.size(); }
+    // comparison of each lane of conversion k (a single lane without slot packing)
+    const vector<size_t>& conversion_lanes(const size_t k) const { return conversion_lanes_[k]; }
+    // conversion carrying variable i of ciphertext c
+    size_t conversion_index(const int c, const int i) const { return conversion_index_[c][i]; }
+
 protected:
+    void set_model(const Compiled_Forest &model);
+    void compile_comparisons();
+
     vector<Multivariate_poly< vector<long> > > model_poly_;
-    const vector<unsigned int> n_variables_;
-    const unsigned int n_trees_;
-    const unsigned int n_classes_;
+    vector<unsigned int> n_variables_;
+    unsigned int n_trees_;
+    unsigned int n_classes_;
     const bool plurality_vote_;
+    const unsigned int comparison_window_;
+    const bool pad_sharing_;
     vector<vector<pair <long,long> > > criteria_;
+    bool slot_packing_;
+    unsigned int trees_per_ciphertext_;
+    vector<Multivariate_poly< vector<long> > > packed_poly_;
+    vector<unsigned int> packed_n_variables_;
+    vector<pair <long,long> > comparisons_;
+    size_t query_size_;
+    vector<vector<size_t> > comparison_index_;
+    vector<vector<size_t> > conversion_lanes_;
+    vector<vector<size_t> > conversion_index_;
 };
 
 
@@ -77,6 +129,10 @@ public:
     void run_session();
     
 protected:
+    /* encrypted comparison bits of each query, indexed as comparisons() */
+    vector<vector<mpz_class> > compare(const vector<vector<mpz_class> > &queries);
+    void classify(const vector<mpz_class> &c_b_gm, const EncryptedArray &ea);
+
     Random_forest_Classifier_Server *forest_server_;
 };
 
@@ -85,9 +141,16 @@ public:
     Random_forest_Classifier_Client(boost::asio::io_service& io_service, gmp_randstate_t state, unsigned int keysize, vector<long> &query, unsigned int n_nodes, unsigned int n_trees,
                                     unsigned int n_classes, bool plurality_vote);
     
+    /* classifies the query given to the constructor */
     void run();
+    /* classifies every query in a single session, batch_size of them at a
+     * time: the comparisons of a batch are run together. Per-query
+     * latencies are recorded in metrics(). */
+    vector<long> run(const vector<vector<long> > &queries, size_t batch_size = 1);
     
 protected:
+    long classify(const EncryptedArray &ea);
+
     vector<long> query_;
     unsigned int n_nodes_;
     const unsigned int n_classes_;
@@ -61,7 +61,7 @@ static vector<long> gen_ecg_query()
 
 }
 
-static void test_tree_classifier_client(const string &hostname)
+static void test_tree_classifier_client(const string &hostname, size_t n_queries, size_t batch_size)
 {
     try
     {
@@ -90,10 +90,16 @@ static void test_tree_classifier_client(const string &hostname)
         
 //        vector<long> query_bits = bitDecomp(query, N_LEVELS);
         Random_forest_Classifier_Client client(io_service, randstate,1248,query,n_nodes,n_trees, 6, true);
+        client.set_fixed_base_randomizers(true);
         
         client.connect(io_service, hostname);
         
-        client.run();
+        if (n_queries == 1) {
+            client.run();
+        } else {
+            // several queries in the same session
+            client.run(vector<vector<long> >(n_queries, query), batch_size);
+        }
         
 //        client.disconnect();
         
@@ -107,15 +113,21 @@ static void test_tree_classifier_client(const string &hostname)
 
 int main(int argc, char* argv[])
 {
-    if (argc != 2)
+    if (argc < 2 || argc > 4)
     {
-        std::cerr << "Usage: client <host>" << std::endl;
+        std::cerr << "Usage: client <host> [n_queries] [batch_size]" << std::endl;
         return 1;
     }
     string hostname(argv[1]);
+    size_t n_queries = (argc > 2) ? atoi(argv[2]) : 1;
+    size_t batch_size = (argc > 3) ? atoi(argv[3]) : 1;
+    if (n_queries == 0 || batch_size == 0) {
+        std::cerr << "n_queries and batch_size must be positive" << std::endl;
+        return 1;
+    }
     srand(time(NULL));
 
-    test_tree_classifier_client(hostname);
+    test_tree_classifier_client(hostname, n_queries, batch_size);
     
     return 0;
 }
\ No newline at end of file
@@ -74,7 +74,7 @@ static Node<long>* model_ecg2(vector<pair <long,long> > &criteria )
     return new Node<long>(0, n_left, n_right);
 }
 
-static void test_tree_classifier_server()
+static void test_tree_classifier_server(const char *metrics_path)
 {
     gmp_randstate_t randstate;
     gmp_randinit_default(randstate);
@@ -110,14 +110,53 @@ static void test_tree_classifier_server()
 
     cout << "Init server" << endl;
     Random_forest_Classifier_Server server(randstate,1248,trees,trees.size(),6,n_nodes, criteria, true);
+    if (metrics_path) {
+        server.set_metrics_sink(make_shared<JSON_Lines_Metrics_Sink>(metrics_path));
+    }
     
     cout << "Start server" << endl;
     server.run();
 }
 
-int main()
+static void test_compiled_forest_server(const char *metrics_path, const char *model_path)
+{
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+
+#ifdef BENCHMARK
+    cout << "BENCHMARK flag set" << endl;
+    BENCHMARK_INIT
+#endif
+
+    Compiled_Forest model;
+    if (!load_compiled_forest(model, model_path)) {
+        cerr << "Unable to load the compiled forest " << model_path << endl;
+        exit(1);
+    }
+    cout << "Loaded " << model.n_trees() << " trees, " << model.n_classes << " classes" << endl;
+
+    cout << "Init server" << endl;
+    Random_forest_Classifier_Server server(randstate,1248,model, true);
+    if (metrics_path) {
+        server.set_metrics_sink(make_shared<JSON_Lines_Metrics_Sink>(metrics_path));
+    }
+
+    cout << "Start server" << endl;
+    server.run();
+}
+
+int main(int argc, char* argv[])
 {    
-    test_tree_classifier_server();
+    // optional: file receiving the metrics of each session as JSON lines ("-" for none)
+    const char *metrics_path = (argc > 1 && string(argv[1]) != "-") ? argv[1] : NULL;
+
+    if (argc > 2) {
+        // model produced by compile_forest instead of the ECG trees
+        test_compiled_forest_server(metrics_path, argv[2]);
+    }else{
+        test_tree_classifier_server(metrics_path);
+    }
     
     return 0;
 }
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <crypto/batch.hh>
+
+#include <algorithm>
+
+using namespace std;
+
+void run_batch(unsigned int n_lanes, size_t n, const Batch_Job &job)
+{
+    if (n_lanes < 2 || n < 2) {
+        job(0, n);
+        return;
+    }
+    size_t m = (n + n_lanes - 1)/n_lanes;
+
+    Task_Group group;
+    // the calling thread takes the first range
+    for (size_t i_start = m; i_start < n; i_start += m) {
+        size_t i_end = min<size_t>(i_start + m, n);
+        group.run([&job, i_start, i_end]() { job(i_start, i_end); });
+    }
+    job(0, min<size_t>(m, n));
+    group.wait();
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <functional>
+
+#include <math/mpz_class.hh>
+#include <util/executor.hh>
+
+/*
+ * Splits the indices [0,n) of a batch of independent operations into at most
+ * n_lanes contiguous ranges, runs them as tasks of the process-wide executor
+ * and waits for all of them. With a single lane (or a single element), the
+ * whole batch runs in the calling thread.
+ *
+ * The jobs draw their randomness from the state of the thread running them
+ * (see thread_randstate). Batches can be nested: the waiting thread runs
+ * queued tasks meanwhile.
+ */
+typedef std::function<void(size_t begin, size_t end)> Batch_Job;
+
+void run_batch(unsigned int n_lanes, size_t n, const Batch_Job &job);
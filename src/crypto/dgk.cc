@@ -0,0 +1,258 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <assert.h>
+#include <chrono>
+#include <crypto/dgk.hh>
+#include <math/util_gmp_rand.h>
+#include <math/math_util.hh>
+
+using namespace std;
+
+#define DGK_WINDOW 4
+// zero tests timed when a private key is loaded: the fastest of a few runs
+#define DGK_ZERO_TEST_RUNS 4
+#define DGK_ZERO_TEST_SAMPLES 8
+
+/*
+ * Public-key operations
+ */
+
+DGK::DGK(const vector<mpz_class> &pk)
+    : n(pk[0]), g(pk[1]), h(pk[2]), u(pk[3]), t(pk[4].get_ui()),
+      rbits((5*t+1)/2), batch_lanes(1)
+{
+    assert(pk.size() == 5);
+    h_table = make_shared<FixedBaseWindowExp>(h, n, rbits, DGK_WINDOW);
+}
+
+mpz_class
+DGK::reduce(const mpz_class &plaintext) const
+{
+    mpz_class m;
+    mpz_fdiv_r(m.get_mpz_t(), plaintext.get_mpz_t(), u.get_mpz_t());
+    return m;
+}
+
+mpz_class
+DGK::randomizer(gmp_randstate_t state) const
+{
+    mpz_class r;
+    mpz_urandomb(r.get_mpz_t(),state,rbits);
+    return h_table->pow(r);
+}
+
+mpz_class
+DGK::encrypt(const mpz_class &plaintext, gmp_randstate_t state) const
+{
+    return (mpz_class_powm(g,reduce(plaintext),n) * randomizer(state)) % n;
+}
+
+mpz_class
+DGK::add(const mpz_class &c0, const mpz_class &c1) const
+{
+    return (c0*c1) % n;
+}
+
+mpz_class
+DGK::sub(const mpz_class &c0, const mpz_class &c1) const
+{
+    return (c0*mpz_class_invert(c1, n)) % n;
+}
+
+mpz_class
+DGK::constMult(const mpz_class &m, const mpz_class &c) const
+{
+    return mpz_class_powm(c, m, n);
+}
+
+mpz_class
+DGK::constMult(long m, const mpz_class &c) const
+{
+    return mpz_class_powm(c, m, n);
+}
+
+mpz_class
+DGK::scalarize(const mpz_class &c) const
+{
+    // u is prime: any r in [1,u) is invertible
+    mpz_class r;
+    mpz_class u_1 = u-1;
+    mpz_urandomm(r.get_mpz_t(),thread_randstate(),u_1.get_mpz_t());
+
+    mpz_class c_r = constMult(r+1,c);
+    refresh(c_r);
+    return c_r;
+}
+
+void DGK::refresh(mpz_class &c) const
+{
+    c = c*randomizer(thread_randstate()) % n;
+}
+
+mpz_class DGK::random_encryption() const
+{
+    // unlike Paillier, a random element of Z_n* decrypts to 0 with
+    // probability 1/u, which is not negligible
+    mpz_class m;
+    mpz_class u_1 = u-1;
+    mpz_urandomm(m.get_mpz_t(),thread_randstate(),u_1.get_mpz_t());
+
+    return encrypt(m+1);
+}
+
+void DGK::set_batch_threads(unsigned int n)
+{
+    batch_lanes = (n < 2) ? 1 : n;
+}
+
+vector<mpz_class> DGK::encrypt_batch(const vector<mpz_class> &plaintexts) const
+{
+    vector<mpz_class> c(plaintexts.size());
+    
+    run_batch(batch_lanes, plaintexts.size(), [this,&plaintexts,&c](size_t i_start, size_t i_end) {
+        for (size_t i = i_start; i < i_end; i++) {
+            c[i] = encrypt(plaintexts[i]);
+        }
+    });
+    
+    return c;
+}
+
+/*
+ * Private-key operations
+ */
+
+// element of Z_p* of order exactly ord = v1*v2 (v1 and v2 prime, v2 = 1 allowed)
+static mpz_class
+element_of_order(gmp_randstate_t state, const mpz_class &p, const mpz_class &v1, const mpz_class &v2)
+{
+    mpz_class x, ord = v1*v2;
+    for (;;) {
+        mpz_urandomm(x.get_mpz_t(),state,p.get_mpz_t());
+        if (x < 2) {
+            continue;
+        }
+        x = mpz_class_powm(x,(p-1)/ord,p);
+        if (mpz_class_powm(x,v2,p) != 1 && (v2 == 1 || mpz_class_powm(x,v1,p) != 1)) {
+            return x;
+        }
+    }
+}
+
+DGK_priv::DGK_priv(const vector<mpz_class> &sk)
+    : DGK({sk[0]*sk[1], sk[4], sk[5], sk[6], sk[7]}),
+      p(sk[0]), q(sk[1]), vp(sk[2]), vq(sk[3]),
+      g_p(g % p), g_q(g % q), h_p(h % p), h_q(h % q),
+      g_vp(mpz_class_powm(g_p, vp, p)), zero_test_ms_(0)
+{
+    assert(sk.size() == 8);
+
+    // any element of Z_n costs the same
+    mpz_class c = g*h % n;
+    for (int k = 0; k < DGK_ZERO_TEST_RUNS; k++) {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < DGK_ZERO_TEST_SAMPLES; i++) {
+            is_zero(c);
+        }
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()/DGK_ZERO_TEST_SAMPLES;
+        zero_test_ms_ = (k == 0) ? ms : min(zero_test_ms_, ms);
+    }
+}
+
+mpz_class
+DGK_priv::encrypt(const mpz_class &plaintext, gmp_randstate_t state) const
+{
+    // h has order vp mod p and vq mod q: the exponents are reduced accordingly
+    mpz_class m = reduce(plaintext);
+    mpz_class r_p, r_q;
+    mpz_urandomm(r_p.get_mpz_t(),state,vp.get_mpz_t());
+    mpz_urandomm(r_q.get_mpz_t(),state,vq.get_mpz_t());
+
+    mpz_class c_p = mpz_class_powm(g_p,m,p) * mpz_class_powm(h_p,r_p,p) % p;
+    mpz_class c_q = mpz_class_powm(g_q,m,q) * mpz_class_powm(h_q,r_q,q) % q;
+
+    return mpz_class_crt_2(c_p,c_q,p,q);
+}
+
+bool
+DGK_priv::is_zero(const mpz_class &c) const
+{
+    // c^vp = g^(vp m) mod p, and g^vp has order u
+    return mpz_class_powm(c % p, vp, p) == 1;
+}
+
+mpz_class
+DGK_priv::decrypt(const mpz_class &c) const
+{
+    mpz_class x = mpz_class_powm(c % p, vp, p);
+    mpz_class y = 1;
+
+    for (mpz_class m = 0; m < u; m++) {
+        if (x == y) {
+            return m;
+        }
+        y = (y*g_vp) % p;
+    }
+    assert(false);
+    return -1;
+}
+
+// p = 2 u v k + 1 of nbits bits, for a random k
+static mpz_class
+dgk_prime(gmp_randstate_t state, unsigned int nbits, const mpz_class &u, const mpz_class &v)
+{
+    mpz_class step = 2*u*v, k, p;
+    unsigned int kbits = nbits - mpz_sizeinbase(step.get_mpz_t(),2);
+
+    mpz_urandom_len(k.get_mpz_t(), state, kbits);
+    p = step * k + 1;
+    while (mpz_probab_prime_p(p.get_mpz_t(),40) == 0) {
+        p += step;
+    }
+    return p;
+}
+
+std::vector<mpz_class>
+DGK_priv::keygen(gmp_randstate_t state, unsigned int nbits, unsigned int t, unsigned int ubits)
+{
+    assert(nbits/2 > ubits + t + 2);
+
+    // u only has to be a prime larger than the values compared: it is public
+    mpz_class u, vp, vq, p, q, n;
+    mpz_class u_min = 1;
+    u_min <<= ubits-1;
+    mpz_nextprime(u.get_mpz_t(), u_min.get_mpz_t());
+
+    do {
+        mpz_random_prime_len(vp.get_mpz_t(), state, t, 40);
+        mpz_random_prime_len(vq.get_mpz_t(), state, t, 40);
+        p = dgk_prime(state, nbits/2, u, vp);
+        q = dgk_prime(state, nbits/2, u, vq);
+        n = p * q;
+    } while ((nbits != (unsigned int) mpz_sizeinbase(n.get_mpz_t(),2)) || p == q || vp == vq);
+
+    // g of order u vp vq, h of order vp vq
+    mpz_class g = mpz_class_crt_2(element_of_order(state, p, u, vp), element_of_order(state, q, u, vq), p, q);
+    mpz_class h = mpz_class_crt_2(element_of_order(state, p, vp, 1), element_of_order(state, q, vq, 1), p, q);
+
+    return { p, q, vp, vq, g, h, u, t };
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <math/mpz_class.hh>
+#include <math/math_util.hh>
+#include <crypto/batch.hh>
+#include <crypto/thread_randstate.hh>
+
+/*
+ * Damgard-Geisler-Kroigaard cryptosystem (additively homomorphic, small
+ * plaintext space Z_u).
+ *
+ * n = pq with u | p-1, q-1 and two t-bit primes vp | p-1, vq | q-1.
+ * g has order u vp vq, h has order vp vq, and E(m) = g^m h^r mod n for a
+ * random r of 2.5t bits. Plaintexts are defined mod u, so the homomorphic
+ * operations are too.
+ * With the factorization, checking that a ciphertext encrypts 0 only takes
+ * c^vp mod p: this is what the DGK comparison protocol needs.
+ *
+ * As for Paillier, the keys are immutable, not copyable, and draw their
+ * randomness from the state of the calling thread.
+ */
+class DGK {
+ public:
+    DGK(const std::vector<mpz_class> &pk);
+    virtual ~DGK() {}
+    DGK(const DGK&) = delete;
+    DGK &operator=(const DGK &) = delete;
+    std::vector<mpz_class> pubkey() const { return { n, g, h, u, t }; }
+
+    const mpz_class& plaintext_modulus() const { return u; }
+
+    mpz_class encrypt(const mpz_class &plaintext) const { return encrypt(plaintext, thread_randstate()); }
+    mpz_class add(const mpz_class &c0, const mpz_class &c1) const;
+    mpz_class sub(const mpz_class &c0, const mpz_class &c1) const;
+    mpz_class constMult(const mpz_class &m, const mpz_class &c) const;
+    mpz_class constMult(long m, const mpz_class &c) const;
+    mpz_class constMult(const mpz_class &c, long m) const { return constMult(m,c); };
+    /* multiplies the plaintext by a random non-zero element of Z_u and
+     * rerandomizes: 0 stays 0, anything else becomes random */
+    mpz_class scalarize(const mpz_class &c) const;
+    void refresh(mpz_class &c) const;
+    /* encryption of a random non-zero plaintext */
+    mpz_class random_encryption() const;
+
+    /* see Paillier */
+    std::vector<mpz_class> encrypt_batch(const std::vector<mpz_class> &plaintexts) const;
+    void set_batch_threads(unsigned int n);
+    unsigned int batch_threads() const { return batch_lanes; }
+
+ protected:
+    virtual mpz_class encrypt(const mpz_class &plaintext, gmp_randstate_t state) const;
+
+    /* plaintext reduced in [0,u) */
+    mpz_class reduce(const mpz_class &plaintext) const;
+    /* h^r mod n for a random r */
+    mpz_class randomizer(gmp_randstate_t state) const;
+
+    /* Public key */
+    const mpz_class n, g, h, u;
+    const unsigned int t;
+
+    /* Cached values */
+    const unsigned int rbits;
+    std::shared_ptr<const FixedBaseWindowExp> h_table;
+
+    unsigned int batch_lanes;
+};
+
+class DGK_priv : public DGK {
+ public:
+    DGK_priv(const std::vector<mpz_class> &sk);
+    std::vector<mpz_class> privkey() const { return { p, q, vp, vq, g, h, u, t }; }
+
+    using DGK::encrypt;
+
+    bool is_zero(const mpz_class &c) const;
+    /* time is_zero takes, in ms, measured once when the key is loaded */
+    double zero_test_ms() const { return zero_test_ms_; }
+    /* full decryption, linear in u: only meant for small plaintext spaces */
+    mpz_class decrypt(const mpz_class &c) const;
+
+    static std::vector<mpz_class> keygen(gmp_randstate_t state, unsigned int nbits = 1024, unsigned int t = 160, unsigned int ubits = 16);
+
+ protected:
+    // CRT encryption, much faster than the public one
+    mpz_class encrypt(const mpz_class &plaintext, gmp_randstate_t state) const;
+
+    /* Private key */
+    const mpz_class p, q, vp, vq;
+
+    /* Cached values */
+    const mpz_class g_p, g_q, h_p, h_q;
+    const mpz_class g_vp; /* g^vp mod p, of order u */
+    double zero_test_ms_;
+};
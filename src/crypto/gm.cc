@@ -22,51 +22,40 @@
 #include <crypto/gm.hh>
 #include <math/util_gmp_rand.h>
 
+#include <algorithm>
 #include <iostream>
 
 using namespace std;
 
-GM::GM(const vector<mpz_class> &pk, gmp_randstate_t state) : N(pk[0]), y(pk[1])
+static mpz_class gm_randomizer(const mpz_class &N, gmp_randstate_t state)
+{
+    mpz_class r;
+    do {
+        mpz_urandomm(r.get_mpz_t(),state,N.get_mpz_t());
+    } while (mpz_class_gcd(r,N) != 1);
+    
+    return mpz_class_powm_ui(r,2,N);
+}
+
+GM::GM(const vector<mpz_class> &pk, gmp_randstate_t state) : N(pk[0]), y(pk[1]), batch_lanes(1)
 {
     assert(pk.size() == 2);
-    gmp_randinit_set(_randstate, state);
+    
+    mpz_class mod = N;
+    rpool = make_shared<Randomness_Pool>(N, [mod](gmp_randstate_t s){ return gm_randomizer(mod, s); }, state);
 }
 
 void
-GM::rand_gen(size_t niter, size_t nmax)
+GM::rand_gen(size_t niter, size_t nmax) const
 {
-    if (rqueue.size() >= nmax)
-        niter = 0;
-    else
-        niter = min(niter, nmax - rqueue.size());
-    
-    for (size_t i = 0; i < niter; i++) {
-        
-        mpz_class r;
-        
-        do {
-            mpz_urandomm(r.get_mpz_t(),_randstate,N.get_mpz_t());
-        } while (mpz_class_gcd(r,N) != 1);
-        
-        rqueue.push_back(mpz_class_powm_ui(r,2,N));
-    }
+    rpool->fill(niter, nmax);
 }
 
-mpz_class GM::encrypt(const bool &bit)
+mpz_class GM::encrypt(const bool &bit) const
 {
     mpz_class r2;
-    auto i = rqueue.begin();
-    if (i != rqueue.end()) {
-        r2 = *i;
-        rqueue.pop_front();
-        
-    } else {
-        mpz_class r;
-        do {
-            mpz_urandomm(r.get_mpz_t(),_randstate,N.get_mpz_t());
-        } while (mpz_class_gcd(r,N) != 1);
-        
-        r2 = mpz_class_powm_ui(r,2,N);
+    if (!rpool->pop(r2)) {
+        r2 = gm_randomizer(N, thread_randstate());
     }
     
     if (bit) {
@@ -76,35 +65,30 @@ mpz_class GM::encrypt(const bool &bit)
     return r2;
 }
 
-mpz_class GM::reRand(const mpz_class &c)
+mpz_class GM::reRand(const mpz_class &c) const
 {
     mpz_class r2;
-    auto i = rqueue.begin();
-    if (i != rqueue.end()) {
-        r2 = *i;
-        rqueue.pop_front();
-        
-    } else {
-        mpz_class r;
-        do {
-            mpz_urandomm(r.get_mpz_t(),_randstate,N.get_mpz_t());
-        } while (mpz_class_gcd(r,N) != 1);
-        
-        r2 = mpz_class_powm_ui(r,2,N);
+    if (!rpool->pop(r2)) {
+        r2 = gm_randomizer(N, thread_randstate());
     }
     
     return (r2 * c)%N;
 }
 
-mpz_class GM::XOR(const mpz_class &c1, const mpz_class &c2)
+mpz_class GM::XOR(const mpz_class &c1, const mpz_class &c2) const
 {
     return (c1 * c2)%N;
 }
-mpz_class GM::neg(const mpz_class &c)
+mpz_class GM::neg(const mpz_class &c) const
 {
     return (c*y)%N;
 }
 
+void GM::set_batch_threads(unsigned int n)
+{
+    batch_lanes = (n < 2) ? 1 : n;
+}
+
 GM_priv::GM_priv(const vector<mpz_class> &sk, gmp_randstate_t state) : GM({sk[0],sk[1]},state), p(sk[2]), q(sk[3]), pMinOneBy2((p-1)/2), qMinOneBy2((q-1)/2)
 {
     assert(sk.size() == 4);
@@ -113,7 +97,7 @@ GM_priv::GM_priv(const vector<mpz_class> &sk, gmp_randstate_t state) : GM({sk[0]
 bool GM_priv::decrypt_fast(const mpz_class &ciphertext) const
 {
     mpz_class cp = ciphertext % p;
-    return ( mpz_class_powm(cp,pMinOneBy2,p) == 1);
+    return (mpz_legendre(cp.get_mpz_t(), p.get_mpz_t()) == -1);
 }
 
 bool GM_priv::decrypt(const mpz_class &ciphertext) const
@@ -121,7 +105,44 @@ bool GM_priv::decrypt(const mpz_class &ciphertext) const
     mpz_class cp = ciphertext % p;
     mpz_class cq = ciphertext % q;
     
-    return ( mpz_class_powm(cp,pMinOneBy2,p) != 1)&&( mpz_class_powm(cq,pMinOneBy2,q) != 1);
+    return ( mpz_class_powm(cp,pMinOneBy2,p) != 1)&&( mpz_class_powm(cq,qMinOneBy2,q) != 1);
+}
+
+vector<bool> GM_priv::decrypt_batch(const vector<mpz_class> &ciphertexts) const
+{
+    // the blinded ciphertexts of the slots of a node only take two values:
+    // sort them to decrypt each distinct one once
+    vector<size_t> order(ciphertexts.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&ciphertexts](size_t i, size_t j) { return ciphertexts[i] < ciphertexts[j]; });
+    
+    vector<size_t> distinct;
+    for (size_t k = 0; k < order.size(); k++) {
+        if (k == 0 || ciphertexts[order[k]] != ciphertexts[order[k-1]]) {
+            distinct.push_back(order[k]);
+        }
+    }
+    
+    // not a vector<bool>: the threads write to adjacent elements
+    vector<char> distinct_bits(distinct.size());
+    run_batch(batch_lanes, distinct.size(), [this,&ciphertexts,&distinct,&distinct_bits](size_t i_start, size_t i_end) {
+        for (size_t i = i_start; i < i_end; i++) {
+            distinct_bits[i] = decrypt_fast(ciphertexts[distinct[i]]);
+        }
+    });
+    
+    vector<bool> bits(ciphertexts.size());
+    size_t d = 0;
+    for (size_t k = 0; k < order.size(); k++) {
+        if (k > 0 && ciphertexts[order[k]] != ciphertexts[order[k-1]]) {
+            d++;
+        }
+        bits[order[k]] = distinct_bits[d];
+    }
+    
+    return bits;
 }
 
 
@@ -21,32 +21,46 @@
 #pragma once
 
 #include <math/mpz_class.hh>
+#include <crypto/randomness_pool.hh>
+#include <crypto/batch.hh>
+#include <crypto/thread_randstate.hh>
 
 #include <vector>
-#include <list>
+#include <memory>
 #include <utility>
 
+/* shared and not copyable, like the Paillier keys */
 class GM {
 public:
+    /* state only seeds the randomness pool */
     GM(const std::vector<mpz_class> &pk, gmp_randstate_t state);
+    virtual ~GM() {}
+    GM(const GM&) = delete;
+    GM &operator=(const GM &) = delete;
     std::vector<mpz_class> pubkey() const { return {N, y}; }
     
-    mpz_class encrypt(const bool &bit);
-    mpz_class reRand(const mpz_class &c);
-    mpz_class XOR(const mpz_class &c1, const mpz_class &c2);
-    mpz_class neg(const mpz_class &c);
+    mpz_class encrypt(const bool &bit) const;
+    mpz_class reRand(const mpz_class &c) const;
+    mpz_class XOR(const mpz_class &c1, const mpz_class &c2) const;
+    mpz_class neg(const mpz_class &c) const;
     
-    void rand_gen(size_t niter = 100, size_t nmax = 1000);
+    void rand_gen(size_t niter = 100, size_t nmax = 1000) const;
+
+    /* precomputed r^2 mod N, see Randomness_Pool */
+    Randomness_Pool& randomness_pool() const { return *rpool; }
+
+    /* parallelism of the batch operations, see Paillier */
+    void set_batch_threads(unsigned int n);
+    unsigned int batch_threads() const { return batch_lanes; }
 
 protected:
     /* Public key */
     const mpz_class N, y;
     
-    /* Randomness state */
-    gmp_randstate_t _randstate;
-    
     /* Pre-computed randomness */
-    std::list< mpz_class > rqueue;
+    std::shared_ptr<Randomness_Pool> rpool;
+
+    unsigned int batch_lanes;
 };
 
 class GM_priv : public GM {
@@ -54,8 +68,12 @@ public:
     GM_priv(const std::vector<mpz_class> &sk, gmp_randstate_t state);
     std::vector<mpz_class> privkey() const { return { p, q }; }
     
+    /* quadratic residuosity mod p only, with the Legendre symbol instead of
+     * Euler's criterion: y is a non-residue mod both factors */
     bool decrypt_fast(const mpz_class &ciphertext) const;
     bool decrypt(const mpz_class &ciphertext) const;
+    /* decrypt_fast on each distinct ciphertext, split like the Paillier batches */
+    std::vector<bool> decrypt_batch(const std::vector<mpz_class> &ciphertexts) const;
 
     static std::vector<mpz_class> keygen(gmp_randstate_t randstate, unsigned int nbits = 1024);
 
@@ -20,6 +20,7 @@
  */
 
 #include <assert.h>
+#include <mutex>
 #include <crypto/paillier.hh>
 #include <math/util_gmp_rand.h>
 #include <math/math_util.hh>
@@ -32,38 +33,80 @@ using namespace NTL;
  * Public-key operations
  */
 
+// r^n mod n^2 for a random r, or g^(n r) when g_n = g^n is not 0: with the
+// fast keys (a != 0), decryption only cancels the randomizers of <g^n>
+static mpz_class
+paillier_randomizer(const mpz_class &n, const mpz_class &n2, const mpz_class &g_n, gmp_randstate_t state)
+{
+    mpz_class r;
+    mpz_urandomm(r.get_mpz_t(),state,n.get_mpz_t());
+    if (g_n == 0) {
+        return mpz_class_powm(r,n,n2);
+    }
+    return mpz_class_powm(g_n,r,n2);
+}
+
 Paillier::Paillier(const vector<mpz_class> &pk, gmp_randstate_t state)
     : n(pk[0]), g(pk[1]),
-      nbits(mpz_sizeinbase(n.get_mpz_t(),2)), n2(n*n), good_generator(g == n+1)
+      nbits(mpz_sizeinbase(n.get_mpz_t(),2)), n2(n*n), good_generator(g == n+1),
+      g_n(good_generator ? mpz_class(0) : mpz_class_powm(g,n,n2)), batch_lanes(1)
 {
     assert(pk.size() == 2);
-    gmp_randinit_set(_randstate, state);
+
+    mpz_class mod = n, mod2 = n2, base = g_n;
+    rpool = make_shared<Randomness_Pool>(n2, [mod,mod2,base](gmp_randstate_t s){ return paillier_randomizer(mod, mod2, base, s); }, state);
 }
 
 void
-Paillier::rand_gen(size_t niter, size_t nmax)
+Paillier::rand_gen(size_t niter, size_t nmax) const
 {
-    if (rqueue.size() >= nmax)
-        niter = 0;
-    else
-        niter = min(niter, nmax - rqueue.size());
+    rpool->fill(niter, nmax);
+}
 
-    mpz_class r;
-    for (uint i = 0; i < niter; i++) {
-        mpz_urandomm(r.get_mpz_t(),_randstate,n.get_mpz_t());
+static mpz_class
+fixed_base_randomizer(const FixedBaseWindowExp &h, gmp_randstate_t state)
+{
+    mpz_class x;
+    mpz_urandomb(x.get_mpz_t(),state,h.exp_bits());
+    return h.pow(x);
+}
 
-        rqueue.push_back(mpz_class_powm(g,n*r,n2));
+void
+Paillier::enable_fixed_base_randomizers(unsigned int exp_bits, unsigned int window)
+{
+    if (exp_bits == 0) {
+        exp_bits = (nbits+1)/2;
+    }
+    
+    // with a fast key, g^n generates the whole group of the randomizers
+    mpz_class h = g_n;
+    while (h <= 1) {
+        h = paillier_randomizer(n, n2, g_n, thread_randstate());
     }
+    
+    shared_ptr<const FixedBaseWindowExp> table = make_shared<FixedBaseWindowExp>(h, n2, exp_bits, window);
+    fixed_base = table;
+    rpool = make_shared<Randomness_Pool>(n2, [table](gmp_randstate_t s){ return fixed_base_randomizer(*table, s); }, thread_randstate());
 }
 
-mpz_class
-Paillier::encrypt(const mpz_class &plaintext)
+bool
+Paillier::next_randomizer(mpz_class &rn, gmp_randstate_t state) const
 {
-    auto i = rqueue.begin();
-    if (i != rqueue.end()) {
-        mpz_class rn = *i;
-        rqueue.pop_front();
+    if (rpool->pop(rn)) {
+        return true;
+    }
+    if (fixed_base) {
+        rn = fixed_base_randomizer(*fixed_base, state);
+        return true;
+    }
+    return false;
+}
 
+mpz_class
+Paillier::encrypt(const mpz_class &plaintext, gmp_randstate_t state) const
+{
+    mpz_class rn;
+    if (next_randomizer(rn, state)) {
         if (good_generator) {
             // g = n+1 -> we can avoid an exponentiation
             return ((1+plaintext*n)*rn) %n2;
@@ -72,7 +115,7 @@ Paillier::encrypt(const mpz_class &plaintext)
         return (mpz_class_powm(g,plaintext,n2) * rn) % n2;
     } else {
         mpz_class r;
-        mpz_urandomm(r.get_mpz_t(),_randstate,n.get_mpz_t());
+        mpz_urandomm(r.get_mpz_t(),state,n.get_mpz_t());
 
         if (good_generator) {
             r = mpz_class_powm(r,n,n2);
@@ -119,74 +162,111 @@ Paillier::constXor(bool b, const mpz_class &c) const
 }
 
 mpz_class
-Paillier::scalarize(const mpz_class &c)
+Paillier::scalarize(const mpz_class &c) const
 {
     mpz_class r;
-    mpz_urandomm(r.get_mpz_t(),_randstate,n.get_mpz_t());
+    mpz_urandomm(r.get_mpz_t(),thread_randstate(),n.get_mpz_t());
     // here, we should multiply by r when r is coprime with n
     // to save time, as this will not happen with negligible probability,
     // we don't test this property
     return constMult(r,c);
 }
 
-void Paillier::refresh(mpz_class &c)
+void Paillier::refresh(mpz_class &c) const
 {
     mpz_class rn;
-    auto i = rqueue.begin();
-    if (i != rqueue.end()) {
-        rn = *i;
-        rqueue.pop_front();
-        
-    } else {
-        mpz_class r;
-        mpz_urandomm(r.get_mpz_t(),_randstate,n.get_mpz_t());
-        rn = mpz_class_powm(r,n,n2);
+    if (!next_randomizer(rn, thread_randstate())) {
+        rn = paillier_randomizer(n, n2, g_n, thread_randstate());
     }
     c = c*rn %n2;
 }
 
-mpz_class Paillier::random_encryption()
+mpz_class Paillier::random_encryption() const
 {
     mpz_class r;
-    mpz_urandomm(r.get_mpz_t(),_randstate,n2.get_mpz_t());
+    mpz_urandomm(r.get_mpz_t(),thread_randstate(),n2.get_mpz_t());
 
     return r;
 }
 
 
 
-mpz_class Paillier::dot_product(const std::vector<mpz_class> &c, const std::vector<mpz_class> &v)
+// one squaring chain for the whole vector instead of one per coordinate
+mpz_class Paillier::dot_product(const std::vector<mpz_class> &c, const std::vector<mpz_class> &v) const
 {
     assert(c.size() == v.size());
-    mpz_class x = 1;
+    return multi_powm(c, v, n2);
+}
+
+mpz_class Paillier::dot_product(const std::vector<mpz_class> &c, const std::vector<long> &v) const
+{
+    assert(c.size() == v.size());
+    return multi_powm(c, v, n2);
+}
+
+void Paillier::set_batch_threads(unsigned int n)
+{
+    batch_lanes = (n < 2) ? 1 : n;
+}
+
+vector<mpz_class> Paillier::encrypt_batch(const vector<mpz_class> &plaintexts) const
+{
+    vector<mpz_class> c(plaintexts.size());
     
-    for (size_t i = 0; i < v.size(); i++) {
-        if (v[i] == 0) {
-            continue;
+    run_batch(batch_lanes, plaintexts.size(), [this,&plaintexts,&c](size_t i_start, size_t i_end) {
+        for (size_t i = i_start; i < i_end; i++) {
+            c[i] = encrypt(plaintexts[i]);
         }
-
-        x = add(x, constMult(v[i],c[i]));
-    }
+    });
     
-    return x;
+    return c;
+}
 
+vector<mpz_class> Paillier::constMult_batch(const vector<mpz_class> &m, const vector<mpz_class> &c) const
+{
+    assert(m.size() == c.size());
+    vector<mpz_class> res(c.size());
+    
+    run_batch(batch_lanes, c.size(), [this,&m,&c,&res](size_t i_start, size_t i_end) {
+        for (size_t i = i_start; i < i_end; i++) {
+            res[i] = constMult(m[i], c[i]);
+        }
+    });
+    
+    return res;
 }
 
-mpz_class Paillier::dot_product(const std::vector<mpz_class> &c, const std::vector<long> &v)
+// each thread computes the dot product of its range, the partial products
+// are then multiplied together
+template <typename T>
+static mpz_class dot_product_batch_impl(const Paillier &pk, unsigned int n_lanes, const vector<mpz_class> &c, const vector<T> &v)
 {
     assert(c.size() == v.size());
     mpz_class x = 1;
+    mutex mtx;
     
-    for (size_t i = 0; i < v.size(); i++) {
-        if (v[i] == 0) {
-            continue;
-        }
-        x = add(x, constMult(v[i],c[i]));
-    }
+    run_batch(n_lanes, v.size(), [&pk,&c,&v,&x,&mtx](size_t i_start, size_t i_end) {
+        vector<mpz_class> c_range(c.begin() + i_start, c.begin() + i_end);
+        vector<T> v_range(v.begin() + i_start, v.begin() + i_end);
+        mpz_class y = pk.dot_product(c_range, v_range);
+        
+        lock_guard<mutex> lock(mtx);
+        x = pk.add(x, y);
+    });
     
     return x;
 }
 
+mpz_class Paillier::dot_product_batch(const vector<mpz_class> &c, const vector<mpz_class> &v) const
+{
+    return dot_product_batch_impl(*this, batch_lanes, c, v);
+}
+
+mpz_class Paillier::dot_product_batch(const vector<mpz_class> &c, const vector<long> &v) const
+{
+    return dot_product_batch_impl(*this, batch_lanes, c, v);
+}
+
 /*
  * Private-key operations
  */
@@ -224,6 +304,24 @@ Paillier_priv::Paillier_priv(const vector<mpz_class> &sk, gmp_randstate_t state)
 {
     assert(sk.size() == 4);
     find_crt_factors();
+
+    mpz_class mod = n, mod2 = n2, mod_p2 = p2, mod_q2 = q2;
+    if (fast) {
+        // g^n has order a: the exponent only needs abits bits
+        mpz_class base = g_n, order = a;
+        rpool = make_shared<Randomness_Pool>(n2, [base,order,mod2](gmp_randstate_t s) {
+            mpz_class r;
+            mpz_urandomm(r.get_mpz_t(),s,order.get_mpz_t());
+            return mpz_class_powm(base,r,mod2);
+        }, state);
+    } else {
+        // with the factorization, r^n is computed mod p^2 and q^2
+        rpool = make_shared<Randomness_Pool>(n2, [mod,mod_p2,mod_q2](gmp_randstate_t s) {
+            mpz_class r;
+            mpz_urandomm(r.get_mpz_t(),s,mod.get_mpz_t());
+            return mpz_class_crt_2(mpz_class_powm(r,mod,mod_p2),mpz_class_powm(r,mod,mod_q2),mod_p2,mod_q2);
+        }, state);
+    }
 }
 
 void Paillier_priv::find_crt_factors()
@@ -283,19 +381,15 @@ Paillier_priv::keygen(gmp_randstate_t state, uint nbits, uint abits)
 }
 
 mpz_class
-Paillier_priv::encrypt(const mpz_class &plaintext)
+Paillier_priv::encrypt(const mpz_class &plaintext, gmp_randstate_t state) const
 {
     if (fast) {
         // a != 0
-        return encrypt(plaintext);
+        return Paillier::encrypt(plaintext, state);
     }
     mpz_class rn;
 
-    auto i = rqueue.begin();
-    if (i != rqueue.end()) {
-        rqueue.pop_front();
-        rn = *i;
-        
+    if (next_randomizer(rn, state)) {
         mpz_class c;
         mpz_class c_p;
         mpz_class c_q;
@@ -313,7 +407,7 @@ Paillier_priv::encrypt(const mpz_class &plaintext)
         return (c*rn) %n2;
     } else {
         mpz_class r;
-        mpz_urandomm(r.get_mpz_t(),_randstate,n.get_mpz_t());
+        mpz_urandomm(r.get_mpz_t(),state,n.get_mpz_t());
 
         mpz_class r_p,r_q;
         r_p = mpz_class_powm(r,n,p2);
@@ -340,19 +434,16 @@ Paillier_priv::encrypt(const mpz_class &plaintext)
 }
 
 mpz_class
-Paillier_priv::fast_encrypt_precompute(const mpz_class &plaintext)
+Paillier_priv::fast_encrypt_precompute(const mpz_class &plaintext) const
 {
+    __gmp_randstate_struct *state = thread_randstate();
     if (fast) {
         // a != 0
-        return encrypt(plaintext);
+        return Paillier::encrypt(plaintext, state);
     }
     mpz_class rn;
     
-    auto i = rqueue.begin();
-    if (i != rqueue.end()) {
-        rqueue.pop_front();
-        rn = *i;
-        
+    if (next_randomizer(rn, state)) {
         mpz_class c;
         mpz_class c_p;
         mpz_class c_q;
@@ -369,7 +460,7 @@ Paillier_priv::fast_encrypt_precompute(const mpz_class &plaintext)
         return (c*rn) %n2;
     } else {
         mpz_class r;
-        mpz_urandomm(r.get_mpz_t(),_randstate,n.get_mpz_t());
+        mpz_urandomm(r.get_mpz_t(),state,n.get_mpz_t());
         
         mpz_class r_p,r_q;
         r_p = mpz_class_powm(r,n,p2);
@@ -412,6 +503,20 @@ Paillier_priv::decrypt(const mpz_class &ciphertext) const
     return m;
 }
 
+vector<mpz_class>
+Paillier_priv::decrypt_batch(const vector<mpz_class> &ciphertexts) const
+{
+    vector<mpz_class> m(ciphertexts.size());
+    
+    run_batch(batch_lanes, ciphertexts.size(), [this,&ciphertexts,&m](size_t i_start, size_t i_end) {
+        for (size_t i = i_start; i < i_end; i++) {
+            m[i] = decrypt(ciphertexts[i]);
+        }
+    });
+    
+    return m;
+}
+
 Paillier_priv_fast::Paillier_priv_fast(const std::vector<mpz_class> &sk, gmp_randstate_t state)
 : Paillier_priv({sk[0],sk[1],sk[2],0},state), g_star_(sk[3]), phi_n((p-1)*(q-1)), phi_n2(phi_n*n), phi_n2_bits(mpz_sizeinbase(phi_n2.get_mpz_t(),2))
 {
@@ -435,7 +540,7 @@ void Paillier_priv_fast::precompute_powers()
     
 }
 
-mpz_class Paillier_priv_fast::compute_g_star_power(const mpz_class &x)
+mpz_class Paillier_priv_fast::compute_g_star_power(const mpz_class &x) const
 {
     mpz_class y_p = x % ((p-1)*p);
     mpz_class y_q = x % ((q-1)*q);
@@ -456,12 +561,15 @@ mpz_class Paillier_priv_fast::compute_g_star_power(const mpz_class &x)
     return mpz_class_crt_2(v_p,v_q,p2,q2);
 }
 
-mpz_class Paillier_priv_fast::encrypt(const mpz_class &plaintext)
+mpz_class Paillier_priv_fast::encrypt(const mpz_class &plaintext, gmp_randstate_t state) const
 {
-    mpz_class r_prime;
-    mpz_urandomm(r_prime.get_mpz_t(),_randstate,phi_n.get_mpz_t());
-    
-    mpz_class r = compute_g_star_power(r_prime*n);
+    mpz_class r;
+    if (!next_randomizer(r, state)) {
+        mpz_class r_prime;
+        mpz_urandomm(r_prime.get_mpz_t(),state,phi_n.get_mpz_t());
+        
+        r = compute_g_star_power(r_prime*n);
+    }
     
     mpz_class c_p;
     mpz_class c_q;
@@ -21,46 +21,91 @@
 
 #pragma once
 
-#include <list>
+#include <memory>
 #include <vector>
 #include <NTL/ZZ.h>
 #include <math/mpz_class.hh>
+#include <math/math_util.hh>
+#include <crypto/randomness_pool.hh>
+#include <crypto/batch.hh>
+#include <crypto/thread_randstate.hh>
 
+/*
+ * The keys are immutable once set up (the randomness pool is thread safe)
+ * and are shared by reference between the protocol instances and threads of
+ * a session: they cannot be copied. Their operations draw their randomness
+ * from the state of the calling thread, see thread_randstate.
+ */
 class Paillier {
  public:
+    /* state only seeds the randomness pool */
     Paillier(const std::vector<mpz_class> &pk, gmp_randstate_t state);
+    virtual ~Paillier() {}
+    Paillier(const Paillier&) = delete;
+    Paillier &operator=(const Paillier &) = delete;
     std::vector<mpz_class> pubkey() const { return { n, g }; }
 
-    mpz_class encrypt(const mpz_class &plaintext);
+    mpz_class encrypt(const mpz_class &plaintext) const { return encrypt(plaintext, thread_randstate()); }
     mpz_class add(const mpz_class &c0, const mpz_class &c1) const;
     mpz_class sub(const mpz_class &c0, const mpz_class &c1) const;
     mpz_class constMult(const mpz_class &m, const mpz_class &c) const;
     mpz_class constMult(long m, const mpz_class &c) const;
     mpz_class constMult(const mpz_class &c, long m) const { return constMult(m,c); };
-    mpz_class scalarize(const mpz_class &c);
+    mpz_class scalarize(const mpz_class &c) const;
     mpz_class constXor(bool b, const mpz_class &c) const;
     mpz_class constXor(const mpz_class &c, bool b) const { return constXor(b,c); };
-    void refresh(mpz_class &c);
-    mpz_class random_encryption();
+    void refresh(mpz_class &c) const;
+    mpz_class random_encryption() const;
+
+    mpz_class dot_product(const std::vector<mpz_class> &c, const std::vector<mpz_class> &v) const;
+    mpz_class dot_product(const std::vector<mpz_class> &c, const std::vector<long> &v) const;
+    void rand_gen(size_t niter = 100, size_t nmax = 1000) const;
+
+    /* element-wise operations split into batch_threads() tasks of the
+     * executor (see run_batch) */
+    std::vector<mpz_class> encrypt_batch(const std::vector<mpz_class> &plaintexts) const;
+    std::vector<mpz_class> constMult_batch(const std::vector<mpz_class> &m, const std::vector<mpz_class> &c) const;
+    mpz_class dot_product_batch(const std::vector<mpz_class> &c, const std::vector<mpz_class> &v) const;
+    mpz_class dot_product_batch(const std::vector<mpz_class> &c, const std::vector<long> &v) const;
 
-    mpz_class dot_product(const std::vector<mpz_class> &c, const std::vector<mpz_class> &v);
-    mpz_class dot_product(const std::vector<mpz_class> &c, const std::vector<long> &v);
-    void rand_gen(size_t niter = 100, size_t nmax = 1000);
+    /* n < 2 runs the batches in the calling thread */
+    void set_batch_threads(unsigned int n);
+    unsigned int batch_threads() const { return batch_lanes; }
+
+    /* precomputed randomizers, r^n mod n^2 (g^(n r) for the fast keys):
+     * start() keeps it filled in the background, save()/load() persist it
+     * across restarts */
+    Randomness_Pool& randomness_pool() const { return *rpool; }
+
+    /* alternative randomizers: h^x for a fixed h = r^n mod n^2 (g^n for the
+     * fast keys) and a random exponent x of exp_bits bits (nbits/2 if 0),
+     * with precomputed window tables. Much faster than r^n for a fresh r, but
+     * relies on the short exponent assumption. Resets the randomness pool. */
+    void enable_fixed_base_randomizers(unsigned int exp_bits = 0, unsigned int window = 4);
+    bool fixed_base_randomizers() const { return fixed_base != nullptr; }
 
  protected:
+    /* encryption drawing its randomness from state */
+    virtual mpz_class encrypt(const mpz_class &plaintext, gmp_randstate_t state) const;
+
+    /* next randomizer from the pool or the fixed base, false if none */
+    bool next_randomizer(mpz_class &rn, gmp_randstate_t state) const;
+
     /* Public key */
     const mpz_class n, g;
 
-    /* Randomness state */
-    gmp_randstate_t _randstate;
-
     /* Cached values */
     const uint nbits;
     const mpz_class n2;
     bool good_generator;
+    /* g^n mod n^2 if g != n+1 (fast keys), 0 otherwise */
+    const mpz_class g_n;
     
     /* Pre-computed randomness */
-    std::list<mpz_class> rqueue;
+    std::shared_ptr<Randomness_Pool> rpool;
+    std::shared_ptr<const FixedBaseWindowExp> fixed_base;
+
+    unsigned int batch_lanes;
 };
 
 class Paillier_priv : public Paillier {
@@ -69,17 +114,20 @@ class Paillier_priv : public Paillier {
     std::vector<mpz_class> privkey() const { return { p, q, g, a }; }
     void find_crt_factors();
     
-    // if a !=0, and if you are encrypting using the private key, use this function
-    // 75% speedup
-    mpz_class encrypt(const mpz_class &plaintext);
+    using Paillier::encrypt;
     // no speedup compared to the fast_encrypt
-    mpz_class fast_encrypt_precompute(const mpz_class &plaintext);
+    mpz_class fast_encrypt_precompute(const mpz_class &plaintext) const;
 
     mpz_class decrypt(const mpz_class &ciphertext) const;
+    std::vector<mpz_class> decrypt_batch(const std::vector<mpz_class> &ciphertexts) const;
     static std::vector<mpz_class> keygen(gmp_randstate_t state, uint nbits = 1024, uint abits = 256);
 
 
  protected:
+    // if a !=0, and if you are encrypting using the private key, use this function
+    // 75% speedup
+    mpz_class encrypt(const mpz_class &plaintext, gmp_randstate_t state) const;
+
     /* Private key, including g from public part; n=pq */
     const mpz_class p, q;
     const mpz_class a;      /* non-zero for fast mode */
@@ -97,10 +145,12 @@ class Paillier_priv_fast : public Paillier_priv {
 public:
     Paillier_priv_fast(const std::vector<mpz_class> &sk, gmp_randstate_t state);
     void precompute_powers();
-    mpz_class compute_g_star_power(const mpz_class &x);
+    mpz_class compute_g_star_power(const mpz_class &x) const;
     static std::vector<mpz_class> keygen(gmp_randstate_t state, uint nbits = 1024);
     
-    mpz_class encrypt(const mpz_class &plaintext);
+    using Paillier::encrypt;
+protected:
+    mpz_class encrypt(const mpz_class &plaintext, gmp_randstate_t state) const;
 private:
     const mpz_class g_star_;
     const mpz_class phi_n;
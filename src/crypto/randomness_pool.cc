@@ -0,0 +1,238 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <crypto/randomness_pool.hh>
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace std;
+
+#define RANDOMNESS_POOL_MAGIC "CMRP1\n"
+#define RANDOMNESS_POOL_SEED_BITS 256
+
+// the state must not be a copy of the key's one, otherwise the pool and the
+// online encryptions would draw the same r
+static void seed_from(gmp_randstate_t dst, gmp_randstate_t src)
+{
+    mpz_class seed;
+    mpz_urandomb(seed.get_mpz_t(), src, RANDOMNESS_POOL_SEED_BITS);
+    gmp_randinit_default(dst);
+    gmp_randseed(dst, seed.get_mpz_t());
+}
+
+Randomness_Pool::Randomness_Pool(const mpz_class &modulus, Generator gen, gmp_randstate_t state)
+: modulus_(modulus), gen_(gen), target_(0), stop_(false)
+{
+    seed_from(randstate_, state);
+}
+
+Randomness_Pool::~Randomness_Pool()
+{
+    stop();
+    gmp_randclear(randstate_);
+}
+
+bool Randomness_Pool::pop(mpz_class &r)
+{
+    unique_lock<mutex> lock(mtx_);
+    if (pool_.empty()) {
+        return false;
+    }
+    r = pool_.front();
+    pool_.pop_front();
+    lock.unlock();
+
+    below_target_.notify_one();
+    return true;
+}
+
+void Randomness_Pool::fill(size_t niter, size_t nmax)
+{
+    for (size_t i = 0; i < niter; i++) {
+        {
+            lock_guard<mutex> lock(mtx_);
+            if (pool_.size() >= nmax) {
+                return;
+            }
+        }
+        mpz_class r;
+        {
+            lock_guard<mutex> lock(rand_mtx_);
+            r = gen_(randstate_);
+        }
+        lock_guard<mutex> lock(mtx_);
+        pool_.push_back(r);
+    }
+}
+
+void Randomness_Pool::start(size_t target, unsigned int n_threads)
+{
+    stop();
+
+    {
+        lock_guard<mutex> lock(mtx_);
+        target_ = target;
+        stop_ = false;
+    }
+    for (unsigned int i = 0; i < n_threads; i++) {
+        workers_.push_back(thread(&Randomness_Pool::worker_loop, this));
+    }
+}
+
+void Randomness_Pool::stop()
+{
+    {
+        lock_guard<mutex> lock(mtx_);
+        stop_ = true;
+    }
+    below_target_.notify_all();
+
+    for (size_t i = 0; i < workers_.size(); i++) {
+        workers_[i].join();
+    }
+    workers_.clear();
+}
+
+size_t Randomness_Pool::size() const
+{
+    lock_guard<mutex> lock(mtx_);
+    return pool_.size();
+}
+
+void Randomness_Pool::worker_loop()
+{
+#ifdef SCHED_IDLE
+    // only use the cores nobody else wants
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+    gmp_randstate_t state;
+    {
+        lock_guard<mutex> lock(rand_mtx_);
+        seed_from(state, randstate_);
+    }
+
+    for (;;) {
+        {
+            unique_lock<mutex> lock(mtx_);
+            below_target_.wait(lock, [this]{ return stop_ || pool_.size() < target_; });
+            if (stop_) {
+                break;
+            }
+        }
+
+        // the exponentiation is done without holding the lock
+        mpz_class r = gen_(state);
+
+        lock_guard<mutex> lock(mtx_);
+        pool_.push_back(r);
+    }
+
+    gmp_randclear(state);
+}
+
+size_t Randomness_Pool::save(const string &path)
+{
+    deque<mpz_class> values;
+    {
+        lock_guard<mutex> lock(mtx_);
+        values.swap(pool_);
+    }
+    below_target_.notify_all();
+
+    // the randomizers are as secret as the key: only readable by the owner
+    string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+    FILE *f = (fd < 0) ? NULL : fdopen(fd, "wb");
+    bool ok = (f != NULL);
+    if (f == NULL && fd >= 0) {
+        close(fd);
+    }
+
+    if (ok) {
+        uint64_t count = values.size();
+        size_t magic_len = strlen(RANDOMNESS_POOL_MAGIC);
+        ok = fwrite(RANDOMNESS_POOL_MAGIC, 1, magic_len, f) == magic_len
+            && mpz_out_raw(f, modulus_.get_mpz_t()) != 0
+            && fwrite(&count, sizeof(count), 1, f) == 1;
+        for (size_t i = 0; ok && i < values.size(); i++) {
+            ok = mpz_out_raw(f, values[i].get_mpz_t()) != 0;
+        }
+        ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+        ok = (fclose(f) == 0) && ok;
+        ok = ok && rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    if (!ok) {
+        if (fd >= 0) {
+            unlink(tmp.c_str());
+        }
+        // nothing was saved: keep the values
+        lock_guard<mutex> lock(mtx_);
+        pool_.insert(pool_.begin(), values.begin(), values.end());
+        return 0;
+    }
+
+    return values.size();
+}
+
+size_t Randomness_Pool::load(const string &path)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == NULL) {
+        return 0;
+    }
+
+    char magic[sizeof(RANDOMNESS_POOL_MAGIC)];
+    mpz_class modulus;
+    uint64_t count = 0;
+
+    size_t magic_len = strlen(RANDOMNESS_POOL_MAGIC);
+    if (fread(magic, 1, magic_len, f) != magic_len || memcmp(magic, RANDOMNESS_POOL_MAGIC, magic_len) != 0
+        || mpz_inp_raw(modulus.get_mpz_t(), f) == 0 || modulus != modulus_
+        || fread(&count, sizeof(count), 1, f) != 1) {
+        // not a pool for this key: leave the file alone
+        fclose(f);
+        return 0;
+    }
+
+    deque<mpz_class> values;
+    for (uint64_t i = 0; i < count; i++) {
+        mpz_class r;
+        if (mpz_inp_raw(r.get_mpz_t(), f) == 0) {
+            break;
+        }
+        values.push_back(r);
+    }
+    fclose(f);
+    unlink(path.c_str());
+
+    lock_guard<mutex> lock(mtx_);
+    pool_.insert(pool_.end(), values.begin(), values.end());
+
+    return values.size();
+}
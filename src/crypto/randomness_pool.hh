@@ -0,0 +1,88 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <math/mpz_class.hh>
+
+/*
+ * Pool of precomputed encryption randomizers (r^n mod n^2 for Paillier,
+ * r^2 mod N for GM).
+ *
+ * The pool can be filled synchronously (fill) or kept topped up to a target
+ * depth by background threads running at idle priority (start/stop).
+ * pop never blocks: when the pool is empty, the caller computes the
+ * randomizer itself.
+ *
+ * A randomizer must never be used twice: save moves the content of the pool
+ * to the file and load deletes the file it read. Both check that the file
+ * belongs to the same modulus. The file is only readable by its owner and is
+ * written atomically; if it cannot be written, the pool keeps its content.
+ */
+class Randomness_Pool {
+public:
+    typedef std::function<mpz_class(gmp_randstate_t)> Generator;
+
+    Randomness_Pool(const mpz_class &modulus, Generator gen, gmp_randstate_t state);
+    ~Randomness_Pool();
+
+    Randomness_Pool(const Randomness_Pool&) = delete;
+    Randomness_Pool &operator=(const Randomness_Pool &) = delete;
+
+    bool pop(mpz_class &r);
+
+    /* computes niter randomizers in the calling thread, without exceeding nmax */
+    void fill(size_t niter, size_t nmax);
+
+    void start(size_t target, unsigned int n_threads = 1);
+    void stop();
+    bool running() const { return !workers_.empty(); }
+
+    size_t size() const;
+    size_t target() const { return target_; }
+
+    /* returns the number of randomizers written (resp. read) */
+    size_t save(const std::string &path);
+    size_t load(const std::string &path);
+
+protected:
+    void worker_loop();
+
+    const mpz_class modulus_;
+    Generator gen_;
+    gmp_randstate_t randstate_;
+    std::mutex rand_mtx_;
+
+    std::deque<mpz_class> pool_;
+    size_t target_;
+    bool stop_;
+    std::vector<std::thread> workers_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable below_target_;
+};
@@ -23,13 +23,20 @@
 #include <vector>
 #include <crypto/paillier.hh>
 #include <crypto/gm.hh>
+#include <crypto/dgk.hh>
 #include <NTL/ZZ.h>
 #include <gmpxx.h>
 #include <math/util_gmp_rand.h>
 
 #include <ctime>
+#include <cstdio>
 
 #include<iostream>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+#include <sys/stat.h>
 
 using namespace std;
 using namespace NTL;
@@ -310,6 +317,664 @@ test_gm()
     cout << " passed" << endl;
 }
 
+static void
+test_dgk()
+{
+    cout << "Test DGK ..." << flush;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+
+    auto sk = DGK_priv::keygen(randstate,1024);
+    DGK_priv pp(sk);
+    DGK p(pp.pubkey());
+    mpz_class u = p.plaintext_modulus();
+    
+    mpz_class pt0, pt1, m;
+    mpz_urandomm(pt0.get_mpz_t(),randstate,u.get_mpz_t());
+    mpz_urandomm(pt1.get_mpz_t(),randstate,u.get_mpz_t());
+    mpz_urandomm(m.get_mpz_t(),randstate,u.get_mpz_t());
+    
+    mpz_class ct0 = p.encrypt(pt0);
+    mpz_class ct1 = pp.encrypt(pt1);
+    mpz_class sum = p.add(ct0, ct1);
+    mpz_class diff = p.sub(ct0, ct1);
+    mpz_class prod = p.constMult(m,ct0);
+    
+    assert(pp.decrypt(ct0) == pt0);
+    assert(pp.decrypt(ct1) == pt1);
+    assert(pp.decrypt(sum) == (pt0+pt1)%u);
+    assert(pp.decrypt(diff) == (pt0-pt1+u)%u);
+    assert(pp.decrypt(prod) == (m*pt0)%u);
+    
+    // zero tests
+    mpz_class c_zero = p.encrypt(0);
+    assert(pp.is_zero(c_zero));
+    assert(pp.is_zero(p.sub(ct0, ct0)));
+    assert(pp.is_zero(p.scalarize(c_zero)));
+    assert(pp.is_zero(p.encrypt(u)));
+    assert(!pp.is_zero(p.encrypt(1)));
+    assert(!pp.is_zero(p.scalarize(p.encrypt(1))));
+    assert(!pp.is_zero(p.random_encryption()));
+    
+    // negative plaintexts are taken mod u
+    assert(pp.decrypt(p.encrypt(-1)) == u-1);
+    
+    cout << " passed" << endl;
+}
+
+static void
+test_randomness_pool()
+{
+    cout << "Test randomness pool ..." << flush;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    auto sk = Paillier_priv::keygen(randstate,600,0);
+    Paillier_priv pp(sk,randstate);
+    Paillier p(pp.pubkey(),randstate);
+    
+    // background precomputation
+    p.randomness_pool().start(50, 2);
+    while (p.randomness_pool().size() < 50) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    
+    mpz_class n = pp.pubkey()[0];
+    for (size_t i = 0; i < 100; i++) {
+        mpz_class pt;
+        mpz_urandomm(pt.get_mpz_t(),randstate,n.get_mpz_t());
+        mpz_class c = p.encrypt(pt);
+        p.refresh(c);
+        assert(pp.decrypt(c) == pt);
+        assert(pp.decrypt(pp.encrypt(pt)) == pt);
+    }
+    p.randomness_pool().stop();
+    // the encryptions above may have drained the pool
+    p.rand_gen(10, 10);
+    
+    // persistence: the file is consumed by the first load, and only a pool
+    // for the same key can load it
+    const string path = "test_randomness_pool.bin";
+    size_t pooled = p.randomness_pool().size();
+    assert(p.randomness_pool().save("/nonexistent/test_randomness_pool.bin") == 0);
+    assert(p.randomness_pool().size() == pooled);
+    
+    size_t saved = p.randomness_pool().save(path);
+    assert(saved == pooled);
+    assert(p.randomness_pool().size() == 0);
+    struct stat st;
+    assert(stat(path.c_str(), &st) == 0 && (st.st_mode & 0777) == 0600);
+    
+    Paillier_priv other_pp(Paillier_priv::keygen(randstate,600,0),randstate);
+    Paillier other(other_pp.pubkey(),randstate);
+    assert(other.randomness_pool().load(path) == 0);
+    
+    Paillier restarted(pp.pubkey(),randstate);
+    assert(restarted.randomness_pool().load(path) == saved);
+    assert(restarted.randomness_pool().load(path) == 0);
+    mpz_class c = restarted.encrypt(42);
+    assert(pp.decrypt(c) == 42);
+    
+    // fast keys (a != 0): the randomizers are powers of g^n
+    Paillier_priv fast_pp(Paillier_priv::keygen(randstate,600,128),randstate);
+    Paillier fast_p(fast_pp.pubkey(),randstate);
+    mpz_class fast_n = fast_pp.pubkey()[0];
+    fast_p.rand_gen(20, 20);
+    fast_pp.rand_gen(20, 20);
+    for (size_t i = 0; i < 40; i++) {
+        mpz_class pt;
+        mpz_urandomm(pt.get_mpz_t(),randstate,fast_n.get_mpz_t());
+        mpz_class c = fast_p.encrypt(pt);
+        assert(fast_pp.decrypt(c) == pt);
+        fast_p.refresh(c);
+        assert(fast_pp.decrypt(c) == pt);
+        assert(fast_pp.decrypt(fast_pp.encrypt(pt)) == pt);
+    }
+    
+    // GM
+    GM_priv gm(GM_priv::keygen(randstate),randstate);
+    gm.rand_gen(20, 20);
+    assert(gm.randomness_pool().size() == 20);
+    for (size_t i = 0; i < 40; i++) {
+        bool b = (i%3 == 0);
+        assert(gm.decrypt(gm.encrypt(b)) == b);
+        assert(gm.decrypt(gm.reRand(gm.encrypt(b))) == b);
+    }
+    
+    cout << " passed" << endl;
+}
+
+static void
+test_fixed_base_randomizers()
+{
+    cout << "Test fixed-base randomizers ..." << flush;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    auto sk = Paillier_priv::keygen(randstate,600,0);
+    Paillier_priv pp(sk,randstate);
+    mpz_class n = pp.pubkey()[0];
+    mpz_class n2 = n*n;
+    
+    for (unsigned int w = 1; w <= 6; w++) {
+        mpz_class g;
+        mpz_urandomm(g.get_mpz_t(),randstate,n2.get_mpz_t());
+        FixedBaseWindowExp fbe(g, n2, 301, w);
+        for (size_t i = 0; i < 10; i++) {
+            mpz_class e;
+            mpz_urandomb(e.get_mpz_t(),randstate,301);
+            assert(fbe.pow(e) == mpz_class_powm(g,e,n2));
+        }
+        assert(fbe.pow(0) == 1);
+    }
+    
+    Paillier p(pp.pubkey(),randstate);
+    p.enable_fixed_base_randomizers();
+    assert(p.fixed_base_randomizers());
+    
+    for (size_t i = 0; i < 50; i++) {
+        mpz_class pt;
+        mpz_urandomm(pt.get_mpz_t(),randstate,n.get_mpz_t());
+        mpz_class c = p.encrypt(pt);
+        assert(pp.decrypt(c) == pt);
+        p.refresh(c);
+        assert(pp.decrypt(c) == pt);
+    }
+    
+    // fast keys (a != 0): the table is built on g^n
+    Paillier_priv fast_pp(Paillier_priv::keygen(randstate,600,128),randstate);
+    Paillier fast_p(fast_pp.pubkey(),randstate);
+    mpz_class fast_n = fast_pp.pubkey()[0];
+    fast_p.enable_fixed_base_randomizers();
+    fast_pp.enable_fixed_base_randomizers();
+    fast_p.rand_gen(10, 10);
+    
+    for (size_t i = 0; i < 50; i++) {
+        mpz_class pt;
+        mpz_urandomm(pt.get_mpz_t(),randstate,fast_n.get_mpz_t());
+        mpz_class c = fast_p.encrypt(pt);
+        assert(fast_pp.decrypt(c) == pt);
+        fast_p.refresh(c);
+        assert(fast_pp.decrypt(c) == pt);
+        assert(fast_pp.decrypt(fast_pp.encrypt(pt)) == pt);
+    }
+    
+    cout << " passed" << endl;
+}
+
+static void
+fixed_base_perf(unsigned int k, size_t n_iteration)
+{
+    cout << "Test fixed-base randomizers performances ..." << endl;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    auto sk = Paillier_priv::keygen(randstate,k,0);
+    Paillier_priv pp(sk,randstate);
+    Paillier p(pp.pubkey(),randstate);
+    Paillier p_fb(pp.pubkey(),randstate);
+    p_fb.enable_fixed_base_randomizers();
+    
+    cout << "k = " << k << endl;
+    cout << n_iteration << " iterations" << endl;
+    
+    struct timespec t0,t1;
+    uint64_t t;
+    
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID,&t0);
+    for (size_t i = 0; i < n_iteration; i++) {
+        p.encrypt(i);
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID,&t1);
+    t = (((uint64_t)t1.tv_sec) - ((uint64_t)t0.tv_sec) )* 1000000000 + (t1.tv_nsec - t0.tv_nsec);
+    cerr << "public encryption: "<<  ((double)t/1000000)/n_iteration <<"ms per plaintext" << endl;
+    
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID,&t0);
+    for (size_t i = 0; i < n_iteration; i++) {
+        p_fb.encrypt(i);
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID,&t1);
+    t = (((uint64_t)t1.tv_sec) - ((uint64_t)t0.tv_sec) )* 1000000000 + (t1.tv_nsec - t0.tv_nsec);
+    cerr << "public encryption with fixed-base randomizers: "<<  ((double)t/1000000)/n_iteration <<"ms per plaintext" << endl;
+}
+static void
+test_paillier_batch()
+{
+    cout << "Test Paillier batch operations ..." << flush;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    auto sk = Paillier_priv::keygen(randstate,600,0);
+    Paillier_priv pp(sk,randstate);
+    Paillier p(pp.pubkey(),randstate);
+    Paillier_priv_fast ppf(Paillier_priv_fast::keygen(randstate,600),randstate);
+    mpz_class n = pp.pubkey()[0];
+    
+    size_t n_values = 37;
+    vector<mpz_class> pt(n_values), m(n_values);
+    vector<long> m_long(n_values);
+    for (size_t i = 0; i < n_values; i++) {
+        mpz_urandomm(pt[i].get_mpz_t(),randstate,n.get_mpz_t());
+        m_long[i] = (i % 5 == 0) ? 0 : (long)i - 10;
+        m[i] = m_long[i];
+    }
+    
+    // the same results in the calling thread and split over a pool
+    for (unsigned int threads = 1; threads <= 4; threads += 3) {
+        p.set_batch_threads(threads);
+        pp.set_batch_threads(threads);
+        ppf.set_batch_threads(threads);
+        
+        vector<mpz_class> c = p.encrypt_batch(pt);
+        vector<mpz_class> c_priv = pp.encrypt_batch(pt);
+        assert(c.size() == n_values);
+        assert(pp.decrypt_batch(c) == pt);
+        assert(pp.decrypt_batch(c_priv) == pt);
+        vector<mpz_class> pt_fast(pt);
+        for (size_t i = 0; i < n_values; i++) {
+            pt_fast[i] %= ppf.pubkey()[0];
+        }
+        assert(ppf.decrypt_batch(ppf.encrypt_batch(pt_fast)) == pt_fast);
+        
+        // no randomizer is used twice
+        for (size_t i = 1; i < n_values; i++) {
+            assert(c[i] != c[i-1]);
+        }
+        
+        vector<mpz_class> c_m = p.constMult_batch(m, c);
+        mpz_class expected_dp = 0;
+        for (size_t i = 0; i < n_values; i++) {
+            mpz_class prod;
+            mpz_mod(prod.get_mpz_t(), mpz_class(m[i]*pt[i]).get_mpz_t(), n.get_mpz_t());
+            assert(pp.decrypt(c_m[i]) == prod);
+            expected_dp += prod;
+        }
+        expected_dp %= n;
+        assert(pp.decrypt(p.dot_product_batch(c, m)) == expected_dp);
+        assert(pp.decrypt(p.dot_product_batch(c, m_long)) == expected_dp);
+        assert(p.dot_product_batch(c, m_long) == p.dot_product(c, m_long));
+    }
+    
+    assert(p.encrypt_batch(vector<mpz_class>()).empty());
+    
+    cout << " passed" << endl;
+}
+
+static void
+test_gm_batch()
+{
+    cout << "Test GM batch decryption ..." << flush;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    GM_priv gm(GM_priv::keygen(randstate,600),randstate);
+    
+    // fresh encryptions, and copies of the same ciphertexts like in the slots of a node
+    vector<mpz_class> c;
+    vector<bool> bits;
+    for (size_t i = 0; i < 50; i++) {
+        bool b = gmp_urandomb_ui(randstate,1);
+        mpz_class ct = gm.encrypt(b);
+        for (size_t k = 0; k <= i%4; k++) {
+            c.push_back(ct);
+            bits.push_back(b);
+        }
+        c.push_back(gm.neg(ct));
+        bits.push_back(!b);
+    }
+    
+    for (size_t i = 0; i < c.size(); i++) {
+        assert(gm.decrypt_fast(c[i]) == bits[i]);
+        assert(gm.decrypt(c[i]) == bits[i]);
+    }
+    
+    for (unsigned int threads = 1; threads <= 4; threads += 3) {
+        gm.set_batch_threads(threads);
+        assert(gm.decrypt_batch(c) == bits);
+    }
+    assert(gm.decrypt_batch(vector<mpz_class>()).empty());
+    
+    cout << " passed" << endl;
+}
+
+static void
+test_executor()
+{
+    cout << "Test executor ..." << flush;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    Paillier_priv pp(Paillier_priv::keygen(randstate,600),randstate);
+    pp.set_batch_threads(4);
+    
+    // batches can run batches: the waiting threads help
+    size_t n_outer = 6, n_inner = 5;
+    vector<vector<mpz_class> > pt(n_outer, vector<mpz_class>(n_inner)), c(n_outer);
+    for (size_t i = 0; i < n_outer; i++) {
+        for (size_t j = 0; j < n_inner; j++) {
+            pt[i][j] = gmp_urandomb_ui(randstate,32);
+        }
+    }
+    run_batch(4, n_outer, [&pp,&pt,&c](size_t i_start, size_t i_end) {
+        for (size_t i = i_start; i < i_end; i++) {
+            c[i] = pp.encrypt_batch(pt[i]);
+        }
+    });
+    for (size_t i = 0; i < n_outer; i++) {
+        assert(pp.decrypt_batch(c[i]) == pt[i]);
+    }
+    
+    // an exhausted share runs the tasks in the calling thread
+    {
+        Executor::Share share(0);
+        Executor::Share::Binding binding(share);
+        thread::id caller = this_thread::get_id();
+        bool inline_only = true;
+        Task_Group group;
+        for (int i = 0; i < 8; i++) {
+            group.run([&caller,&inline_only,&share]() {
+                if (this_thread::get_id() != caller || Executor::Share::current() != &share) {
+                    inline_only = false;
+                }
+            });
+        }
+        group.wait();
+        assert(inline_only);
+    }
+    
+    // the first exception is rethrown by wait
+    Task_Group group;
+    group.run([]() { throw runtime_error("task failed"); });
+    bool thrown = false;
+    try {
+        group.wait();
+    } catch (runtime_error &e) {
+        thrown = true;
+    }
+    assert(thrown);
+    
+    // blocking tasks all start, even if there are more of them than workers
+    size_t n_blocking = Executor::global().size() + 2;
+    atomic<size_t> started(0);
+    for (size_t i = 0; i < n_blocking; i++) {
+        group.run_blocking([&started,n_blocking]() {
+            started++;
+            while (started < n_blocking) {
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+        });
+    }
+    group.wait();
+    
+    cout << " passed" << endl;
+}
+
+static void
+test_dot_product()
+{
+    cout << "Test Paillier dot product ..." << flush;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    auto sk = Paillier_priv::keygen(randstate,600,0);
+    Paillier_priv pp(sk,randstate);
+    Paillier p(pp.pubkey(),randstate);
+    mpz_class n = pp.pubkey()[0];
+    mpz_class n2 = n*n;
+    
+    // short vectors use interleaved windows, long ones the bucket method
+    size_t sizes[] = {0, 1, 2, 7, 40, 300};
+    for (size_t size : sizes) {
+        vector<mpz_class> c(size), v(size);
+        vector<long> v_long(size);
+        for (size_t i = 0; i < size; i++) {
+            c[i] = p.encrypt(mpz_class(gmp_urandomb_ui(randstate,20)));
+            mpz_urandomm(v[i].get_mpz_t(),randstate,n.get_mpz_t());
+            v_long[i] = (long)gmp_urandomb_ui(randstate,30) - (1L << 29);
+            if (i % 5 == 3) {
+                v[i] = 0;
+                v_long[i] = 0;
+            }
+        }
+        if (size > 1) {
+            v[1] = -v[1];
+        }
+        
+        mpz_class expected = 1, expected_long = 1;
+        for (size_t i = 0; i < size; i++) {
+            expected = p.add(expected, p.constMult(v[i],c[i]));
+            expected_long = p.add(expected_long, p.constMult(v_long[i],c[i]));
+        }
+        assert(p.dot_product(c, v) == expected);
+        assert(p.dot_product(c, v_long) == expected_long);
+    }
+    
+    cout << " passed" << endl;
+}
+
+static double wall_time_ms(const struct timespec &t0, const struct timespec &t1)
+{
+    return (((double)t1.tv_sec) - ((double)t0.tv_sec))*1000. + (t1.tv_nsec - t0.tv_nsec)/1000000.;
+}
+
+static void
+batch_perf(unsigned int k, size_t n_values)
+{
+    cout << "Test Paillier batch throughput ..." << endl;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    auto sk = Paillier_priv::keygen(randstate,k,0);
+    Paillier_priv pp(sk,randstate);
+    Paillier p(pp.pubkey(),randstate);
+    mpz_class n = pp.pubkey()[0];
+    
+    vector<mpz_class> pt(n_values);
+    for (size_t i = 0; i < n_values; i++) {
+        mpz_urandomm(pt[i].get_mpz_t(),randstate,n.get_mpz_t());
+    }
+    
+    cout << "k = " << k << endl;
+    cout << n_values << " values" << endl;
+    
+    unsigned int max_threads = Executor::global().size();
+    struct timespec t0,t1;
+    
+    for (unsigned int threads = 1; threads <= max_threads; threads *= 2) {
+        p.set_batch_threads(threads);
+        pp.set_batch_threads(threads);
+        
+        clock_gettime(CLOCK_MONOTONIC,&t0);
+        vector<mpz_class> c = p.encrypt_batch(pt);
+        clock_gettime(CLOCK_MONOTONIC,&t1);
+        double t_enc = wall_time_ms(t0,t1);
+        
+        clock_gettime(CLOCK_MONOTONIC,&t0);
+        pp.decrypt_batch(c);
+        clock_gettime(CLOCK_MONOTONIC,&t1);
+        double t_dec = wall_time_ms(t0,t1);
+        
+        clock_gettime(CLOCK_MONOTONIC,&t0);
+        p.constMult_batch(pt, c);
+        clock_gettime(CLOCK_MONOTONIC,&t1);
+        double t_mult = wall_time_ms(t0,t1);
+        
+        cerr << threads << " threads: ";
+        cerr << n_values/t_enc*1000 << " encryptions/s, ";
+        cerr << n_values/t_dec*1000 << " decryptions/s, ";
+        cerr << n_values/t_mult*1000 << " constMult/s" << endl;
+    }
+}
+
+static void
+gm_decrypt_perf(unsigned int k, size_t n_values)
+{
+    cout << "Test GM decryption performances ..." << endl;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    GM_priv gm(GM_priv::keygen(randstate,k),randstate);
+    
+    vector<mpz_class> c(n_values);
+    for (size_t i = 0; i < n_values; i++) {
+        c[i] = gm.encrypt(gmp_urandomb_ui(randstate,1));
+    }
+    
+    cout << "k = " << k << endl;
+    cout << n_values << " ciphertexts" << endl;
+    
+    struct timespec t0,t1;
+    
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    for (size_t i = 0; i < n_values; i++) {
+        gm.decrypt(c[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    cerr << "decryption: " << wall_time_ms(t0,t1)/n_values << "ms per ciphertext" << endl;
+    
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    for (size_t i = 0; i < n_values; i++) {
+        gm.decrypt_fast(c[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    cerr << "Legendre symbol decryption: " << wall_time_ms(t0,t1)/n_values << "ms per ciphertext" << endl;
+    
+    // the slots of a node: the same two blinded values everywhere
+    vector<mpz_class> slots(n_values);
+    for (size_t i = 0; i < n_values; i++) {
+        slots[i] = (i%2) ? c[0] : gm.neg(c[0]);
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    gm.decrypt_batch(slots);
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    cerr << "batch decryption of duplicated slots: " << wall_time_ms(t0,t1)/n_values << "ms per ciphertext" << endl;
+}
+
+static void
+dot_product_perf(unsigned int k, size_t n_values)
+{
+    cout << "Test Paillier dot product performances ..." << endl;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    auto sk = Paillier_priv::keygen(randstate,k,0);
+    Paillier_priv pp(sk,randstate);
+    Paillier p(pp.pubkey(),randstate);
+    mpz_class n = pp.pubkey()[0];
+    
+    vector<mpz_class> c(n_values), v(n_values);
+    vector<long> v_long(n_values);
+    for (size_t i = 0; i < n_values; i++) {
+        c[i] = p.encrypt(mpz_class(i));
+        mpz_urandomm(v[i].get_mpz_t(),randstate,n.get_mpz_t());
+        v_long[i] = gmp_urandomb_ui(randstate,32);
+    }
+    
+    cout << "k = " << k << endl;
+    cout << n_values << " coordinates" << endl;
+    
+    struct timespec t0,t1;
+    mpz_class x;
+    
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    x = 1;
+    for (size_t i = 0; i < n_values; i++) {
+        x = p.add(x, p.constMult(v[i],c[i]));
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    cerr << "one exponentiation per coordinate: " << wall_time_ms(t0,t1) << "ms" << endl;
+    
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    p.dot_product(c, v);
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    cerr << "multi-exponentiation: " << wall_time_ms(t0,t1) << "ms" << endl;
+    
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    x = 1;
+    for (size_t i = 0; i < n_values; i++) {
+        x = p.add(x, p.constMult(v_long[i],c[i]));
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    cerr << "32 bits weights, one exponentiation per coordinate: " << wall_time_ms(t0,t1) << "ms" << endl;
+    
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    p.dot_product(c, v_long);
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    cerr << "32 bits weights, multi-exponentiation: " << wall_time_ms(t0,t1) << "ms" << endl;
+}
+
+// zero tests of the comparison protocol: DGK vs Paillier decryption
+static void dgk_perf(unsigned int k, size_t n_iteration)
+{
+    cout << "Test DGK performances ..." << endl;
+    
+    cout << "k = " << k << "\n" << n_iteration << " iterations" << endl;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    DGK_priv pp(DGK_priv::keygen(randstate,k));
+    DGK p(pp.pubkey());
+    Paillier_priv_fast paillier(Paillier_priv_fast::keygen(randstate,k),randstate);
+    
+    vector<mpz_class> ct(n_iteration), ct_paillier(n_iteration);
+    struct timespec t0,t1;
+    
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    for (size_t i = 0; i < n_iteration; i++) {
+        ct[i] = p.encrypt(i%2);
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    cerr << "DGK public encryption: " << wall_time_ms(t0,t1)/n_iteration << "ms per plaintext" << endl;
+    
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    for (size_t i = 0; i < n_iteration; i++) {
+        ct[i] = pp.encrypt(i%2);
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    cerr << "DGK private encryption: " << wall_time_ms(t0,t1)/n_iteration << "ms per plaintext" << endl;
+    
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    for (size_t i = 0; i < n_iteration; i++) {
+        assert(pp.is_zero(ct[i]) == (i%2 == 0));
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    cerr << "DGK zero test: " << wall_time_ms(t0,t1)/n_iteration << "ms per ciphertext" << endl;
+    
+    for (size_t i = 0; i < n_iteration; i++) {
+        ct_paillier[i] = paillier.encrypt(i%2);
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t0);
+    for (size_t i = 0; i < n_iteration; i++) {
+        assert((paillier.decrypt(ct_paillier[i]) == 0) == (i%2 == 0));
+    }
+    clock_gettime(CLOCK_MONOTONIC,&t1);
+    cerr << "Paillier zero test (decryption): " << wall_time_ms(t0,t1)/n_iteration << "ms per ciphertext" << endl;
+}
+
 int
 main(int ac, char **av)
 {
@@ -318,6 +983,13 @@ main(int ac, char **av)
 	test_paillier();
 	test_paillier_fast();
 	test_gm();
+	test_dgk();
+	test_randomness_pool();
+	test_fixed_base_randomizers();
+	test_paillier_batch();
+	test_gm_batch();
+	test_executor();
+	test_dot_product();
 
     
     unsigned int k = 1024;
@@ -334,6 +1006,26 @@ main(int ac, char **av)
     cout << endl;
 
     paillier_fast_perf(k, n_iteration);
+
+    cout << endl;
+
+    dgk_perf(k, n_iteration);
+
+    cout << endl;
+
+    fixed_base_perf(k, n_iteration);
+
+    cout << endl;
+
+    batch_perf(k, n_iteration);
+
+    cout << endl;
+
+    gm_decrypt_perf(k, n_iteration);
+
+    cout << endl;
+
+    dot_product_perf(k, n_iteration);
     
     return 0;
 }
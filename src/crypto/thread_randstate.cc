@@ -0,0 +1,60 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <crypto/thread_randstate.hh>
+
+#include <random>
+
+#define THREAD_RANDSTATE_SEED_WORDS 8
+
+namespace {
+
+class Thread_Randstate {
+public:
+    Thread_Randstate()
+    {
+        std::random_device rd;
+        mpz_class seed = 0;
+        for (unsigned int i = 0; i < THREAD_RANDSTATE_SEED_WORDS; i++) {
+            seed <<= 32;
+            seed += (unsigned long)rd();
+        }
+        gmp_randinit_default(state_);
+        gmp_randseed(state_, seed.get_mpz_t());
+    }
+
+    ~Thread_Randstate()
+    {
+        gmp_randclear(state_);
+    }
+
+    Thread_Randstate(const Thread_Randstate&) = delete;
+    Thread_Randstate &operator=(const Thread_Randstate &) = delete;
+
+    gmp_randstate_t state_;
+};
+
+}
+
+__gmp_randstate_struct* thread_randstate()
+{
+    static thread_local Thread_Randstate randstate;
+    return randstate.state_;
+}
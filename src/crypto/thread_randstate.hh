@@ -0,0 +1,34 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <math/mpz_class.hh>
+
+/*
+ * Random state of the calling thread.
+ *
+ * gmp random states are not thread safe, and the keys are shared by all the
+ * protocol instances and threads of a session: the keys do not own any
+ * mutable randomness, their operations draw from the state of the thread
+ * calling them. Each state is seeded on first use from the system entropy
+ * source and cleared when the thread exits.
+ */
+__gmp_randstate_struct* thread_randstate();
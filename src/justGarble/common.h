@@ -128,6 +128,16 @@ static inline block RIGHTSHIFT(block bl) {
 #define FREE_XOR
 #define DKC2
 //#define TRUNCATED
+#define HALF_GATES
+
+#if defined(HALF_GATES) && (!defined(FREE_XOR) || defined(TRUNCATED) || defined(ROW_REDUCTION))
+#error "HALF_GATES needs FREE_XOR and excludes TRUNCATED and ROW_REDUCTION"
+#endif
+/* the garbled comparisons size their tables and messages by their AND gates
+ * only (comparison_circuit_table_count in mpc/garbled_comparison.hh) */
+#ifndef FREE_XOR
+#error "The garbled comparisons need FREE_XOR"
+#endif
 
 
 #define TIMES 10
@@ -28,7 +28,64 @@
 #include <malloc.h>
 #include <wmmintrin.h>
 
-#ifdef TRUNCATED
+#if defined(HALF_GATES)
+int evaluate(GarbledCircuit *garbledCircuit, ExtractedLabels extractedLabels,
+		OutputMap outputMap) {
+	GarbledGate *garbledGate;
+	DKCipherContext dkCipherContext;
+	DKCipherInit(&(garbledCircuit->globalKey), &dkCipherContext);
+	GarbledTable *garbledTable = garbledCircuit->garbledTable;
+	int tableIndex = 0;
+	long i, sa, sb;
+	int type, c0, c1, c2;
+	block A, B, WG, WE;
+	block labels[2], tweaks[2], hashes[2];
+	block zero = zero_block();
+
+	for (i = 0; i < garbledCircuit->n; i++) {
+		garbledCircuit->wires[i].label = extractedLabels[i];
+	}
+
+	for (i = 0; i < garbledCircuit->q; i++) {
+		garbledGate = &(garbledCircuit->garbledGates[i]);
+		type = garbledGate->type;
+		A = garbledCircuit->wires[garbledGate->input0].label;
+		B = garbledCircuit->wires[garbledGate->input1].label;
+
+		if (isLinearGate(type)) {
+			// the constant c0 is already in the garbler's labels
+			c0 = gateOutput(type, 0, 0);
+			c1 = gateOutput(type, 1, 0) ^ c0;
+			c2 = gateOutput(type, 0, 1) ^ c0;
+			garbledCircuit->wires[garbledGate->output].label =
+					xorBlocks(c1 ? A : zero, c2 ? B : zero);
+			continue;
+		}
+
+		sa = getLSB(A);
+		sb = getLSB(B);
+
+		labels[0] = A;
+		labels[1] = B;
+		tweaks[0] = makeBlock(2 * i, (long)0);
+		tweaks[1] = makeBlock(2 * i + 1, (long)0);
+		halfGatesHash(labels, tweaks, hashes, 2, &(dkCipherContext.K));
+
+		WG = xorBlocks(hashes[0], sa ? garbledTable[tableIndex].table[0] : zero);
+		WE = xorBlocks(hashes[1],
+				sb ? xorBlocks(garbledTable[tableIndex].table[1], A) : zero);
+
+		garbledCircuit->wires[garbledGate->output].label = xorBlocks(WG, WE);
+		tableIndex++;
+	}
+
+	for (i = 0; i < garbledCircuit->m; i++) {
+		outputMap[i] = garbledCircuit->wires[garbledCircuit->outputs[i]].label;
+	}
+	return 0;
+}
+
+#elif defined(TRUNCATED)
 int evaluate(GarbledCircuit *garbledCircuit, ExtractedLabels extractedLabels,
 		OutputMap outputMap) {
 	GarbledGate *garbledGate;
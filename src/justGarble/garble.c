@@ -173,7 +173,131 @@ int extractLabels(ExtractedLabels extractedLabels, InputLabels inputLabels,
 	return 0;
 
 }
-#ifdef TRUNCATED
+#if defined(HALF_GATES)
+/*
+ * Half-gates garbling (Zahur, Rosulek, Evans 2015).
+ * A non-linear gate computes ((a ^ alpha) & (b ^ beta)) ^ gamma: it is garbled
+ * as an AND gate on the relabeled inputs and only needs two ciphertexts.
+ * Linear gates (XOR, XNOR, NOT, ...) are free.
+ */
+void halfGatesHash(block *labels, block *tweaks, block *out, int n, AES_KEY *K) {
+	int i;
+	block in[4];
+	for (i = 0; i < n; i++) {
+		in[i] = xorBlocks(double_block(labels[i]), tweaks[i]);
+		out[i] = in[i];
+	}
+	AES_ecb_encrypt_blks(out, n, K);
+	for (i = 0; i < n; i++) {
+		out[i] = xorBlocks(out[i], in[i]);
+	}
+}
+
+long garbleCircuit(GarbledCircuit *garbledCircuit, InputLabels inputLabels,
+		OutputMap outputMap) {
+
+	GarblingContext garblingContext;
+	GarbledGate *garbledGate;
+	GarbledTable *garbledTable;
+	long i;
+	int input0, input1, output, type;
+	int c0, c1, c2, s, alpha, beta, gamma;
+	long pa, pb;
+	block a0, b0, TG, TE, WG, WE;
+	block labels[4], tweaks[4], hashes[4];
+	block zero = zero_block();
+	srand_sse(time(NULL));
+
+	createInputLabels(inputLabels, garbledCircuit->n);
+	garbledCircuit->id = getFreshId();
+
+	for (i = 0; i < 2 * garbledCircuit->n; i += 2) {
+		garbledCircuit->wires[i / 2].label0 = inputLabels[i];
+		garbledCircuit->wires[i / 2].label1 = inputLabels[i + 1];
+	}
+	garbledTable = garbledCircuit->garbledTable;
+	block key = randomBlock();
+	garblingContext.R =
+			xorBlocks(garbledCircuit->wires[0].label0, garbledCircuit->wires[0].label1);
+	garbledCircuit->globalKey = key;
+	DKCipherInit(&key, &(garblingContext.dkCipherContext));
+	block R = garblingContext.R;
+	int tableIndex = 0;
+
+	for (i = 0; i < garbledCircuit->q; i++) {
+		garbledGate = &(garbledCircuit->garbledGates[i]);
+		input0 = garbledGate->input0;
+		input1 = garbledGate->input1;
+		output = garbledGate->output;
+		type = garbledGate->type;
+
+		if (isLinearGate(type)) {
+			// out = c0 ^ c1.a ^ c2.b
+			c0 = gateOutput(type, 0, 0);
+			c1 = gateOutput(type, 1, 0) ^ c0;
+			c2 = gateOutput(type, 0, 1) ^ c0;
+			garbledCircuit->wires[output].label0 = xorBlocks(
+					xorBlocks(c1 ? garbledCircuit->wires[input0].label0 : zero,
+							c2 ? garbledCircuit->wires[input1].label0 : zero),
+					c0 ? R : zero);
+			garbledCircuit->wires[output].label1 =
+					xorBlocks(garbledCircuit->wires[output].label0, R);
+			continue;
+		}
+
+		// (1-alpha, 1-beta) is the only input on which the output differs
+		for (s = 0; s < 4; s++) {
+			if (gateOutput(type, s >> 1, s & 1)
+					!= gateOutput(type, (s >> 1) ^ 1, (s & 1) ^ 1)
+					&& gateOutput(type, s >> 1, s & 1)
+							!= gateOutput(type, (s >> 1) ^ 1, s & 1)) {
+				break;
+			}
+		}
+		alpha = 1 - (s >> 1);
+		beta = 1 - (s & 1);
+		gamma = gateOutput(type, alpha, beta);
+
+		a0 = alpha ? garbledCircuit->wires[input0].label1 : garbledCircuit->wires[input0].label0;
+		b0 = beta ? garbledCircuit->wires[input1].label1 : garbledCircuit->wires[input1].label0;
+		pa = getLSB(a0);
+		pb = getLSB(b0);
+
+		labels[0] = a0;
+		labels[1] = xorBlocks(a0, R);
+		labels[2] = b0;
+		labels[3] = xorBlocks(b0, R);
+		tweaks[0] = tweaks[1] = makeBlock(2 * i, (long)0);
+		tweaks[2] = tweaks[3] = makeBlock(2 * i + 1, (long)0);
+		halfGatesHash(labels, tweaks, hashes, 4, &(garblingContext.dkCipherContext.K));
+
+		// generator half
+		TG = xorBlocks(xorBlocks(hashes[0], hashes[1]), pb ? R : zero);
+		WG = xorBlocks(hashes[0], pa ? TG : zero);
+
+		// evaluator half
+		TE = xorBlocks(xorBlocks(hashes[2], hashes[3]), a0);
+		WE = xorBlocks(hashes[2], pb ? xorBlocks(TE, a0) : zero);
+
+		garbledCircuit->wires[output].label0 =
+				xorBlocks(xorBlocks(WG, WE), gamma ? R : zero);
+		garbledCircuit->wires[output].label1 =
+				xorBlocks(garbledCircuit->wires[output].label0, R);
+
+		garbledTable[tableIndex].table[0] = TG;
+		garbledTable[tableIndex].table[1] = TE;
+		tableIndex++;
+	}
+	for (i = 0; i < garbledCircuit->m; i++) {
+		outputMap[2 * i] =
+				garbledCircuit->wires[garbledCircuit->outputs[i]].label0;
+		outputMap[2 * i + 1] =
+				garbledCircuit->wires[garbledCircuit->outputs[i]].label1;
+	}
+	return 0;
+}
+
+#elif defined(TRUNCATED)
 #ifdef ROW_REDUCTION
 long garbleCircuit(GarbledCircuit *garbledCircuit, InputLabels inputLabels, OutputMap outputMap) {
 
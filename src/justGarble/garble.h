@@ -41,6 +41,19 @@ extern "C" {
 #define XOR_ID -2
 #define NOT_ID -3
 
+#ifdef HALF_GATES
+// the output of a gate on (a,b) is the bit 2a+b of its type
+#define gateOutput(type, a, b) (((type) >> (2*(a) + (b))) & 1)
+
+// gates with an even number of ones in their truth table are linear (free)
+static inline int isLinearGate(int type) {
+	return !(__builtin_popcount(type & 15) & 1);
+}
+
+// H(x, j) = AES_K(2x ^ j) ^ (2x ^ j) with the fixed key K, for n <= 4 pairs
+void halfGatesHash(block *labels, block *tweaks, block *out, int n, AES_KEY *K);
+#endif
+
 int createNewGate(Gate *gate, Wire *input0, Wire *input1, Wire *output, int type );
 int createNewWire(Wire *in, GarblingContext *garblingContext, int id);
 int getNextWire(GarblingContext *garblingContext);
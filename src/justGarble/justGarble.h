@@ -53,6 +53,11 @@ typedef struct {
 	char table[4][10];
 
 } GarbledTable;
+#elif defined(HALF_GATES)
+// half-gates: the generator's and the evaluator's half (T_G, T_E)
+typedef struct {
+	block table[2];
+} GarbledTable;
 #else
 typedef struct {
 	block table[4];
@@ -22,6 +22,7 @@
 #include <math/mpz_class.hh>
 #include <math/math_util.hh>
 #include <vector>
+#include <algorithm>
 
 using namespace std;
 
@@ -140,6 +141,41 @@ void FixedPointExp::init() {
     //   }
 }
 
+FixedBaseWindowExp::FixedBaseWindowExp(const mpz_class &g, const mpz_class &mod, unsigned int exp_bits, unsigned int window)
+: mod_(mod), exp_bits_(exp_bits), window_(window)
+{
+    assert(window_ > 0 && window_ < 16);
+    size_t rows = (exp_bits_ + window_ - 1)/window_;
+    size_t cols = ((size_t)1) << window_;
+    table_ = vector<mpz_class>(rows*cols);
+    
+    mpz_class base = g % mod_; // g^(2^(w.i))
+    for (size_t i = 0; i < rows; i++) {
+        table_[i*cols] = 1;
+        for (size_t j = 1; j < cols; j++) {
+            table_[i*cols + j] = (table_[i*cols + j - 1]*base) % mod_;
+        }
+        base = (table_[i*cols + cols - 1]*base) % mod_;
+    }
+}
+
+mpz_class FixedBaseWindowExp::pow(const mpz_class &e) const
+{
+    assert(e >= 0 && mpz_sizeinbase(e.get_mpz_t(),2) <= exp_bits_);
+    
+    size_t rows = (exp_bits_ + window_ - 1)/window_;
+    mpz_class res = 1;
+    for (size_t i = 0; i < rows; i++) {
+        unsigned long digit = 0;
+        for (unsigned int b = 0; b < window_; b++) {
+            digit |= ((unsigned long)mpz_tstbit(e.get_mpz_t(), i*window_ + b)) << b;
+        }
+        // no shortcut for zero digits: the exponent is usually secret
+        res = (res*table_[(i << window_) + digit]) % mod_;
+    }
+    return res;
+}
+
 void FixedPointExp::powerMod(mpz_t& result, mpz_t& e) {
     mpz_set_ui(result, 1);
     for (unsigned u=0; u<m_numberOfElements; u++) {
@@ -153,3 +189,161 @@ void FixedPointExp::powerMod(mpz_t& result, mpz_t& e) {
     }
 }
 
+
+static inline unsigned long window_digit(const mpz_class &e, size_t i, unsigned int w)
+{
+    unsigned long digit = 0;
+    for (unsigned int b = 0; b < w; b++) {
+        digit |= ((unsigned long)mpz_tstbit(e.get_mpz_t(), i*w + b)) << b;
+    }
+    return digit;
+}
+
+// x = x*y mod m, where an empty x stands for 1
+static inline void mul_mod_acc(mpz_class &x, bool &x_set, const mpz_class &y, const mpz_class &mod)
+{
+    if (x_set) {
+        x = (x*y) % mod;
+    } else {
+        x = y;
+        x_set = true;
+    }
+}
+
+// bases are reduced, exponents are positive
+static mpz_class multi_powm_straus(const vector<mpz_class> &b, const vector<mpz_class> &e, size_t bits, unsigned int w, const mpz_class &mod)
+{
+    size_t cols = ((size_t)1) << w;
+    vector<mpz_class> table(b.size()*cols);
+    for (size_t j = 0; j < b.size(); j++) {
+        table[j*cols + 1] = b[j];
+        for (size_t d = 2; d < cols; d++) {
+            table[j*cols + d] = (table[j*cols + d - 1]*b[j]) % mod;
+        }
+    }
+    
+    size_t rows = (bits + w - 1)/w;
+    mpz_class res = 1;
+    bool res_set = false;
+    for (size_t i = rows; i-- > 0;) {
+        if (res_set) {
+            for (unsigned int s = 0; s < w; s++) {
+                res = (res*res) % mod;
+            }
+        }
+        for (size_t j = 0; j < b.size(); j++) {
+            unsigned long d = window_digit(e[j], i, w);
+            if (d != 0) {
+                mul_mod_acc(res, res_set, table[j*cols + d], mod);
+            }
+        }
+    }
+    return res;
+}
+
+static mpz_class multi_powm_pippenger(const vector<mpz_class> &b, const vector<mpz_class> &e, size_t bits, unsigned int w, const mpz_class &mod)
+{
+    size_t cols = ((size_t)1) << w;
+    vector<mpz_class> buckets(cols);
+    vector<bool> bucket_set(cols);
+    
+    size_t rows = (bits + w - 1)/w;
+    mpz_class res = 1;
+    bool res_set = false;
+    for (size_t i = rows; i-- > 0;) {
+        if (res_set) {
+            for (unsigned int s = 0; s < w; s++) {
+                res = (res*res) % mod;
+            }
+        }
+        
+        fill(bucket_set.begin(), bucket_set.end(), false);
+        for (size_t j = 0; j < b.size(); j++) {
+            unsigned long d = window_digit(e[j], i, w);
+            if (d != 0) {
+                bool s = bucket_set[d];
+                mul_mod_acc(buckets[d], s, b[j], mod);
+                bucket_set[d] = s;
+            }
+        }
+        
+        // prod_d buckets[d]^d with running products: 2 multiplications per bucket
+        mpz_class acc, sum;
+        bool acc_set = false, sum_set = false;
+        for (size_t d = cols; d-- > 1;) {
+            if (bucket_set[d]) {
+                mul_mod_acc(acc, acc_set, buckets[d], mod);
+            }
+            if (acc_set) {
+                mul_mod_acc(sum, sum_set, acc, mod);
+            }
+        }
+        if (sum_set) {
+            mul_mod_acc(res, res_set, sum, mod);
+        }
+    }
+    return res;
+}
+
+mpz_class multi_powm(const vector<mpz_class> &bases, const vector<mpz_class> &exps, const mpz_class &mod)
+{
+    assert(bases.size() == exps.size());
+    
+    vector<mpz_class> b, e;
+    size_t bits = 0;
+    for (size_t i = 0; i < bases.size(); i++) {
+        if (exps[i] == 0) {
+            continue;
+        }
+        if (exps[i] < 0) {
+            b.push_back(mpz_class_invert(bases[i], mod));
+            e.push_back(-exps[i]);
+        } else {
+            b.push_back(bases[i] % mod);
+            e.push_back(exps[i]);
+        }
+        bits = max(bits, mpz_sizeinbase(e.back().get_mpz_t(), 2));
+    }
+    
+    if (b.size() == 0) {
+        return mpz_class(1) % mod;
+    }
+    if (b.size() == 1) {
+        return mpz_class_powm(b[0], e[0], mod);
+    }
+    
+    // cost in modular multiplications, squarings included
+    size_t n = b.size();
+    size_t best_cost = 0;
+    unsigned int best_w = 1;
+    bool pippenger = false;
+    for (unsigned int w = 1; w <= 16; w++) {
+        size_t rows = (bits + w - 1)/w;
+        size_t straus = n*((((size_t)1) << w) - 2) + bits + n*rows;
+        size_t bucket = bits + rows*(n + (((size_t)1) << (w+1)));
+        if (best_cost == 0 || straus < best_cost) {
+            best_cost = straus;
+            best_w = w;
+            pippenger = false;
+        }
+        if (bucket < best_cost) {
+            best_cost = bucket;
+            best_w = w;
+            pippenger = true;
+        }
+    }
+    
+    if (pippenger) {
+        return multi_powm_pippenger(b, e, bits, best_w, mod);
+    }
+    return multi_powm_straus(b, e, bits, best_w, mod);
+}
+
+mpz_class multi_powm(const vector<mpz_class> &bases, const vector<long> &exps, const mpz_class &mod)
+{
+    vector<mpz_class> e(exps.size());
+    for (size_t i = 0; i < exps.size(); i++) {
+        e[i] = exps[i];
+    }
+    return multi_powm(bases, e, mod);
+}
@@ -60,4 +60,29 @@ private:
     mpz_t* m_table;
 };
 
+// Fixed-base exponentiation with a window of w bits: the table holds
+// g^(j.2^(w.i)) for 0 <= j < 2^w, so g^e costs exp_bits/w multiplications
+// and no squaring. pow is const and can be shared between threads.
+class FixedBaseWindowExp {
+public:
+    FixedBaseWindowExp(const mpz_class &g, const mpz_class &mod, unsigned int exp_bits, unsigned int window = 4);
+    
+    // e must be non-negative and at most exp_bits() bits long
+    mpz_class pow(const mpz_class &e) const;
+    
+    unsigned int exp_bits() const { return exp_bits_; }
+    unsigned int window() const { return window_; }
+    
+private:
+    const mpz_class mod_;
+    const unsigned int exp_bits_;
+    const unsigned int window_;
+    std::vector<mpz_class> table_; // row i starts at i << window_
+};
 
+// Simultaneous multi-exponentiation: prod bases[i]^exps[i] mod mod with a
+// single squaring chain. Interleaved windows (Straus) for short vectors,
+// bucket method (Pippenger) for long ones, the window being picked by a cost
+// model. Negative exponents invert the base, which must then be invertible.
+mpz_class multi_powm(const std::vector<mpz_class> &bases, const std::vector<mpz_class> &exps, const mpz_class &mod);
+mpz_class multi_powm(const std::vector<mpz_class> &bases, const std::vector<long> &exps, const mpz_class &mod);
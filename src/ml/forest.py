@@ -0,0 +1,55 @@
+#!/usr/bin/evn python2
+
+import math
+import numpy as np
+import os
+from sklearn import metrics, ensemble
+from loaders import *
+
+# the protocol compares integers: features and thresholds are multiplied by
+# SCALE, the queries must be scaled the same way
+SCALE = 1 << 16
+N_TREES = 10
+MAX_DEPTH = 6
+
+def export_forest(clf, fp):
+  # text format read by read_forest_text (tree/model_store.hh)
+  print >>fp, "forest", len(clf.estimators_), len(clf.classes_)
+  for est in clf.estimators_:
+    t = est.tree_
+    print >>fp, "tree", t.node_count
+    for i in xrange(t.node_count):
+      left, right = t.children_left[i], t.children_right[i]
+      if left == -1:
+        feature, threshold = 0, 0
+      else:
+        feature = t.feature[i]
+        threshold = int(math.floor(t.threshold[i] * SCALE))
+      label = int(np.argmax(t.value[i][0]))
+      print >>fp, left, right, feature, threshold, label
+
+if __name__ == '__main__':
+
+  datasets = [
+    ('sbc', load_simple_breast_cancer_data(SIMPLE_BREAST_CANCER_DATA)),
+    ('aud', load_audiology_data(AUDIOLOGY_TRAIN_DATA, AUDIOLOGY_TEST_DATA)),
+    ('nursery', load_nursery_data(NURSERY_DATA)),
+  ]
+
+  np.seterr(all='raise')
+
+  for name, (X_train, X_test, Y_train, Y_test) in datasets:
+
+    clf = ensemble.RandomForestClassifier(n_estimators=N_TREES, max_depth=MAX_DEPTH)
+    clf.fit(X_train, Y_train)
+
+    print "metrics on training data"
+    print metrics.classification_report(Y_train, clf.predict(X_train))
+    print
+
+    print "metrics on testing data"
+    print metrics.classification_report(Y_test, clf.predict(X_test))
+
+    # compile with: compile_forest out/<name>.forest <name>.cfm [packing]
+    with open(os.path.join('out', name + '.forest'), 'w+') as fp:
+      export_forest(clf, fp)
@@ -30,7 +30,7 @@
 using namespace NTL;
 using namespace std;
 
-mpz_class Change_ES_FHE_from_GM_A::blind(const mpz_class &c, GM &gm, gmp_randstate_t state)
+mpz_class Change_ES_FHE_from_GM_A::blind(const mpz_class &c, const GM &gm, gmp_randstate_t state)
 {
 #ifndef BLINDING
     coin_ = 0;
@@ -64,7 +64,7 @@ Ctxt Change_ES_FHE_from_GM_A::unblind(const Ctxt &c, const FHEPubKey& publicKey,
 }
 
 
-Ctxt Change_ES_FHE_from_GM_B::decrypt_encrypt(const mpz_class &c, GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea)
+Ctxt Change_ES_FHE_from_GM_B::decrypt_encrypt(const mpz_class &c, const GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea)
 {
     bool b = gm.decrypt(c);
 
@@ -83,7 +83,7 @@ Ctxt Change_ES_FHE_from_GM_B::decrypt_encrypt(const mpz_class &c, GM_priv &gm, c
 
 
 
-vector<mpz_class> Change_ES_FHE_from_GM_slots_A::blind(const vector<mpz_class> &c, GM &gm, gmp_randstate_t state, unsigned long n_slots)
+vector<mpz_class> Change_ES_FHE_from_GM_slots_A::blind(const vector<mpz_class> &c, const GM &gm, gmp_randstate_t state, unsigned long n_slots)
 {
     size_t n = std::min<size_t>(c.size(),n_slots);
     vector<mpz_class> rand_c(n_slots);
@@ -125,13 +125,10 @@ Ctxt Change_ES_FHE_from_GM_slots_A::unblind(const Ctxt &c, const FHEPubKey& publ
     return d;
 }
 
-Ctxt Change_ES_FHE_from_GM_slots_B::decrypt_encrypt(const vector<mpz_class> &c, GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea)
+Ctxt Change_ES_FHE_from_GM_slots_B::decrypt_encrypt(const vector<mpz_class> &c, const GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea)
 {
-    vector<long> v(c.size());
-    
-    for (size_t i = 0; i < c.size(); i++) {
-        v[i] = gm.decrypt(c[i]);
-    }
+    vector<bool> bits = gm.decrypt_batch(c);
+    vector<long> v(bits.begin(), bits.end());
 
 #ifndef BLINDING
     cout << "Got bits ";
@@ -151,7 +148,7 @@ Ctxt Change_ES_FHE_from_GM_slots_B::decrypt_encrypt(const vector<mpz_class> &c,
 
 }
 
-vector<mpz_class> Change_GM_from_ES_FHE_slots_B::decrypt_encrypt(const Ctxt &c, GM &gm, const FHESecKey &privateKey,
+vector<mpz_class> Change_GM_from_ES_FHE_slots_B::decrypt_encrypt(const Ctxt &c, const GM &gm, const FHESecKey &privateKey,
                                                                const EncryptedArray &ea) {
     // decrypt and test
     vector<long> res_bits;
@@ -175,7 +172,7 @@ vector<mpz_class> Change_GM_from_ES_FHE_slots_B::decrypt_encrypt(const Ctxt &c,
     return v;
 }
 
-vector<mpz_class> Change_GM_from_ES_FHE_slots_A::unblind(const vector<mpz_class> &c, GM &gm)
+vector<mpz_class> Change_GM_from_ES_FHE_slots_A::unblind(const vector<mpz_class> &c, const GM &gm)
 {
     size_t n = c.size();
     vector<mpz_class> real_c(n);
@@ -217,7 +214,7 @@ Ctxt Change_GM_from_ES_FHE_slots_A::blind(const Ctxt &c, const FHEPubKey& public
     return d;
 }
 
-vector<mpz_class> Change_Paillier_from_GM_slots_A::blind(const vector<mpz_class> &c, GM &gm, gmp_randstate_t state, unsigned long n_slots)
+vector<mpz_class> Change_Paillier_from_GM_slots_A::blind(const vector<mpz_class> &c, const GM &gm, gmp_randstate_t state, unsigned long n_slots)
 {
     size_t n = std::min<size_t>(c.size(),n_slots);
     vector<mpz_class> rand_c(n);
@@ -244,7 +241,7 @@ vector<mpz_class> Change_Paillier_from_GM_slots_A::blind(const vector<mpz_class>
     return rand_c;
 }
 
-vector<mpz_class> Change_Paillier_from_GM_slots_A::unblind(const vector<mpz_class> &c_p, Paillier &publicKey)
+vector<mpz_class> Change_Paillier_from_GM_slots_A::unblind(const vector<mpz_class> &c_p, const Paillier &publicKey)
 {
     vector<mpz_class> c_p_unblinded(c_p.size());
 
@@ -256,16 +253,17 @@ vector<mpz_class> Change_Paillier_from_GM_slots_A::unblind(const vector<mpz_clas
     return c_p_unblinded;
 }
 
-vector<mpz_class> Change_Paillier_from_GM_slots_B::decrypt_encrypt(const vector<mpz_class> &c_gm, GM_priv &gm, Paillier &publicKey)
+vector<mpz_class> Change_Paillier_from_GM_slots_B::decrypt_encrypt(const vector<mpz_class> &c_gm, const GM_priv &gm, const Paillier &publicKey)
 {
     vector<mpz_class> c_p(c_gm.size());
+    vector<bool> bits = gm.decrypt_batch(c_gm);
 
 #ifndef BLINDING
     cout << "Got bits ";
 #endif
 
     for (size_t i = 0; i < c_gm.size(); i++) {
-        long v = gm.decrypt(c_gm[i]);
+        long v = bits[i];
 #ifndef BLINDING
         cout << v << ", ";
 #endif
@@ -307,7 +305,7 @@ Ctxt Change_Paillier_from_ES_FHE_slots_A::blind(const Ctxt &c, const FHEPubKey &
 }
 
 vector<mpz_class>
-Change_Paillier_from_ES_FHE_slots_A::unblind(const vector<mpz_class> &c_p, Paillier &publicKey) {
+Change_Paillier_from_ES_FHE_slots_A::unblind(const vector<mpz_class> &c_p, const Paillier &publicKey) {
     vector<mpz_class> c_p_unblinded(c_p.size());
 
     for (size_t i = 0; i < c_p.size(); ++i) {
@@ -319,7 +317,7 @@ Change_Paillier_from_ES_FHE_slots_A::unblind(const vector<mpz_class> &c_p, Paill
     return c_p_unblinded;
 }
 
-vector<mpz_class> Change_Paillier_from_ES_FHE_slots_B::decrypt_encrypt(const Ctxt &c, Paillier &publicKey,
+vector<mpz_class> Change_Paillier_from_ES_FHE_slots_B::decrypt_encrypt(const Ctxt &c, const Paillier &publicKey,
                                                                        const FHESecKey &privateKey,
                                                                        const EncryptedArray &ea) {
     // decrypt and test
@@ -347,7 +345,7 @@ vector<mpz_class> Change_Paillier_from_ES_FHE_slots_B::decrypt_encrypt(const Ctx
 }
 
 vector<mpz_class>
-Move_Paillier_A::blind(const vector<mpz_class> &c_p, Paillier &publicKey, gmp_randstate_t state) {
+Move_Paillier_A::blind(const vector<mpz_class> &c_p, const Paillier &publicKey, gmp_randstate_t state) {
     vector<mpz_class> randomized_values(c_p.size());
     noise_ = vector<mpz_class>(c_p.size());
 
@@ -361,7 +359,7 @@ Move_Paillier_A::blind(const vector<mpz_class> &c_p, Paillier &publicKey, gmp_ra
     return randomized_values;
 }
 
-vector<mpz_class> Move_Paillier_A::enc_noise(Paillier &ownKey) {
+vector<mpz_class> Move_Paillier_A::enc_noise(const Paillier &ownKey) {
     vector<mpz_class> c_noise(noise_.size());
     for (size_t i = 0; i<noise_.size(); ++i) {
         c_noise[i] = ownKey.encrypt(noise_[i]);
@@ -379,7 +377,7 @@ vector<mpz_class> Move_Paillier_B::unblind(const vector<mpz_class> &c_p, const v
 }
 
 vector<mpz_class>
-Move_Paillier_B::decrypt_encrypt(const vector<mpz_class> &c_p, Paillier_priv &privateKey, Paillier &otherKey) {
+Move_Paillier_B::decrypt_encrypt(const vector<mpz_class> &c_p, const Paillier_priv &privateKey, const Paillier &otherKey) {
     vector<mpz_class> reencrypted_values(c_p.size());
 
     for (size_t i = 0; i<c_p.size(); ++i) {
@@ -37,7 +37,7 @@ class Change_ES_FHE_from_GM_A {
 public:
 //    Change_ES_FHE_from_GM_A()
 
-    mpz_class blind(const mpz_class &c, GM &gm, gmp_randstate_t state);
+    mpz_class blind(const mpz_class &c, const GM &gm, gmp_randstate_t state);
     Ctxt unblind(const Ctxt &c, const FHEPubKey& publicKey, const EncryptedArray &ea);
 protected:
     bool coin_;
@@ -45,7 +45,7 @@ protected:
 
 class Change_ES_FHE_from_GM_B {
     public:
-    static Ctxt decrypt_encrypt(const mpz_class &c, GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea);
+    static Ctxt decrypt_encrypt(const mpz_class &c, const GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea);
 };
 
 
@@ -56,7 +56,7 @@ class Change_ES_FHE_from_GM_slots_A {
     public:
     //    Change_ES_FHE_from_GM_A()
     
-    vector<mpz_class> blind(const vector<mpz_class> &c, GM &gm, gmp_randstate_t state, unsigned long n_slots);
+    vector<mpz_class> blind(const vector<mpz_class> &c, const GM &gm, gmp_randstate_t state, unsigned long n_slots);
     Ctxt unblind(const Ctxt &c, const FHEPubKey& publicKey, const EncryptedArray &ea);
     protected:
     vector<long> coins_;
@@ -64,7 +64,7 @@ class Change_ES_FHE_from_GM_slots_A {
 
 class Change_ES_FHE_from_GM_slots_B {
     public:
-    static Ctxt decrypt_encrypt(const vector<mpz_class> &c, GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea);
+    static Ctxt decrypt_encrypt(const vector<mpz_class> &c, const GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea);
 };
 
 /*
@@ -73,7 +73,7 @@ class Change_ES_FHE_from_GM_slots_B {
 class Change_GM_from_ES_FHE_slots_A {
 public:
 
-    vector<mpz_class> unblind(const vector<mpz_class> &c, GM &gm);
+    vector<mpz_class> unblind(const vector<mpz_class> &c, const GM &gm);
     Ctxt blind(const Ctxt &c, const FHEPubKey& publicKey, const EncryptedArray &ea, gmp_randstate_t state, unsigned long n_slots);
 protected:
     vector<long> coins_;
@@ -81,7 +81,7 @@ protected:
 
 class Change_GM_from_ES_FHE_slots_B {
 public:
-    static vector<mpz_class> decrypt_encrypt(const Ctxt &c, GM &gm, const FHESecKey &privateKey, const EncryptedArray &ea);
+    static vector<mpz_class> decrypt_encrypt(const Ctxt &c, const GM &gm, const FHESecKey &privateKey, const EncryptedArray &ea);
 };
 
 /*
@@ -90,15 +90,15 @@ public:
 class Change_Paillier_from_GM_slots_A {
 public:
 
-    vector<mpz_class> blind(const vector<mpz_class> &c_gm, GM &gm, gmp_randstate_t state, unsigned long n_slots);
-    vector<mpz_class> unblind(const vector<mpz_class> &c_p, Paillier &publicKey);
+    vector<mpz_class> blind(const vector<mpz_class> &c_gm, const GM &gm, gmp_randstate_t state, unsigned long n_slots);
+    vector<mpz_class> unblind(const vector<mpz_class> &c_p, const Paillier &publicKey);
 protected:
     vector<bool> coins_;
 };
 
 class Change_Paillier_from_GM_slots_B {
 public:
-    static vector<mpz_class> decrypt_encrypt(const vector<mpz_class> &c_gm, GM_priv &gm, Paillier &publicKey);
+    static vector<mpz_class> decrypt_encrypt(const vector<mpz_class> &c_gm, const GM_priv &gm, const Paillier &publicKey);
 };
 
 /*
@@ -108,14 +108,14 @@ class Change_Paillier_from_ES_FHE_slots_A {
 public:
 
     Ctxt blind(const Ctxt &c, const FHEPubKey& publicKey, const EncryptedArray &ea, gmp_randstate_t state, unsigned long n_slots);
-    vector<mpz_class> unblind(const vector<mpz_class> &c_p, Paillier &publicKey);
+    vector<mpz_class> unblind(const vector<mpz_class> &c_p, const Paillier &publicKey);
 protected:
     vector<long> coins_;
 };
 
 class Change_Paillier_from_ES_FHE_slots_B {
 public:
-    static vector<mpz_class> decrypt_encrypt(const Ctxt &c, Paillier &publicKey, const FHESecKey &privateKey, const EncryptedArray &ea);
+    static vector<mpz_class> decrypt_encrypt(const Ctxt &c, const Paillier &publicKey, const FHESecKey &privateKey, const EncryptedArray &ea);
 };
 
 /*
@@ -124,8 +124,8 @@ public:
 class Move_Paillier_A {
 public:
 
-    vector<mpz_class> blind(const vector<mpz_class> &c_p, Paillier &publicKey, gmp_randstate_t state);
-    vector<mpz_class> enc_noise(Paillier &ownKey);
+    vector<mpz_class> blind(const vector<mpz_class> &c_p, const Paillier &publicKey, gmp_randstate_t state);
+    vector<mpz_class> enc_noise(const Paillier &ownKey);
 
 protected:
     vector<mpz_class> noise_;
@@ -134,5 +134,5 @@ protected:
 class Move_Paillier_B {
 public:
     vector<mpz_class> unblind(const vector<mpz_class> &c_p, const vector<mpz_class> &noise, const Paillier &publicKey);
-    static vector<mpz_class> decrypt_encrypt(const vector<mpz_class> &c_p, Paillier_priv &privateKey, Paillier &otherKey);
+    static vector<mpz_class> decrypt_encrypt(const vector<mpz_class> &c_p, const Paillier_priv &privateKey, const Paillier &otherKey);
 };
\ No newline at end of file
@@ -31,7 +31,7 @@ public:
     virtual void set_bit_length(size_t l) = 0;
     
     virtual mpz_class output() const = 0;
-    virtual GM gm() const = 0;
+    virtual const GM& gm() const = 0;
 };
 
 // party B has the secret parameters
@@ -41,7 +41,7 @@ public:
     virtual size_t bit_length() const { return 0; }
     virtual void set_bit_length(size_t l) = 0;
 
-    virtual GM_priv gm() const = 0;
+    virtual const GM_priv& gm() const = 0;
 };
 
 // dynamicaly call the right test function
@@ -20,11 +20,11 @@
 
 #include <mpc/enc_argmax.hh>
 #include <algorithm>
-#include <thread>
+#include <util/executor.hh>
 #include <ctime>
 
 
-EncArgmax_Owner::EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, Paillier &p, function<Comparison_protocol_A*()> comparator_creator, gmp_randstate_t state)
+EncArgmax_Owner::EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, const Paillier &p, function<Comparison_protocol_A*()> comparator_creator, gmp_randstate_t state)
 : k_(a.size()),is_protocol_done_(false)
 {
     perm_ = genRandomPermutation(k_,state);
@@ -65,7 +65,7 @@ void EncArgmax_Owner::unpermuteResult(size_t argmax_perm)
 
 
 
-EncArgmax_Helper::EncArgmax_Helper(const size_t &l, const size_t &k,Paillier_priv_fast &pp, function<Comparison_protocol_B*()> comparator_creator)
+EncArgmax_Helper::EncArgmax_Helper(const size_t &l, const size_t &k,const Paillier_priv_fast &pp, function<Comparison_protocol_B*()> comparator_creator)
 : k_(k)
 {
     comparators_ = vector< vector<Rev_EncCompare_Helper*> >(k_);
@@ -192,26 +192,20 @@ void runProtocol(EncArgmax_Owner &owner, EncArgmax_Helper &helper, gmp_randstate
     size_t m = (k-1)*(k-2)/2;
     m = ceilf( ((float)m)/num_threads);
     
-    thread threads[num_threads];
-    size_t t = 0, c_count = 0, i_begin = 0;
+    Task_Group group;
+    size_t c_count = 0, i_begin = 0;
     for (size_t i = 0; i < k; i++) {
         c_count += i;
         if (c_count >= m) {
-            threads[t] = thread(threadCall, &owner, &helper, state, lambda, i_begin,i+1);
+            group.run([&owner, &helper, state, lambda, i_begin, i]() { threadCall(&owner, &helper, state, lambda, i_begin, i+1); });
             i_begin = i+1;
             c_count = 0;
-            t++;
         }
     }
     if (c_count >0) {
-        threads[t] = thread(threadCall, &owner, &helper, state, lambda, i_begin,k);
-        t++;
-    }
-
-    size_t t_max = t;
-    for (t = 0; t < t_max; t++) {
-        threads[t].join();
+        group.run([&owner, &helper, state, lambda, i_begin, k]() { threadCall(&owner, &helper, state, lambda, i_begin, k); });
     }
+    group.wait();
 
     helper.sort();
     owner.unpermuteResult(helper.permuted_argmax());
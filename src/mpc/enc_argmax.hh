@@ -34,7 +34,7 @@ using namespace std;
 
 class EncArgmax_Owner {
 public:
-    EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, Paillier &p, function<Comparison_protocol_A*()> comparator_creator, gmp_randstate_t state);
+    EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, const Paillier &p, function<Comparison_protocol_A*()> comparator_creator, gmp_randstate_t state);
     ~EncArgmax_Owner();
     
     vector< vector<Rev_EncCompare_Owner*> >comparators() const { return comparators_; }
@@ -56,7 +56,7 @@ protected:
 
 class EncArgmax_Helper {
 public:
-    EncArgmax_Helper(const size_t &l, const size_t &k,Paillier_priv_fast &pp, function<Comparison_protocol_B*()> comparator_creator);
+    EncArgmax_Helper(const size_t &l, const size_t &k,const Paillier_priv_fast &pp, function<Comparison_protocol_B*()> comparator_creator);
 
     ~EncArgmax_Helper();
     
@@ -35,7 +35,7 @@
 
 class EncCompare_Owner {
 public:
-    EncCompare_Owner(const mpz_class &v_a, const mpz_class &v_b, const size_t &l, Paillier &p, Comparison_protocol_B *comparator, gmp_randstate_t state);
+    EncCompare_Owner(const mpz_class &v_a, const mpz_class &v_b, const size_t &l, const Paillier &p, Comparison_protocol_B *comparator, gmp_randstate_t state);
     ~EncCompare_Owner();
     
     void set_input(const mpz_class &v_a, const mpz_class &v_b);
@@ -43,7 +43,7 @@ public:
     void decryptResult(const mpz_class &c_t);
     inline bool output() const { assert(is_protocol_done_); return t_; }
     
-    Paillier paillier() const { return paillier_; }
+    const Paillier& paillier() const { return paillier_; }
     Comparison_protocol_B* comparator() { return comparator_; };
 
     
@@ -55,7 +55,7 @@ public:
 protected:
     mpz_class a_,b_;
     size_t bit_length_;
-    Paillier paillier_;
+    const Paillier &paillier_;
     Comparison_protocol_B *comparator_;
     gmp_randstate_t randstate_;
     
@@ -73,12 +73,12 @@ protected:
 
 class EncCompare_Helper {
 public:
-    EncCompare_Helper(const size_t &l, Paillier_priv_fast &pp, Comparison_protocol_A *comparator);
+    EncCompare_Helper(const size_t &l, const Paillier_priv_fast &pp, Comparison_protocol_A *comparator);
     ~EncCompare_Helper();
     void setup(const mpz_class &c_z);
     mpz_class concludeProtocol(const mpz_class &c_r_l_);
 
-    Paillier_priv_fast paillier() const { return paillier_; }
+    const Paillier_priv_fast& paillier() const { return paillier_; }
     Comparison_protocol_A* comparator() { return comparator_; };
     
     bool is_set_up() const { return is_set_up_; }
@@ -87,7 +87,7 @@ public:
     mpz_class encrypted_output() const { return c_t_; }
 protected:
     size_t bit_length_;
-    Paillier_priv_fast paillier_;
+    const Paillier_priv_fast &paillier_;
     Comparison_protocol_A *comparator_;
     
     /* intermediate values */
@@ -23,6 +23,8 @@
 using namespace std;
 
 #include<iostream>
+#include <cstring>
+#include <malloc.h>
 
 #include <justGarble/gates.h>
 
@@ -111,7 +113,7 @@ GarbledCircuit* create_comparison_circuit(GarblingContext *garblingContext, size
     
     int n = 2*l+1; // # of input bits
     int m = 1; // one output bit : the result
-    int q = 4*l-1; // number of gates : 2 (first round) + 4*(l-1) other rounds + 1 (final XOR)
+    int q = comparison_circuit_gate_count(l); // number of gates : 2 (first round) + 4*(l-1) other rounds + 1 (final XOR)
     int r = n+4*l+1; // number of wires
   
     block *labels = (block*) malloc(sizeof(block) * 2 * n);
@@ -147,18 +149,22 @@ GarbledCircuit* create_comparison_circuit(GarblingContext *garblingContext, size
     return gc;
 }
 
-GC_Compare_A::GC_Compare_A(const mpz_class &x, const size_t &l, GM &gm, gmp_randstate_t state)
-: a_(x), bit_length_(l), gm_(gm)
+GC_Compare_A::GC_Compare_A(const mpz_class &x, const size_t &l, const GM &gm, gmp_randstate_t state, OTExtension *ot_extension)
+: a_(x), bit_length_(l), gm_(gm), ot_extension_(ot_extension)
 {
     s_ = 1 - 2*gmp_urandomb_ui(state,1);
     gmp_randinit_set(randstate_, state);
 }
 
-void GC_Compare_A::prepare_circuit()
+void GC_Compare_A::prepare_circuit(GarbledTable *table)
 {
-    GarblingContext garblingContext;
-    
-    gc_ = create_comparison_circuit(&garblingContext, bit_length_, NULL);
+    skeleton_ = GC_Circuit_Cache::instance().comparison_circuit(bit_length_);
+    gc_ = skeleton_->instantiate();
+
+    if (table) {
+        free(gc_->garbledTable);
+        gc_->garbledTable = table;
+    }
 }
 
 void GC_Compare_A::evaluateGC(InputLabels a_inputLabels, InputLabels b_inputLabels)
@@ -209,19 +215,23 @@ vector<bool> GC_Compare_A::get_a_bits()
 }
 
 
-GC_Compare_B::GC_Compare_B(const mpz_class &y, const size_t &l, GM_priv &gm, gmp_randstate_t state)
-: b_(y), bit_length_(l), gm_(gm), mask_(0)
+GC_Compare_B::GC_Compare_B(const mpz_class &y, const size_t &l, const GM_priv &gm, gmp_randstate_t state, OTExtension *ot_extension)
+: b_(y), bit_length_(l), gm_(gm), mask_(0), ot_extension_(ot_extension)
 {
     mask_ = gmp_urandomb_ui(state,1);
 }
 
 
-void GC_Compare_B::prepare_circuit()
+void GC_Compare_B::prepare_circuit(GarbledTable *table)
 {
-    GarblingContext garblingContext;
-    
-    gc_ = create_comparison_circuit(&garblingContext, bit_length_,&outputMap_);
-    
+    skeleton_ = GC_Circuit_Cache::instance().comparison_circuit(bit_length_);
+    gc_ = skeleton_->instantiate(&outputMap_);
+
+    if (table) {
+        free(gc_->garbledTable);
+        gc_->garbledTable = table;
+    }
+
     createInputLabels(gc_->inputLabels,gc_->n);
     
     garbleCircuit(gc_, gc_->inputLabels, outputMap_);
@@ -267,6 +277,127 @@ mpz_class GC_Compare_B::get_enc_mask()
     return gm_.encrypt(mask_);
 }
 
+GC_Batch_Frame::GC_Batch_Frame(size_t n, size_t l)
+: n_(n), l_(l), t_(comparison_circuit_table_count(l))
+{
+    size_ = (3*n_ + n_*(l_+1))*sizeof(block) + n_*t_*sizeof(GarbledTable);
+    data_ = (char *)memalign(128, size_);
+}
+
+GC_Batch_Frame::~GC_Batch_Frame()
+{
+    free(data_);
+}
+
+GC_Compare_Batch_A::GC_Compare_Batch_A(const vector<GC_Compare_A*> &comparators)
+: comparators_(comparators), bit_length_(0), frame_(NULL)
+{
+    assert(comparators_.size() > 0);
+    bit_length_ = comparators_[0]->bit_length();
+}
+
+GC_Compare_Batch_A::~GC_Compare_Batch_A()
+{
+    delete frame_;
+}
+
+void GC_Compare_Batch_A::prepare_circuits()
+{
+    frame_ = new GC_Batch_Frame(comparators_.size(), bit_length_);
+
+    for (size_t i = 0; i < comparators_.size(); i++) {
+        assert(comparators_[i]->bit_length() == bit_length_);
+        comparators_[i]->prepare_circuit(frame_->garbled_table(i));
+    }
+}
+
+vector<bool> GC_Compare_Batch_A::get_a_bits()
+{
+    vector<bool> bits;
+    bits.reserve(comparators_.size()*bit_length_);
+
+    for (size_t i = 0; i < comparators_.size(); i++) {
+        vector<bool> a_bits = comparators_[i]->get_a_bits();
+        bits.insert(bits.end(), a_bits.begin(), a_bits.end());
+    }
+
+    return bits;
+}
+
+void GC_Compare_Batch_A::evaluateGC(InputLabels a_inputLabels)
+{
+    for (size_t i = 0; i < comparators_.size(); i++) {
+        comparators_[i]->set_global_key(frame_->global_keys()[i]);
+        comparators_[i]->evaluateGC(a_inputLabels + i*bit_length_, frame_->b_input_labels(i));
+        comparators_[i]->map_output(frame_->output_map(i));
+    }
+}
+
+void GC_Compare_Batch_A::unblind(const vector<mpz_class> &enc_masks)
+{
+    assert(enc_masks.size() == comparators_.size());
+
+    for (size_t i = 0; i < comparators_.size(); i++) {
+        comparators_[i]->unblind(enc_masks[i]);
+    }
+}
+
+GC_Compare_Batch_B::GC_Compare_Batch_B(const vector<GC_Compare_B*> &comparators)
+: comparators_(comparators), bit_length_(0), frame_(NULL)
+{
+    assert(comparators_.size() > 0);
+    bit_length_ = comparators_[0]->bit_length();
+}
+
+GC_Compare_Batch_B::~GC_Compare_Batch_B()
+{
+    delete frame_;
+}
+
+void GC_Compare_Batch_B::prepare_circuits()
+{
+    frame_ = new GC_Batch_Frame(comparators_.size(), bit_length_);
+
+    for (size_t i = 0; i < comparators_.size(); i++) {
+        assert(comparators_[i]->bit_length() == bit_length_);
+        comparators_[i]->prepare_circuit(frame_->garbled_table(i));
+
+        frame_->global_keys()[i] = comparators_[i]->get_global_key();
+
+        OutputMap om = comparators_[i]->get_output_map();
+        frame_->output_map(i)[0] = om[0];
+        frame_->output_map(i)[1] = om[1];
+
+        block *b_labels = comparators_[i]->get_b_input_labels();
+        memcpy(frame_->b_input_labels(i), b_labels, (bit_length_+1)*sizeof(block));
+        free(b_labels);
+    }
+}
+
+InputLabels GC_Compare_Batch_B::get_all_a_input_labels()
+{
+    block *a_ins = (block *)malloc(2*comparators_.size()*bit_length_*sizeof(block));
+
+    for (size_t i = 0; i < comparators_.size(); i++) {
+        block *labels = comparators_[i]->get_all_a_input_labels();
+        memcpy(a_ins + 2*i*bit_length_, labels, 2*bit_length_*sizeof(block));
+        free(labels);
+    }
+
+    return a_ins;
+}
+
+vector<mpz_class> GC_Compare_Batch_B::get_enc_masks()
+{
+    vector<mpz_class> masks(comparators_.size());
+
+    for (size_t i = 0; i < comparators_.size(); i++) {
+        masks[i] = comparators_[i]->get_enc_mask();
+    }
+
+    return masks;
+}
+
 
 
 
@@ -317,4 +448,32 @@ void runProtocol(GC_Compare_A &party_a, GC_Compare_B &party_b, gmp_randstate_t s
     outputVals[0] = party_a.map_output(party_b.get_output_map());
     
     party_a.unblind(party_b.get_enc_mask());
-}
\ No newline at end of file
+}
+void runProtocol(GC_Compare_Batch_A &party_a, GC_Compare_Batch_B &party_b, gmp_randstate_t state)
+{
+    party_a.prepare_circuits();
+    party_b.prepare_circuits();
+    
+    // the frame is what goes through the network
+    assert(party_a.frame()->size() == party_b.frame()->size());
+    memcpy(party_a.frame()->data(), party_b.frame()->data(), party_b.frame()->size());
+    
+    size_t n_labels = party_a.size()*party_a.bit_length();
+    int *a_inputs = (int *)malloc(n_labels*sizeof(int));
+    block *a_labels = (block *)malloc(n_labels*sizeof(block));
+    
+    // to get a_labels, you HAVE TO run some OT with B
+    vector<bool> a_bits = party_a.get_a_bits();
+    for (size_t i = 0; i < n_labels; i++) {
+        a_inputs[i] = a_bits[i];
+    }
+    block *all_a_labels = party_b.get_all_a_input_labels();
+    extractLabels(a_labels, all_a_labels, a_inputs, n_labels);
+    
+    party_a.evaluateGC(a_labels);
+    party_a.unblind(party_b.get_enc_masks());
+    
+    free(all_a_labels);
+    free(a_labels);
+    free(a_inputs);
+}
@@ -22,21 +22,27 @@
 #define __ciphermed_proj__garbled_comparison__
 
 #include <vector>
+#include <memory>
 #include <gmpxx.h>
 
 #include <crypto/gm.hh>
 
 #include <mpc/comparison_protocol.hh>
+#include <mpc/gc_circuit_cache.hh>
 
 #include <justGarble/justGarble.h>
 
+class OTExtension;
+
 class GC_Compare_A : public Comparison_protocol_A {
 public:
     
-    GC_Compare_A(const mpz_class &x, const size_t &l, GM &gm, gmp_randstate_t state);
+    GC_Compare_A(const mpz_class &x, const size_t &l, const GM &gm, gmp_randstate_t state, OTExtension *ot_extension = NULL);
     void set_value(const mpz_class &x) { a_ = x; };
 
-    void prepare_circuit();
+    // the gates come from the process-wide skeleton cache
+    // if table is not NULL, the garbled table is stored there (l AND gates)
+    void prepare_circuit(GarbledTable *table = NULL);
     
     std::vector<bool> get_a_bits();
     
@@ -49,9 +55,11 @@ public:
 
     GarbledCircuit* get_garbled_circuit(){ return gc_; };
 
+    // when set, the OTs for a's labels are extended from this object's base OTs
+    OTExtension* ot_extension() const { return ot_extension_; }
+    void set_ot_extension(OTExtension *ot_extension) { ot_extension_ = ot_extension; }
     
-    
-    GM gm() const { return gm_; }
+    const GM& gm() const { return gm_; }
     size_t bit_length() const { return bit_length_; }
     virtual void set_bit_length(size_t l) {bit_length_ = l;}
     
@@ -63,15 +71,18 @@ protected:
     long s_;
     size_t bit_length_; // bit length of the numbers to compare
     
+    std::shared_ptr<const GC_Circuit_Skeleton> skeleton_; // shared gates of gc_
     GarbledCircuit *gc_;
     block computedOutput_;
     
-    GM gm_;
+    const GM &gm_;
     gmp_randstate_t randstate_;
     
     mpz_class res_;
     int blinded_res_;
 
+    OTExtension *ot_extension_;
+
 };
 
 
@@ -79,10 +90,12 @@ protected:
 class GC_Compare_B : public Comparison_protocol_B {
 public:
     
-    GC_Compare_B(const mpz_class &y, const size_t &l, GM_priv &gm, gmp_randstate_t state);
+    GC_Compare_B(const mpz_class &y, const size_t &l, const GM_priv &gm, gmp_randstate_t state, OTExtension *ot_extension = NULL);
     void set_value(const mpz_class &y) { b_ = y; };
     
-    void prepare_circuit();
+    // the gates come from the process-wide skeleton cache, only the table is garbled
+    // if table is not NULL, the circuit is garbled directly into it (l AND gates)
+    void prepare_circuit(GarbledTable *table = NULL);
     
     
     GarbledCircuit* get_garbled_circuit(){ return gc_; };
@@ -95,10 +108,13 @@ public:
     InputLabels get_all_a_input_labels();
     InputLabels get_b_input_labels();
 
+    OTExtension* ot_extension() const { return ot_extension_; }
+    void set_ot_extension(OTExtension *ot_extension) { ot_extension_ = ot_extension; }
+
     int get_mask(){ return mask_; }
     mpz_class get_enc_mask();
     
-    GM_priv gm() const { return gm_; };
+    const GM_priv& gm() const { return gm_; };
     size_t bit_length() const { return bit_length_; }
     virtual void set_bit_length(size_t l) {bit_length_ = l;}
     
@@ -106,15 +122,103 @@ public:
     mpz_class b_;
 protected:
     size_t bit_length_; // bit length of the numbers to compare
+    std::shared_ptr<const GC_Circuit_Skeleton> skeleton_; // shared gates of gc_
     GarbledCircuit *gc_;
-    GM_priv gm_;
+    const GM_priv &gm_;
     
     int mask_;
 
     OutputMap outputMap_;
 
+    OTExtension *ot_extension_;
+};
+
+/*
+ * Batched garbled comparisons: the circuits of all the comparisons are garbled
+ * into one buffer (the frame) that is sent in a single write, and the inputs
+ * of the evaluator are transfered with a single batch of OTs.
+ *
+ * Frame layout, for n comparisons over l bits:
+ *   global keys (n blocks) | output maps (2n blocks) |
+ *   b's labels (n(l+1) blocks) | garbled tables (nl GarbledTable)
+ *
+ * The batch objects do not own the comparators.
+ */
+
+class GC_Batch_Frame {
+public:
+    GC_Batch_Frame(size_t n, size_t l);
+    ~GC_Batch_Frame();
+
+    char* data() { return data_; }
+    size_t size() const { return size_; }
+
+    block* global_keys() { return (block *)data_; }
+    OutputMap output_map(size_t i) { return (block *)data_ + n_ + 2*i; }
+    InputLabels b_input_labels(size_t i) { return (block *)data_ + 3*n_ + i*(l_+1); }
+    GarbledTable* garbled_table(size_t i) { return (GarbledTable *)((block *)data_ + 3*n_ + n_*(l_+1)) + i*t_; }
+
+protected:
+    size_t n_, l_, t_;
+    size_t size_;
+    char *data_;
+
+private:
+    GC_Batch_Frame(const GC_Batch_Frame&);
+    GC_Batch_Frame& operator=(const GC_Batch_Frame&);
 };
 
+class GC_Compare_Batch_A {
+public:
+    GC_Compare_Batch_A(const std::vector<GC_Compare_A*> &comparators);
+    ~GC_Compare_Batch_A();
+
+    void prepare_circuits();
+
+    // the frame has to be filled with B's frame before evaluation
+    GC_Batch_Frame* frame() { return frame_; }
+
+    std::vector<bool> get_a_bits(); // bits of all the comparisons, concatenated
+    void evaluateGC(InputLabels a_inputLabels); // n*l labels
+    void unblind(const std::vector<mpz_class> &enc_masks);
+
+    OTExtension* ot_extension() const { return comparators_[0]->ot_extension(); }
+    size_t size() const { return comparators_.size(); }
+    size_t bit_length() const { return bit_length_; }
+
+protected:
+    std::vector<GC_Compare_A*> comparators_;
+    size_t bit_length_;
+    GC_Batch_Frame *frame_;
+};
+
+class GC_Compare_Batch_B {
+public:
+    GC_Compare_Batch_B(const std::vector<GC_Compare_B*> &comparators);
+    ~GC_Compare_Batch_B();
+
+    void prepare_circuits();
+
+    GC_Batch_Frame* frame() { return frame_; }
+
+    InputLabels get_all_a_input_labels(); // 2*n*l labels, to be freed by the caller
+    std::vector<mpz_class> get_enc_masks();
+
+    OTExtension* ot_extension() const { return comparators_[0]->ot_extension(); }
+    size_t size() const { return comparators_.size(); }
+    size_t bit_length() const { return bit_length_; }
+
+protected:
+    std::vector<GC_Compare_B*> comparators_;
+    size_t bit_length_;
+    GC_Batch_Frame *frame_;
+};
+
+inline int comparison_circuit_gate_count(size_t l) { return 4*l-1; }
+// only the l AND gates have a garbled table, the XORs are free (justGarble
+// is built with FREE_XOR, see justGarble/common.h)
+inline int comparison_circuit_table_count(size_t l) { return l; }
+
 int CompareCircuit(GarbledCircuit *gc, GarblingContext *garblingContext, int n,               int* inputs, int* outputs);
 int OneBitCompareCircuit(GarbledCircuit *gc, GarblingContext *garblingContext, int* inputs, int* outputs);
 int FirstRound_OneBitCompareCircuit(GarbledCircuit *garbledCircuit, GarblingContext *garblingContext, int* inputs, int* outputs);
@@ -126,4 +230,6 @@ inline void runProtocol(GC_Compare_A *party_a, GC_Compare_B *party_b, gmp_randst
 {
     runProtocol(*party_a,*party_b, state);
 }
+
+void runProtocol(GC_Compare_Batch_A &party_a, GC_Compare_Batch_B &party_b, gmp_randstate_t state);
 #endif /* defined(__ciphermed_proj__garbled_comparison__) */
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <mpc/gc_circuit_cache.hh>
+
+#include <mpc/garbled_comparison.hh>
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+
+using namespace std;
+
+GC_Circuit_Skeleton::GC_Circuit_Skeleton(size_t l)
+: l_(l)
+{
+    GarblingContext garblingContext;
+    OutputMap om;
+    
+    // build a throw-away instance and only keep its topology
+    GarbledCircuit *gc = create_comparison_circuit(&garblingContext, l, &om);
+    
+    n_ = gc->n;
+    m_ = gc->m;
+    q_ = gc->q;
+    r_ = gc->r;
+    gates_ = gc->garbledGates;
+    outputs_ = gc->outputs;
+    
+    free(garblingContext.fixedWires);
+    free(gc->garbledTable);
+    free(gc->wires);
+    free(gc->inputLabels);
+    free(gc);
+    free(om);
+}
+
+GC_Circuit_Skeleton::~GC_Circuit_Skeleton()
+{
+    free(gates_);
+    free(outputs_);
+}
+
+GarbledCircuit* GC_Circuit_Skeleton::instantiate(OutputMap *om) const
+{
+    GarbledCircuit *gc = (GarbledCircuit *)malloc(sizeof(GarbledCircuit));
+    
+    gc->n = n_;
+    gc->m = m_;
+    gc->q = q_;
+    gc->r = r_;
+    gc->id = 0;
+    
+    // garbling and evaluation never write to the gates nor to the outputs
+    gc->garbledGates = gates_;
+    gc->outputs = outputs_;
+    
+    gc->garbledTable = (GarbledTable *)memalign(128, sizeof(GarbledTable)*comparison_circuit_table_count(l_));
+    gc->wires = (Wire *)memalign(128, sizeof(Wire)*r_);
+    gc->inputLabels = (block *)malloc(2*n_*sizeof(block));
+    memset(gc->wires, 0, sizeof(Wire)*r_);
+    
+    if (om) {
+        *om = (OutputMap)malloc(2*m_*sizeof(block));
+    }
+    
+    return gc;
+}
+
+GC_Circuit_Cache& GC_Circuit_Cache::instance()
+{
+    static GC_Circuit_Cache cache;
+    return cache;
+}
+
+GC_Circuit_Cache::GC_Circuit_Cache(size_t capacity)
+: capacity_(capacity)
+{
+    assert(capacity_ > 0);
+}
+
+shared_ptr<const GC_Circuit_Skeleton> GC_Circuit_Cache::comparison_circuit(size_t l)
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        map<size_t, entry>::iterator it = skeletons_.find(l);
+        if (it != skeletons_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.second);
+            return it->second.first;
+        }
+    }
+    
+    // build outside of the lock: concurrent misses on the same l are harmless
+    shared_ptr<const GC_Circuit_Skeleton> skeleton = make_shared<GC_Circuit_Skeleton>(l);
+    
+    lock_guard<mutex> lock(mutex_);
+    map<size_t, entry>::iterator it = skeletons_.find(l);
+    if (it != skeletons_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second.second);
+        return it->second.first;
+    }
+    
+    lru_.push_front(l);
+    skeletons_[l] = entry(skeleton, lru_.begin());
+    evict();
+    
+    return skeleton;
+}
+
+void GC_Circuit_Cache::set_capacity(size_t capacity)
+{
+    assert(capacity > 0);
+    lock_guard<mutex> lock(mutex_);
+    capacity_ = capacity;
+    evict();
+}
+
+size_t GC_Circuit_Cache::capacity() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return capacity_;
+}
+
+size_t GC_Circuit_Cache::size() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return skeletons_.size();
+}
+
+void GC_Circuit_Cache::clear()
+{
+    lock_guard<mutex> lock(mutex_);
+    skeletons_.clear();
+    lru_.clear();
+}
+
+// must be called with the lock held
+void GC_Circuit_Cache::evict()
+{
+    while (skeletons_.size() > capacity_) {
+        skeletons_.erase(lru_.back());
+        lru_.pop_back();
+    }
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <justGarble/justGarble.h>
+
+// number of distinct bit lengths kept by default
+#define GC_CIRCUIT_CACHE_CAPACITY 16
+
+/*
+ * Topology of a comparison circuit over l bits: the gates only depend on l so
+ * they are built once and shared (read-only) by every garbled instance.
+ * Instances own their wires, labels and garbled table.
+ */
+class GC_Circuit_Skeleton {
+public:
+    GC_Circuit_Skeleton(size_t l);
+    ~GC_Circuit_Skeleton();
+
+    // allocates a garbled circuit using the skeleton's gates
+    // the output map (2 blocks) is allocated if om is not NULL
+    GarbledCircuit* instantiate(OutputMap *om = NULL) const;
+
+    size_t bit_length() const { return l_; }
+
+protected:
+    size_t l_;
+    int n_, m_, q_, r_;
+    GarbledGate *gates_;
+    int *outputs_;
+
+private:
+    GC_Circuit_Skeleton(const GC_Circuit_Skeleton&);
+    GC_Circuit_Skeleton& operator=(const GC_Circuit_Skeleton&);
+};
+
+/*
+ * Process-wide LRU cache of comparison skeletons, keyed by bit length.
+ * Evicted skeletons stay alive as long as some circuit still uses them.
+ */
+class GC_Circuit_Cache {
+public:
+    static GC_Circuit_Cache& instance();
+
+    std::shared_ptr<const GC_Circuit_Skeleton> comparison_circuit(size_t l);
+
+    void set_capacity(size_t capacity);
+    size_t capacity() const;
+    size_t size() const;
+    void clear();
+
+protected:
+    GC_Circuit_Cache(size_t capacity = GC_CIRCUIT_CACHE_CAPACITY);
+    void evict();
+
+    typedef std::list<size_t> lru_list;
+    typedef std::pair<std::shared_ptr<const GC_Circuit_Skeleton>, lru_list::iterator> entry;
+
+    mutable std::mutex mutex_;
+    size_t capacity_;
+    std::map<size_t, entry> skeletons_;
+    lru_list lru_; // most recently used first
+
+private:
+    GC_Circuit_Cache(const GC_Circuit_Cache&);
+    GC_Circuit_Cache& operator=(const GC_Circuit_Cache&);
+};
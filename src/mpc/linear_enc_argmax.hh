@@ -32,7 +32,7 @@ using namespace  std;
 
 class Linear_EncArgmax_Owner {
 public:
-    Linear_EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, Paillier &p, gmp_randstate_t state, unsigned int lambda = 100);
+    Linear_EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, const Paillier &p, gmp_randstate_t state, unsigned int lambda = 100);
 //    ~Linear_EncArgmax_Owner();
     
     void unpermuteResult(size_t argmax_perm);
@@ -55,7 +55,7 @@ protected:
     unsigned int lambda_;
     size_t bit_length_;
     gmp_randstate_t randstate_;
-    Paillier paillier_;
+    const Paillier &paillier_;
 
     /* intermediate value */
     mpz_class enc_max_;
@@ -70,7 +70,7 @@ protected:
 
 class Linear_EncArgmax_Helper {
 public:
-    Linear_EncArgmax_Helper(const size_t &l, const size_t &k,Paillier_priv_fast &pp);
+    Linear_EncArgmax_Helper(const size_t &l, const size_t &k,const Paillier_priv_fast &pp);
     
 //    ~Linear_EncArgmax_Helper();
     
@@ -88,7 +88,7 @@ protected:
     size_t bit_length_;
 
     size_t argmax_perm_;
-    Paillier_priv_fast paillier_;
+    const Paillier_priv_fast &paillier_;
     
 };
 
@@ -33,7 +33,7 @@ using namespace NTL;
 //{
 //}
 
-LSIC_A::LSIC_A(const mpz_class &x,const size_t &l,GM &gm)
+LSIC_A::LSIC_A(const mpz_class &x,const size_t &l,const GM &gm)
 : a_(x), bit_length_(l), gm_(gm), i_(0)
 {
 }
@@ -138,7 +138,7 @@ mpz_class LSIC_A::output() const
 
 /* LSIC_B */
 
-LSIC_B::LSIC_B(const mpz_class &y,const size_t l, GM_priv &gm)
+LSIC_B::LSIC_B(const mpz_class &y,const size_t l, const GM_priv &gm)
 : b_(y), bit_length_(l), gm_(gm), protocol_started_(false)
 {
 }
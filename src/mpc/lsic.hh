@@ -55,10 +55,10 @@ struct LSIC_Packet_B {
 
 class LSIC_A : public Comparison_protocol_A{
 public:
-    LSIC_A(const mpz_class &x,const size_t &l,GM &gm);
+    LSIC_A(const mpz_class &x,const size_t &l,const GM &gm);
 
     void set_value(const mpz_class &x);
-    GM gm() const { return gm_; };
+    const GM& gm() const { return gm_; };
 
     /* Runs the right round according to the current state.
      * Returns true if the last round has been ran. 
@@ -78,7 +78,7 @@ public:
 protected:
     mpz_class a_;
     size_t bit_length_; // bit length of the numbers to compare
-	GM gm_;
+	const GM &gm_;
     
     /* internal state */
     bool c_; // the fair coin 'c' in the paper
@@ -103,13 +103,13 @@ protected:
 
 class LSIC_B : public Comparison_protocol_B{
 public:
-    LSIC_B(const mpz_class &y,const size_t l, GM_priv &gm);
+    LSIC_B(const mpz_class &y,const size_t l, const GM_priv &gm);
     
 	std::vector<mpz_class> privparams() const { return gm_.privkey(); };
 	std::vector<mpz_class> pubparams() const { return gm_.pubkey(); };
     
     void set_value(const mpz_class &x);
-    GM_priv gm() const { return gm_; };
+    const GM_priv& gm() const { return gm_; };
     
     size_t bitLength() const { return bit_length_; }
     void set_bit_length(size_t l) { bit_length_ = l; };
@@ -122,7 +122,7 @@ public:
 protected:
     mpz_class b_;
     size_t bit_length_; // bit length of the numbers to compare
-    GM_priv gm_;
+    const GM_priv &gm_;
     bool protocol_started_;
 };
 
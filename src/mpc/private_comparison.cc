@@ -20,13 +20,19 @@
 
 #include <mpc/private_comparison.hh>
 
+#include <atomic>
+#include <chrono>
 #include <thread>
+#include <crypto/batch.hh>
+#include <util/executor.hh>
 #include <util/util.hh>
 
 using namespace std;
 
-Compare_B::Compare_B(const mpz_class &y, const size_t &l, Paillier_priv_fast &paillier, GM_priv &gm)
-: b_(y), bit_length_(l), paillier_(paillier), gm_(gm)
+Compare_B::Zero_Search_Padding Compare_B::default_padding_ = Compare_B::PAD_SLEEP;
+
+Compare_B::Compare_B(const mpz_class &y, const size_t &l, const DGK_priv &dgk, const GM_priv &gm)
+: b_(y), bit_length_(l), dgk_(dgk), gm_(gm), padding_(default_padding_)
 {
     
 }
@@ -38,7 +44,7 @@ vector<mpz_class> Compare_B::encrypt_bits()
     vector<mpz_class> c_b(bit_length_);
     
     for (size_t i = 0; i < bit_length_; i++) {
-        c_b[i] = paillier_.encrypt(mpz_tstbit(b_.get_mpz_t(),i));
+        c_b[i] = dgk_.encrypt(mpz_tstbit(b_.get_mpz_t(),i));
     }
     
     return c_b;
@@ -51,54 +57,82 @@ vector<mpz_class> Compare_B::encrypt_bits_parallel(unsigned int n_threads)
     }
 //    ScopedTimer timer("encrypt_bits_parallel");
     vector<mpz_class> c_b(bit_length_);
-    
-    
-    size_t n = bit_length_;
-    size_t m = ceilf( ((float)n)/n_threads);
-    thread threads[n_threads];
 
-    auto job =[this,&c_b](size_t i_start,size_t i_end)
+    run_batch(n_threads, bit_length_, [this,&c_b](size_t i_start,size_t i_end)
     {
         for (size_t i = i_start; i < i_end; i++) {
-            c_b[i] = paillier_.encrypt(mpz_tstbit(b_.get_mpz_t(),i));
+            c_b[i] = dgk_.encrypt(mpz_tstbit(b_.get_mpz_t(),i));
         }
-    };
-
-    size_t t = 0, i_start = 0;
-    
-    for (t = 0; t < n_threads; t++) {
-        threads[t] = thread(job,i_start,min<size_t>(i_start+m,n));
-        i_start += m;
-    }
-    
-    
-    size_t t_max = t;
-    for (t = 0; t < t_max; t++) {
-        threads[t].join();
-    }
+    });
 
     return c_b;
 }
 
-mpz_class Compare_B::search_zero(const vector<mpz_class> &c)
+// the lanes of a parallel search compete for the memory and the caches:
+// the deadline leaves them some room over the cost of a zero test
+#define ZERO_SEARCH_MARGIN 1.5
+
+// c has been shuffled by A: the lanes take the elements in order, one at a
+// time, and give up as soon as one of them found a zero
+mpz_class Compare_B::search_zero_parallel(const vector<mpz_class> &c, unsigned int n_threads)
 {
 //    ScopedTimer timer("search_zero");
-    // can be parallelized
-    for (size_t i = 0; i < c.size(); i++) {
-        if (paillier_.decrypt(c[i]) == 0) {
-//            cout << "Has zero" << endl;
-            return gm_.encrypt(true);
+    size_t n = c.size();
+    n_threads = max<size_t>(1, min<size_t>(n_threads, n));
+
+    bool early_exit = (padding_ != PAD_COMPUTE);
+    atomic<bool> found(false);
+    atomic<size_t> next(0);
+
+    auto lane = [this,&c,n,early_exit,&found,&next]()
+    {
+        while (!(early_exit && found.load())) {
+            size_t i = next++;
+            if (i >= n) {
+                break;
+            }
+            if (dgk_.is_zero(c[i])) {
+                found = true;
+            }
+        }
+    };
+
+    Timer timer;
+    Task_Group lanes;
+    for (unsigned int t = 1; t < n_threads; t++) {
+        lanes.run(lane);
+    }
+    lane();
+    lanes.wait();
+
+    if (padding_ == PAD_SLEEP) {
+        // the deadline does not depend on where the zero is, only on the
+        // cost of an element for this key and on the lanes that can run at
+        // the same time: no more than the executor's workers, nor than the
+        // session's share
+        unsigned int parallel = min<unsigned int>(n_threads, Executor::global().size());
+        Executor::Share *share = Executor::Share::current();
+        if (share != NULL) {
+            parallel = min<unsigned int>(parallel, share->max_workers() + 1);
+        }
+        parallel = max(1U, parallel);
+        // elements tested by each lane when there is no zero
+        size_t rounds = (n + parallel - 1)/parallel;
+        double deadline = rounds*dgk_.zero_test_ms()*ZERO_SEARCH_MARGIN;
+        double elapsed = timer.lap_ms();
+        if (elapsed < deadline) {
+            this_thread::sleep_for(chrono::duration<double, milli>(deadline - elapsed));
         }
     }
-  
-    return gm_.encrypt(false);
+
+    return gm_.encrypt(found.load());
 }
 
-Compare_A::Compare_A(const mpz_class &x, const size_t &l, Paillier &paillier, GM &gm, gmp_randstate_t state)
-: a_(x), bit_length_(l), paillier_(paillier), gm_(gm)
+Compare_A::Compare_A(const mpz_class &x, const size_t &l, const DGK &dgk, const GM &gm, gmp_randstate_t state)
+: a_(x), bit_length_(l), dgk_(dgk), gm_(gm)
 {
     s_ = 1 - 2*gmp_urandomb_ui(state,1);
-    paillier_one_ = paillier_.pubkey()[1]; // g is an encryption of 1
+    dgk_one_ = dgk_.pubkey()[1]; // g is an encryption of 1
     gmp_randinit_set(randstate_, state);
 
 }
@@ -106,6 +140,9 @@ Compare_A::Compare_A(const mpz_class &x, const size_t &l, Paillier &paillier, GM
 
 std::vector<mpz_class> Compare_A::compute(const std::vector<mpz_class> &c_b, unsigned int n_threads)
 {
+    // the c_i are in [-1,3l+2]: they must not wrap around mod u
+    assert(3*bit_length_ + 3 < dgk_.plaintext_modulus());
+
     vector<mpz_class> c = compute_w(c_b);
     c = compute_sums(c);
     
@@ -129,7 +166,7 @@ vector<mpz_class> Compare_A::compute_w(const std::vector<mpz_class> &c_b)
         if (mpz_tstbit(a_.get_mpz_t(),i) == 0) {
             c_w[i] = c_b[i];
         }else{
-            c_w[i] = paillier_.sub(paillier_one_,c_b[i]);
+            c_w[i] = dgk_.sub(dgk_one_,c_b[i]);
         }
     }
 
@@ -144,7 +181,7 @@ vector<mpz_class> Compare_A::compute_sums(const std::vector<mpz_class> &c_w)
     c_sums[bit_length_-1] = 1;
 
     for (size_t i = bit_length_-1; i > 0; i--) {
-        c_sums[i-1] = paillier_.add(c_sums[i],c_w[i]);
+        c_sums[i-1] = dgk_.add(c_sums[i],c_w[i]);
     }
     
     return c_sums;
@@ -165,25 +202,25 @@ vector<mpz_class> Compare_A::compute_c(const std::vector<mpz_class> &c_b,const s
             // a_i != delta => c_i > 0
             // avoid computations, generate a random element
             // the decryption of c[i] can be 0 but this happens with neg. prob.
-            c[i] = paillier_.random_encryption();
+            c[i] = dgk_.random_encryption();
             continue;
         }
-        c[i] = paillier_.constMult(3,c_sums[i]);
+        c[i] = dgk_.constMult(3,c_sums[i]);
         
-        c[i] = paillier_.sub(c[i], c_b[i]);
+        c[i] = dgk_.sub(c[i], c_b[i]);
         
         
         switch (a_i+s_) {
             case 1:
-            c[i] = paillier_.add(c[i], paillier_one_);
+            c[i] = dgk_.add(c[i], dgk_one_);
             break;
             
             case 2:
-            c[i] = paillier_.add(c[i], paillier_one_*paillier_one_);
+            c[i] = dgk_.add(c[i], dgk_one_*dgk_one_);
             break;
             
             case -1:
-            c[i] = paillier_.sub(c[i], paillier_one_);
+            c[i] = dgk_.sub(c[i], dgk_one_);
             break;
             
             default:
@@ -204,7 +241,7 @@ vector<mpz_class> Compare_A::rerandomize(const vector<mpz_class> &c, const std::
     vector<mpz_class> c_rand(c);
     
     for (size_t i = 0; i < rerand_indexes.size(); i++) {
-        c_rand[rerand_indexes[i]] = paillier_.scalarize(c_rand[rerand_indexes[i]]);
+        c_rand[rerand_indexes[i]] = dgk_.scalarize(c_rand[rerand_indexes[i]]);
     }
     
     return c_rand;
@@ -219,30 +256,13 @@ vector<mpz_class> Compare_A::rerandomize_parallel(const vector<mpz_class> &c, co
     }
     
     vector<mpz_class> c_rand(c);
-    
-    size_t n = rerand_indexes.size();
-    size_t m = ceilf( ((float)n)/n_threads);
-    thread threads[n_threads];
-    
-    auto job =[this,&c_rand,&rerand_indexes](size_t i_start,size_t i_end)
+
+    run_batch(n_threads, rerand_indexes.size(), [this,&c_rand,&rerand_indexes](size_t i_start,size_t i_end)
     {
         for (size_t i = i_start; i < i_end; i++) {
-            c_rand[rerand_indexes[i]] = paillier_.scalarize(c_rand[rerand_indexes[i]]);
+            c_rand[rerand_indexes[i]] = dgk_.scalarize(c_rand[rerand_indexes[i]]);
         }
-    };
-
-    size_t t = 0, i_start = 0;
-    
-    for (t = 0; t < n_threads; t++) {
-        threads[t] = thread(job,i_start,min<size_t>(i_start+m,n));
-        i_start += m;
-    }
-    
-    
-    size_t t_max = t;
-    for (t = 0; t < t_max; t++) {
-        threads[t].join();
-    }
+    });
     
     return c_rand;
 }
@@ -274,6 +294,6 @@ void runProtocol(Compare_A &party_a, Compare_B &party_b, gmp_randstate_t state)
 
     
 //    delete timer;
-    mpz_class t_prime = party_b.search_zero(c);
+    mpz_class t_prime = party_b.search_zero_parallel(c,2);
     party_a.unblind(t_prime);
 }
\ No newline at end of file
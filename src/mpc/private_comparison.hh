@@ -22,14 +22,14 @@
 
 #include <vector>
 #include <gmpxx.h>
-#include <crypto/paillier.hh>
+#include <crypto/dgk.hh>
 #include <crypto/gm.hh>
 
 #include <mpc/comparison_protocol.hh>
 
 class Compare_A : public Comparison_protocol_A {
 public:
-    Compare_A(const mpz_class &x, const size_t &l, Paillier &paillier, GM &gm, gmp_randstate_t state);
+    Compare_A(const mpz_class &x, const size_t &l, const DGK &dgk, const GM &gm, gmp_randstate_t state);
     
     void set_value(const mpz_class &x) { a_ = x; };
 
@@ -47,7 +47,7 @@ public:
 
     void unblind(const mpz_class &t_prime);
     
-    GM gm() const { return gm_; }
+    const GM& gm() const { return gm_; }
     size_t bit_length() const { return bit_length_; }
     virtual void set_bit_length(size_t l) {bit_length_ = l;}
 
@@ -57,38 +57,56 @@ protected:
     mpz_class a_;
     long s_;
     size_t bit_length_; // bit length of the numbers to compare
-    Paillier paillier_;
-    GM gm_;
+    const DGK &dgk_;
+    const GM &gm_;
     
     mpz_class res_;
-    mpz_class paillier_one_;
+    mpz_class dgk_one_;
     
     gmp_randstate_t randstate_;
 };
 
 class Compare_B : public Comparison_protocol_B {
 public:
-    Compare_B(const mpz_class &y, const size_t &l, Paillier_priv_fast &paillier, GM_priv &gm);
+    /*
+     * The zero search stops as soon as a zero is found. As the position of
+     * the zero depends on the inputs, its running time is padded:
+     * - NO_PADDING: none, the timing leaks,
+     * - PAD_SLEEP: sleeps until the time a whole search takes, the cores
+     *   are free meanwhile. The deadline is derived from the cost of a zero
+     *   test, measured when the DGK key is loaded (DGK_priv::zero_test_ms),
+     * - PAD_COMPUTE: no early exit, all the elements are tested.
+     */
+    enum Zero_Search_Padding { NO_PADDING, PAD_SLEEP, PAD_COMPUTE };
+
+    Compare_B(const mpz_class &y, const size_t &l, const DGK_priv &dgk, const GM_priv &gm);
     
     virtual void set_value(const mpz_class &x) { b_ = x; };
 
     std::vector<mpz_class> encrypt_bits();
     std::vector<mpz_class> encrypt_bits_parallel(unsigned int n_threads = 4);
     
-    mpz_class search_zero(const std::vector<mpz_class> &c);
+    mpz_class search_zero(const std::vector<mpz_class> &c) { return search_zero_parallel(c, 1); }
+    mpz_class search_zero_parallel(const std::vector<mpz_class> &c, unsigned int n_threads = 4);
+
+    Zero_Search_Padding zero_search_padding() const { return padding_; }
+    void set_zero_search_padding(Zero_Search_Padding p) { padding_ = p; }
+    /* for the comparators created afterwards, PAD_SLEEP by default */
+    static void set_default_zero_search_padding(Zero_Search_Padding p) { default_padding_ = p; }
     
-    GM_priv gm() const { return gm_; };
+    const GM_priv& gm() const { return gm_; };
     size_t bit_length() const { return bit_length_; }
     virtual void set_bit_length(size_t l) {bit_length_ = l;}
 
 protected:
     mpz_class b_;
     size_t bit_length_; // bit length of the numbers to compare
-    Paillier_priv_fast paillier_;
-    GM_priv gm_;
-};
+    const DGK_priv &dgk_;
+    const GM_priv &gm_;
+    Zero_Search_Padding padding_;
 
-void threadCall(Paillier &paillier, std::vector<mpz_class> &c_rand, std::vector<size_t> &rerand_indexes, size_t i_start, size_t i_end);
+    static Zero_Search_Padding default_padding_;
+};
 
 
 void runProtocol(Compare_A &party_a, Compare_B &party_b, gmp_randstate_t state);
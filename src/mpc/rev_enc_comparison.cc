@@ -27,8 +27,8 @@
 using namespace std;
 
 
-Rev_EncCompare_Owner::Rev_EncCompare_Owner(const mpz_class &v_a, const mpz_class &v_b, const size_t &l, Paillier &p,Comparison_protocol_A* comparator, gmp_randstate_t state)
-: a_(v_a), b_(v_b), bit_length_(l), paillier_(p), comparator_(comparator), is_set_up_(false), two_l_(0)
+Rev_EncCompare_Owner::Rev_EncCompare_Owner(const mpz_class &v_a, const mpz_class &v_b, const size_t &l, const Paillier &p,Comparison_protocol_A* comparator, gmp_randstate_t state)
+: a_(v_a), b_(v_b), plain_b_(false), bit_length_(l), paillier_(p), comparator_(comparator), is_set_up_(false), two_l_(0)
 {
     assert(bit_length_ != 0);
     gmp_randinit_set(randstate_, state);
@@ -48,19 +48,34 @@ void Rev_EncCompare_Owner::set_input(const mpz_class &v_a, const mpz_class &v_b)
     assert(!is_set_up_);
     a_ = v_a;
     b_ = v_b;
+    plain_b_ = false;
+}
+
+void Rev_EncCompare_Owner::set_plain_input(const mpz_class &v_a, const mpz_class &b)
+{
+    assert(!is_set_up_);
+    a_ = v_a;
+    b_ = b;
+    plain_b_ = true;
 }
 
 mpz_class Rev_EncCompare_Owner::setup(unsigned int lambda)
 {
     mpz_class x, r, z, c;
     
-    // x = b + 2^l - a
-    x = paillier_.add(b_,paillier_.encrypt(two_l_));
-    x = paillier_.sub(x,a_);
-    
     mpz_urandomb(r.get_mpz_t(), randstate_, lambda+bit_length_);
-    // z = x + r
-    z = paillier_.add(x,paillier_.encrypt(r));
+    
+    if (plain_b_) {
+        // z = b + 2^l + r - a, with a single encryption
+        z = paillier_.sub(paillier_.encrypt(b_ + two_l_ + r),a_);
+    }else{
+        // x = b + 2^l - a
+        x = paillier_.add(b_,paillier_.encrypt(two_l_));
+        x = paillier_.sub(x,a_);
+        
+        // z = x + r
+        z = paillier_.add(x,paillier_.encrypt(r));
+    }
 
     // c = r mod 2^l
     c = r % two_l_;
@@ -88,7 +103,7 @@ mpz_class Rev_EncCompare_Owner::concludeProtocol(const mpz_class &c_z_l)
     return c_t_;
 }
 
-Rev_EncCompare_Helper::Rev_EncCompare_Helper(const size_t &l, Paillier_priv_fast &pp, Comparison_protocol_B *comparator)
+Rev_EncCompare_Helper::Rev_EncCompare_Helper(const size_t &l, const Paillier_priv_fast &pp, Comparison_protocol_B *comparator)
 : bit_length_(l), paillier_(pp), comparator_(comparator), is_set_up_(false),two_l_(0), is_protocol_done_(false)
 {
     mpz_setbit(two_l_.get_mpz_t(),bit_length_); // set two_l_ to 2^l
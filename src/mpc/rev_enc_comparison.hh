@@ -36,25 +36,31 @@
 class Rev_EncCompare_Owner {
 public:
 //    Rev_EncCompare_Owner(const mpz_class &v_a, const mpz_class &v_b, const size_t &l, const std::vector<mpz_class> pk_p, const std::vector<mpz_class> &pk_gm, gmp_randstate_t state);
-    Rev_EncCompare_Owner(const mpz_class &v_a, const mpz_class &v_b, const size_t &l, Paillier &p,Comparison_protocol_A* comparator, gmp_randstate_t state);
+    Rev_EncCompare_Owner(const mpz_class &v_a, const mpz_class &v_b, const size_t &l, const Paillier &p,Comparison_protocol_A* comparator, gmp_randstate_t state);
     ~Rev_EncCompare_Owner();
     
     void set_input(const mpz_class &v_a, const mpz_class &v_b);
+    // b is a plaintext known to the owner (e.g. a threshold of the model): it is
+    // folded in the blinding and no encryption of b is needed. The helper's side
+    // of the protocol is unchanged.
+    void set_plain_input(const mpz_class &v_a, const mpz_class &b);
     mpz_class setup(unsigned int lambda); // lambda is the parameter for statistical security. r <- [0, 2^{l+lambda}[ \cap \Z
     mpz_class concludeProtocol(const mpz_class &c_r_l_);
 
-    Paillier paillier() const { return paillier_; }
+    const Paillier& paillier() const { return paillier_; }
     Comparison_protocol_A* comparator() { return comparator_; };
     mpz_class get_c_r_l() const { return c_r_l_; };
     bool is_set_up() const { return is_set_up_; }
     size_t bit_length() const { return bit_length_; }
+    bool plain_b() const { return plain_b_; }
 
     mpz_class encrypted_output() const { return c_t_; }
 
 protected:
     mpz_class a_,b_;
+    bool plain_b_;
     size_t bit_length_;
-    Paillier paillier_;
+    const Paillier &paillier_;
     Comparison_protocol_A *comparator_;
     gmp_randstate_t randstate_;
     
@@ -71,7 +77,7 @@ protected:
 
 class Rev_EncCompare_Helper {
 public:
-    Rev_EncCompare_Helper(const size_t &l, Paillier_priv_fast &pp, Comparison_protocol_B *comparator);
+    Rev_EncCompare_Helper(const size_t &l, const Paillier_priv_fast &pp, Comparison_protocol_B *comparator);
     ~Rev_EncCompare_Helper();
     
     void setup(const mpz_class &c_z);
@@ -79,7 +85,7 @@ public:
     inline bool protocol_done() { return is_protocol_done_; }
     inline bool output() const { assert(is_protocol_done_);  return t_; }
 
-    Paillier_priv_fast paillier() const { return paillier_; }
+    const Paillier_priv_fast& paillier() const { return paillier_; }
     Comparison_protocol_B* comparator() { return comparator_; };
     mpz_class get_c_z_l() const { return c_z_l_; };
     bool is_set_up() const { return is_set_up_; }
@@ -88,7 +94,7 @@ public:
     
 protected:
     size_t bit_length_;
-    Paillier_priv_fast paillier_;
+    const Paillier_priv_fast &paillier_;
     Comparison_protocol_B *comparator_;
     
     /* intermediate values */
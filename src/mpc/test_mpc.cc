@@ -98,9 +98,9 @@ static void test_compare(unsigned int nbits = 256)
     gmp_randinit_default(randstate);
     gmp_randseed_ui(randstate,time(NULL));
     
-    auto sk_p = Paillier_priv_fast::keygen(randstate,1024);
-    Paillier_priv_fast pp(sk_p,randstate);
-    Paillier p(pp.pubkey(),randstate);
+    auto sk_dgk = DGK_priv::keygen(randstate,1024);
+    DGK_priv pp(sk_dgk);
+    DGK p(pp.pubkey());
     
     auto sk_gm = GM_priv::keygen(randstate);
     GM_priv gm_priv(sk_gm,randstate);
@@ -131,6 +131,63 @@ static void test_compare(unsigned int nbits = 256)
     cout << "Test Compare passed" << endl;
 }
 
+static void test_zero_search(size_t n = 256)
+{
+    cout << "Test zero search ..." << endl;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    DGK_priv pp(DGK_priv::keygen(randstate,1024));
+    GM_priv gm_priv(GM_priv::keygen(randstate),randstate);
+    Compare_B party_b(0, n, pp, gm_priv);
+    
+    vector<mpz_class> c(n);
+    for (size_t i = 0; i < n; i++) {
+        c[i] = pp.random_encryption();
+    }
+    
+    Compare_B::Zero_Search_Padding modes[] = { Compare_B::NO_PADDING, Compare_B::PAD_SLEEP, Compare_B::PAD_COMPUTE };
+    const char *names[] = { "no padding", "sleep", "compute" };
+    
+    for (size_t m = 0; m < 3; m++) {
+        party_b.set_zero_search_padding(modes[m]);
+        for (unsigned int n_threads = 1; n_threads <= 4; n_threads *= 2) {
+            // the fastest of several runs is kept: the noise only adds time.
+            // The runs with and without a zero alternate, so that both see
+            // the same load
+            double t_none = 0, t_zero = 0;
+            for (int k = 0; k < 5; k++) {
+                Timer timer;
+                assert(gm_priv.decrypt(party_b.search_zero_parallel(c, n_threads)) == false);
+                double t = timer.lap_ms();
+                t_none = (k == 0) ? t : min(t_none, t);
+                
+                // the zero at the beginning is the worst case for the timing
+                size_t i_zero = (k < 3) ? 0 : gmp_urandomm_ui(randstate, n);
+                mpz_class saved = c[i_zero];
+                c[i_zero] = pp.encrypt(0);
+                
+                timer.lap_ms();
+                assert(gm_priv.decrypt(party_b.search_zero_parallel(c, n_threads)) == true);
+                t = timer.lap_ms();
+                t_zero = (k == 0) ? t : min(t_zero, t);
+                
+                c[i_zero] = saved;
+            }
+            cout << names[m] << ", " << n_threads << " threads: " << t_none << " ms without a zero, " << t_zero << " ms with one" << endl;
+            
+            // when padded, finding a zero must not be noticeably faster
+            if (modes[m] != Compare_B::NO_PADDING) {
+                assert(t_zero >= 0.75*t_none);
+            }
+        }
+    }
+    
+    cout << "Test zero search passed" << endl;
+}
+
 static void test_gc(unsigned int nbits = 256)
 {
 //    nbits = 128;
@@ -174,6 +231,79 @@ static void test_gc(unsigned int nbits = 256)
 
 }
 
+static void test_gc_batch(unsigned int nbits = 64, unsigned int n = 20)
+{
+    cout << "Test batched compare with Garbled Circuits ..." << endl;
+    ScopedTimer timer("GC Batch Compare");
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    auto sk_gm = GM_priv::keygen(randstate);
+    GM_priv gm_priv(sk_gm,randstate);
+    GM gm(gm_priv.pubkey(),randstate);
+    
+    vector<mpz_class> a(n), b(n);
+    vector<GC_Compare_A*> comparators_a(n);
+    vector<GC_Compare_B*> comparators_b(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        mpz_urandomb(a[i].get_mpz_t(), randstate, nbits);
+        mpz_urandomb(b[i].get_mpz_t(), randstate, nbits);
+        comparators_a[i] = new GC_Compare_A(a[i], nbits, gm, randstate);
+        comparators_b[i] = new GC_Compare_B(b[i], nbits, gm_priv, randstate);
+    }
+    
+    GC_Compare_Batch_A batch_a(comparators_a);
+    GC_Compare_Batch_B batch_b(comparators_b);
+    
+    runProtocol(batch_a, batch_b, randstate);
+    
+    for (size_t i = 0; i < n; i++) {
+        bool result = gm_priv.decrypt(comparators_a[i]->output());
+        assert( result == (a[i] < b[i]));
+        delete comparators_a[i];
+        delete comparators_b[i];
+    }
+    
+    cout << "Test GC Batch Compare passed" << endl;
+}
+
+static void test_gc_cache()
+{
+    cout << "Test GC circuit cache ..." << endl;
+    
+    GC_Circuit_Cache &cache = GC_Circuit_Cache::instance();
+    size_t old_capacity = cache.capacity();
+    
+    cache.clear();
+    cache.set_capacity(2);
+    
+    shared_ptr<const GC_Circuit_Skeleton> s8 = cache.comparison_circuit(8);
+    assert(cache.comparison_circuit(8) == s8);
+    
+    cache.comparison_circuit(16);
+    cache.comparison_circuit(8); // 16 is now the least recently used
+    cache.comparison_circuit(32);
+    assert(cache.size() == 2);
+    assert(cache.comparison_circuit(8) == s8);
+    
+    // evicted skeletons stay valid for their users
+    shared_ptr<const GC_Circuit_Skeleton> s16 = cache.comparison_circuit(16);
+    cache.clear();
+    GarbledCircuit *gc = s16->instantiate();
+    assert(gc->q == comparison_circuit_gate_count(16));
+    free(gc->garbledTable);
+    free(gc->wires);
+    free(gc->inputLabels);
+    free(gc);
+    
+    cache.set_capacity(old_capacity);
+    
+    cout << "Test GC circuit cache passed" << endl;
+}
+
 static void test_enc_compare(unsigned int nbits = 256,unsigned int lambda = 100)
 {
     cout << "Test comparison over encrypted data ..." << endl;
@@ -264,6 +394,43 @@ static void test_rev_enc_compare(unsigned int nbits = 256,unsigned int lambda =
     cout << "Test passed" << endl;
 }
 
+static void test_rev_plain_compare(unsigned int nbits = 256,unsigned int lambda = 100)
+{
+    cout << "Test reverse comparison with a plaintext ..." << endl;
+    ScopedTimer timer("Plain Compare");
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    auto sk_p = Paillier_priv_fast::keygen(randstate,1024);
+    Paillier_priv_fast pp(sk_p,randstate);
+    Paillier p(pp.pubkey(),randstate);
+    
+    auto sk_gm = GM_priv::keygen(randstate);
+    GM_priv gm_priv(sk_gm,randstate);
+    GM gm(gm_priv.pubkey(),randstate);
+    
+    for (int i = 0; i < 3; i++) {
+        LSIC_A *party_a = new LSIC_A(0, nbits, gm);
+        LSIC_B *party_b = new LSIC_B(0, nbits, gm_priv);
+        
+        mpz_class a, b;
+        mpz_urandom_len(a.get_mpz_t(), randstate, nbits);
+        mpz_urandom_len(b.get_mpz_t(), randstate, nbits);
+        
+        Rev_EncCompare_Helper server(nbits,pp,party_b);
+        Rev_EncCompare_Owner client(0,0, nbits, p,party_a, randstate);
+        client.set_plain_input(pp.encrypt(a),b);
+        
+        runProtocol(client,server,randstate,lambda);
+        
+        assert(server.output() == (a <= b));
+    }
+    
+    cout << "Test passed" << endl;
+}
+
 static void test_enc_argmax(unsigned int k = 5, unsigned int nbits = 256,unsigned int lambda = 100, unsigned int num_threads = 1)
 {
     cout << "Test argmax over encrypted data ..." << endl;
@@ -560,7 +727,8 @@ int main(int argc, char **argv)
     
 
 //    test_lsic(l);
-//    test_compare(l);
+    test_compare(l);
+    test_zero_search();
     
 //    for (int i = 0; i < 1; i++) {
 //        test_gc(l);
@@ -568,9 +736,14 @@ int main(int argc, char **argv)
 //    }
     
     
+    test_gc_cache();
+    test_gc_batch(l,n);
+    cout << "\n\n";
+    
 //    test_enc_compare(l,lambda);
 //    cout << "\n\n";
     test_rev_enc_compare(l,lambda);
+    test_rev_plain_compare(l,lambda);
 
 //    cout << "\n\n";
 //    test_enc_argmax(n,l,lambda,t);
@@ -23,7 +23,7 @@
 #include <algorithm>
 
 
-Tree_EncArgmax_Owner::Tree_EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, Paillier &p, gmp_randstate_t state, unsigned int lambda)
+Tree_EncArgmax_Owner::Tree_EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, const Paillier &p, gmp_randstate_t state, unsigned int lambda)
 : a_(a), k_(a.size()), local_max_(k_), round_count_(0), lambda_(lambda), bit_length_(l), paillier_(p), is_protocol_done_(false)
 {
     assert(k_ > 0);
@@ -103,7 +103,7 @@ void Tree_EncArgmax_Owner::unpermuteResult(size_t argmax_perm)
     is_protocol_done_ = true;
 }
 
-Tree_EncArgmax_Helper::Tree_EncArgmax_Helper(const size_t &l, const size_t &k,Paillier_priv_fast &pp)
+Tree_EncArgmax_Helper::Tree_EncArgmax_Helper(const size_t &l, const size_t &k,const Paillier_priv_fast &pp)
 : k_(k), local_argmax_(k), round_count_(0), bit_length_(l), argmax_perm_(0), paillier_(pp)
 {
     assert(k_ > 0);
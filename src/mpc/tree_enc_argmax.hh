@@ -32,7 +32,7 @@ using namespace  std;
 
 class Tree_EncArgmax_Owner {
 public:
-    Tree_EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, Paillier &p, gmp_randstate_t state, unsigned int lambda = 100);
+    Tree_EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, const Paillier &p, gmp_randstate_t state, unsigned int lambda = 100);
     
     void unpermuteResult(size_t argmax_perm);
     size_t output() const { assert(is_protocol_done_); return i_0_;}
@@ -56,7 +56,7 @@ protected:
     unsigned int lambda_;
     size_t bit_length_;
     gmp_randstate_t randstate_;
-    Paillier paillier_;
+    const Paillier &paillier_;
 
     /* intermediate value */
     vector<mpz_class> noise_;
@@ -70,7 +70,7 @@ protected:
 
 class Tree_EncArgmax_Helper {
 public:
-    Tree_EncArgmax_Helper(const size_t &l, const size_t &k,Paillier_priv_fast &pp);
+    Tree_EncArgmax_Helper(const size_t &l, const size_t &k,const Paillier_priv_fast &pp);
         
     void update_argmax(vector<bool> comp, const vector<mpz_class> &old_enc_max, vector<mpz_class> &new_enc_max, vector<mpz_class> &x, vector<mpz_class> &y);
     
@@ -89,7 +89,7 @@ protected:
     size_t bit_length_;
 
     size_t argmax_perm_;
-    Paillier_priv_fast paillier_;
+    const Paillier_priv_fast &paillier_;
     
 };
 
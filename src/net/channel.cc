@@ -0,0 +1,173 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <net/channel.hh>
+#include <net/message_io.hh>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+string Channel::read_message()
+{
+    vector<byte> header(HEADER_SIZE);
+    read(&header[0], HEADER_SIZE);
+
+    string content(decode_header(header), '\0');
+    if (content.size() > 0) {
+        read(&content[0], content.size());
+    }
+    return content;
+}
+
+void Channel::write_message(string &&content)
+{
+    vector<byte> header(HEADER_SIZE);
+    encode_header(header, content.size());
+
+    write(&header[0], HEADER_SIZE);
+    write(content.data(), content.size());
+}
+
+void TCP_Channel::read(void *data, size_t size)
+{
+    boost::asio::read(socket_, boost::asio::buffer(data, size));
+}
+
+void TCP_Channel::write(const void *data, size_t size)
+{
+    boost::asio::write(socket_, boost::asio::buffer(data, size));
+}
+
+void TCP_Channel::write_message(string &&content)
+{
+    vector<byte> header(HEADER_SIZE);
+    encode_header(header, content.size());
+
+    vector<boost::asio::const_buffer> buffers;
+    buffers.push_back(boost::asio::buffer(header));
+    buffers.push_back(boost::asio::buffer(content));
+    boost::asio::write(socket_, buffers);
+}
+
+void TCP_Channel::shutdown()
+{
+    boost::system::error_code ec;
+    socket_.shutdown(tcp::socket::shutdown_both, ec);
+}
+
+pair<unique_ptr<Local_Channel>, unique_ptr<Local_Channel> > Local_Channel::create_pair()
+{
+    shared_ptr<Pipe> a_to_b = make_shared<Pipe>(), b_to_a = make_shared<Pipe>();
+
+    return make_pair(unique_ptr<Local_Channel>(new Local_Channel(b_to_a, a_to_b)),
+                     unique_ptr<Local_Channel>(new Local_Channel(a_to_b, b_to_a)));
+}
+
+void Local_Channel::Pipe::push(string &&data, bool message)
+{
+    {
+        lock_guard<mutex> lock(mtx);
+        if (closed) {
+            throw runtime_error("Write on a closed channel");
+        }
+        Buffer b = {move(data), message};
+        buffers.push_back(move(b));
+    }
+    changed.notify_one();
+}
+
+void Local_Channel::close()
+{
+    for (Pipe *p : {in_.get(), out_.get()}) {
+        {
+            lock_guard<mutex> lock(p->mtx);
+            p->closed = true;
+        }
+        p->changed.notify_all();
+    }
+}
+
+void Local_Channel::wait_for_data(unique_lock<mutex> &lock)
+{
+    in_->changed.wait(lock, [this]{ return !in_->buffers.empty() || in_->closed; });
+    if (in_->buffers.empty()) {
+        throw runtime_error("Channel closed by the peer");
+    }
+}
+
+void Local_Channel::read(void *data, size_t size)
+{
+    unsigned char *dst = (unsigned char *)data;
+
+    unique_lock<mutex> lock(in_->mtx);
+    while (size > 0) {
+        wait_for_data(lock);
+
+        Pipe::Buffer &b = in_->buffers.front();
+        if (b.message) {
+            // read as bytes: the header has to be there after all
+            vector<byte> header(HEADER_SIZE);
+            encode_header(header, b.data.size());
+            b.data.insert(b.data.begin(), header.begin(), header.end());
+            b.message = false;
+        }
+
+        size_t n = min(size, b.data.size() - in_->offset);
+        memcpy(dst, b.data.data() + in_->offset, n);
+        dst += n;
+        size -= n;
+        in_->offset += n;
+        if (in_->offset == b.data.size()) {
+            in_->buffers.pop_front();
+            in_->offset = 0;
+        }
+    }
+}
+
+void Local_Channel::write(const void *data, size_t size)
+{
+    out_->push(string((const char *)data, size), false);
+}
+
+string Local_Channel::read_message()
+{
+    {
+        unique_lock<mutex> lock(in_->mtx);
+        wait_for_data(lock);
+
+        Pipe::Buffer &b = in_->buffers.front();
+        if (b.message) {
+            string content = move(b.data);
+            in_->buffers.pop_front();
+            return content;
+        }
+    }
+    // the message was written as bytes
+    return Channel::read_message();
+}
+
+void Local_Channel::write_message(string &&content)
+{
+    out_->push(move(content), true);
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <boost/asio.hpp>
+
+using boost::asio::ip::tcp;
+
+/*
+ * Transport between the two parties of a protocol.
+ *
+ * read and write block until all the bytes went through and throw on
+ * failure. The protocol messages (see message_io.hh) use read_message and
+ * write_message: a header of HEADER_SIZE bytes giving the length, then the
+ * content. Implementations may pass the messages without framing them, as
+ * long as both ends see the same stream.
+ *
+ * A channel may be read by one thread while another one writes to it, but
+ * two threads must not read (or write) at the same time.
+ */
+class Channel {
+public:
+    virtual ~Channel() {}
+
+    virtual void read(void *data, size_t size) = 0;
+    virtual void write(const void *data, size_t size) = 0;
+
+    virtual std::string read_message();
+    virtual void write_message(std::string &&content);
+
+    /* makes the pending and later reads of both ends fail */
+    virtual void shutdown() {}
+};
+
+/* a connected socket: a message is written with a single system call */
+class TCP_Channel : public Channel {
+public:
+    TCP_Channel(tcp::socket &socket) : socket_(socket) {}
+
+    tcp::socket& socket() const { return socket_; }
+
+    void read(void *data, size_t size);
+    void write(const void *data, size_t size);
+    void write_message(std::string &&content);
+    void shutdown();
+
+protected:
+    tcp::socket &socket_;
+};
+
+/*
+ * Both ends of a connection in the same process, e.g. to run the owner and
+ * the helper of a protocol in one benchmark or test.
+ * A message written on one end is moved to the other: it is neither framed
+ * nor copied. The queues are unbounded.
+ * Destroying (or closing) an end makes the reads of the other one fail once
+ * they consumed what was written before.
+ */
+class Local_Channel : public Channel {
+public:
+    static std::pair<std::unique_ptr<Local_Channel>, std::unique_ptr<Local_Channel> > create_pair();
+
+    ~Local_Channel() { close(); }
+
+    void read(void *data, size_t size);
+    void write(const void *data, size_t size);
+    std::string read_message();
+    void write_message(std::string &&content);
+    void shutdown() { close(); }
+
+    void close();
+
+protected:
+    // data written on one end, in order
+    struct Pipe {
+        struct Buffer {
+            std::string data;
+            // a whole message, without its header
+            bool message;
+        };
+
+        std::deque<Buffer> buffers;
+        // bytes of the first buffer already read
+        size_t offset;
+        bool closed;
+
+        std::mutex mtx;
+        std::condition_variable changed;
+
+        Pipe() : offset(0), closed(false) {}
+
+        void push(std::string &&data, bool message);
+    };
+
+    Local_Channel(std::shared_ptr<Pipe> in, std::shared_ptr<Pipe> out) : in_(in), out_(out) {}
+
+    // waits for data to read, must be called with in_->mtx held
+    void wait_for_data(std::unique_lock<std::mutex> &lock);
+
+    std::shared_ptr<Pipe> in_, out_;
+};
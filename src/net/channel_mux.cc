@@ -0,0 +1,192 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <net/channel_mux.hh>
+#include <net/message_io.hh>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+Mux_Channel::Mux_Channel(Channel_Mux &mux, uint32_t id)
+: mux_(mux), id_(id), offset_(0), unacknowledged_(0), in_flight_(0), credit_(MUX_WINDOW)
+{
+}
+
+void Mux_Channel::read(void *data, size_t size)
+{
+    unsigned char *dst = (unsigned char *)data;
+    unique_lock<mutex> lock(mux_.mtx_);
+    while (size > 0) {
+        mux_.changed_.wait(lock, [this]{ return !frames_.empty() || mux_.peer_closed_ || !mux_.failure_.empty(); });
+        if (frames_.empty()) {
+            mux_.check_failure();
+            throw runtime_error("Multiplexed channel closed by the peer");
+        }
+
+        vector<unsigned char> &frame = frames_.front();
+        size_t n = min(size, frame.size() - offset_);
+        memcpy(dst, &frame[offset_], n);
+        dst += n;
+        size -= n;
+        offset_ += n;
+        unacknowledged_ += n;
+        if (offset_ == frame.size()) {
+            frames_.pop_front();
+            offset_ = 0;
+        }
+
+        // give the credit back in large enough chunks, as we go: a message
+        // larger than the window is only sent as we read it
+        if (unacknowledged_ >= MUX_WINDOW/2) {
+            uint32_t credit = unacknowledged_;
+            unacknowledged_ = 0;
+            in_flight_ -= credit;
+
+            lock.unlock();
+            unsigned char payload[4];
+            for (unsigned i = 0; i < 4; i++) {
+                payload[i] = (credit >> (24 - 8*i)) & 0xFF;
+            }
+            mux_.send_frame(id_ | MUX_CREDIT_FLAG, payload, sizeof(payload));
+            lock.lock();
+        }
+    }
+}
+
+void Mux_Channel::write(const void *data, size_t size)
+{
+    const unsigned char *src = (const unsigned char *)data;
+    while (size > 0) {
+        size_t n;
+        {
+            unique_lock<mutex> lock(mux_.mtx_);
+            mux_.changed_.wait(lock, [this]{ return credit_ > 0 || !mux_.failure_.empty(); });
+            mux_.check_failure();
+            n = min<size_t>(min<size_t>(size, credit_), MUX_MAX_FRAME);
+            credit_ -= n;
+        }
+        mux_.send_frame(id_, src, n);
+        src += n;
+        size -= n;
+    }
+}
+
+Channel_Mux::Channel_Mux(Channel &channel, unsigned int n_channels)
+: channel_(channel), closed_(false), peer_closed_(false)
+{
+    for (unsigned int i = 0; i < n_channels; i++) {
+        channels_.push_back(unique_ptr<Mux_Channel>(new Mux_Channel(*this, i)));
+    }
+    // the reader blocks on the channel: it must not hold an executor worker
+    reader_.run_blocking([this]() { reader_loop(); });
+}
+
+Channel_Mux::~Channel_Mux()
+{
+    if (!closed_) {
+        // the peer may never close its side: unblock the reader
+        channel_.shutdown();
+    }
+    // wait for the reader, it records its errors itself
+    try {
+        reader_.wait();
+    } catch (...) {
+    }
+}
+
+void Channel_Mux::close()
+{
+    send_frame(MUX_END, NULL, 0);
+    closed_ = true;
+    reader_.wait();
+
+    lock_guard<mutex> lock(mtx_);
+    check_failure();
+}
+
+void Channel_Mux::check_failure() const
+{
+    if (!failure_.empty()) {
+        throw runtime_error("Multiplexed connection failed: " + failure_);
+    }
+}
+
+void Channel_Mux::send_frame(uint32_t channel, const void *data, size_t size)
+{
+    // a single write for the header and the payload
+    vector<byte> frame(MUX_HEADER_SIZE + size);
+    encode_mux_header(&frame[0], channel, size);
+    if (size > 0) {
+        memcpy(&frame[MUX_HEADER_SIZE], data, size);
+    }
+
+    lock_guard<mutex> lock(write_mtx_);
+    channel_.write(&frame[0], frame.size());
+}
+
+void Channel_Mux::reader_loop()
+{
+    try {
+        for (;;) {
+            byte header[MUX_HEADER_SIZE];
+            channel_.read(header, MUX_HEADER_SIZE);
+            uint32_t channel;
+            unsigned size;
+            decode_mux_header(header, channel, size);
+
+            if (channel == MUX_END) {
+                lock_guard<mutex> lock(mtx_);
+                peer_closed_ = true;
+                changed_.notify_all();
+                return;
+            }
+
+            uint32_t id = channel & ~MUX_CREDIT_FLAG;
+            if (id >= channels_.size() || size > MUX_MAX_FRAME || ((channel & MUX_CREDIT_FLAG) && size != 4)) {
+                throw runtime_error("Invalid multiplexed frame");
+            }
+            vector<unsigned char> payload(size);
+            if (size > 0) {
+                channel_.read(&payload[0], size);
+            }
+
+            lock_guard<mutex> lock(mtx_);
+            Mux_Channel &c = *channels_[id];
+            if (channel & MUX_CREDIT_FLAG) {
+                c.credit_ += ((uint32_t)payload[0] << 24) | ((uint32_t)payload[1] << 16) | ((uint32_t)payload[2] << 8) | payload[3];
+            } else if (size > 0) {
+                // the peer may not send more than the credit we gave it
+                c.in_flight_ += size;
+                if (c.in_flight_ > MUX_WINDOW) {
+                    throw runtime_error("Peer exceeded the window of channel " + to_string(id));
+                }
+                c.frames_.push_back(move(payload));
+            }
+            changed_.notify_all();
+        }
+    } catch (exception &e) {
+        lock_guard<mutex> lock(mtx_);
+        failure_ = e.what();
+        changed_.notify_all();
+    }
+}
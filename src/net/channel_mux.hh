@@ -0,0 +1,123 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <net/channel.hh>
+#include <util/executor.hh>
+
+// unread bytes a sender may have in flight on a channel
+#define MUX_WINDOW (1 << 20)
+#define MUX_MAX_FRAME (1 << 16)
+
+class Channel_Mux;
+
+/* one byte stream of a Channel_Mux */
+class Mux_Channel : public Channel {
+public:
+    Mux_Channel(Channel_Mux &mux, uint32_t id);
+
+    Mux_Channel(const Mux_Channel&) = delete;
+    Mux_Channel &operator=(const Mux_Channel &) = delete;
+
+    uint32_t id() const { return id_; }
+
+    void read(void *data, size_t size);
+    void write(const void *data, size_t size);
+
+protected:
+    friend class Channel_Mux;
+
+    Channel_Mux &mux_;
+    const uint32_t id_;
+
+    // received frames not consumed yet, the first one from offset_ on
+    std::deque<std::vector<unsigned char> > frames_;
+    size_t offset_;
+    // bytes consumed since the last credit we gave to the peer
+    size_t unacknowledged_;
+    // bytes received and not credited back yet, read or not
+    size_t in_flight_;
+    // bytes we may still send before the peer credits us
+    size_t credit_;
+};
+
+/*
+ * Stream multiplexing over the channel of a session, so that parallel
+ * protocol executions need no connection of their own.
+ *
+ * Both parties open a mux with the same number of channels at the same point
+ * of the protocol: channel i of one party is connected to channel i of the
+ * other. The data is sent in frames of at most MUX_MAX_FRAME bytes, with a
+ * header giving the channel and the length (see message_io.hh).
+ *
+ * Flow control is per channel: a sender never has more than MUX_WINDOW
+ * unread bytes in flight on a channel, and the receiver gives credit back as
+ * they are read. A reader thread drains the underlying channel into the
+ * multiplexed ones, so a channel waiting for its peer never blocks the others.
+ *
+ * close() tells the peer we are done and waits for it to do the same: the
+ * underlying channel is then back to unmultiplexed messages. A mux destroyed
+ * without being closed (e.g. after an exception) shuts the underlying
+ * channel down to unblock the reader.
+ */
+class Channel_Mux {
+public:
+    Channel_Mux(Channel &channel, unsigned int n_channels);
+    ~Channel_Mux();
+
+    Channel_Mux(const Channel_Mux&) = delete;
+    Channel_Mux &operator=(const Channel_Mux &) = delete;
+
+    size_t size() const { return channels_.size(); }
+    Mux_Channel& channel(size_t i) { return *channels_[i]; }
+
+    void close();
+
+protected:
+    friend class Mux_Channel;
+
+    void reader_loop();
+    void send_frame(uint32_t channel, const void *data, size_t size);
+    // throws if the reader failed, must be called with mtx_ held
+    void check_failure() const;
+
+    Channel &channel_;
+    std::vector<std::unique_ptr<Mux_Channel> > channels_;
+
+    bool closed_;
+    bool peer_closed_;
+    std::string failure_;
+
+    std::mutex mtx_;
+    std::condition_variable changed_;
+    // frames are written whole
+    std::mutex write_mtx_;
+
+    Task_Group reader_;
+};
@@ -19,6 +19,7 @@
  *
  */
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <boost/asio.hpp>
 #include <gmpxx.h>
@@ -56,11 +57,13 @@ using boost::asio::ip::tcp;
 using namespace std;
 
 Client::Client(boost::asio::io_service& io_service, gmp_randstate_t state,Key_dependencies_descriptor key_deps_desc, unsigned int keysize, unsigned int lambda)
-: socket_(io_service),key_deps_desc_(key_deps_desc), gm_(NULL), paillier_(NULL), server_paillier_(NULL), server_gm_(NULL), fhe_context_(NULL), server_fhe_pk_(NULL), fhe_sk_(NULL), n_threads_(2), lambda_(lambda)
+: socket_(io_service), channel_(socket_), ot_extension_(channel_), key_deps_desc_(key_deps_desc), gm_(NULL), paillier_(NULL), dgk_(NULL), server_paillier_(NULL), server_gm_(NULL), server_dgk_(NULL), fhe_context_(NULL), server_fhe_pk_(NULL), fhe_sk_(NULL), metrics_("client"), n_threads_(2), fixed_base_randomizers_(false), lambda_(lambda)
 {
     gmp_randinit_set(rand_state_, state);
     
     init_needed_keys(keysize);
+    prepare_key_material();
+    key_cache_ = Key_Cache::shared_cache();
     
     ObliviousTransfer::init(OT_SECPARAM);
 }
@@ -71,6 +74,13 @@ Client::~Client()
         delete server_fhe_pk_;
     }
     delete fhe_context_;
+    delete server_dgk_;
+    delete dgk_;
+
+    metrics_.finish();
+    if (metrics_sink_) {
+        metrics_sink_->publish(metrics_);
+    }
 }
 
 
@@ -91,6 +101,9 @@ void Client::init_needed_keys(unsigned int keysize)
     if (key_deps_desc_.need_client_paillier) {
         init_Paillier(keysize);
     }
+    if (key_deps_desc_.need_client_dgk) {
+        init_DGK(keysize);
+    }
     
     
     // for FHE keys, we need the FHE context from the server
@@ -104,12 +117,30 @@ void Client::init_needed_keys(unsigned int keysize)
 //    }
 }
 
+void Client::prepare_key_material()
+{
+    // in the order expected by the server
+    if (key_deps_desc_.need_client_gm) {
+        key_material_.push_back(get_pk_message(gm_).SerializeAsString());
+    }
+    if (key_deps_desc_.need_client_paillier) {
+        key_material_.push_back(get_pk_message(paillier_).SerializeAsString());
+    }
+    if (key_deps_desc_.need_client_dgk) {
+        key_material_.push_back(get_pk_message(dgk_).SerializeAsString());
+    }
+
+    for (size_t i = 0; i < key_material_.size(); ++i) {
+        key_digests_.push_back(Key_Cache::digest(key_material_[i]));
+    }
+}
+
 void Client::init_GM(unsigned int keysize)
 {
     if (gm_ != NULL) {
         return;
     }
-    gm_ = new GM_priv(GM_priv::keygen(rand_state_,keysize),rand_state_);
+    gm_ = new GM_priv(stored_key("client_gm", keysize, [&]{ return GM_priv::keygen(rand_state_,keysize); }),rand_state_);
 }
 
 void Client::init_Paillier(unsigned int keysize)
@@ -117,10 +148,32 @@ void Client::init_Paillier(unsigned int keysize)
     if (paillier_ != NULL) {
         return;
     }
-    paillier_ = new Paillier_priv_fast(Paillier_priv_fast::keygen(rand_state_,keysize), rand_state_);
+    paillier_ = new Paillier_priv_fast(stored_key("client_paillier", keysize, [&]{ return Paillier_priv_fast::keygen(rand_state_,keysize); }), rand_state_);
 
 }
 
+void Client::init_DGK(unsigned int keysize)
+{
+    if (dgk_ != NULL) {
+        return;
+    }
+    dgk_ = new DGK_priv(stored_key("client_dgk", keysize, [&]{ return DGK_priv::keygen(rand_state_,keysize); }));
+}
+
+void Client::set_fixed_base_randomizers(bool b)
+{
+    if (b && !fixed_base_randomizers_) {
+        if (paillier_) {
+            paillier_->enable_fixed_base_randomizers();
+        }
+        if (server_paillier_) {
+            server_paillier_->enable_fixed_base_randomizers();
+        }
+    }
+    // there is no way back for keys that already use them
+    fixed_base_randomizers_ = b;
+}
+
 void Client::init_FHE_context()
 {
     if (fhe_context_) {
@@ -150,8 +203,15 @@ void Client::get_server_pk_gm()
         return;
     }
 
-    Protobuf::GM_PK pk = readMessageFromSocket<Protobuf::GM_PK>(socket_);
+    Protobuf::GM_PK pk = readMessageFromSocket<Protobuf::GM_PK>(channel_);
     cout << "Received GM PK" << endl;
+    set_server_pk_gm(pk.SerializeAsString());
+}
+
+void Client::set_server_pk_gm(const string &serialized_pk)
+{
+    Protobuf::GM_PK pk;
+    pk.ParseFromString(serialized_pk);
     server_gm_ = create_from_pk_message(pk,rand_state_);
 }
 
@@ -162,9 +222,26 @@ void Client::get_server_pk_paillier()
         return;
     }
 
-    Protobuf::Paillier_PK pk = readMessageFromSocket<Protobuf::Paillier_PK>(socket_);
+    Protobuf::Paillier_PK pk = readMessageFromSocket<Protobuf::Paillier_PK>(channel_);
     cout << "Received Paillier PK" << endl;
+    set_server_pk_paillier(pk.SerializeAsString());
+}
+
+void Client::set_server_pk_paillier(const string &serialized_pk)
+{
+    Protobuf::Paillier_PK pk;
+    pk.ParseFromString(serialized_pk);
     server_paillier_ = create_from_pk_message(pk,rand_state_);
+    if (fixed_base_randomizers_) {
+        server_paillier_->enable_fixed_base_randomizers();
+    }
+}
+
+void Client::set_server_pk_dgk(const string &serialized_pk)
+{
+    Protobuf::DGK_PK pk;
+    pk.ParseFromString(serialized_pk);
+    server_dgk_ = create_from_pk_message(pk);
 }
 
 void Client::get_fhe_context()
@@ -173,8 +250,15 @@ void Client::get_fhe_context()
         return;
     }
     
-    Protobuf::FHE_Context c = readMessageFromSocket<Protobuf::FHE_Context>(socket_);
+    Protobuf::FHE_Context c = readMessageFromSocket<Protobuf::FHE_Context>(channel_);
     cout << "Received FHE Context" << endl;
+    set_fhe_context(c.SerializeAsString());
+}
+
+void Client::set_fhe_context(const string &serialized_context)
+{
+    Protobuf::FHE_Context c;
+    c.ParseFromString(serialized_context);
     fhe_context_ = create_from_message(c);
     
     // we suppose d > 0
@@ -187,8 +271,15 @@ void Client::get_server_pk_fhe()
         return;
     }
     
-    Protobuf::FHE_PK pk = readMessageFromSocket<Protobuf::FHE_PK>(socket_);
+    Protobuf::FHE_PK pk = readMessageFromSocket<Protobuf::FHE_PK>(channel_);
     cout << "Received FHE PK" << endl;
+    set_server_pk_fhe(pk.SerializeAsString());
+}
+
+void Client::set_server_pk_fhe(const string &serialized_pk)
+{
+    Protobuf::FHE_PK pk;
+    pk.ParseFromString(serialized_pk);
     server_fhe_pk_ = create_from_pk_message(pk,*fhe_context_);
 }
 
@@ -196,14 +287,14 @@ void Client::send_gm_pk()
 {
     assert(gm_!=NULL);
     Protobuf::GM_PK pk_message = get_pk_message(gm_);
-    sendMessageToSocket<Protobuf::GM_PK>(socket_,pk_message);
+    sendMessageToSocket<Protobuf::GM_PK>(channel_,pk_message);
 }
 
 void Client::send_paillier_pk()
 {
     assert(paillier_ != NULL);
     Protobuf::Paillier_PK pk_message = get_pk_message(paillier_);
-    sendMessageToSocket<Protobuf::Paillier_PK>(socket_,pk_message);
+    sendMessageToSocket<Protobuf::Paillier_PK>(channel_,pk_message);
 }
 
 void Client::send_fhe_pk()
@@ -212,35 +303,75 @@ void Client::send_fhe_pk()
     
     Protobuf::FHE_PK pk_message = get_pk_message(publicKey);
     
-    sendMessageToSocket<Protobuf::FHE_PK>(socket_,pk_message);
+    sendMessageToSocket<Protobuf::FHE_PK>(channel_,pk_message);
     
 }
 
+// see Server_session::exchange_keys: the server keys we already have are
+// taken from the cache, ours are only sent if the server does not have them
 void Client::exchange_keys()
 {
+    metrics_.set_phase("key_exchange");
+    size_t n_server_keys = (key_deps_desc_.need_server_gm ? 1 : 0) + (key_deps_desc_.need_server_paillier ? 1 : 0)
+                         + (key_deps_desc_.need_server_dgk ? 1 : 0)
+                         + ((key_deps_desc_.need_server_fhe || key_deps_desc_.need_client_fhe) ? 1 : 0)
+                         + (key_deps_desc_.need_server_fhe ? 1 : 0);
+
+    Protobuf::Key_Digests server_digests = readMessageFromSocket<Protobuf::Key_Digests>(channel_);
+    if ((size_t)server_digests.digest_size() != n_server_keys) {
+        throw std::runtime_error("Unexpected key exchange message");
+    }
+
+    vector<string> server_material(n_server_keys);
+    Protobuf::Key_Request request;
+    for (size_t i = 0; i < n_server_keys; ++i) {
+        request.add_need(!key_cache_->get(server_digests.digest(i), server_material[i]));
+    }
+    sendMessageToSocket<Protobuf::Key_Request>(channel_, request);
+
+    Protobuf::Key_Digests announce;
+    for (size_t i = 0; i < key_digests_.size(); ++i) {
+        announce.add_digest(key_digests_[i]);
+    }
+    sendMessageToSocket<Protobuf::Key_Digests>(channel_, announce);
+
+    for (size_t i = 0; i < n_server_keys; ++i) {
+        if (request.need(i)) {
+            server_material[i] = readSerializedMessageFromSocket(channel_);
+            if (Key_Cache::digest(server_material[i]) != server_digests.digest(i)) {
+                throw std::runtime_error("Server key does not match its digest");
+            }
+            key_cache_->put(server_digests.digest(i), server_material[i]);
+        }
+    }
+
+    Protobuf::Key_Request server_request = readMessageFromSocket<Protobuf::Key_Request>(channel_);
+    if ((size_t)server_request.need_size() != key_material_.size()) {
+        throw std::runtime_error("Unexpected key exchange message");
+    }
+    for (size_t i = 0; i < key_material_.size(); ++i) {
+        if (server_request.need(i)) {
+            sendSerializedMessageToSocket(channel_, key_material_[i]);
+        }
+    }
+
+    size_t k = 0;
     if (key_deps_desc_.need_server_gm) {
-        get_server_pk_gm();
+        set_server_pk_gm(server_material[k++]);
     }
     if (key_deps_desc_.need_server_paillier) {
-        get_server_pk_paillier();
+        set_server_pk_paillier(server_material[k++]);
     }
-    
-    if (key_deps_desc_.need_client_gm) {
-        send_gm_pk();
+    if (key_deps_desc_.need_server_dgk) {
+        set_server_pk_dgk(server_material[k++]);
     }
-    if (key_deps_desc_.need_client_paillier) {
-        send_paillier_pk();
+    if (key_deps_desc_.need_server_fhe || key_deps_desc_.need_client_fhe) {
+        set_fhe_context(server_material[k++]);
     }
-    
-    if (key_deps_desc_.need_server_fhe ||
-        key_deps_desc_.need_client_fhe) {
-        // if we use FHE, we need the context from the server before doing anything
-        get_fhe_context();
-    }
-    
     if (key_deps_desc_.need_server_fhe) {
-        get_server_pk_fhe();
+        set_server_pk_fhe(server_material[k++]);
     }
+
     if (key_deps_desc_.need_client_fhe) {
         // create the key only now
         init_FHE_key();
@@ -248,27 +379,41 @@ void Client::exchange_keys()
     }
 }
 
+void Client::send_query_batch(const vector<vector<mpz_class> > &queries)
+{
+    assert(queries.size() > 0);
+    sendIntToSocket(channel_, queries.size());
+    for (size_t q = 0; q < queries.size(); ++q) {
+        send_int_array_to_socket(channel_, queries[q]);
+    }
+}
+
+void Client::end_queries()
+{
+    sendIntToSocket(channel_, 0);
+}
+
 mpz_class Client::run_comparison_protocol_A(Comparison_protocol_A *comparator)
 {
-    exec_comparison_protocol_A(socket_,comparator,n_threads_);
+    exec_comparison_protocol_A(channel_,comparator,n_threads_);
     return comparator->output();
 }
 
 mpz_class Client::run_lsic_A(LSIC_A *lsic)
 {
-    exec_lsic_A(socket_,lsic);
+    exec_lsic_A(channel_,lsic);
     return lsic->output();
 }
 
 mpz_class Client::run_priv_compare_A(Compare_A *comparator)
 {
-    exec_priv_compare_A(socket_,comparator,n_threads_);
+    exec_priv_compare_A(channel_,comparator,n_threads_);
     return comparator->output();
 }
 
 mpz_class Client::run_garbled_compare_A(GC_Compare_A *comparator)
 {
-    exec_garbled_compare_A(socket_,comparator);
+    exec_garbled_compare_A(channel_,comparator);
     return comparator->output();
 }
 
@@ -276,22 +421,22 @@ mpz_class Client::run_garbled_compare_A(GC_Compare_A *comparator)
 
 void Client::run_comparison_protocol_B(Comparison_protocol_B *comparator)
 {
-    exec_comparison_protocol_B(socket_,comparator,n_threads_);
+    exec_comparison_protocol_B(channel_,comparator,n_threads_);
 }
 
 void Client::run_lsic_B(LSIC_B *lsic)
 {
-    exec_lsic_B(socket_,lsic);
+    exec_lsic_B(channel_,lsic);
 }
 
 void Client::run_priv_compare_B(Compare_B *comparator)
 {
-    exec_priv_compare_B(socket_,comparator,n_threads_);
+    exec_priv_compare_B(channel_,comparator,n_threads_);
 }
 
 void Client::run_garbled_compare_B(GC_Compare_B *comparator)
 {
-    exec_garbled_compare_B(socket_,comparator);
+    exec_garbled_compare_B(channel_,comparator);
 }
 
 
@@ -305,7 +450,7 @@ void Client::rev_enc_comparison(const mpz_class &a, const mpz_class &b, size_t l
 
 void Client::run_rev_enc_comparison_owner(Rev_EncCompare_Owner &owner)
 {
-    exec_rev_enc_comparison_owner(socket_, owner, lambda_, true, n_threads_);
+    exec_rev_enc_comparison_owner(channel_, owner, lambda_, true, n_threads_);
 }
 
 
@@ -317,7 +462,7 @@ bool Client::help_rev_enc_comparison(const size_t &l, COMPARISON_PROTOCOL compar
 
 bool Client::run_rev_enc_comparison_helper(Rev_EncCompare_Helper &helper)
 {
-    exec_rev_enc_comparison_helper(socket_, helper, true, n_threads_);
+    exec_rev_enc_comparison_helper(channel_, helper, true, n_threads_);
     return helper.output();
 }
 
@@ -332,7 +477,7 @@ bool Client::enc_comparison(const mpz_class &a, const mpz_class &b, size_t l, CO
 
 bool Client::run_enc_comparison_owner(EncCompare_Owner &owner)
 {
-    exec_enc_comparison_owner(socket_, owner, lambda_, true, n_threads_);
+    exec_enc_comparison_owner(channel_, owner, lambda_, true, n_threads_);
     return owner.output();
 }
 
@@ -344,7 +489,7 @@ void Client::help_enc_comparison(const size_t &l, COMPARISON_PROTOCOL comparison
 
 void Client::run_enc_comparison_helper(EncCompare_Helper &helper)
 {
-    exec_enc_comparison_helper(socket_,helper, true, n_threads_);
+    exec_enc_comparison_helper(channel_,helper, true, n_threads_);
 }
 
 // same as before, but the result is encrypted under QR
@@ -352,23 +497,23 @@ void Client::run_enc_comparison_helper(EncCompare_Helper &helper)
 
 mpz_class Client::run_rev_enc_comparison_owner_enc_result(Rev_EncCompare_Owner &owner)
 {
-    exec_rev_enc_comparison_owner(socket_, owner, lambda_, false, n_threads_);
+    exec_rev_enc_comparison_owner(channel_, owner, lambda_, false, n_threads_);
     return owner.encrypted_output();
 }
 
 void Client::run_rev_enc_comparison_helper_enc_result(Rev_EncCompare_Helper &helper)
 {
-    exec_rev_enc_comparison_helper(socket_, helper, false, n_threads_);
+    exec_rev_enc_comparison_helper(channel_, helper, false, n_threads_);
 }
 
 void Client::run_enc_comparison_owner_enc_result(EncCompare_Owner &owner)
 {
-    exec_enc_comparison_owner(socket_, owner, lambda_, false, n_threads_);
+    exec_enc_comparison_owner(channel_, owner, lambda_, false, n_threads_);
 }
 
 mpz_class Client::run_enc_comparison_helper_enc_result(EncCompare_Helper &helper)
 {
-    exec_enc_comparison_helper(socket_,helper, false, n_threads_);
+    exec_enc_comparison_helper(channel_,helper, false, n_threads_);
     return helper.encrypted_output();
 }
 
@@ -404,6 +549,80 @@ void Client::help_enc_comparison_enc_result(const size_t &l, COMPARISON_PROTOCOL
     run_rev_enc_comparison_helper_enc_result(helper);
 }
 
+vector<mpz_class> Client::batch_enc_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l)
+{
+    assert(a.size() == b.size());
+    size_t n = a.size();
+    vector<Rev_EncCompare_Owner*> owners(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        owners[i] = new Rev_EncCompare_Owner(create_rev_enc_comparator_owner(l, GC_PROTOCOL));
+        owners[i]->set_input(a[i],b[i]);
+    }
+    
+    exec_rev_enc_comparison_owner_batch(channel_, owners, lambda_, false);
+    
+    vector<mpz_class> results(n);
+    for (size_t i = 0; i < n; i++) {
+        results[i] = owners[i]->encrypted_output();
+        delete owners[i];
+    }
+    
+    return results;
+}
+
+void Client::help_batch_enc_comparison_enc_result(const size_t n, const size_t &l)
+{
+    vector<Rev_EncCompare_Helper*> helpers(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        helpers[i] = new Rev_EncCompare_Helper(create_rev_enc_comparator_helper(l, GC_PROTOCOL));
+    }
+    
+    exec_rev_enc_comparison_helper_batch(channel_, helpers, false);
+    
+    for (size_t i = 0; i < n; i++) {
+        delete helpers[i];
+    }
+}
+
+vector<mpz_class> Client::pipelined_enc_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, unsigned int window)
+{
+    assert(a.size() == b.size());
+    size_t n = a.size();
+    vector<Rev_EncCompare_Owner*> owners(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        owners[i] = new Rev_EncCompare_Owner(create_rev_enc_comparator_owner(l, GC_PROTOCOL));
+        owners[i]->set_input(a[i],b[i]);
+    }
+    
+    exec_rev_enc_comparison_owner_pipelined(channel_, owners, lambda_, window, false);
+    
+    vector<mpz_class> results(n);
+    for (size_t i = 0; i < n; i++) {
+        results[i] = owners[i]->encrypted_output();
+        delete owners[i];
+    }
+    
+    return results;
+}
+
+void Client::help_pipelined_enc_comparison_enc_result(const size_t n, const size_t &l)
+{
+    vector<Rev_EncCompare_Helper*> helpers(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        helpers[i] = new Rev_EncCompare_Helper(create_rev_enc_comparator_helper(l, GC_PROTOCOL));
+    }
+    
+    exec_rev_enc_comparison_helper_pipelined(channel_, helpers, false);
+    
+    for (size_t i = 0; i < n; i++) {
+        delete helpers[i];
+    }
+}
+
 vector<bool> Client::multiple_enc_comparison(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, COMPARISON_PROTOCOL comparison_prot)
 {
     assert(a.size() == b.size());
@@ -416,7 +635,7 @@ vector<bool> Client::multiple_enc_comparison(const vector<mpz_class> &a, const v
     }
 
     unsigned int thread_per_job = ceilf(((float)n_threads_)/n);
-    multiple_exec_enc_comparison_owner(socket_, owners, lambda_, true, thread_per_job, port_+1);
+    multiple_exec_enc_comparison_owner(channel_, owners, lambda_, true, thread_per_job);
     
     vector<bool> results(n);
     
@@ -438,7 +657,7 @@ void Client::multiple_help_enc_comparison(const size_t n, const size_t &l, COMPA
     }
    
     unsigned int thread_per_job = ceilf(((float)n_threads_)/n);
-    multiple_exec_enc_comparison_helper(socket_, helpers, true, thread_per_job, port_+1);
+    multiple_exec_enc_comparison_helper(channel_, helpers, true, thread_per_job);
     
     for (size_t i = 0; i < n; i++) {
         delete helpers[i];
@@ -457,7 +676,7 @@ void Client::multiple_rev_enc_comparison(const vector<mpz_class> &a, const vecto
     }
     
     unsigned int thread_per_job = ceilf(((float)n_threads_)/n);
-    multiple_exec_rev_enc_comparison_owner(socket_, owners, lambda_, true, thread_per_job, port_+1);
+    multiple_exec_rev_enc_comparison_owner(channel_, owners, lambda_, true, thread_per_job);
     
     
     for (size_t i = 0; i < n; i++) {
@@ -477,7 +696,7 @@ vector<bool> Client::multiple_help_rev_enc_comparison(const size_t n, const size
     }
     
     unsigned int thread_per_job = ceilf(((float)n_threads_)/n);
-    multiple_exec_rev_enc_comparison_helper(socket_, helpers, true, thread_per_job, port_+1);
+    multiple_exec_rev_enc_comparison_helper(channel_, helpers, true, thread_per_job);
     
     vector<bool> results(n);
     for (size_t i = 0; i < n; i++) {
@@ -499,12 +718,12 @@ size_t Client::run_linear_enc_argmax(Linear_EncArgmax_Owner &owner, COMPARISON_P
     if (comparison_prot == LSIC_PROTOCOL) {
         comparator_creator = [this,nbits](){ return new LSIC_A(0,nbits,*server_gm_); };
     }else if (comparison_prot == DGK_PROTOCOL){
-        comparator_creator = [this,nbits](){ return new Compare_A(0,nbits,*server_paillier_,*server_gm_,rand_state_); };
+        comparator_creator = [this,nbits](){ return new Compare_A(0,nbits,*server_dgk_,*server_gm_,rand_state_); };
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator_creator = [this,nbits](){ return new GC_Compare_A(0,nbits,*server_gm_, rand_state_); };
+        comparator_creator = [this,nbits](){ return new GC_Compare_A(0,nbits,*server_gm_, rand_state_, &ot_extension_); };
     }
 
-    exec_linear_enc_argmax(socket_,owner, comparator_creator, lambda_, n_threads_);
+    exec_linear_enc_argmax(channel_,owner, comparator_creator, lambda_, n_threads_);
     
     return owner.output();
 }
@@ -520,12 +739,12 @@ size_t Client::run_tree_enc_argmax(Tree_EncArgmax_Owner &owner, COMPARISON_PROTO
     if (comparison_prot == LSIC_PROTOCOL) {
         comparator_creator = [this,nbits](){ return new LSIC_A(0,nbits,*server_gm_); };
     }else if (comparison_prot == DGK_PROTOCOL){
-        comparator_creator = [this,nbits](){ return new Compare_A(0,nbits,*server_paillier_,*server_gm_,rand_state_); };
+        comparator_creator = [this,nbits](){ return new Compare_A(0,nbits,*server_dgk_,*server_gm_,rand_state_); };
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator_creator = [this,nbits](){ return new GC_Compare_A(0,nbits,*server_gm_, rand_state_); };
+        comparator_creator = [this,nbits](){ return new GC_Compare_A(0,nbits,*server_gm_, rand_state_, &ot_extension_); };
     }
 
-    exec_tree_enc_argmax(socket_,owner, comparator_creator, lambda_, n_threads_, port_+1);
+    exec_tree_enc_argmax(channel_,owner, comparator_creator, lambda_, n_threads_);
     
     return owner.output();
 }
@@ -534,13 +753,13 @@ Ctxt Client::change_encryption_scheme(const vector<mpz_class> &c_gm)
 {
     EncryptedArray ea(*fhe_context_, fhe_G_);
 
-    return exec_change_encryption_scheme_slots(socket_, c_gm, *server_gm_ ,*server_fhe_pk_, ea, rand_state_);
+    return exec_change_encryption_scheme_slots(channel_, c_gm, *server_gm_ ,*server_fhe_pk_, ea, rand_state_);
 }
 
 void Client::run_change_encryption_scheme_slots_helper()
 {
     EncryptedArray ea(*fhe_context_, fhe_G_);
-    exec_change_encryption_scheme_slots_helper(socket_, *gm_, *fhe_sk_, ea);
+    exec_change_encryption_scheme_slots_helper(channel_, *gm_, *fhe_sk_, ea);
 }
 
 
@@ -548,24 +767,24 @@ vector<mpz_class> Client::change_encryption_scheme_back(const Ctxt &c_fhe)
 {
     EncryptedArray ea(*fhe_context_, fhe_G_);
 
-    return exec_change_encryption_scheme_back_slots(socket_, c_fhe, *server_gm_ ,*server_fhe_pk_, ea, rand_state_);
+    return exec_change_encryption_scheme_back_slots(channel_, c_fhe, *server_gm_ ,*server_fhe_pk_, ea, rand_state_);
 }
 
 void Client::run_change_encryption_scheme_back_slots_helper()
 {
     EncryptedArray ea(*fhe_context_, fhe_G_);
-    exec_change_encryption_scheme_back_slots_helper(socket_, *gm_, *fhe_sk_, ea);
+    exec_change_encryption_scheme_back_slots_helper(channel_, *gm_, *fhe_sk_, ea);
 }
 
 
 mpz_class Client::compute_dot_product(const vector<mpz_class> &x)
 {
-    return exec_compute_dot_product(socket_, x, *server_paillier_);
+    return exec_compute_dot_product(channel_, x, *server_paillier_);
 }
 
 void Client::help_compute_dot_product(const vector<mpz_class> &y, bool encrypted_input)
 {
-    exec_help_compute_dot_product(socket_, y, *paillier_, encrypted_input);
+    exec_help_compute_dot_product(channel_, y, *paillier_, encrypted_input);
 }
 
 
@@ -580,9 +799,9 @@ EncCompare_Owner Client::create_enc_comparator_owner(size_t bit_size, COMPARISON
         comparator = new LSIC_B(0,bit_size,*gm_);
     }else if (comparison_prot == DGK_PROTOCOL){
         assert(paillier_ != NULL);
-        comparator = new Compare_B(0,bit_size,*paillier_,*gm_);
+        comparator = new Compare_B(0,bit_size,*dgk_,*gm_);
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_B(0,bit_size,*gm_, rand_state_);
+        comparator = new GC_Compare_B(0,bit_size,*gm_, rand_state_, &ot_extension_);
     }
 
     return EncCompare_Owner(0,0,bit_size,*server_paillier_,comparator,rand_state_);
@@ -597,9 +816,9 @@ EncCompare_Helper Client::create_enc_comparator_helper(size_t bit_size, COMPARIS
     if (comparison_prot == LSIC_PROTOCOL) {
         comparator = new LSIC_A(0,bit_size,*server_gm_);
     }else if (comparison_prot == DGK_PROTOCOL){
-        comparator = new Compare_A(0,bit_size,*server_paillier_,*server_gm_,rand_state_);
+        comparator = new Compare_A(0,bit_size,*server_dgk_,*server_gm_,rand_state_);
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_A(0,bit_size,*server_gm_, rand_state_);
+        comparator = new GC_Compare_A(0,bit_size,*server_gm_, rand_state_, &ot_extension_);
     }
     
     return EncCompare_Helper(bit_size,*paillier_,comparator);
@@ -615,9 +834,9 @@ Rev_EncCompare_Owner Client::create_rev_enc_comparator_owner(size_t bit_size, CO
     if (comparison_prot == LSIC_PROTOCOL) {
         comparator = new LSIC_A(0,bit_size,*server_gm_);
     }else if (comparison_prot == DGK_PROTOCOL){
-        comparator = new Compare_A(0,bit_size,*server_paillier_,*server_gm_,rand_state_);
+        comparator = new Compare_A(0,bit_size,*server_dgk_,*server_gm_,rand_state_);
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_A(0,bit_size,*server_gm_, rand_state_);
+        comparator = new GC_Compare_A(0,bit_size,*server_gm_, rand_state_, &ot_extension_);
     }
     
     return Rev_EncCompare_Owner(0,0,bit_size,*server_paillier_,comparator,rand_state_);
@@ -634,30 +853,30 @@ Rev_EncCompare_Helper Client::create_rev_enc_comparator_helper(size_t bit_size,
         comparator = new LSIC_B(0,bit_size,*gm_);
     }else if (comparison_prot == DGK_PROTOCOL){
         assert(paillier_ != NULL);
-        comparator = new Compare_B(0,bit_size,*paillier_,*gm_);
+        comparator = new Compare_B(0,bit_size,*dgk_,*gm_);
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_B(0,bit_size,*gm_, rand_state_);
+        comparator = new GC_Compare_B(0,bit_size,*gm_, rand_state_, &ot_extension_);
     }
     
     return Rev_EncCompare_Helper(bit_size,*paillier_,comparator);
 }
 
 vector<mpz_class> Client::change_encryption_scheme_gm_paillier(const vector<mpz_class> &c_gm) {
-    return exec_change_encryption_scheme_paillier_slots(socket_, c_gm, *server_gm_, *server_paillier_, rand_state_);
+    return exec_change_encryption_scheme_paillier_slots(channel_, c_gm, *server_gm_, *server_paillier_, rand_state_);
 }
 
 void Client::run_change_encryption_scheme_gm_paillier_slots_helper() {
-    exec_change_encryption_scheme_paillier_slots_helper(socket_, *gm_, *paillier_);
+    exec_change_encryption_scheme_paillier_slots_helper(channel_, *gm_, *paillier_);
 }
 
 vector<mpz_class> Client::change_encryption_scheme_fhe_paillier(const Ctxt &c_fhe) {
     EncryptedArray ea(*fhe_context_, fhe_G_);
-    return exec_change_encryption_scheme_fhe_paillier_slots(socket_, c_fhe, *server_paillier_ ,*server_fhe_pk_, ea, rand_state_);
+    return exec_change_encryption_scheme_fhe_paillier_slots(channel_, c_fhe, *server_paillier_ ,*server_fhe_pk_, ea, rand_state_);
 }
 
 void Client::run_change_encryption_scheme_fhe_paillier_slots_helper() {
     EncryptedArray ea(*fhe_context_, fhe_G_);
-    exec_change_encryption_scheme_fhe_paillier_slots_helper(socket_, *paillier_, *fhe_sk_, ea);
+    exec_change_encryption_scheme_fhe_paillier_slots_helper(channel_, *paillier_, *fhe_sk_, ea);
 }
 
 void Client::run_tree_enc_argmax(Tree_EncArgmax_Helper &helper, COMPARISON_PROTOCOL comparison_prot) {
@@ -667,17 +886,17 @@ void Client::run_tree_enc_argmax(Tree_EncArgmax_Helper &helper, COMPARISON_PROTO
     if (comparison_prot == LSIC_PROTOCOL) {
         comparator_creator = [this,nbits](){ return new LSIC_B(0,nbits,*gm_); };
     }else if (comparison_prot == DGK_PROTOCOL){
-        comparator_creator = [this,nbits](){ return new Compare_B(0,nbits,*paillier_,*gm_); };
+        comparator_creator = [this,nbits](){ return new Compare_B(0,nbits,*dgk_,*gm_); };
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator_creator = [this,nbits](){ return new GC_Compare_B(0,nbits,*gm_, rand_state_); };
+        comparator_creator = [this,nbits](){ return new GC_Compare_B(0,nbits,*gm_, rand_state_, &ot_extension_); };
     }
-    exec_tree_enc_argmax(socket_, helper, comparator_creator, n_threads_, port_+1);
+    exec_tree_enc_argmax(channel_, helper, comparator_creator, n_threads_);
 }
 
 void Client::move_paillier_to_server(vector<mpz_class> c_p) {
-    exec_move_paillier_encryption(socket_, c_p, *paillier_, *server_paillier_, rand_state_);
+    exec_move_paillier_encryption(channel_, c_p, *paillier_, *server_paillier_, rand_state_);
 }
 
 vector<mpz_class> Client::move_paillier_from_server() {
-    return exec_move_paillier_encryption_helper(socket_, *paillier_, *server_paillier_);
+    return exec_move_paillier_encryption_helper(channel_, *paillier_, *server_paillier_);
 }
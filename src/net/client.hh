@@ -22,6 +22,7 @@
 
 #include <gmpxx.h>
 #include <vector>
+#include <memory>
 #include <boost/asio.hpp>
 
 #include <mpc/garbled_comparison.hh>
@@ -30,10 +31,15 @@
 
 #include <crypto/paillier.hh>
 #include <crypto/gm.hh>
+#include <crypto/dgk.hh>
 
 #include <net/key_deps_descriptor.hh>
+#include <net/key_store.hh>
+#include <net/ot_extension.hh>
 #include <net/defs.hh>
 
+#include <util/session_metrics.hh>
+
 using boost::asio::ip::tcp;
 
 using namespace std;
@@ -46,11 +52,13 @@ public:
     void connect(boost::asio::io_service& io_service, const string& hostname, const unsigned int port=PORT);
 
     tcp::socket& socket() { return socket_; }
+    Channel& channel() { return channel_; }
     
     /* Keys management */
     void init_needed_keys(unsigned int keysize);
     void init_GM(unsigned int keysize);
     void init_Paillier(unsigned int keysize);
+    void init_DGK(unsigned int keysize);
     void init_FHE_context();
     void init_FHE_key();
 
@@ -60,17 +68,28 @@ public:
     
     bool has_paillier_pk() const { return (server_paillier_ != NULL); }
     bool has_gm_pk() const { return (server_gm_ != NULL); }
+    bool has_dgk_pk() const { return (server_dgk_ != NULL); }
     bool has_fhe_pk() const { return (server_fhe_pk_ != NULL); }
     void get_server_pk_gm();
     void get_server_pk_paillier();
     void get_fhe_context();
     void get_server_pk_fhe();
+    /* from serialized Protobuf messages */
+    void set_server_pk_gm(const string &serialized_pk);
+    void set_server_pk_paillier(const string &serialized_pk);
+    void set_server_pk_dgk(const string &serialized_pk);
+    void set_fhe_context(const string &serialized_context);
+    void set_server_pk_fhe(const string &serialized_pk);
     
     void send_gm_pk();
     void send_paillier_pk();
     void send_fhe_pk();
 
     void exchange_keys();
+
+    /* see Server_session::read_query_batch */
+    void send_query_batch(const vector<vector<mpz_class> > &queries);
+    void end_queries();
     
     mpz_class run_comparison_protocol_A(Comparison_protocol_A *comparator);
     mpz_class run_lsic_A(LSIC_A *lsic);
@@ -95,6 +114,14 @@ public:
     
     mpz_class enc_comparison_enc_result(const mpz_class &a, const mpz_class &b, size_t l, COMPARISON_PROTOCOL comparison_prot);
     void help_enc_comparison_enc_result(const size_t &l, COMPARISON_PROTOCOL comparison_prot);
+
+    // n garbled comparisons in a single round trip (always GC_PROTOCOL)
+    vector<mpz_class> batch_enc_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l);
+    void help_batch_enc_comparison_enc_result(const size_t n, const size_t &l);
+
+    // n garbled comparisons with at most window of them in flight (always GC_PROTOCOL)
+    vector<mpz_class> pipelined_enc_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, unsigned int window);
+    void help_pipelined_enc_comparison_enc_result(const size_t n, const size_t &l);
     
     vector<bool> multiple_enc_comparison(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, COMPARISON_PROTOCOL comparison_prot);
     void multiple_help_enc_comparison(const size_t n, const size_t &l, COMPARISON_PROTOCOL comparison_prot);
@@ -146,15 +173,34 @@ public:
 
     unsigned int n_threads() const { return n_threads_; }
     void set_n_threads(unsigned int n) { assert(n > 0); n_threads_ = n; }
+
+    /* Paillier encryptions (with our key and the server's) use fixed-base
+     * randomizers, see Paillier::enable_fixed_base_randomizers */
+    void set_fixed_base_randomizers(bool b);
+
+    /* bind the metrics to the thread running the protocols, they are
+     * published to the sink (if any) when the client is destroyed */
+    Session_Metrics& metrics() { return metrics_; }
+    void set_metrics_sink(shared_ptr<Metrics_Sink> sink) { metrics_sink_ = sink; }
+
+    /* keys of the servers received in previous sessions, by default
+     * Key_Cache::shared_cache() */
+    void set_key_cache(shared_ptr<Key_Cache> cache) { key_cache_ = cache; }
 protected:
+    void prepare_key_material();
+
     tcp::socket socket_;
+    TCP_Channel channel_;
+    OTExtension ot_extension_;
     
     const Key_dependencies_descriptor key_deps_desc_;
     GM_priv *gm_;
     Paillier_priv_fast *paillier_;
+    DGK_priv *dgk_;
     
     Paillier *server_paillier_;
     GM *server_gm_;
+    DGK *server_dgk_;
     
     FHEcontext *fhe_context_;
     FHEPubKey *server_fhe_pk_;
@@ -164,9 +210,17 @@ protected:
     gmp_randstate_t rand_state_;
     
     boost::asio::streambuf input_buf_;
+    Session_Metrics metrics_;
+    shared_ptr<Metrics_Sink> metrics_sink_;
+
+    /* our public keys, serialized, and their digests */
+    vector<string> key_material_;
+    vector<string> key_digests_;
+    shared_ptr<Key_Cache> key_cache_;
     
     unsigned int n_threads_;
     unsigned int port_;
+    bool fixed_base_randomizers_;
 
     /* statistical security */
     unsigned int lambda_;
@@ -15,3 +15,6 @@
 #define FHE_m 0 // XXX: check?
 
 #define OT_SECPARAM 1024
+
+#define MAX_PENDING_SESSIONS 16
+#define MAX_QUERY_BATCH 1024
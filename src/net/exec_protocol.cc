@@ -24,23 +24,32 @@
 #include <net/net_utils.hh>
 
 #include <mpc/change_encryption_scheme.hh>
-#include <thread>
+#include <util/executor.hh>
+#include <net/channel_mux.hh>
 #include <net/defs.hh>
 
 #include <net/oblivious_transfer.hh>
+#include <net/ot_extension.hh>
 
-void exec_comparison_protocol_A(tcp::socket &socket, Comparison_protocol_A *comparator, unsigned int n_threads)
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+void exec_comparison_protocol_A(Channel &channel, Comparison_protocol_A *comparator, unsigned int n_threads)
 {
     if(typeid(*comparator) == typeid(LSIC_A)) {
-        exec_lsic_A(socket, reinterpret_cast<LSIC_A*>(comparator));
+        exec_lsic_A(channel, reinterpret_cast<LSIC_A*>(comparator));
     }else if(typeid(*comparator) == typeid(Compare_A)){
-        exec_priv_compare_A(socket, reinterpret_cast<Compare_A*>(comparator),n_threads);
+        exec_priv_compare_A(channel, reinterpret_cast<Compare_A*>(comparator),n_threads);
     }else if(typeid(*comparator) == typeid(GC_Compare_A)) {
-        exec_garbled_compare_A(socket, reinterpret_cast<GC_Compare_A*>(comparator));
+        exec_garbled_compare_A(channel, reinterpret_cast<GC_Compare_A*>(comparator));
     }
 }
 
-void exec_lsic_A(tcp::socket &socket, LSIC_A *lsic)
+void exec_lsic_A(Channel &channel, LSIC_A *lsic)
 {
     LSIC_Packet_A a_packet;
     LSIC_Packet_B b_packet;
@@ -51,7 +60,7 @@ void exec_lsic_A(tcp::socket &socket, LSIC_A *lsic)
    
     // response-request
     for (; ; ) {
-        b_message = readMessageFromSocket<Protobuf::LSIC_B_Message>(socket);
+        b_message = readMessageFromSocket<Protobuf::LSIC_B_Message>(channel);
         b_packet = convert_from_message(b_message);
         
         state = lsic->answerRound(b_packet,&a_packet);
@@ -61,17 +70,17 @@ void exec_lsic_A(tcp::socket &socket, LSIC_A *lsic)
         }
         
         a_message = convert_to_message(a_packet);
-        sendMessageToSocket(socket, a_message);
+        sendMessageToSocket(channel, a_message);
     }
 }
 
-void exec_priv_compare_A(tcp::socket &socket, Compare_A *comparator, unsigned int n_threads)
+void exec_priv_compare_A(Channel &channel, Compare_A *comparator, unsigned int n_threads)
 {
     vector<mpz_class> c_b(comparator->bit_length());
     
     // first get encrypted bits
     
-    Protobuf::BigIntArray c_b_message = readMessageFromSocket<Protobuf::BigIntArray>(socket);
+    Protobuf::BigIntArray c_b_message = readMessageFromSocket<Protobuf::BigIntArray>(channel);
     c_b = convert_from_message(c_b_message);
 
     vector<mpz_class> c_rand = comparator->compute(c_b,n_threads);
@@ -79,18 +88,18 @@ void exec_priv_compare_A(tcp::socket &socket, Compare_A *comparator, unsigned in
     // send the result
     
     Protobuf::BigIntArray c_rand_message = convert_to_message(c_rand);
-    sendMessageToSocket(socket, c_rand_message);
+    sendMessageToSocket(channel, c_rand_message);
     
     // wait for the encrypted result
     mpz_class c_t_prime;
     
-    Protobuf::BigInt c_t_prime_message = readMessageFromSocket<Protobuf::BigInt>(socket);
+    Protobuf::BigInt c_t_prime_message = readMessageFromSocket<Protobuf::BigInt>(channel);
     c_t_prime = convert_from_message(c_t_prime_message);
     
     comparator->unblind(c_t_prime);
 }
 
-void exec_garbled_compare_A(tcp::socket &socket, GC_Compare_A *comparator)
+void exec_garbled_compare_A(Channel &channel, GC_Compare_A *comparator)
 {
     comparator->prepare_circuit();
     int l = comparator->bit_length();
@@ -101,14 +110,14 @@ void exec_garbled_compare_A(tcp::socket &socket, GC_Compare_A *comparator)
     int a_inputs[l];
     
     // first get the global key ...
-    global_key = read_block_from_socket(socket);
+    global_key = read_block_from_socket(channel);
     comparator->set_global_key(global_key);
     
     // ... and then the garbled table ...
-    read_byte_string_from_socket(socket, (unsigned char*)(gc->garbledTable), sizeof(GarbledTable)*(gc->q));
+    read_byte_string_from_socket(channel, (unsigned char*)(gc->garbledTable), sizeof(GarbledTable)*comparison_circuit_table_count(l));
     
     // ... b's labels
-    read_byte_string_from_socket(socket, (unsigned char*)b_labels, (l+1)*sizeof(block));
+    read_byte_string_from_socket(channel, (unsigned char*)b_labels, (l+1)*sizeof(block));
     
     // initiate OT to get our labels
     
@@ -117,7 +126,13 @@ void exec_garbled_compare_A(tcp::socket &socket, GC_Compare_A *comparator)
         a_inputs[i] = a_bits[i];
     }
 
-    ObliviousTransfer::receiver(l, a_inputs, (char *)a_labels, socket, sizeof(block));
+    // extend the session's base OTs when possible (they are bound to a single channel)
+    OTExtension *ot_extension = comparator->ot_extension();
+    if (ot_extension && ot_extension->uses_channel(channel)) {
+        ot_extension->receiver(l, a_inputs, (char *)a_labels, sizeof(block));
+    }else{
+        ObliviousTransfer::receiver(l, a_inputs, (char *)a_labels, channel, sizeof(block));
+    }
     
     // evaluate GC
     
@@ -126,29 +141,29 @@ void exec_garbled_compare_A(tcp::socket &socket, GC_Compare_A *comparator)
     
     // get the outputmap
     OutputMap om = new block[2*sizeof(block)]; // m = 1
-    read_byte_string_from_socket(socket, (unsigned char*)om, 2*sizeof(block));
+    read_byte_string_from_socket(channel, (unsigned char*)om, 2*sizeof(block));
 
     // apply the outputmap
     comparator->map_output(om);
     
     // unblind
-    Protobuf::BigInt mask_m = readMessageFromSocket<Protobuf::BigInt>(socket);
+    Protobuf::BigInt mask_m = readMessageFromSocket<Protobuf::BigInt>(channel);
     mpz_class mask = convert_from_message(mask_m);
     comparator->unblind(mask);
 }
 
-void exec_comparison_protocol_B(tcp::socket &socket, Comparison_protocol_B *comparator, unsigned int n_threads)
+void exec_comparison_protocol_B(Channel &channel, Comparison_protocol_B *comparator, unsigned int n_threads)
 {
     if(typeid(*comparator) == typeid(LSIC_B)) {
-        exec_lsic_B(socket, reinterpret_cast<LSIC_B*>(comparator));
+        exec_lsic_B(channel, reinterpret_cast<LSIC_B*>(comparator));
     }else if(typeid(*comparator) == typeid(Compare_B)){
-        exec_priv_compare_B(socket, reinterpret_cast<Compare_B*>(comparator), n_threads);
+        exec_priv_compare_B(channel, reinterpret_cast<Compare_B*>(comparator), n_threads);
     }else if(typeid(*comparator) == typeid(GC_Compare_B)) {
-        exec_garbled_compare_B(socket, reinterpret_cast<GC_Compare_B*>(comparator));
+        exec_garbled_compare_B(channel, reinterpret_cast<GC_Compare_B*>(comparator));
     }
 }
 
-void exec_lsic_B(tcp::socket &socket, LSIC_B *lsic)
+void exec_lsic_B(Channel &channel, LSIC_B *lsic)
 {
 //    cout << "Start LSIC B" << endl;
 
@@ -158,50 +173,50 @@ void exec_lsic_B(tcp::socket &socket, LSIC_B *lsic)
     Protobuf::LSIC_B_Message b_message;
     
     b_message = convert_to_message(b_packet);
-    sendMessageToSocket(socket, b_message);
+    sendMessageToSocket(channel, b_message);
     
 //    cout << "LSIC setup sent" << endl;
     
     // wait for packets
     
     for (;b_packet.index < lsic->bitLength()-1; ) {
-        a_message = readMessageFromSocket<Protobuf::LSIC_A_Message>(socket);
+        a_message = readMessageFromSocket<Protobuf::LSIC_A_Message>(channel);
         a_packet = convert_from_message(a_message);
         
         b_packet = lsic->answerRound(a_packet);
         
         b_message = convert_to_message(b_packet);
-        sendMessageToSocket(socket, b_message);
+        sendMessageToSocket(channel, b_message);
     }
     
 //    cout << "LSIC B Done" << endl;
 }
 
-void exec_priv_compare_B(tcp::socket &socket, Compare_B *comparator, unsigned int n_threads)
+void exec_priv_compare_B(Channel &channel, Compare_B *comparator, unsigned int n_threads)
 {
     vector<mpz_class> c(comparator->bit_length());
     
     
     // send the encrypted bits
     Protobuf::BigIntArray c_b_message = convert_to_message(comparator->encrypt_bits_parallel(n_threads));
-    sendMessageToSocket(socket, c_b_message);
+    sendMessageToSocket(channel, c_b_message);
     
     // wait for the answer from the client
-    Protobuf::BigIntArray c_message = readMessageFromSocket<Protobuf::BigIntArray>(socket);
+    Protobuf::BigIntArray c_message = readMessageFromSocket<Protobuf::BigIntArray>(channel);
     c = convert_from_message(c_message);
     
     
     //    input_stream >> c;
     
-    mpz_class c_t_prime = comparator->search_zero(c);
+    mpz_class c_t_prime = comparator->search_zero_parallel(c, n_threads);
     
     // send the blinded result
     Protobuf::BigInt c_t_prime_message = convert_to_message(c_t_prime);
-    sendMessageToSocket(socket, c_t_prime_message);
+    sendMessageToSocket(channel, c_t_prime_message);
     
 }
 
-void exec_garbled_compare_B(tcp::socket &socket, GC_Compare_B *comparator)
+void exec_garbled_compare_B(Channel &channel, GC_Compare_B *comparator)
 {
     comparator->prepare_circuit();
     int l = comparator->bit_length();
@@ -211,46 +226,112 @@ void exec_garbled_compare_B(tcp::socket &socket, GC_Compare_B *comparator)
     
     // first send the global key ...
     global_key = comparator->get_global_key();
-    write_block_to_socket(global_key, socket);
+    write_block_to_socket(global_key, channel);
     
     // ... and then the garbled table ...
-    write_byte_string_to_socket(socket, (unsigned char*)(gc->garbledTable), sizeof(GarbledTable)*(gc->q));
+    write_byte_string_to_socket(channel, (unsigned char*)(gc->garbledTable), sizeof(GarbledTable)*comparison_circuit_table_count(l));
     
     // ... b's labels
     block *b_labels = comparator->get_b_input_labels();
-    write_byte_string_to_socket(socket, (unsigned char*)b_labels, (l+1)*sizeof(block));
+    write_byte_string_to_socket(channel, (unsigned char*)b_labels, (l+1)*sizeof(block));
     
     // initiate OT send get a's labels
     
     block *all_a_labels;
     all_a_labels = comparator->get_all_a_input_labels();
     
-    ObliviousTransfer::sender(l,(char *)all_a_labels, socket, sizeof(block));
+    OTExtension *ot_extension = comparator->ot_extension();
+    if (ot_extension && ot_extension->uses_channel(channel)) {
+        ot_extension->sender(l, (char *)all_a_labels, sizeof(block));
+    }else{
+        ObliviousTransfer::sender(l,(char *)all_a_labels, channel, sizeof(block));
+    }
     
     
     // send the outputmap
     OutputMap om = comparator->get_output_map(); // m = 1
-    write_byte_string_to_socket(socket, (unsigned char*)om, 2*sizeof(block));
+    write_byte_string_to_socket(channel, (unsigned char*)om, 2*sizeof(block));
     
     // send the mask
     mpz_class mask = comparator->get_enc_mask();
     Protobuf::BigInt mask_m = convert_to_message(mask);
-    sendMessageToSocket(socket, mask_m);
+    sendMessageToSocket(channel, mask_m);
 }
 
-void exec_rev_enc_comparison_owner(tcp::socket &socket, Rev_EncCompare_Owner &owner, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
+void exec_garbled_compare_batch_A(Channel &channel, GC_Compare_Batch_A &batch)
+{
+    batch.prepare_circuits();
+    size_t n_labels = batch.size()*batch.bit_length();
+    GC_Batch_Frame *frame = batch.frame();
+    
+    // get the keys, output maps, b's labels and garbled tables of all the circuits at once ...
+    read_byte_string_from_socket(channel, frame->data(), frame->size());
+    
+    // ... and the masks
+    Protobuf::BigIntArray masks_m = readMessageFromSocket<Protobuf::BigIntArray>(channel);
+    vector<mpz_class> masks = convert_from_message(masks_m);
+    
+    // a single OT batch for all our labels
+    int *a_inputs = new int[n_labels];
+    block *a_labels = (block *)malloc(n_labels*sizeof(block));
+    
+    vector<bool> a_bits = batch.get_a_bits();
+    for (size_t i = 0; i < n_labels; i++) {
+        a_inputs[i] = a_bits[i];
+    }
+    
+    OTExtension *ot_extension = batch.ot_extension();
+    if (ot_extension && ot_extension->uses_channel(channel)) {
+        ot_extension->receiver(n_labels, a_inputs, (char *)a_labels, sizeof(block));
+    }else{
+        ObliviousTransfer::receiver(n_labels, a_inputs, (char *)a_labels, channel, sizeof(block));
+    }
+    
+    batch.evaluateGC(a_labels);
+    batch.unblind(masks);
+    
+    free(a_labels);
+    delete [] a_inputs;
+}
+
+void exec_garbled_compare_batch_B(Channel &channel, GC_Compare_Batch_B &batch)
+{
+    batch.prepare_circuits();
+    size_t n_labels = batch.size()*batch.bit_length();
+    GC_Batch_Frame *frame = batch.frame();
+    
+    // the sizes are known to both parties: send the raw frame ...
+    write_byte_string_to_socket(channel, frame->data(), frame->size());
+    
+    // ... and the masks before the OTs so A can unblind as soon as it is done
+    Protobuf::BigIntArray masks_m = convert_to_message(batch.get_enc_masks());
+    sendMessageToSocket(channel, masks_m);
+    
+    block *all_a_labels = batch.get_all_a_input_labels();
+    
+    OTExtension *ot_extension = batch.ot_extension();
+    if (ot_extension && ot_extension->uses_channel(channel)) {
+        ot_extension->sender(n_labels, (char *)all_a_labels, sizeof(block));
+    }else{
+        ObliviousTransfer::sender(n_labels, (char *)all_a_labels, channel, sizeof(block));
+    }
+    
+    free(all_a_labels);
+}
+
+void exec_rev_enc_comparison_owner(Channel &channel, Rev_EncCompare_Owner &owner, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
 {
     size_t l = owner.bit_length();
     mpz_class c_z(owner.setup(lambda));
     
     Protobuf::Enc_Compare_Setup_Message setup_message = convert_to_message(c_z,l);
-    sendMessageToSocket(socket, setup_message);
+    sendMessageToSocket(channel, setup_message);
     
     // the other party does some computation, we just have to run the comparator
     
-    exec_comparison_protocol_A(socket, owner.comparator(), n_threads);
+    exec_comparison_protocol_A(channel, owner.comparator(), n_threads);
     
-    Protobuf::BigInt c_z_l_message = readMessageFromSocket<Protobuf::BigInt>(socket);
+    Protobuf::BigInt c_z_l_message = readMessageFromSocket<Protobuf::BigInt>(channel);
     mpz_class c_z_l = convert_from_message(c_z_l_message);
     
     
@@ -262,14 +343,14 @@ void exec_rev_enc_comparison_owner(tcp::socket &socket, Rev_EncCompare_Owner &ow
     }
     // ... else send the last message to the server
     Protobuf::BigInt c_t_message = convert_to_message(c_t);
-    sendMessageToSocket(socket, c_t_message);
+    sendMessageToSocket(channel, c_t_message);
 }
 
-void exec_rev_enc_comparison_helper(tcp::socket &socket, Rev_EncCompare_Helper &helper, bool decrypt_result, unsigned int n_threads)
+void exec_rev_enc_comparison_helper(Channel &channel, Rev_EncCompare_Helper &helper, bool decrypt_result, unsigned int n_threads)
 {
     // setup the helper if necessary
     if (!helper.is_set_up()) {
-        Protobuf::Enc_Compare_Setup_Message setup_message = readMessageFromSocket<Protobuf::Enc_Compare_Setup_Message>(socket);
+        Protobuf::Enc_Compare_Setup_Message setup_message = readMessageFromSocket<Protobuf::Enc_Compare_Setup_Message>(channel);
         if (setup_message.has_bit_length()) {
             helper.set_bit_length(setup_message.bit_length());
         }
@@ -279,13 +360,13 @@ void exec_rev_enc_comparison_helper(tcp::socket &socket, Rev_EncCompare_Helper &
     }
     
     // now, we need to run the comparison protocol
-    exec_comparison_protocol_B(socket, helper.comparator(), n_threads);
+    exec_comparison_protocol_B(channel, helper.comparator(), n_threads);
     
     
     mpz_class c_z_l(helper.get_c_z_l());
     
     Protobuf::BigInt c_z_l_message = convert_to_message(c_z_l);
-    sendMessageToSocket(socket, c_z_l_message);
+    sendMessageToSocket(channel, c_z_l_message);
     
     // if we don't decrypt the result, we are done now ...
     if (!decrypt_result) {
@@ -293,44 +374,44 @@ void exec_rev_enc_comparison_helper(tcp::socket &socket, Rev_EncCompare_Helper &
     }
 
     // ... else wait for the answer of the owner
-    Protobuf::BigInt c_t_message = readMessageFromSocket<Protobuf::BigInt>(socket);
+    Protobuf::BigInt c_t_message = readMessageFromSocket<Protobuf::BigInt>(channel);
     mpz_class c_t = convert_from_message(c_t_message);
     helper.decryptResult(c_t);
 }
 
-void exec_enc_comparison_owner(tcp::socket &socket, EncCompare_Owner &owner, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
+void exec_enc_comparison_owner(Channel &channel, EncCompare_Owner &owner, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
 {
     // now run the protocol itself
     size_t l = owner.bit_length();
     mpz_class c_z(owner.setup(lambda));
     
     Protobuf::Enc_Compare_Setup_Message setup_message = convert_to_message(c_z,l);
-    sendMessageToSocket(socket, setup_message);
+    sendMessageToSocket(channel, setup_message);
     
     // the server does some computation, we just have to run the lsic
     
-    exec_comparison_protocol_B(socket, owner.comparator(), n_threads);
+    exec_comparison_protocol_B(channel, owner.comparator(), n_threads);
     
     mpz_class c_r_l(owner.get_c_r_l());
     Protobuf::BigInt c_r_l_message = convert_to_message(c_r_l);
-    sendMessageToSocket(socket, c_r_l_message);
+    sendMessageToSocket(channel, c_r_l_message);
     
     // if we don't decrypt the result, we are done now ...
     if (!decrypt_result) {
         return;
     }
     // ... else wait for the answer of the owner
-    Protobuf::BigInt c_t_message = readMessageFromSocket<Protobuf::BigInt>(socket);
+    Protobuf::BigInt c_t_message = readMessageFromSocket<Protobuf::BigInt>(channel);
     mpz_class c_t = convert_from_message(c_t_message);
     
     owner.decryptResult(c_t);
 }
 
-void exec_enc_comparison_helper(tcp::socket &socket, EncCompare_Helper &helper, bool decrypt_result, unsigned int n_threads)
+void exec_enc_comparison_helper(Channel &channel, EncCompare_Helper &helper, bool decrypt_result, unsigned int n_threads)
 {
     // setup the helper if necessary
     if (!helper.is_set_up()) {
-        Protobuf::Enc_Compare_Setup_Message setup_message = readMessageFromSocket<Protobuf::Enc_Compare_Setup_Message>(socket);
+        Protobuf::Enc_Compare_Setup_Message setup_message = readMessageFromSocket<Protobuf::Enc_Compare_Setup_Message>(channel);
         if (setup_message.has_bit_length()) {
             helper.set_bit_length(setup_message.bit_length());
         }
@@ -340,9 +421,9 @@ void exec_enc_comparison_helper(tcp::socket &socket, EncCompare_Helper &helper,
     }
     
     // now, we need to run the comparison protocol
-    exec_comparison_protocol_A(socket, helper.comparator(), n_threads);
+    exec_comparison_protocol_A(channel, helper.comparator(), n_threads);
     
-    Protobuf::BigInt c_r_l_message = readMessageFromSocket<Protobuf::BigInt>(socket);
+    Protobuf::BigInt c_r_l_message = readMessageFromSocket<Protobuf::BigInt>(channel);
     mpz_class c_r_l = convert_from_message(c_r_l_message);
     
     mpz_class c_t = helper.concludeProtocol(c_r_l);
@@ -353,154 +434,369 @@ void exec_enc_comparison_helper(tcp::socket &socket, EncCompare_Helper &helper,
     }
     // else ... send the last message to the server
     Protobuf::BigInt c_t_message = convert_to_message(c_t);
-    sendMessageToSocket(socket, c_t_message);
+    sendMessageToSocket(channel, c_t_message);
 }
 
 
-void multiple_exec_enc_comparison_owner_thread_call(shared_ptr<tcp::socket> socket, EncCompare_Owner *owner_ptr, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
-{
-    exec_enc_comparison_owner(*socket,*owner_ptr,lambda,decrypt_result,n_threads);
-}
-
-void multiple_exec_enc_comparison_owner(tcp::socket &socket, vector<EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result, unsigned int n_threads, unsigned int port)
+void exec_rev_enc_comparison_owner_batch(Channel &channel, vector<Rev_EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result)
 {
-    // when doing multiple executions in parallel, the owner creates the sockets and the helper connects
+    size_t n = owners.size();
+    vector<mpz_class> c_z(n);
+    vector<GC_Compare_A*> comparators(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        c_z[i] = owners[i]->setup(lambda);
+        assert(typeid(*(owners[i]->comparator())) == typeid(GC_Compare_A));
+        comparators[i] = reinterpret_cast<GC_Compare_A*>(owners[i]->comparator());
+    }
     
-    thread **comparison_threads = new thread* [owners.size()];
+    Protobuf::BigIntArray c_z_message = convert_to_message(c_z);
+    sendMessageToSocket(channel, c_z_message);
     
-    tcp::endpoint endpoint = socket.local_endpoint(); // (tcp::v4(), PORT+1);
-    endpoint.port(port);
+    GC_Compare_Batch_A batch(comparators);
+    exec_garbled_compare_batch_A(channel, batch);
     
-    tcp::acceptor acceptor(socket.get_io_service(), endpoint);
+    Protobuf::BigIntArray c_z_l_message = readMessageFromSocket<Protobuf::BigIntArray>(channel);
+    vector<mpz_class> c_z_l = convert_from_message(c_z_l_message);
+    assert(c_z_l.size() == n);
     
-    for (size_t i = 0; i < owners.size(); i++) {
-        shared_ptr<tcp::socket> comp_socket (new tcp::socket(socket.get_io_service()));
-        
-        if (i == 0) {
-            // now that we are ready to accept connexions on this port, notify the client
-            sendMessageToSocket<Protobuf::SOCKET_READY_Message>(socket,Protobuf::SOCKET_READY_Message());
-        }
-        
-        acceptor.accept(*comp_socket);
-        
-        // the socket has been created and the helper connected, now run the comparisons
-        comparison_threads[i] = new thread(&multiple_exec_enc_comparison_owner_thread_call,comp_socket,owners[i],lambda,decrypt_result,n_threads);
+    vector<mpz_class> c_t(n);
+    for (size_t i = 0; i < n; i++) {
+        c_t[i] = owners[i]->concludeProtocol(c_z_l[i]);
     }
     
-    for (size_t i = 0 ; i < owners.size(); i++) {
-        comparison_threads[i]->join();
-        delete comparison_threads[i];
+    if (!decrypt_result) {
+        return;
     }
-    
-    delete [] comparison_threads;
-}
-
-void multiple_exec_enc_comparison_helper_thread_call(shared_ptr<tcp::socket> socket,EncCompare_Helper *helper_ptr, bool decrypt_result, unsigned int n_threads)
-{
-    exec_enc_comparison_helper(*socket,*helper_ptr,decrypt_result,n_threads);
+    Protobuf::BigIntArray c_t_message = convert_to_message(c_t);
+    sendMessageToSocket(channel, c_t_message);
 }
 
-void multiple_exec_enc_comparison_helper(tcp::socket &socket, vector<EncCompare_Helper*> &helpers, bool decrypt_result, unsigned int n_threads, unsigned int port)
+void exec_rev_enc_comparison_helper_batch(Channel &channel, vector<Rev_EncCompare_Helper*> &helpers, bool decrypt_result)
 {
-    thread **comparison_threads = new thread* [helpers.size()];
+    size_t n = helpers.size();
+    vector<GC_Compare_B*> comparators(n);
     
-    tcp::resolver resolver(socket.get_io_service());
-    tcp::endpoint endpoint = socket.remote_endpoint(); // (tcp::v4(), PORT+1);
-    endpoint.port(port);
+    Protobuf::BigIntArray c_z_message = readMessageFromSocket<Protobuf::BigIntArray>(channel);
+    vector<mpz_class> c_z = convert_from_message(c_z_message);
+    assert(c_z.size() == n);
     
+    for (size_t i = 0; i < n; i++) {
+        helpers[i]->setup(c_z[i]);
+        assert(typeid(*(helpers[i]->comparator())) == typeid(GC_Compare_B));
+        comparators[i] = reinterpret_cast<GC_Compare_B*>(helpers[i]->comparator());
+    }
     
-    // wait for the owner to be ready
-    readMessageFromSocket<Protobuf::SOCKET_READY_Message>(socket);
+    GC_Compare_Batch_B batch(comparators);
+    exec_garbled_compare_batch_B(channel, batch);
     
-    for (size_t i = 0; i < helpers.size(); i++) {
-        shared_ptr<tcp::socket> comp_socket (new tcp::socket(socket.get_io_service()));
-        comp_socket->connect(endpoint);
-        
-        // the socket has been created and the owner connected, now run the comparisons
-        comparison_threads[i] = new thread(&multiple_exec_enc_comparison_helper_thread_call,(comp_socket),(helpers[i]),decrypt_result,n_threads);
+    vector<mpz_class> c_z_l(n);
+    for (size_t i = 0; i < n; i++) {
+        c_z_l[i] = helpers[i]->get_c_z_l();
     }
+    Protobuf::BigIntArray c_z_l_message = convert_to_message(c_z_l);
+    sendMessageToSocket(channel, c_z_l_message);
     
-    for (size_t i = 0 ; i < helpers.size(); i++) {
-        comparison_threads[i]->join();
-        delete comparison_threads[i];
+    if (!decrypt_result) {
+        return;
+    }
+    Protobuf::BigIntArray c_t_message = readMessageFromSocket<Protobuf::BigIntArray>(channel);
+    vector<mpz_class> c_t = convert_from_message(c_t_message);
+    assert(c_t.size() == n);
+    for (size_t i = 0; i < n; i++) {
+        helpers[i]->decryptResult(c_t[i]);
     }
-    
-    delete [] comparison_threads;
 }
 
-void multiple_exec_rev_enc_comparison_owner_thread_call(shared_ptr<tcp::socket> socket, Rev_EncCompare_Owner *owner_ptr, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
+static Protobuf::Pipelined_Compare_Message pipelined_message(Protobuf::Pipelined_Compare_Message::Message_Type type, size_t tag, const mpz_class &value, const string &data = string())
 {
-    exec_rev_enc_comparison_owner(*socket,*owner_ptr,lambda,decrypt_result,n_threads);
+    Protobuf::Pipelined_Compare_Message message;
+    message.set_type(type);
+    message.set_tag(tag);
+    *message.mutable_value() = convert_to_message(value);
+    if (data.size() > 0) {
+        message.set_data(data);
+    }
+    return message;
 }
 
-void multiple_exec_rev_enc_comparison_owner(tcp::socket &socket, vector<Rev_EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result, unsigned int n_threads, unsigned int port)
+static void send_pipelined_message(Channel &channel, Protobuf::Pipelined_Compare_Message::Message_Type type, size_t tag, const mpz_class &value, const string &data = string())
 {
-    // when doing multiple executions in parallel, the owner creates the sockets and the helper connects
+    sendMessageToSocket(channel, pipelined_message(type, tag, value, data));
+}
+
+// Sends the messages pushed by the calling thread from a blocking task, in
+// order. The helper answers each message with a blocking write: if the owner
+// stopped reading to write, both parties could block on full socket buffers
+// as soon as more than a few comparisons are in flight.
+class Pipelined_Writer {
+public:
+    Pipelined_Writer(Channel &channel) : channel_(channel), closed_(false)
+    {
+        writer_.run_blocking([this]{ write_loop(); });
+    }
     
-    thread **comparison_threads = new thread* [owners.size()];
+    ~Pipelined_Writer() { close(); }
     
-    tcp::endpoint endpoint = socket.local_endpoint(); // (tcp::v4(), PORT+1);
-    endpoint.port(port);
+    void push(Protobuf::Pipelined_Compare_Message &&message)
+    {
+        {
+            lock_guard<mutex> lock(mtx_);
+            queue_.push_back(move(message));
+        }
+        changed_.notify_one();
+    }
     
-    tcp::acceptor acceptor(socket.get_io_service(), endpoint);
+    /* waits for the queued messages to be sent, rethrows a failed write */
+    void finish()
+    {
+        close();
+        writer_.wait();
+    }
     
-    for (size_t i = 0; i < owners.size(); i++) {
-        shared_ptr<tcp::socket> comp_socket (new tcp::socket(socket.get_io_service()));
-        
-        if (i == 0) {
-            // now that we are ready to accept connexions on this port, notify the client
-            sendMessageToSocket<Protobuf::SOCKET_READY_Message>(socket,Protobuf::SOCKET_READY_Message());
+protected:
+    void close()
+    {
+        {
+            lock_guard<mutex> lock(mtx_);
+            closed_ = true;
         }
-        
-        acceptor.accept(*comp_socket);
-        
-        // the socket has been created and the helper connected, now run the comparisons
-        comparison_threads[i] = new thread(&multiple_exec_rev_enc_comparison_owner_thread_call,comp_socket,owners[i],lambda,decrypt_result,n_threads);
+        changed_.notify_one();
     }
     
-    for (size_t i = 0 ; i < owners.size(); i++) {
-        comparison_threads[i]->join();
-        delete comparison_threads[i];
+    void write_loop()
+    {
+        for (;;) {
+            Protobuf::Pipelined_Compare_Message message;
+            {
+                unique_lock<mutex> lock(mtx_);
+                changed_.wait(lock, [this]{ return closed_ || !queue_.empty(); });
+                if (queue_.empty()) {
+                    return;
+                }
+                message = move(queue_.front());
+                queue_.pop_front();
+            }
+            sendMessageToSocket(channel_, message);
+        }
     }
     
-    delete [] comparison_threads;
-}
+    Channel &channel_;
+    deque<Protobuf::Pipelined_Compare_Message> queue_;
+    bool closed_;
+    mutex mtx_;
+    condition_variable changed_;
+    // last member: waits for the writer before the queue goes away
+    Task_Group writer_;
+};
+
+// progress of each pipelined comparison: the tags and types come from the
+// peer, a message that does not fit the stage of its comparison is rejected
+enum Pipelined_Stage { PIPELINED_NONE, PIPELINED_SETUP, PIPELINED_GARBLED, PIPELINED_ANSWERED, PIPELINED_DONE };
 
-void multiple_exec_rev_enc_comparison_helper_thread_call(shared_ptr<tcp::socket> socket,Rev_EncCompare_Helper *helper_ptr, bool decrypt_result, unsigned int n_threads)
+static void check_pipelined_message(bool ok, size_t tag)
 {
-    exec_rev_enc_comparison_helper(*socket,*helper_ptr,decrypt_result,n_threads);
+    if (!ok) {
+        throw std::runtime_error("Unexpected pipelined comparison message for tag " + to_string(tag));
+    }
 }
 
-void multiple_exec_rev_enc_comparison_helper(tcp::socket &socket, vector<Rev_EncCompare_Helper*> &helpers, bool decrypt_result, unsigned int n_threads, unsigned int port)
+void exec_rev_enc_comparison_owner_pipelined(Channel &channel, vector<Rev_EncCompare_Owner*> &owners, unsigned int lambda, unsigned int window, bool decrypt_result)
 {
-    thread **comparison_threads = new thread* [helpers.size()];
+    size_t n = owners.size();
+    if (n == 0) {
+        return;
+    }
+    assert(window > 0);
+    
+    size_t l = owners[0]->bit_length();
+    vector<GC_Compare_A*> comparators(n);
+    for (size_t i = 0; i < n; i++) {
+        assert(typeid(*(owners[i]->comparator())) == typeid(GC_Compare_A));
+        assert(owners[i]->bit_length() == l);
+        comparators[i] = reinterpret_cast<GC_Compare_A*>(owners[i]->comparator());
+    }
+    
+    // the OT messages are carried by the tagged messages: we need the session's extension
+    OTExtension *ot_extension = comparators[0]->ot_extension();
+    assert(ot_extension && ot_extension->uses_channel(channel));
+    ot_extension->prepare_receiver();
     
-    tcp::resolver resolver(socket.get_io_service());
-    tcp::endpoint endpoint = socket.remote_endpoint(); // (tcp::v4(), PORT+1);
-    endpoint.port(port);
+    vector<unique_ptr<GC_Compare_Batch_A> > circuits(n);
+    vector<Pipelined_Stage> stages(n, PIPELINED_NONE);
+    vector<OTExtension::Receiver_State> ot_states(n);
+    vector<mpz_class> masks(n);
+    size_t next = 0, done = 0;
     
+    // from here on, the owner only blocks reading
+    Pipelined_Writer writer(channel);
     
-    // wait for the owner to be ready
-    readMessageFromSocket<Protobuf::SOCKET_READY_Message>(socket);
+    // fill the pipeline
+    for (; next < n && next < window; next++) {
+        writer.push(pipelined_message(Protobuf::Pipelined_Compare_Message::SETUP, next, owners[next]->setup(lambda)));
+        stages[next] = PIPELINED_SETUP;
+    }
     
-    for (size_t i = 0; i < helpers.size(); i++) {
-        shared_ptr<tcp::socket> comp_socket (new tcp::socket(socket.get_io_service()));
-        comp_socket->connect(endpoint);
+    while (done < n) {
+        Protobuf::Pipelined_Compare_Message message = readMessageFromSocket<Protobuf::Pipelined_Compare_Message>(channel);
+        size_t tag = message.tag();
+        check_pipelined_message(tag < next, tag);
         
-        // the socket has been created and the owner connected, now run the comparisons
-        comparison_threads[i] = new thread(&multiple_exec_rev_enc_comparison_helper_thread_call,(comp_socket),(helpers[i]),decrypt_result,n_threads);
+        if (message.type() == Protobuf::Pipelined_Compare_Message::GARBLED) {
+            check_pipelined_message(stages[tag] == PIPELINED_SETUP, tag);
+            circuits[tag].reset(new GC_Compare_Batch_A(vector<GC_Compare_A*>(1, comparators[tag])));
+            circuits[tag]->prepare_circuits();
+            
+            GC_Batch_Frame *frame = circuits[tag]->frame();
+            check_pipelined_message(message.data().size() == frame->size(), tag);
+            memcpy(frame->data(), message.data().data(), frame->size());
+            masks[tag] = convert_from_message(message.value());
+            stages[tag] = PIPELINED_GARBLED;
+            
+            vector<bool> a_bits = circuits[tag]->get_a_bits();
+            vector<int> a_inputs(a_bits.begin(), a_bits.end());
+            string request(OTExtension::request_size(l), 0);
+            ot_extension->receiver_request(l, a_inputs.data(), (unsigned char *)&request[0], ot_states[tag]);
+            
+            writer.push(pipelined_message(Protobuf::Pipelined_Compare_Message::OT_REQUEST, tag, 0, request));
+        }else{
+            check_pipelined_message(message.type() == Protobuf::Pipelined_Compare_Message::OT_RESPONSE
+                                    && stages[tag] == PIPELINED_GARBLED
+                                    && message.data().size() == OTExtension::response_size(l, sizeof(block)), tag);
+            
+            block *a_labels = (block *)malloc(l*sizeof(block));
+            ot_extension->receiver_finish(ot_states[tag], message.data().data(), (char *)a_labels, sizeof(block));
+            
+            circuits[tag]->evaluateGC(a_labels);
+            circuits[tag]->unblind(vector<mpz_class>(1, masks[tag]));
+            free(a_labels);
+            circuits[tag].reset();
+            stages[tag] = PIPELINED_DONE;
+            
+            mpz_class c_t = owners[tag]->concludeProtocol(convert_from_message(message.value()));
+            if (decrypt_result) {
+                writer.push(pipelined_message(Protobuf::Pipelined_Compare_Message::RESULT, tag, c_t));
+            }
+            done++;
+            
+            // keep the pipeline full
+            if (next < n) {
+                writer.push(pipelined_message(Protobuf::Pipelined_Compare_Message::SETUP, next, owners[next]->setup(lambda)));
+                stages[next] = PIPELINED_SETUP;
+                next++;
+            }
+        }
+    }
+    writer.finish();
+}
+
+void exec_rev_enc_comparison_helper_pipelined(Channel &channel, vector<Rev_EncCompare_Helper*> &helpers, bool decrypt_result)
+{
+    size_t n = helpers.size();
+    if (n == 0) {
+        return;
     }
     
-    for (size_t i = 0 ; i < helpers.size(); i++) {
-        comparison_threads[i]->join();
-        delete comparison_threads[i];
+    vector<GC_Compare_B*> comparators(n);
+    for (size_t i = 0; i < n; i++) {
+        assert(typeid(*(helpers[i]->comparator())) == typeid(GC_Compare_B));
+        comparators[i] = reinterpret_cast<GC_Compare_B*>(helpers[i]->comparator());
     }
     
-    delete [] comparison_threads;
+    OTExtension *ot_extension = comparators[0]->ot_extension();
+    assert(ot_extension && ot_extension->uses_channel(channel));
+    ot_extension->prepare_sender();
+    
+    vector<unique_ptr<GC_Compare_Batch_B> > circuits(n);
+    vector<Pipelined_Stage> stages(n, PIPELINED_NONE);
+    size_t answered = 0, concluded = 0;
+    
+    // the messages are answered in the order they come, whatever their tag
+    while (answered < n || (decrypt_result && concluded < n)) {
+        Protobuf::Pipelined_Compare_Message message = readMessageFromSocket<Protobuf::Pipelined_Compare_Message>(channel);
+        size_t tag = message.tag();
+        check_pipelined_message(tag < n, tag);
+        
+        if (message.type() == Protobuf::Pipelined_Compare_Message::SETUP) {
+            check_pipelined_message(stages[tag] == PIPELINED_NONE, tag);
+            helpers[tag]->setup(convert_from_message(message.value()));
+            
+            circuits[tag].reset(new GC_Compare_Batch_B(vector<GC_Compare_B*>(1, comparators[tag])));
+            circuits[tag]->prepare_circuits();
+            stages[tag] = PIPELINED_GARBLED;
+            
+            GC_Batch_Frame *frame = circuits[tag]->frame();
+            send_pipelined_message(channel, Protobuf::Pipelined_Compare_Message::GARBLED, tag, circuits[tag]->get_enc_masks()[0], string(frame->data(), frame->size()));
+        }else if (message.type() == Protobuf::Pipelined_Compare_Message::OT_REQUEST) {
+            check_pipelined_message(stages[tag] == PIPELINED_GARBLED, tag);
+            size_t l = circuits[tag]->bit_length();
+            check_pipelined_message(message.data().size() == OTExtension::request_size(l), tag);
+            
+            block *all_a_labels = circuits[tag]->get_all_a_input_labels();
+            string response(OTExtension::response_size(l, sizeof(block)), 0);
+            ot_extension->sender_respond(l, (const unsigned char *)message.data().data(), (char *)all_a_labels, &response[0], sizeof(block));
+            free(all_a_labels);
+            circuits[tag].reset();
+            stages[tag] = PIPELINED_ANSWERED;
+            
+            send_pipelined_message(channel, Protobuf::Pipelined_Compare_Message::OT_RESPONSE, tag, helpers[tag]->get_c_z_l(), response);
+            answered++;
+        }else{
+            check_pipelined_message(message.type() == Protobuf::Pipelined_Compare_Message::RESULT
+                                    && decrypt_result && stages[tag] == PIPELINED_ANSWERED, tag);
+            helpers[tag]->decryptResult(convert_from_message(message.value()));
+            stages[tag] = PIPELINED_DONE;
+            concluded++;
+        }
+    }
+}
+
+// runs job(c_i, i) for i in [0,n) in parallel, c_i being the i-th channel
+// multiplexed on channel
+static void multiplexed_exec(Channel &channel, size_t n, const function<void(Channel&, size_t)> &job)
+{
+    Channel_Mux mux(channel, n);
+    {
+        // the executions block on their channels: each gets its own thread
+        Task_Group executions;
+        for (size_t i = 0; i < n; i++) {
+            Channel *c_i = &mux.channel(i);
+            executions.run_blocking([&job, c_i, i]() { job(*c_i, i); });
+        }
+        executions.wait();
+    }
+    mux.close();
+}
+
+void multiple_exec_enc_comparison_owner(Channel &channel, vector<EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
+{
+    multiplexed_exec(channel, owners.size(), [&owners, lambda, decrypt_result, n_threads](Channel &c, size_t i) {
+        exec_enc_comparison_owner(c, *owners[i], lambda, decrypt_result, n_threads);
+    });
+}
+
+void multiple_exec_enc_comparison_helper(Channel &channel, vector<EncCompare_Helper*> &helpers, bool decrypt_result, unsigned int n_threads)
+{
+    multiplexed_exec(channel, helpers.size(), [&helpers, decrypt_result, n_threads](Channel &c, size_t i) {
+        exec_enc_comparison_helper(c, *helpers[i], decrypt_result, n_threads);
+    });
+}
+
+void multiple_exec_rev_enc_comparison_owner(Channel &channel, vector<Rev_EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
+{
+    multiplexed_exec(channel, owners.size(), [&owners, lambda, decrypt_result, n_threads](Channel &c, size_t i) {
+        exec_rev_enc_comparison_owner(c, *owners[i], lambda, decrypt_result, n_threads);
+    });
 }
 
+void multiple_exec_rev_enc_comparison_helper(Channel &channel, vector<Rev_EncCompare_Helper*> &helpers, bool decrypt_result, unsigned int n_threads)
+{
+    multiplexed_exec(channel, helpers.size(), [&helpers, decrypt_result, n_threads](Channel &c, size_t i) {
+        exec_rev_enc_comparison_helper(c, *helpers[i], decrypt_result, n_threads);
+    });
+}
 
-void exec_linear_enc_argmax(tcp::socket &socket, Linear_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads)
+void exec_linear_enc_argmax(Channel &channel, Linear_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads)
 {
     size_t k = owner.elements_number();
     for (size_t i = 0; i < (k-1); i++) {
@@ -508,65 +804,65 @@ void exec_linear_enc_argmax(tcp::socket &socket, Linear_EncArgmax_Owner &owner,
         
         Rev_EncCompare_Owner rev_enc_owner = owner.create_current_round_rev_enc_compare_owner(comparator);
         
-        exec_rev_enc_comparison_owner(socket, rev_enc_owner, lambda, true, n_threads);
+        exec_rev_enc_comparison_owner(channel, rev_enc_owner, lambda, true, n_threads);
         
         mpz_class randomized_enc_max, randomized_value;
         owner.next_round(randomized_enc_max, randomized_value);
         
         // send the randomizations to the server
-        sendIntToSocket(socket,randomized_enc_max);
-        sendIntToSocket(socket,randomized_value);
+        sendIntToSocket(channel,randomized_enc_max);
+        sendIntToSocket(channel,randomized_value);
         
         // get the server's response
         mpz_class new_enc_max, x, y;
-        new_enc_max = readIntFromSocket(socket);
-        x = readIntFromSocket(socket);
-        y = readIntFromSocket(socket);
+        new_enc_max = readIntFromSocket(channel);
+        x = readIntFromSocket(channel);
+        y = readIntFromSocket(channel);
         
         owner.update_enc_max(new_enc_max, x, y);
     }
     
     mpz_class permuted_argmax;
-    permuted_argmax = readIntFromSocket(socket);
+    permuted_argmax = readIntFromSocket(channel);
     
     owner.unpermuteResult(permuted_argmax.get_ui());
 }
 
-void exec_linear_enc_argmax(tcp::socket &socket, Linear_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads)
+void exec_linear_enc_argmax(Channel &channel, Linear_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads)
 {
     size_t k = helper.elements_number();
     
     for (size_t i = 0; i < k - 1; i++) {
         //        cout << "Round " << i << endl;
-//        Compare_B comparator(0,nbits,server_->paillier(),server_->gm());
+//        Compare_B comparator(0,nbits,server_->dgk(),server_->gm());
         //        LSIC_B comparator(0,nbits,server_->gm());
         Comparison_protocol_B *comparator = comparator_creator();
 
         Rev_EncCompare_Helper rev_enc_helper = helper.rev_enc_compare_helper(comparator);
         
-        exec_rev_enc_comparison_helper(socket, rev_enc_helper, true, n_threads);
+        exec_rev_enc_comparison_helper(channel, rev_enc_helper, true, n_threads);
         
         mpz_class randomized_enc_max, randomized_value;
         
         // read the values sent by the client
-        randomized_enc_max = readIntFromSocket(socket);
-        randomized_value = readIntFromSocket(socket);
+        randomized_enc_max = readIntFromSocket(channel);
+        randomized_value = readIntFromSocket(channel);
         
         // and send the server's response
         mpz_class new_enc_max, x, y;
         helper.update_argmax(rev_enc_helper.output(), randomized_enc_max, randomized_value, i+1, new_enc_max, x, y);
         
-        sendIntToSocket(socket,new_enc_max);
-        sendIntToSocket(socket,x);
-        sendIntToSocket(socket,y);
+        sendIntToSocket(channel,new_enc_max);
+        sendIntToSocket(channel,x);
+        sendIntToSocket(channel,y);
     }
     
 //    cout << "Send result" << endl;
     mpz_class permuted_argmax = helper.permuted_argmax();
-    sendIntToSocket(socket, permuted_argmax);
+    sendIntToSocket(channel, permuted_argmax);
 }
 
-void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads, unsigned int port)
+void exec_tree_enc_argmax(Channel &channel, Tree_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads)
 {
     size_t k = owner.elements_number();
     
@@ -574,7 +870,7 @@ void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Owner &owner, func
         vector<Rev_EncCompare_Owner*> rev_enc_owners = owner.create_current_round_rev_enc_compare_owners(comparator_creator);
 
         unsigned int thread_per_job = ceilf(((float)n_threads)/rev_enc_owners.size());
-        multiple_exec_rev_enc_comparison_owner(socket,rev_enc_owners,lambda,true,thread_per_job, port);
+        multiple_exec_rev_enc_comparison_owner(channel,rev_enc_owners,lambda,true,thread_per_job);
         
         // cleanup
         for (size_t i = 0; i < rev_enc_owners.size(); i++) {
@@ -584,25 +880,25 @@ void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Owner &owner, func
         vector<mpz_class> randomized_enc_max = owner.next_round();
         
         // send the randomized values to the helper
-        send_int_array_to_socket(socket,randomized_enc_max);
+        send_int_array_to_socket(channel,randomized_enc_max);
         
         // get the helper's response
         vector<mpz_class> new_enc_max, x, y;
         
-        new_enc_max = read_int_array_from_socket(socket);
-        x = read_int_array_from_socket(socket);
-        y = read_int_array_from_socket(socket);
+        new_enc_max = read_int_array_from_socket(channel);
+        x = read_int_array_from_socket(channel);
+        y = read_int_array_from_socket(channel);
         
         owner.update_local_max(new_enc_max, x, y);
     }
     
     mpz_class permuted_argmax;
-    permuted_argmax = readIntFromSocket(socket);
+    permuted_argmax = readIntFromSocket(channel);
     
     owner.unpermuteResult(permuted_argmax.get_ui());
 }
 
-void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads, unsigned int port)
+void exec_tree_enc_argmax(Channel &channel, Tree_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads)
 {
     size_t k = helper.elements_number();
     
@@ -611,7 +907,7 @@ void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Helper &helper, fu
         
         unsigned int thread_per_job = ceilf(((float)n_threads)/rev_enc_helpers.size());
        
-        multiple_exec_rev_enc_comparison_helper(socket,rev_enc_helpers,true,thread_per_job, port);
+        multiple_exec_rev_enc_comparison_helper(channel,rev_enc_helpers,true,thread_per_job);
         
         // get result and cleanup
         vector<bool> results (rev_enc_helpers.size());
@@ -621,7 +917,7 @@ void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Helper &helper, fu
         }
         
         // read the values sent by the owner
-        vector<mpz_class> randomized_enc_max = read_int_array_from_socket(socket);
+        vector<mpz_class> randomized_enc_max = read_int_array_from_socket(channel);
         
         
         vector<mpz_class> new_enc_max, x, y;
@@ -629,24 +925,24 @@ void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Helper &helper, fu
         helper.update_argmax(results, randomized_enc_max, new_enc_max, x, y);
 
         // and send the server's response
-        send_int_array_to_socket(socket,new_enc_max);
-        send_int_array_to_socket(socket,x);
-        send_int_array_to_socket(socket,y);
+        send_int_array_to_socket(channel,new_enc_max);
+        send_int_array_to_socket(channel,x);
+        send_int_array_to_socket(channel,y);
     }
     
     // send the permuted result
     mpz_class permuted_argmax = helper.permuted_argmax();
-    sendIntToSocket(socket, permuted_argmax);
+    sendIntToSocket(channel, permuted_argmax);
 }
 
-Ctxt exec_change_encryption_scheme_slots(tcp::socket &socket, const vector<mpz_class> &c_gm, GM &gm, const FHEPubKey& publicKey, const EncryptedArray &ea, gmp_randstate_t randstate)
+Ctxt exec_change_encryption_scheme_slots(Channel &channel, const vector<mpz_class> &c_gm, GM &gm, const FHEPubKey& publicKey, const EncryptedArray &ea, gmp_randstate_t randstate)
 {
     Change_ES_FHE_from_GM_slots_A switcher;
     vector<mpz_class> c_gm_blinded = switcher.blind(c_gm,gm,randstate, ea.size());
     
-    send_int_array_to_socket(socket, c_gm_blinded);
+    send_int_array_to_socket(channel, c_gm_blinded);
     
-    Ctxt c_blinded_fhe = read_fhe_ctxt_from_socket(socket, publicKey);
+    Ctxt c_blinded_fhe = read_fhe_ctxt_from_socket(channel, publicKey);
     
     
     Ctxt c_fhe = switcher.unblind(c_blinded_fhe,publicKey,ea);
@@ -654,72 +950,66 @@ Ctxt exec_change_encryption_scheme_slots(tcp::socket &socket, const vector<mpz_c
     return c_fhe;
 }
 
-void exec_change_encryption_scheme_slots_helper(tcp::socket &socket, GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea)
+void exec_change_encryption_scheme_slots_helper(Channel &channel, GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea)
 {
-    vector<mpz_class> c_gm_blinded = read_int_array_from_socket(socket);
+    vector<mpz_class> c_gm_blinded = read_int_array_from_socket(channel);
     Ctxt c_blinded_fhe = Change_ES_FHE_from_GM_slots_B::decrypt_encrypt(c_gm_blinded,gm,publicKey,ea);
     
-    send_fhe_ctxt_to_socket(socket, c_blinded_fhe);
+    send_fhe_ctxt_to_socket(channel, c_blinded_fhe);
 }
 
-vector<mpz_class> exec_change_encryption_scheme_back_slots(tcp::socket &socket, const Ctxt &c_fhe, GM &gm, const FHEPubKey& publicKey, const EncryptedArray &ea, gmp_randstate_t randstate)
+vector<mpz_class> exec_change_encryption_scheme_back_slots(Channel &channel, const Ctxt &c_fhe, GM &gm, const FHEPubKey& publicKey, const EncryptedArray &ea, gmp_randstate_t randstate)
 {
     Change_GM_from_ES_FHE_slots_A switcher;
     Ctxt c_fhe_blinded = switcher.blind(c_fhe, publicKey, ea, randstate, ea.size());
 
-    send_fhe_ctxt_to_socket(socket, c_fhe_blinded);
+    send_fhe_ctxt_to_socket(channel, c_fhe_blinded);
 
-    vector<mpz_class> c_blinded_gm = read_int_array_from_socket(socket);
+    vector<mpz_class> c_blinded_gm = read_int_array_from_socket(channel);
     vector<mpz_class> c_gm = switcher.unblind(c_blinded_gm, gm);
 
     return c_gm;
 }
 
-void exec_change_encryption_scheme_back_slots_helper(tcp::socket &socket, GM &gm, const FHESecKey &privateKey, const EncryptedArray &ea)
+void exec_change_encryption_scheme_back_slots_helper(Channel &channel, GM &gm, const FHESecKey &privateKey, const EncryptedArray &ea)
 {
-    Ctxt c_fhe_blinded = read_fhe_ctxt_from_socket(socket, privateKey);
+    Ctxt c_fhe_blinded = read_fhe_ctxt_from_socket(channel, privateKey);
     vector<mpz_class> c_blinded_gm = Change_GM_from_ES_FHE_slots_B::decrypt_encrypt(c_fhe_blinded,gm,privateKey,ea);
 
-    send_int_array_to_socket(socket, c_blinded_gm);
+    send_int_array_to_socket(channel, c_blinded_gm);
 }
 
-vector<mpz_class> exec_change_encryption_scheme_paillier_slots(tcp::socket &socket, const vector<mpz_class> &c_gm, GM &gm, Paillier& publicKey, gmp_randstate_t randstate)
+vector<mpz_class> exec_change_encryption_scheme_paillier_slots(Channel &channel, const vector<mpz_class> &c_gm, GM &gm, Paillier& publicKey, gmp_randstate_t randstate)
 {
     Change_Paillier_from_GM_slots_A switcher;
     vector<mpz_class> c_gm_blinded = switcher.blind(c_gm, gm, randstate, c_gm.size());
 
-    send_int_array_to_socket(socket, c_gm_blinded);
+    send_int_array_to_socket(channel, c_gm_blinded);
 
-    vector<mpz_class> c_blinded_paillier = read_int_array_from_socket(socket);
+    vector<mpz_class> c_blinded_paillier = read_int_array_from_socket(channel);
     vector<mpz_class> c_paillier = switcher.unblind(c_blinded_paillier, publicKey);
 
     return c_paillier;
 }
 
-void exec_change_encryption_scheme_paillier_slots_helper(tcp::socket &socket, GM_priv &gm, Paillier &publicKey)
+void exec_change_encryption_scheme_paillier_slots_helper(Channel &channel, GM_priv &gm, Paillier &publicKey)
 {
-    vector<mpz_class> c_gm_blinded = read_int_array_from_socket(socket);
+    vector<mpz_class> c_gm_blinded = read_int_array_from_socket(channel);
     vector<mpz_class> c_blinded_paillier = Change_Paillier_from_GM_slots_B::decrypt_encrypt(c_gm_blinded,gm,publicKey);
 
-    send_int_array_to_socket(socket, c_blinded_paillier);
+    send_int_array_to_socket(channel, c_blinded_paillier);
 }
 
-mpz_class exec_compute_dot_product(tcp::socket &socket, const vector<mpz_class> &x, Paillier &p)
+mpz_class exec_compute_dot_product(Channel &channel, const vector<mpz_class> &x, Paillier &p)
 {
-    // get the input vector from the socket
-    vector<mpz_class> y = read_int_array_from_socket(socket);
+    // get the input vector from the channel
+    vector<mpz_class> y = read_int_array_from_socket(channel);
     
     // compute the encrypted dot product
-    mpz_class v = 1;
-    
-    for (size_t i = 0; i < y.size(); i++) {
-        v = p.add(v, p.constMult(x[i],y[i]));
-    }
-
-    return v;
+    return p.dot_product(y, x);
 }
 
-void exec_help_compute_dot_product(tcp::socket &socket, const vector<mpz_class> &y, Paillier_priv &pp, bool encrypted_input)
+void exec_help_compute_dot_product(Channel &channel, const vector<mpz_class> &y, Paillier_priv &pp, bool encrypted_input)
 {
     vector<mpz_class> c_y;
     
@@ -734,50 +1024,50 @@ void exec_help_compute_dot_product(tcp::socket &socket, const vector<mpz_class>
         }
     }
     
-    send_int_array_to_socket(socket, c_y);
+    send_int_array_to_socket(channel, c_y);
 }
 
-vector<mpz_class> exec_change_encryption_scheme_fhe_paillier_slots(tcp::socket &socket, const Ctxt &c_fhe, Paillier &p,
+vector<mpz_class> exec_change_encryption_scheme_fhe_paillier_slots(Channel &channel, const Ctxt &c_fhe, Paillier &p,
                                                                    const FHEPubKey &publicKey, const EncryptedArray &ea,
                                                                    gmp_randstate_t randstate) {
     Change_Paillier_from_ES_FHE_slots_A switcher;
     Ctxt c_fhe_blinded = switcher.blind(c_fhe, publicKey, ea, randstate, ea.size());
 
-    send_fhe_ctxt_to_socket(socket, c_fhe_blinded);
+    send_fhe_ctxt_to_socket(channel, c_fhe_blinded);
 
-    vector<mpz_class> c_blinded_paillier = read_int_array_from_socket(socket);
+    vector<mpz_class> c_blinded_paillier = read_int_array_from_socket(channel);
     vector<mpz_class> c_paillier = switcher.unblind(c_blinded_paillier, p);
 
     return c_paillier;
 }
 
 void
-exec_change_encryption_scheme_fhe_paillier_slots_helper(tcp::socket &socket, Paillier &p, const FHESecKey &privateKey,
+exec_change_encryption_scheme_fhe_paillier_slots_helper(Channel &channel, Paillier &p, const FHESecKey &privateKey,
                                                         const EncryptedArray &ea) {
-    Ctxt c_fhe_blinded = read_fhe_ctxt_from_socket(socket, privateKey);
+    Ctxt c_fhe_blinded = read_fhe_ctxt_from_socket(channel, privateKey);
     vector<mpz_class> c_blinded_paillier = Change_Paillier_from_ES_FHE_slots_B::decrypt_encrypt(c_fhe_blinded, p, privateKey, ea);
 
-    send_int_array_to_socket(socket, c_blinded_paillier);
+    send_int_array_to_socket(channel, c_blinded_paillier);
 }
 
-void exec_move_paillier_encryption(tcp::socket &socket, const vector<mpz_class> &c_p, Paillier &own, Paillier &other,
+void exec_move_paillier_encryption(Channel &channel, const vector<mpz_class> &c_p, Paillier &own, Paillier &other,
                                    gmp_randstate_t randstate) {
     Move_Paillier_A switcher;
     vector<mpz_class> c_blinded_paillier = switcher.blind(c_p, other, randstate);
 
-    send_int_array_to_socket(socket, c_blinded_paillier);
+    send_int_array_to_socket(channel, c_blinded_paillier);
 
     vector<mpz_class> c_noise = switcher.enc_noise(own);
 
-    send_int_array_to_socket(socket, c_noise);
+    send_int_array_to_socket(channel, c_noise);
 }
 
-vector<mpz_class> exec_move_paillier_encryption_helper(tcp::socket &socket, Paillier_priv &own, Paillier &other) {
+vector<mpz_class> exec_move_paillier_encryption_helper(Channel &channel, Paillier_priv &own, Paillier &other) {
     Move_Paillier_B switcher;
 
-    vector<mpz_class> c_blinded_paillier = read_int_array_from_socket(socket);
+    vector<mpz_class> c_blinded_paillier = read_int_array_from_socket(channel);
     vector<mpz_class> c_blinded_paillier_other = switcher.decrypt_encrypt(c_blinded_paillier, own, other);
 
-    vector<mpz_class> c_noise = read_int_array_from_socket(socket);
+    vector<mpz_class> c_noise = read_int_array_from_socket(channel);
     return switcher.unblind(c_blinded_paillier_other, c_noise, other);
 }
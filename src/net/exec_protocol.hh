@@ -25,7 +25,7 @@
 #include <crypto/paillier.hh>
 #include <crypto/gm.hh>
 
-#include <boost/asio.hpp>
+#include <net/channel.hh>
 #include <net/message_io.hh>
 
 #include <mpc/lsic.hh>
@@ -45,51 +45,62 @@
 
 #include "defs.hh"
 
-using boost::asio::ip::tcp;
 
+void exec_comparison_protocol_A(Channel &channel, Comparison_protocol_A *comparator, unsigned int n_threads = 2);
+void exec_lsic_A(Channel &channel, LSIC_A *lsic);
+void exec_priv_compare_A(Channel &channel, Compare_A *comparator, unsigned int n_threads);
+void exec_garbled_compare_A(Channel &channel, GC_Compare_A *comparator);
 
-void exec_comparison_protocol_A(tcp::socket &socket, Comparison_protocol_A *comparator, unsigned int n_threads = 2);
-void exec_lsic_A(tcp::socket &socket, LSIC_A *lsic);
-void exec_priv_compare_A(tcp::socket &socket, Compare_A *comparator, unsigned int n_threads);
-void exec_garbled_compare_A(tcp::socket &socket, GC_Compare_A *comparator);
+// all the circuits in one frame and all the input labels in one OT batch
+void exec_garbled_compare_batch_A(Channel &channel, GC_Compare_Batch_A &batch);
+void exec_garbled_compare_batch_B(Channel &channel, GC_Compare_Batch_B &batch);
 
-void exec_comparison_protocol_B(tcp::socket &socket, Comparison_protocol_B *comparator, unsigned int n_threads = 2);
-void exec_lsic_B(tcp::socket &socket, LSIC_B *lsic);
-void exec_priv_compare_B(tcp::socket &socket, Compare_B *comparator, unsigned int n_threads = 2);
-void exec_garbled_compare_B(tcp::socket &socket, GC_Compare_B *comparator);
+void exec_comparison_protocol_B(Channel &channel, Comparison_protocol_B *comparator, unsigned int n_threads = 2);
+void exec_lsic_B(Channel &channel, LSIC_B *lsic);
+void exec_priv_compare_B(Channel &channel, Compare_B *comparator, unsigned int n_threads = 2);
+void exec_garbled_compare_B(Channel &channel, GC_Compare_B *comparator);
 
-void exec_enc_comparison_owner(tcp::socket &socket, EncCompare_Owner &owner, unsigned int lambda, bool decrypt_result, unsigned int n_threads = 2);
-void exec_enc_comparison_helper(tcp::socket &socket, EncCompare_Helper &helper, bool decrypt_result, unsigned int n_threads = 2);
+void exec_enc_comparison_owner(Channel &channel, EncCompare_Owner &owner, unsigned int lambda, bool decrypt_result, unsigned int n_threads = 2);
+void exec_enc_comparison_helper(Channel &channel, EncCompare_Helper &helper, bool decrypt_result, unsigned int n_threads = 2);
 
-void exec_rev_enc_comparison_owner(tcp::socket &socket, Rev_EncCompare_Owner &owner, unsigned int lambda, bool decrypt_result, unsigned int n_threads = 2);
-void exec_rev_enc_comparison_helper(tcp::socket &socket, Rev_EncCompare_Helper &helper, bool decrypt_result, unsigned int n_threads = 2);
+void exec_rev_enc_comparison_owner(Channel &channel, Rev_EncCompare_Owner &owner, unsigned int lambda, bool decrypt_result, unsigned int n_threads = 2);
+void exec_rev_enc_comparison_helper(Channel &channel, Rev_EncCompare_Helper &helper, bool decrypt_result, unsigned int n_threads = 2);
 
-void multiple_exec_enc_comparison_owner(tcp::socket &socket, vector<EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result, unsigned int n_threads, unsigned int port = PORT+1);
-void multiple_exec_enc_comparison_helper(tcp::socket &socket, vector<EncCompare_Helper*> &helpers, bool decrypt_result, unsigned int n_threads = 2, unsigned int port = PORT+1);
+// batched GC_PROTOCOL comparisons on a single channel
+void exec_rev_enc_comparison_owner_batch(Channel &channel, vector<Rev_EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result);
+void exec_rev_enc_comparison_helper_batch(Channel &channel, vector<Rev_EncCompare_Helper*> &helpers, bool decrypt_result);
 
-void multiple_exec_rev_enc_comparison_owner(tcp::socket &socket, vector<Rev_EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result, unsigned int n_threads, unsigned int port = PORT+1);
-void multiple_exec_rev_enc_comparison_helper(tcp::socket &socket, vector<Rev_EncCompare_Helper*> &helpers, bool decrypt_result, unsigned int n_threads, unsigned int port = PORT+1);
+// GC_PROTOCOL comparisons with up to window of them in flight, using tagged messages
+void exec_rev_enc_comparison_owner_pipelined(Channel &channel, vector<Rev_EncCompare_Owner*> &owners, unsigned int lambda, unsigned int window, bool decrypt_result);
+void exec_rev_enc_comparison_helper_pipelined(Channel &channel, vector<Rev_EncCompare_Helper*> &helpers, bool decrypt_result);
 
-void exec_linear_enc_argmax(tcp::socket &socket, Linear_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads = 2);
-void exec_linear_enc_argmax(tcp::socket &socket, Linear_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads = 2);
+// parallel comparisons, each on its own channel multiplexed on channel (see Channel_Mux)
+void multiple_exec_enc_comparison_owner(Channel &channel, vector<EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result, unsigned int n_threads);
+void multiple_exec_enc_comparison_helper(Channel &channel, vector<EncCompare_Helper*> &helpers, bool decrypt_result, unsigned int n_threads = 2);
 
-void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads = 2, unsigned int port = PORT+1);
-void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads = 2, unsigned int port = PORT+1);
+void multiple_exec_rev_enc_comparison_owner(Channel &channel, vector<Rev_EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result, unsigned int n_threads);
+void multiple_exec_rev_enc_comparison_helper(Channel &channel, vector<Rev_EncCompare_Helper*> &helpers, bool decrypt_result, unsigned int n_threads);
 
-Ctxt exec_change_encryption_scheme_slots(tcp::socket &socket, const vector<mpz_class> &c_gm, GM &gm, const FHEPubKey& publicKey, const EncryptedArray &ea, gmp_randstate_t randstate);
-void exec_change_encryption_scheme_slots_helper(tcp::socket &socket, GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea);
+void exec_linear_enc_argmax(Channel &channel, Linear_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads = 2);
+void exec_linear_enc_argmax(Channel &channel, Linear_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads = 2);
 
-vector<mpz_class> exec_change_encryption_scheme_back_slots(tcp::socket &socket, const Ctxt &c_fhe, GM &gm, const FHEPubKey& publicKey, const EncryptedArray &ea, gmp_randstate_t randstate);
-void exec_change_encryption_scheme_back_slots_helper(tcp::socket &socket, GM &gm, const FHESecKey &privateKey, const EncryptedArray &ea);
+void exec_tree_enc_argmax(Channel &channel, Tree_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads = 2);
+void exec_tree_enc_argmax(Channel &channel, Tree_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads = 2);
 
-vector<mpz_class> exec_change_encryption_scheme_paillier_slots(tcp::socket &socket, const vector<mpz_class> &c_gm, GM &gm, Paillier& publicKey, gmp_randstate_t randstate);
-void exec_change_encryption_scheme_paillier_slots_helper(tcp::socket &socket, GM_priv &gm, Paillier &publicKey);
+Ctxt exec_change_encryption_scheme_slots(Channel &channel, const vector<mpz_class> &c_gm, GM &gm, const FHEPubKey& publicKey, const EncryptedArray &ea, gmp_randstate_t randstate);
+void exec_change_encryption_scheme_slots_helper(Channel &channel, GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea);
 
-vector<mpz_class> exec_change_encryption_scheme_fhe_paillier_slots(tcp::socket &socket, const Ctxt &c_fhe, Paillier &p, const FHEPubKey& publicKey, const EncryptedArray &ea, gmp_randstate_t randstate);
-void exec_change_encryption_scheme_fhe_paillier_slots_helper(tcp::socket &socket, Paillier &p, const FHESecKey &privateKey, const EncryptedArray &ea);
+vector<mpz_class> exec_change_encryption_scheme_back_slots(Channel &channel, const Ctxt &c_fhe, GM &gm, const FHEPubKey& publicKey, const EncryptedArray &ea, gmp_randstate_t randstate);
+void exec_change_encryption_scheme_back_slots_helper(Channel &channel, GM &gm, const FHESecKey &privateKey, const EncryptedArray &ea);
 
-mpz_class exec_compute_dot_product(tcp::socket &socket, const vector<mpz_class> &x, Paillier &p);
-void exec_help_compute_dot_product(tcp::socket &socket, const vector<mpz_class> &y, Paillier_priv &pp, bool encrypted_input);
+vector<mpz_class> exec_change_encryption_scheme_paillier_slots(Channel &channel, const vector<mpz_class> &c_gm, GM &gm, Paillier& publicKey, gmp_randstate_t randstate);
+void exec_change_encryption_scheme_paillier_slots_helper(Channel &channel, GM_priv &gm, Paillier &publicKey);
 
-void exec_move_paillier_encryption(tcp::socket &socket, const vector<mpz_class> &c_p, Paillier &own, Paillier &other, gmp_randstate_t randstate);
-vector<mpz_class> exec_move_paillier_encryption_helper(tcp::socket &socket, Paillier_priv &own, Paillier &other);
\ No newline at end of file
+vector<mpz_class> exec_change_encryption_scheme_fhe_paillier_slots(Channel &channel, const Ctxt &c_fhe, Paillier &p, const FHEPubKey& publicKey, const EncryptedArray &ea, gmp_randstate_t randstate);
+void exec_change_encryption_scheme_fhe_paillier_slots_helper(Channel &channel, Paillier &p, const FHESecKey &privateKey, const EncryptedArray &ea);
+
+mpz_class exec_compute_dot_product(Channel &channel, const vector<mpz_class> &x, Paillier &p);
+void exec_help_compute_dot_product(Channel &channel, const vector<mpz_class> &y, Paillier_priv &pp, bool encrypted_input);
+
+void exec_move_paillier_encryption(Channel &channel, const vector<mpz_class> &c_p, Paillier &own, Paillier &other, gmp_randstate_t randstate);
+vector<mpz_class> exec_move_paillier_encryption_helper(Channel &channel, Paillier_priv &own, Paillier &other);
\ No newline at end of file
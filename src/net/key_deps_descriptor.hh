@@ -9,7 +9,11 @@ struct Key_dependencies_descriptor {
     bool need_client_paillier;
     bool need_client_fhe;
 
-    Key_dependencies_descriptor(bool server_gm, bool server_paillier, bool server_fhe, bool client_gm, bool client_paillier, bool client_fhe)
-    : need_server_gm(server_gm), need_server_paillier(server_paillier),  need_server_fhe(server_fhe),  need_client_gm(client_gm),  need_client_paillier(client_paillier),  need_client_fhe(client_fhe)
+    // for the DGK comparison protocol
+    bool need_server_dgk;
+    bool need_client_dgk;
+
+    Key_dependencies_descriptor(bool server_gm, bool server_paillier, bool server_fhe, bool client_gm, bool client_paillier, bool client_fhe, bool server_dgk = false, bool client_dgk = false)
+    : need_server_gm(server_gm), need_server_paillier(server_paillier),  need_server_fhe(server_fhe),  need_client_gm(client_gm),  need_client_paillier(client_paillier),  need_client_fhe(client_fhe), need_server_dgk(server_dgk), need_client_dgk(client_dgk)
     {};
 };
\ No newline at end of file
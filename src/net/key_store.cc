@@ -0,0 +1,470 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <net/key_store.hh>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <openssl/sha.h>
+
+#include <net/defs.hh>
+
+using namespace std;
+
+#define KEY_STORE_MAGIC "CMKS1\n"
+// versions kept on disk: the current one and the previous one
+#define KEY_STORE_KEEP 2
+
+shared_ptr<Key_Store> Key_Store::default_store_;
+once_flag Key_Store::default_store_init_;
+
+static void put_word(string &out, uint64_t w)
+{
+    out.append((const char *)&w, sizeof(w));
+}
+
+static void put_blob(string &out, const string &blob)
+{
+    put_word(out, blob.size());
+    out += blob;
+}
+
+static void put_mpz(string &out, const mpz_class &x)
+{
+    assert(x >= 0);
+    size_t len = (mpz_sizeinbase(x.get_mpz_t(), 2) + 7)/8;
+    string bytes(len, '\0');
+    mpz_export(&bytes[0], &len, 1, 1, 1, 0, x.get_mpz_t());
+    bytes.resize(len);
+    put_blob(out, bytes);
+}
+
+class Payload_Reader {
+public:
+    Payload_Reader(const string &data) : data_(data), pos_(0), ok_(true) {}
+
+    bool ok() const { return ok_; }
+    bool at_end() const { return pos_ == data_.size(); }
+
+    uint64_t word()
+    {
+        uint64_t w = 0;
+        if (!ok_ || data_.size() - pos_ < sizeof(w)) {
+            ok_ = false;
+            return 0;
+        }
+        memcpy(&w, data_.data() + pos_, sizeof(w));
+        pos_ += sizeof(w);
+        return w;
+    }
+
+    string blob()
+    {
+        uint64_t len = word();
+        if (!ok_ || len > data_.size() - pos_) {
+            ok_ = false;
+            return string();
+        }
+        string b = data_.substr(pos_, len);
+        pos_ += len;
+        return b;
+    }
+
+    mpz_class mpz()
+    {
+        string bytes = blob();
+        mpz_class x = 0;
+        if (!bytes.empty()) {
+            mpz_import(x.get_mpz_t(), bytes.size(), 1, 1, 1, 0, bytes.data());
+        }
+        return x;
+    }
+
+private:
+    const string &data_;
+    size_t pos_;
+    bool ok_;
+};
+
+static bool read_file(const string &path, string &content)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == NULL) {
+        return false;
+    }
+    content.clear();
+    char buf[1 << 16];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        content.append(buf, n);
+    }
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+// the parameters of net/defs.hh: keys of another context cannot be used
+static vector<int64_t> fhe_params()
+{
+    return {FHE_p, FHE_r, FHE_d, FHE_c, FHE_L, FHE_w, FHE_s, FHE_k, FHE_m};
+}
+
+Key_Store::Key_Store(const string &dir, uint64_t max_age)
+: dir_(dir), max_age_(max_age)
+{
+}
+
+// the environment is only read if the program does not set the store itself
+static shared_ptr<Key_Store> store_from_env()
+{
+    const char *dir = getenv("CIPHERMED_KEY_DIR");
+    if (dir == NULL || *dir == '\0') {
+        return shared_ptr<Key_Store>();
+    }
+    const char *max_age = getenv("CIPHERMED_KEY_MAX_AGE");
+    return make_shared<Key_Store>(dir, max_age ? strtoull(max_age, NULL, 10) : 0);
+}
+
+shared_ptr<Key_Store> Key_Store::default_store()
+{
+    call_once(default_store_init_, []{ default_store_ = store_from_env(); });
+    return default_store_;
+}
+
+void Key_Store::set_default_store(shared_ptr<Key_Store> store)
+{
+    call_once(default_store_init_, []{});
+    default_store_ = store;
+}
+
+vector<mpz_class> stored_key(const string &name, unsigned int keysize, function<vector<mpz_class>()> keygen)
+{
+    shared_ptr<Key_Store> store = Key_Store::default_store();
+    vector<mpz_class> sk;
+    if (store && store->load_key(name, keysize, sk)) {
+        return sk;
+    }
+    sk = keygen();
+    if (store && !store->save_key(name, keysize, sk)) {
+        cerr << "Unable to save the key " << name << " in " << store->dir() << endl;
+    }
+    return sk;
+}
+
+string Key_Store::path(const string &name, unsigned int version) const
+{
+    return dir_ + "/" + name + "." + to_string(version);
+}
+
+// versions of the key in the directory, in increasing order
+vector<unsigned int> Key_Store::versions(const string &name) const
+{
+    assert(name.find('.') == string::npos && name.find('/') == string::npos);
+
+    vector<unsigned int> v;
+    DIR *d = opendir(dir_.c_str());
+    if (d == NULL) {
+        return v;
+    }
+    string prefix = name + ".";
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        string file = entry->d_name;
+        if (file.compare(0, prefix.size(), prefix) != 0 || file.size() == prefix.size()) {
+            continue;
+        }
+        string suffix = file.substr(prefix.size());
+        // skips the temporary files
+        if (suffix.find_first_not_of("0123456789") != string::npos || suffix.size() > 9) {
+            continue;
+        }
+        v.push_back(stoul(suffix));
+    }
+    closedir(d);
+
+    sort(v.begin(), v.end());
+    return v;
+}
+
+unsigned int Key_Store::latest_version(const string &name) const
+{
+    vector<unsigned int> v = versions(name);
+    return v.empty() ? 0 : v.back();
+}
+
+bool Key_Store::read_latest(const string &name, const vector<int64_t> &params, string &payload) const
+{
+    vector<unsigned int> v = versions(name);
+    uint64_t now = time(NULL);
+    size_t magic_len = strlen(KEY_STORE_MAGIC);
+
+    for (auto it = v.rbegin(); it != v.rend(); ++it) {
+        string content;
+        if (!read_file(path(name, *it), content)
+            || content.compare(0, magic_len, KEY_STORE_MAGIC) != 0) {
+            continue;
+        }
+        string body = content.substr(magic_len);
+        Payload_Reader r(body);
+
+        uint64_t created = r.word();
+        if (max_age_ > 0 && created + max_age_ < now) {
+            // the older versions have expired too
+            return false;
+        }
+        // keys generated for other parameters are ignored
+        bool same_params = (r.word() == params.size());
+        for (size_t i = 0; i < params.size() && same_params; ++i) {
+            same_params = ((int64_t)r.word() == params[i]);
+        }
+        string p = r.blob();
+        if (same_params && r.ok() && r.at_end()) {
+            payload = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Key_Store::write_next(const string &name, const vector<int64_t> &params, const string &payload) const
+{
+    unsigned int version = latest_version(name) + 1;
+
+    string content = KEY_STORE_MAGIC;
+    put_word(content, time(NULL));
+    put_word(content, params.size());
+    for (size_t i = 0; i < params.size(); ++i) {
+        put_word(content, params[i]);
+    }
+    put_blob(content, payload);
+
+    // secret keys: only readable by the owner
+    string tmp = path(name, version) + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    size_t written = 0;
+    while (written < content.size()) {
+        ssize_t n = write(fd, content.data() + written, content.size() - written);
+        if (n <= 0) {
+            break;
+        }
+        written += n;
+    }
+    bool ok = (written == content.size()) && fsync(fd) == 0;
+    ok = (close(fd) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), path(name, version).c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    vector<unsigned int> v = versions(name);
+    for (size_t i = 0; i + KEY_STORE_KEEP < v.size(); ++i) {
+        unlink(path(name, v[i]).c_str());
+    }
+    return true;
+}
+
+bool Key_Store::load_key(const string &name, unsigned int keysize, vector<mpz_class> &sk) const
+{
+    string payload;
+    if (!read_latest(name, {keysize}, payload)) {
+        return false;
+    }
+    Payload_Reader r(payload);
+    uint64_t n = r.word();
+    vector<mpz_class> key;
+    for (uint64_t i = 0; i < n && r.ok(); ++i) {
+        key.push_back(r.mpz());
+    }
+    if (!r.ok() || !r.at_end()) {
+        return false;
+    }
+    sk = key;
+    return true;
+}
+
+bool Key_Store::save_key(const string &name, unsigned int keysize, const vector<mpz_class> &sk) const
+{
+    string payload;
+    put_word(payload, sk.size());
+    for (size_t i = 0; i < sk.size(); ++i) {
+        put_mpz(payload, sk[i]);
+    }
+    return write_next(name, {keysize}, payload);
+}
+
+FHEcontext* Key_Store::load_fhe(const string &name, FHESecKey **sk) const
+{
+    string payload;
+    if (!read_latest(name, fhe_params(), payload)) {
+        return NULL;
+    }
+    Payload_Reader r(payload);
+    string context_blob = r.blob();
+    string sk_blob = r.blob();
+    if (!r.ok() || !r.at_end() || (sk != NULL && sk_blob.empty())) {
+        return NULL;
+    }
+
+    // same serialization as the context sent to the clients
+    istringstream context_stream(context_blob);
+    unsigned long m, p, rr;
+    vector<long> gens, ords;
+    readContextBase(context_stream, m, p, rr, gens, ords);
+    FHEcontext *context = new FHEcontext(m, p, rr, gens, ords);
+    context_stream >> (*context);
+
+    if (sk != NULL) {
+        istringstream sk_stream(sk_blob);
+        *sk = new FHESecKey(*context);
+        sk_stream >> (**sk);
+    }
+    return context;
+}
+
+bool Key_Store::save_fhe(const string &name, const FHEcontext &context, const FHESecKey *sk) const
+{
+    ostringstream context_stream;
+    writeContextBase(context_stream, context);
+    context_stream << context;
+
+    ostringstream sk_stream;
+    if (sk != NULL) {
+        sk_stream << (*sk);
+    }
+
+    string payload;
+    put_blob(payload, context_stream.str());
+    put_blob(payload, sk_stream.str());
+    return write_next(name, fhe_params(), payload);
+}
+
+Key_Cache::Key_Cache(const string &dir, size_t max_entries)
+: dir_(dir), max_entries_(max_entries)
+{
+}
+
+string Key_Cache::digest(const string &content)
+{
+    unsigned char md[SHA256_DIGEST_LENGTH];
+    SHA256((const unsigned char *)content.data(), content.size(), md);
+    return string((const char *)md, sizeof(md));
+}
+
+string Key_Cache::path(const string &digest) const
+{
+    static const char hex[] = "0123456789abcdef";
+    string name;
+    for (size_t i = 0; i < digest.size(); ++i) {
+        name += hex[(digest[i] >> 4) & 0xF];
+        name += hex[digest[i] & 0xF];
+    }
+    return dir_ + "/" + name + ".pk";
+}
+
+// must be called with mtx_ held
+void Key_Cache::insert(const string &digest, const string &content)
+{
+    if (!entries_.insert(make_pair(digest, content)).second) {
+        return;
+    }
+    order_.push_back(digest);
+    while (order_.size() > max_entries_) {
+        entries_.erase(order_.front());
+        order_.pop_front();
+    }
+}
+
+bool Key_Cache::get(const string &digest, string &content)
+{
+    {
+        lock_guard<mutex> lock(mtx_);
+        auto it = entries_.find(digest);
+        if (it != entries_.end()) {
+            content = it->second;
+            return true;
+        }
+    }
+    if (dir_.empty()) {
+        return false;
+    }
+
+    string c;
+    if (!read_file(path(digest), c) || Key_Cache::digest(c) != digest) {
+        return false;
+    }
+    lock_guard<mutex> lock(mtx_);
+    insert(digest, c);
+    content = c;
+    return true;
+}
+
+void Key_Cache::put(const string &digest, const string &content)
+{
+    {
+        lock_guard<mutex> lock(mtx_);
+        insert(digest, content);
+    }
+    if (dir_.empty()) {
+        return;
+    }
+
+    // a file clobbered by concurrent writers is rejected by get
+    string tmp = path(digest) + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if (f == NULL) {
+        return;
+    }
+    bool ok = (fwrite(content.data(), 1, content.size(), f) == content.size());
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), path(digest).c_str()) != 0) {
+        unlink(tmp.c_str());
+    }
+}
+
+size_t Key_Cache::size() const
+{
+    lock_guard<mutex> lock(mtx_);
+    return entries_.size();
+}
+
+shared_ptr<Key_Cache> Key_Cache::shared_cache()
+{
+    static once_flag init;
+    static shared_ptr<Key_Cache> cache;
+    call_once(init, []{
+        const char *dir = getenv("CIPHERMED_KEY_CACHE");
+        cache = make_shared<Key_Cache>(dir ? dir : "");
+    });
+    return cache;
+}
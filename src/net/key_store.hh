@@ -0,0 +1,132 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <FHE.h>
+#include <FHEContext.h>
+#include <math/mpz_class.hh>
+
+/*
+ * Keys kept on disk across restarts, so that a server or a client does not
+ * run keygen (and build the FHE context) every time it starts.
+ *
+ * Each key is stored in the directory as <name>.<version>, in a binary
+ * format recording when it was generated and the parameters it was
+ * generated for. The latest version matching the parameters is loaded.
+ * A key older than the maximum age is not loaded anymore: the caller
+ * generates a new one and saves it as the next version, which rotates the
+ * keys at the next restart. The keygen tool generates the next version in
+ * advance, off the critical path of the servers.
+ *
+ * Files are written with mode 0600 to a temporary name and then renamed,
+ * the two latest versions of each key are kept.
+ */
+class Key_Store {
+public:
+    /* max_age in seconds, 0 for keys that never expire */
+    Key_Store(const std::string &dir, uint64_t max_age = 0);
+
+    const std::string& dir() const { return dir_; }
+    uint64_t max_age() const { return max_age_; }
+
+    /* secret keys as returned by the keygen functions of the cryptosystems,
+     * name is e.g. "paillier" or "gm" */
+    bool load_key(const std::string &name, unsigned int keysize, std::vector<mpz_class> &sk) const;
+    bool save_key(const std::string &name, unsigned int keysize, const std::vector<mpz_class> &sk) const;
+
+    /* FHE context built with the parameters of net/defs.hh and, if sk is not
+     * NULL, the secret key generated in this context. load returns NULL if
+     * there is no such context, or no secret key when one is asked for. */
+    FHEcontext* load_fhe(const std::string &name, FHESecKey **sk) const;
+    bool save_fhe(const std::string &name, const FHEcontext &context, const FHESecKey *sk) const;
+
+    /* latest version of the key, 0 if none */
+    unsigned int latest_version(const std::string &name) const;
+
+    /* store used by the Server and Client classes when they create their
+     * keys. Unless set by the program, it is taken from the environment:
+     * CIPHERMED_KEY_DIR and CIPHERMED_KEY_MAX_AGE (seconds), none if unset */
+    static std::shared_ptr<Key_Store> default_store();
+    static void set_default_store(std::shared_ptr<Key_Store> store);
+
+protected:
+    std::vector<unsigned int> versions(const std::string &name) const;
+    std::string path(const std::string &name, unsigned int version) const;
+
+    bool read_latest(const std::string &name, const std::vector<int64_t> &params, std::string &payload) const;
+    bool write_next(const std::string &name, const std::vector<int64_t> &params, const std::string &payload) const;
+
+    const std::string dir_;
+    const uint64_t max_age_;
+
+    static std::shared_ptr<Key_Store> default_store_;
+    static std::once_flag default_store_init_;
+};
+
+/* the key stored under name in the default store, or a new one from keygen,
+ * saved in the default store if there is one */
+std::vector<mpz_class> stored_key(const std::string &name, unsigned int keysize, std::function<std::vector<mpz_class>()> keygen);
+
+#define KEY_CACHE_MAX_ENTRIES 1024
+
+/*
+ * Content-addressed cache of public key material for the key exchange:
+ * serialized messages indexed by their SHA-256 digest.
+ *
+ * Entries are kept in memory (at most max_entries, the oldest are evicted)
+ * and, if a directory is given, in files named after their hex digest so
+ * that they survive restarts. Entries read from disk are checked against
+ * their digest. Thread-safe.
+ */
+class Key_Cache {
+public:
+    Key_Cache(const std::string &dir = "", size_t max_entries = KEY_CACHE_MAX_ENTRIES);
+
+    bool get(const std::string &digest, std::string &content);
+    void put(const std::string &digest, const std::string &content);
+    size_t size() const;
+
+    static std::string digest(const std::string &content);
+
+    /* cache shared by the sessions of the process, on disk in
+     * CIPHERMED_KEY_CACHE if set, only in memory otherwise */
+    static std::shared_ptr<Key_Cache> shared_cache();
+
+protected:
+    std::string path(const std::string &digest) const;
+    void insert(const std::string &digest, const std::string &content);
+
+    const std::string dir_;
+    const size_t max_entries_;
+
+    std::map<std::string, std::string> entries_;
+    std::deque<std::string> order_;
+    mutable std::mutex mtx_;
+};
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Generates the next version of keys in a key store (see net/key_store.hh),
+ * so that servers and clients load them at their next start instead of
+ * running keygen themselves. Running it periodically, e.g. from cron, with
+ * a period shorter than CIPHERMED_KEY_MAX_AGE rotates the keys.
+ *
+ *   keygen <dir> <key_size> <name>...
+ *
+ * where name is server_gm, server_paillier, server_dgk, server_fhe,
+ * client_gm, client_paillier or client_dgk.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <openssl/rand.h>
+
+#include <FHE.h>
+#include <util/fhe_util.hh>
+
+#include <crypto/gm.hh>
+#include <crypto/paillier.hh>
+#include <crypto/dgk.hh>
+#include <net/defs.hh>
+#include <net/key_store.hh>
+
+using namespace std;
+
+#define KEYGEN_SEED_BYTES 32
+
+static bool generate(const Key_Store &store, const string &name, unsigned int key_size, gmp_randstate_t randstate)
+{
+    if (name == "server_gm" || name == "client_gm") {
+        return store.save_key(name, key_size, GM_priv::keygen(randstate, key_size));
+    }
+    if (name == "server_paillier" || name == "client_paillier") {
+        return store.save_key(name, key_size, Paillier_priv_fast::keygen(randstate, key_size));
+    }
+    if (name == "server_dgk" || name == "client_dgk") {
+        return store.save_key(name, key_size, DGK_priv::keygen(randstate, key_size));
+    }
+    if (name == "server_fhe") {
+        FHEcontext *context = create_FHEContext(FHE_p,FHE_r,FHE_d,FHE_c,FHE_L,FHE_s,FHE_k,FHE_m);
+        FHESecKey sk(*context);
+        sk.GenSecKey(FHE_w);
+        bool ok = store.save_fhe(name, *context, &sk);
+        delete context;
+        return ok;
+    }
+    cerr << "Unknown key " << name << endl;
+    return false;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 4)
+    {
+        std::cerr << "Usage: keygen <dir> <key_size> <name>..." << std::endl;
+        return 1;
+    }
+
+    Key_Store store(argv[1]);
+    unsigned int key_size = atoi(argv[2]);
+
+    // long-lived keys: seed from the system, not from the time
+    unsigned char seed[KEYGEN_SEED_BYTES];
+    if (RAND_bytes(seed, sizeof(seed)) != 1) {
+        cerr << "Unable to seed the generator" << endl;
+        return 1;
+    }
+    mpz_class gmp_seed;
+    mpz_import(gmp_seed.get_mpz_t(), sizeof(seed), 1, 1, 1, 0, seed);
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed(randstate, gmp_seed.get_mpz_t());
+    SetSeed(ZZFromBytes(seed, sizeof(seed)));
+
+    int ret = 0;
+    for (int i = 3; i < argc; i++) {
+        if (generate(store, argv[i], key_size, randstate)) {
+            cout << argv[i] << ": version " << store.latest_version(argv[i]) << endl;
+        } else {
+            cerr << argv[i] << ": failed" << endl;
+            ret = 1;
+        }
+    }
+
+    gmp_randclear(randstate);
+    return ret;
+}
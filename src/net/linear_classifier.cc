@@ -60,18 +60,16 @@ void Linear_Classifier_Client::get_model()
 
 bool Linear_Classifier_Client::run()
 {
+    Session_Metrics::Binding metrics_binding(metrics_);
     // get public keys
     exchange_all_keys();
     
     // get the model
     get_model();
     
-    // compute the encrypted dot product
-    mpz_class v = 1;
-    
-    for (size_t i = 0; i < values_.size(); i++) {
-        v = server_paillier_->add(v, server_paillier_->constMult(values_[i],model_[i]));
-    }
+    // compute the encrypted dot product (the last model entry is the bias)
+    vector<mpz_class> c_model(model_.begin(), model_.begin() + values_.size());
+    mpz_class v = server_paillier_->dot_product(c_model, values_);
     
     // build the comparator over encrypted data
     EncCompare_Owner owner = create_enc_comparator_owner(bit_size_,false);
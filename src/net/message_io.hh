@@ -6,10 +6,19 @@
 #include <vector>
 
 #include <util/benchmarks.hh>
+#include <util/session_metrics.hh>
+#include <net/channel.hh>
 
 const unsigned HEADER_SIZE = 4;
 typedef unsigned char byte;
 
+/* frames of a Channel_Mux: channel id, then payload length.
+ * Credit frames carry 4 bytes of credit for channel (id & ~MUX_CREDIT_FLAG),
+ * MUX_END is the last frame a party sends. */
+const unsigned MUX_HEADER_SIZE = 8;
+const uint32_t MUX_CREDIT_FLAG = 0x80000000;
+const uint32_t MUX_END = 0xFFFFFFFF;
+
 template <class CharContainer>
 std::string show_hex(const CharContainer& c)
 {
@@ -42,56 +51,79 @@ static void encode_header(std::vector<byte>& buf, unsigned size)
     buf[3] = static_cast<boost::uint8_t>(size & 0xFF);
 }
 
+static void encode_mux_header(byte *buf, uint32_t channel, unsigned size)
+{
+    for (unsigned i = 0; i < 4; ++i) {
+        buf[i] = static_cast<byte>((channel >> (24 - 8*i)) & 0xFF);
+        buf[4 + i] = static_cast<byte>((size >> (24 - 8*i)) & 0xFF);
+    }
+}
+
+static void decode_mux_header(const byte *buf, uint32_t &channel, unsigned &size)
+{
+    channel = 0;
+    size = 0;
+    for (unsigned i = 0; i < 4; ++i) {
+        channel = channel * 256 + buf[i];
+        size = size * 256 + buf[4 + i];
+    }
+}
+
 template <class T>
-T readMessageFromSocket(boost::asio::ip::tcp::socket &socket) {
-//    PAUSE_BENCHMARK
-    std::vector<byte> m_readbuf;
-    m_readbuf.resize(HEADER_SIZE);
+T readMessageFromSocket(Channel &channel) {
     PAUSE_BENCHMARK
-    boost::asio::read(socket, boost::asio::buffer(m_readbuf));
-//    (cerr << "Got header!\n");
-//    (cerr << show_hex(m_readbuf) << endl);
-    unsigned msg_len = decode_header(m_readbuf);
-    
-    m_readbuf.resize(HEADER_SIZE + msg_len);
+    Session_Metrics::IO_Scope io(Session_Metrics::RECEIVED);
+    std::string content = channel.read_message();
     
-    EXCHANGED_BYTES(HEADER_SIZE + msg_len)
+    EXCHANGED_BYTES(HEADER_SIZE + content.size())
     INTERACTION
-    
-    boost::asio::mutable_buffers_1 buf = boost::asio::buffer(&m_readbuf[HEADER_SIZE], msg_len);
-    boost::asio::read(socket, buf);
+    io.add_bytes(HEADER_SIZE + content.size());
+    io.done();
     RESUME_BENCHMARK
     
-//    (cerr << "Got body!\n");
-//    (cerr << show_hex(m_readbuf) << endl);
-    
     T m;
-    m.ParseFromArray(&m_readbuf[HEADER_SIZE], m_readbuf.size() - HEADER_SIZE);
+    m.ParseFromArray(content.data(), content.size());
     
-//    RESUME_BENCHMARK
     return m;
 }
 
 template <class T>
-void sendMessageToSocket(boost::asio::ip::tcp::socket &socket, const T& msg) {
-   // PAUSE_BENCHMARK
-    
-    std::vector<byte> writebuf;
+void sendMessageToSocket(Channel &channel, const T& msg) {
     unsigned msg_size = msg.ByteSize();
-    
-    writebuf.resize(HEADER_SIZE + msg_size);
+    std::string writebuf(msg_size, '\0');
     
     EXCHANGED_BYTES(HEADER_SIZE + msg_size);
     INTERACTION
     
-    encode_header(writebuf, msg_size);
-    
-    if (!msg.SerializeToArray(&writebuf[HEADER_SIZE], msg_size)) {
+    if (!msg.SerializeToArray(&writebuf[0], msg_size)) {
         std::cerr << "Error when serializing" << std::endl;
         return;
     }
-    boost::asio::write(socket, boost::asio::buffer(writebuf));
-   // RESUME_BENCHMARK
+    Session_Metrics::IO_Scope io(Session_Metrics::SENT, HEADER_SIZE + msg_size);
+    channel.write_message(std::move(writebuf));
+}
+
+/* messages kept serialized, e.g. cached key material */
+inline std::string readSerializedMessageFromSocket(Channel &channel) {
+    PAUSE_BENCHMARK
+    Session_Metrics::IO_Scope io(Session_Metrics::RECEIVED);
+    std::string content = channel.read_message();
+
+    EXCHANGED_BYTES(HEADER_SIZE + content.size())
+    INTERACTION
+    io.add_bytes(HEADER_SIZE + content.size());
+    io.done();
+    RESUME_BENCHMARK
+
+    return content;
+}
+
+inline void sendSerializedMessageToSocket(Channel &channel, const std::string &content) {
+    EXCHANGED_BYTES(HEADER_SIZE + content.size());
+    INTERACTION
+
+    Session_Metrics::IO_Scope io(Session_Metrics::SENT, HEADER_SIZE + content.size());
+    channel.write_message(std::string(content));
 }
 
 #endif
\ No newline at end of file
@@ -89,48 +89,51 @@ istream& parseInt(istream& in, mpz_class &i, int base)
     return in;
 }
 
-void sendIntToSocket(boost::asio::ip::tcp::socket &socket, const mpz_class& m)
+void sendIntToSocket(Channel &channel, const mpz_class& m)
 {
     Protobuf::BigInt msg = convert_to_message(m);
-    sendMessageToSocket(socket,msg);
+    sendMessageToSocket(channel,msg);
 }
 
-mpz_class readIntFromSocket(boost::asio::ip::tcp::socket &socket)
+mpz_class readIntFromSocket(Channel &channel)
 {
-    Protobuf::BigInt msg = readMessageFromSocket<Protobuf::BigInt>(socket);
+    Protobuf::BigInt msg = readMessageFromSocket<Protobuf::BigInt>(channel);
     return convert_from_message(msg);
 }
 
-void send_int_array_to_socket(boost::asio::ip::tcp::socket &socket, const vector<mpz_class>& m)
+void send_int_array_to_socket(Channel &channel, const vector<mpz_class>& m)
 {
     Protobuf::BigIntArray msg = convert_to_message(m);
-    sendMessageToSocket(socket,msg);
+    sendMessageToSocket(channel,msg);
 }
 
-vector<mpz_class> read_int_array_from_socket(boost::asio::ip::tcp::socket &socket)
+vector<mpz_class> read_int_array_from_socket(Channel &channel)
 {
-    Protobuf::BigIntArray msg = readMessageFromSocket<Protobuf::BigIntArray>(socket);
+    Protobuf::BigIntArray msg = readMessageFromSocket<Protobuf::BigIntArray>(channel);
     return convert_from_message(msg);
 }
 
 
-void send_fhe_ctxt_to_socket(boost::asio::ip::tcp::socket &socket, const Ctxt &c)
+void send_fhe_ctxt_to_socket(Channel &channel, const Ctxt &c)
 {
     Protobuf::FHE_Ctxt msg = convert_to_message(c);
-    sendMessageToSocket(socket,msg);
+    sendMessageToSocket(channel,msg);
 }
 
-Ctxt read_fhe_ctxt_from_socket(boost::asio::ip::tcp::socket &socket, const FHEPubKey &pubkey)
+Ctxt read_fhe_ctxt_from_socket(Channel &channel, const FHEPubKey &pubkey)
 {
-    Protobuf::FHE_Ctxt msg = readMessageFromSocket<Protobuf::FHE_Ctxt>(socket);
+    Protobuf::FHE_Ctxt msg = readMessageFromSocket<Protobuf::FHE_Ctxt>(channel);
     return convert_from_message(msg,pubkey);
 }
 
 
-void read_byte_string_from_socket(boost::asio::ip::tcp::socket &socket, unsigned char *buffer, size_t byte_count)
+void read_byte_string_from_socket(Channel &channel, unsigned char *buffer, size_t byte_count)
 {
     PAUSE_BENCHMARK
-    boost::asio::read(socket, boost::asio::buffer(buffer, byte_count));
+    {
+        Session_Metrics::IO_Scope io(Session_Metrics::RECEIVED, byte_count);
+        channel.read(buffer, byte_count);
+    }
     
     EXCHANGED_BYTES(byte_count)
     INTERACTION
@@ -138,15 +141,18 @@ void read_byte_string_from_socket(boost::asio::ip::tcp::socket &socket, unsigned
     RESUME_BENCHMARK
 }
 
-void read_byte_string_from_socket(boost::asio::ip::tcp::socket &socket, char *buffer, size_t byte_count)
+void read_byte_string_from_socket(Channel &channel, char *buffer, size_t byte_count)
 {
-    read_byte_string_from_socket(socket, (unsigned char *)buffer, byte_count);
+    read_byte_string_from_socket(channel, (unsigned char *)buffer, byte_count);
 }
 
-void write_byte_string_to_socket(boost::asio::ip::tcp::socket &socket, unsigned char *buffer, size_t byte_count)
+void write_byte_string_to_socket(Channel &channel, unsigned char *buffer, size_t byte_count)
 {
     PAUSE_BENCHMARK
-    boost::asio::write(socket, boost::asio::buffer(buffer, byte_count));
+    {
+        Session_Metrics::IO_Scope io(Session_Metrics::SENT, byte_count);
+        channel.write(buffer, byte_count);
+    }
     
     EXCHANGED_BYTES(byte_count)
     INTERACTION
@@ -154,24 +160,24 @@ void write_byte_string_to_socket(boost::asio::ip::tcp::socket &socket, unsigned
     RESUME_BENCHMARK
 }
 
-void write_byte_string_to_socket(boost::asio::ip::tcp::socket &socket, char *buffer, size_t byte_count)
+void write_byte_string_to_socket(Channel &channel, char *buffer, size_t byte_count)
 {
-    write_byte_string_to_socket(socket, (unsigned char *)buffer, byte_count);
+    write_byte_string_to_socket(channel, (unsigned char *)buffer, byte_count);
 }
 
-__m128i read_block_from_socket(boost::asio::ip::tcp::socket &socket)
+__m128i read_block_from_socket(Channel &channel)
 {
     union{
         __m128i v;
         unsigned char a[sizeof(__m128i)];
     }u;
 
-    read_byte_string_from_socket(socket, (unsigned char*)u.a, sizeof(__m128i));
+    read_byte_string_from_socket(channel, (unsigned char*)u.a, sizeof(__m128i));
 
     return u.v;
 }
 
-void write_block_to_socket(__m128i block, boost::asio::ip::tcp::socket &socket)
+void write_block_to_socket(__m128i block, Channel &channel)
 {
     union{
         __m128i v;
@@ -180,5 +186,5 @@ void write_block_to_socket(__m128i block, boost::asio::ip::tcp::socket &socket)
     
     u.v = block;
     
-    write_byte_string_to_socket(socket, (unsigned char*)u.a, sizeof(__m128i));
+    write_byte_string_to_socket(channel, (unsigned char*)u.a, sizeof(__m128i));
 }
\ No newline at end of file
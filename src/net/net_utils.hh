@@ -3,7 +3,7 @@
 #include <iostream>
 #include <vector>
 
-#include <boost/asio.hpp>
+#include <net/channel.hh>
 
 #include <mpc/lsic.hh>
 #include <gmpxx.h>
@@ -29,22 +29,22 @@ istream& operator>>(istream& in, vector<mpz_class> &v);
 istream& parseInt(istream& in, mpz_class &i, int base);
 
 
-void sendIntToSocket(boost::asio::ip::tcp::socket &socket, const mpz_class& m);
-mpz_class readIntFromSocket(boost::asio::ip::tcp::socket &socket);
+void sendIntToSocket(Channel &channel, const mpz_class& m);
+mpz_class readIntFromSocket(Channel &channel);
 
 
-void send_int_array_to_socket(boost::asio::ip::tcp::socket &socket, const vector<mpz_class>& m);
-vector<mpz_class> read_int_array_from_socket(boost::asio::ip::tcp::socket &socket);
+void send_int_array_to_socket(Channel &channel, const vector<mpz_class>& m);
+vector<mpz_class> read_int_array_from_socket(Channel &channel);
 
 
-void send_fhe_ctxt_to_socket(boost::asio::ip::tcp::socket &socket, const Ctxt &c);
-Ctxt read_fhe_ctxt_from_socket(boost::asio::ip::tcp::socket &socket, const FHEPubKey &pubkey);
+void send_fhe_ctxt_to_socket(Channel &channel, const Ctxt &c);
+Ctxt read_fhe_ctxt_from_socket(Channel &channel, const FHEPubKey &pubkey);
 
 
-void read_byte_string_from_socket(boost::asio::ip::tcp::socket &socket, unsigned char *buffer, size_t byte_count);
-void read_byte_string_from_socket(boost::asio::ip::tcp::socket &socket, char *buffer, size_t byte_count);
-void write_byte_string_to_socket(boost::asio::ip::tcp::socket &socket, unsigned char *buffer, size_t byte_count);
-void write_byte_string_to_socket(boost::asio::ip::tcp::socket &socket, char *buffer, size_t byte_count);
+void read_byte_string_from_socket(Channel &channel, unsigned char *buffer, size_t byte_count);
+void read_byte_string_from_socket(Channel &channel, char *buffer, size_t byte_count);
+void write_byte_string_to_socket(Channel &channel, unsigned char *buffer, size_t byte_count);
+void write_byte_string_to_socket(Channel &channel, char *buffer, size_t byte_count);
 
-__m128i read_block_from_socket(boost::asio::ip::tcp::socket &socket);
-void write_block_to_socket(__m128i block, boost::asio::ip::tcp::socket &socket);
\ No newline at end of file
+__m128i read_block_from_socket(Channel &channel);
+void write_block_to_socket(__m128i block, Channel &channel);
\ No newline at end of file
@@ -11,7 +11,11 @@
 #include <math/math_util.hh>
 #include <net/net_utils.hh>
 
+#include <openssl/rand.h>
+
 #include <cassert>
+#include <mutex>
+#include <stdexcept>
 
 const char* ifcp1024 = "B10B8F96A080E01DDE92DE5EAE5D54EC52C99FBCFB06A3C69A6A9DCA52D23B616073E28675A23D189838EF1E2EE652C013ECB4AEA906112324975C3CD49B83BFACCBDD7D90C4BD7098488E9C219A73724EFFD6FAE5644738FAA31A4FF55BCCC0A151AF5F0DC8B4BD45BF37DF365C1A65E68CFDA76D4DA708DF1FB2BC2E4A4371";//"124325339146889384540494091085456630009856882741872806181731279018491820800119460022367403769795008250021191767583423221479185609066059226301250167164084041279837566626881119772675984258163062926954046545485368458404445166682380071370274810671501916789361956272226105723317679562001235501455748016154805420913";
 const char* ifcg1024 = "A4D1CBD5C3FD34126765A442EFB99905F8104DD258AC507FD6406CFF14266D31266FEA1E5C41564B777E690F5504F213160217B4B01B886A5E91547F9E2749F4D7FBD7D3B9A92EE1909D0D2263F80A76A6A24C087A091F531DBF0A0169B6A28AD662A4D18E73AFA32D779D5918D08BC8858F4DCEF97C2A24855E6EEB22B3B2E5";//"115740200527109164239523414760926155534485715860090261532154107313946218459149402375178179458041461723723231563839316251515439564315555249353831328479173170684416728715378198172203100328308536292821245983596065287318698169565702979765910089654821728828592422299160041156491980943427556153020487552135890973413";
@@ -40,6 +44,15 @@ static void hashReturn(char* ret, char* val, int val_len, int ctr) {
 NPState ObliviousTransfer::m_NPState;
 int ObliviousTransfer::m_SecParam = 0;
 
+// the random state is shared by all the sessions of the process
+static std::mutex rnd_state_mtx;
+
+static void random_field_element(mpz_t r)
+{
+    std::lock_guard<std::mutex> lock(rnd_state_mtx);
+    mpz_urandomb(r, ObliviousTransfer::m_NPState.rnd_state, ObliviousTransfer::m_NPState.field_size*8);
+}
+
 bool ObliviousTransfer::GMP_Init(int secparam) {
     m_SecParam = secparam;
     mpz_init(m_NPState.p);
@@ -58,6 +71,16 @@ bool ObliviousTransfer::GMP_Init(int secparam) {
     }
     
     gmp_randinit_mt (m_NPState.rnd_state );
+    // the receiver's exponents hide its choices: the state must not be predictable
+    unsigned char seed_bytes[32];
+    if (RAND_bytes(seed_bytes, sizeof(seed_bytes)) != 1) {
+        throw std::runtime_error("Unable to seed the oblivious transfer");
+    }
+    mpz_t seed;
+    mpz_init(seed);
+    mpz_import(seed, sizeof(seed_bytes), 1, 1, 0, 0, seed_bytes);
+    gmp_randseed(m_NPState.rnd_state, seed);
+    mpz_clear(seed);
     m_NPState.field_size = mpz_sizeinbase(m_NPState.p, 2)/8;
     return true;
 }
@@ -86,7 +109,7 @@ bool ObliviousTransfer::GMP_Cleanup()
 
 
 
-bool ObliviousTransfer::receiver(int nOTs, int *choices, char *ret, tcp::socket &socket, uint8_t block_size)
+bool ObliviousTransfer::receiver(int nOTs, int *choices, char *ret, Channel &channel, uint8_t block_size)
 {
     assert(block_size <= SHA1_BYTES);
     int nSndVals = 2;
@@ -111,13 +134,13 @@ bool ObliviousTransfer::receiver(int nOTs, int *choices, char *ret, tcp::socket
         mpz_init(PK_sigma[k]);
         
         //generate random PK_sigmas
-        mpz_urandomb(ztmp, m_NPState.rnd_state, m_NPState.field_size*8);
+        random_field_element(ztmp);
         mpz_mod(pK[k], ztmp, m_NPState.q);
         br.powerMod(PK_sigma[k], pK[k]);
     }
     
 //    socket.Receive(pBuf, nBufSize);
-    read_byte_string_from_socket(socket, pBuf, nBufSize);
+    read_byte_string_from_socket(channel, pBuf, nBufSize);
 
     char* pBufIdx = pBuf;
     
@@ -156,7 +179,7 @@ bool ObliviousTransfer::receiver(int nOTs, int *choices, char *ret, tcp::socket
     }
     
 //    socket.Send(pBuf, nOTs * m_NPState.field_size);
-    write_byte_string_to_socket(socket, pBuf, nOTs * m_NPState.field_size);
+    write_byte_string_to_socket(channel, pBuf, nOTs * m_NPState.field_size);
 
     delete pBuf;
     pBuf = new char[m_NPState.field_size];
@@ -182,7 +205,7 @@ bool ObliviousTransfer::receiver(int nOTs, int *choices, char *ret, tcp::socket
     delete [] hashVar;
     
     char *hashBuf = new char[nOTs * block_size * nSndVals];
-    read_byte_string_from_socket(socket, hashBuf, nOTs * block_size * nSndVals);
+    read_byte_string_from_socket(channel, hashBuf, nOTs * block_size * nSndVals);
 
     
     char *hashBufPtr = hashBuf;
@@ -216,7 +239,7 @@ bool ObliviousTransfer::receiver(int nOTs, int *choices, char *ret, tcp::socket
 
 
 
-bool ObliviousTransfer::sender(int nOTs, char *messages, tcp::socket &socket, uint8_t block_size)
+bool ObliviousTransfer::sender(int nOTs, char *messages, Channel &channel, uint8_t block_size)
 {
     assert(block_size <= SHA1_BYTES);
     char* pBuf = new char[m_NPState.field_size * nOTs];
@@ -237,14 +260,14 @@ bool ObliviousTransfer::sender(int nOTs, char *messages, tcp::socket &socket, ui
     }
     
     //random C1
-    mpz_urandomb(ztmp, m_NPState.rnd_state, m_NPState.field_size*8);
+    random_field_element(ztmp);
     mpz_mod(r, ztmp, m_NPState.q);
     mpz_powm(pC[0], m_NPState.g, r, m_NPState.p);
     
     //random C(i+1)
     for(int u = 1; u < nSndVals; u++)
     {
-        mpz_urandomb(ztmp, m_NPState.rnd_state, m_NPState.field_size*8);
+        random_field_element(ztmp);
         mpz_mod(ztmp2, ztmp, m_NPState.q);
         mpz_powm_ui(pC[u], ztmp2, 2, m_NPState.p);
     }
@@ -259,7 +282,7 @@ bool ObliviousTransfer::sender(int nOTs, char *messages, tcp::socket &socket, ui
         pBufIdx += m_NPState.field_size;
     }
 //    socket.Send(pBuf, nBufSize);
-    write_byte_string_to_socket(socket, pBuf, nBufSize);
+    write_byte_string_to_socket(channel, pBuf, nBufSize);
 
     //====================================================
     // compute C^R
@@ -272,7 +295,7 @@ bool ObliviousTransfer::sender(int nOTs, char *messages, tcp::socket &socket, ui
     // N-P sender: receive pk0
     nBufSize = m_NPState.field_size * nOTs;
 //    socket.Receive(pBuf, nBufSize); //receive the d_j's
-    read_byte_string_from_socket(socket, pBuf, nBufSize);
+    read_byte_string_from_socket(channel, pBuf, nBufSize);
 
     pBufIdx = pBuf;
     mpz_t pPK0[nOTs];
@@ -324,7 +347,7 @@ bool ObliviousTransfer::sender(int nOTs, char *messages, tcp::socket &socket, ui
         }
     }
     
-    write_byte_string_to_socket(socket, hashBuf, nOTs * block_size * nSndVals);
+    write_byte_string_to_socket(channel, hashBuf, nOTs * block_size * nSndVals);
 
     delete [] hashBuf;
     delete [] pBuf;
@@ -11,8 +11,7 @@
 
 #include <stdio.h>
 
-#include <boost/asio.hpp>
-using boost::asio::ip::tcp;
+#include <net/channel.hh>
 
 #include <gmpxx.h>
 
@@ -52,8 +51,8 @@ public:
     static void mpz_export_padded(char* pBufIdx, int field_size, mpz_t to_export);
 
     static void init(int secparam){ GMP_Init(secparam); };
-    static bool sender(int nOTs, char *messages, tcp::socket &socket, uint8_t block_size = SHA1_BYTES);
-    static bool receiver(int nOTs, int *choices, char *ret, tcp::socket &socket, uint8_t block_size = SHA1_BYTES);
+    static bool sender(int nOTs, char *messages, Channel &channel, uint8_t block_size = SHA1_BYTES);
+    static bool receiver(int nOTs, int *choices, char *ret, Channel &channel, uint8_t block_size = SHA1_BYTES);
 };
 
 #endif /* defined(__ciphermed_proj__oblivious_transfer__) */
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <net/ot_extension.hh>
+
+#include <net/net_utils.hh>
+
+#include <openssl/rand.h>
+
+#include <cassert>
+#include <cstring>
+
+// byte length of a column of the IKNP matrix, padded to full AES blocks
+static size_t column_bytes(int nOTs)
+{
+    size_t bytes = (nOTs + 7)/8;
+    return ((bytes + 15)/16)*16;
+}
+
+static EVP_CIPHER_CTX* prg_init(const unsigned char *seed)
+{
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    EVP_EncryptInit_ex(ctx, EVP_aes_128_ecb(), NULL, seed, NULL);
+    EVP_CIPHER_CTX_set_padding(ctx, 0);
+    return ctx;
+}
+
+// AES in counter mode: fills out with len bytes (len multiple of 16)
+static void prg_expand(EVP_CIPHER_CTX *ctx, uint64_t counter, unsigned char *out, size_t len)
+{
+    unsigned char *in = new unsigned char[len];
+    memset(in, 0, len);
+    for (size_t b = 0; b < len/16; b++) {
+        uint64_t c = counter + b;
+        memcpy(in + 16*b, &c, sizeof(uint64_t));
+    }
+    int outl;
+    EVP_EncryptUpdate(ctx, out, &outl, in, len);
+    delete [] in;
+}
+
+// H(index, row): the row is OT_EXT_BASE_OTS bits long
+static void hash_row(unsigned char *ret, const unsigned char *row, uint64_t index)
+{
+    SHA_CTX sha;
+    HASH_INIT(&sha);
+    HASH_UPDATE(&sha, row, OT_EXT_BASE_OTS/8);
+    HASH_UPDATE(&sha, &index, sizeof(uint64_t));
+    HASH_FINAL(&sha, ret);
+}
+
+// cols is a OT_EXT_BASE_OTS x col_bytes bit matrix (one column per base OT)
+// rows receives the nOTs rows of OT_EXT_BASE_OTS bits
+static void transpose(const unsigned char *cols, size_t col_bytes, unsigned char *rows, int nOTs)
+{
+    memset(rows, 0, nOTs*OT_EXT_BASE_OTS/8);
+    for (size_t i = 0; i < OT_EXT_BASE_OTS; i++) {
+        const unsigned char *col = cols + i*col_bytes;
+        for (int j = 0; j < nOTs; j++) {
+            if ((col[j >> 3] >> (j & 7)) & 1) {
+                rows[j*OT_EXT_BASE_OTS/8 + (i >> 3)] |= (1 << (i & 7));
+            }
+        }
+    }
+}
+
+OTExtension::OTExtension(Channel &channel)
+: channel_(channel), sender_ready_(false), sender_counter_(0), sender_index_(0), receiver_ready_(false), receiver_counter_(0), receiver_index_(0)
+{
+    for (size_t i = 0; i < OT_EXT_BASE_OTS; i++) {
+        sender_prg_[i] = NULL;
+        receiver_prg_[0][i] = NULL;
+        receiver_prg_[1][i] = NULL;
+    }
+}
+
+OTExtension::~OTExtension()
+{
+    for (size_t i = 0; i < OT_EXT_BASE_OTS; i++) {
+        if (sender_prg_[i]) {
+            EVP_CIPHER_CTX_free(sender_prg_[i]);
+        }
+        if (receiver_prg_[0][i]) {
+            EVP_CIPHER_CTX_free(receiver_prg_[0][i]);
+            EVP_CIPHER_CTX_free(receiver_prg_[1][i]);
+        }
+    }
+}
+
+void OTExtension::init_sender()
+{
+    int choices[OT_EXT_BASE_OTS];
+    unsigned char seeds[OT_EXT_BASE_OTS*OT_EXT_SEED_BYTES];
+
+    RAND_bytes(s_, OT_EXT_BASE_OTS/8);
+    for (size_t i = 0; i < OT_EXT_BASE_OTS; i++) {
+        choices[i] = (s_[i >> 3] >> (i & 7)) & 1;
+    }
+
+    // roles are reversed for the base OTs
+    ObliviousTransfer::receiver(OT_EXT_BASE_OTS, choices, (char *)seeds, channel_, OT_EXT_SEED_BYTES);
+
+    for (size_t i = 0; i < OT_EXT_BASE_OTS; i++) {
+        sender_prg_[i] = prg_init(seeds + i*OT_EXT_SEED_BYTES);
+    }
+    sender_ready_ = true;
+}
+
+void OTExtension::init_receiver()
+{
+    unsigned char seeds[2*OT_EXT_BASE_OTS*OT_EXT_SEED_BYTES];
+
+    RAND_bytes(seeds, 2*OT_EXT_BASE_OTS*OT_EXT_SEED_BYTES);
+
+    // roles are reversed for the base OTs
+    ObliviousTransfer::sender(OT_EXT_BASE_OTS, (char *)seeds, channel_, OT_EXT_SEED_BYTES);
+
+    for (size_t i = 0; i < OT_EXT_BASE_OTS; i++) {
+        receiver_prg_[0][i] = prg_init(seeds + (2*i)*OT_EXT_SEED_BYTES);
+        receiver_prg_[1][i] = prg_init(seeds + (2*i+1)*OT_EXT_SEED_BYTES);
+    }
+    receiver_ready_ = true;
+}
+
+size_t OTExtension::request_size(int nOTs)
+{
+    return OT_EXT_BASE_OTS*column_bytes(nOTs);
+}
+
+bool OTExtension::sender(int nOTs, char *messages, uint8_t block_size)
+{
+    prepare_sender();
+
+    unsigned char *u = new unsigned char[request_size(nOTs)];
+    char *hashBuf = new char[response_size(nOTs, block_size)];
+
+    read_byte_string_from_socket(channel_, u, request_size(nOTs));
+    sender_respond(nOTs, u, messages, hashBuf, block_size);
+    write_byte_string_to_socket(channel_, hashBuf, response_size(nOTs, block_size));
+
+    delete [] hashBuf;
+    delete [] u;
+
+    return true;
+}
+
+bool OTExtension::receiver(int nOTs, int *choices, char *ret, uint8_t block_size)
+{
+    prepare_receiver();
+
+    Receiver_State state;
+    unsigned char *u = new unsigned char[request_size(nOTs)];
+    char *hashBuf = new char[response_size(nOTs, block_size)];
+
+    receiver_request(nOTs, choices, u, state);
+    write_byte_string_to_socket(channel_, u, request_size(nOTs));
+    read_byte_string_from_socket(channel_, hashBuf, response_size(nOTs, block_size));
+    receiver_finish(state, hashBuf, ret, block_size);
+
+    delete [] hashBuf;
+    delete [] u;
+
+    return true;
+}
+
+void OTExtension::sender_respond(int nOTs, const unsigned char *u, const char *messages, char *hashBuf, uint8_t block_size)
+{
+    assert(block_size <= SHA1_BYTES);
+    assert(sender_ready_);
+
+    size_t col_bytes = column_bytes(nOTs);
+    size_t row_bytes = OT_EXT_BASE_OTS/8;
+    unsigned char *q = new unsigned char[OT_EXT_BASE_OTS*col_bytes];
+    unsigned char *rows = new unsigned char[nOTs*row_bytes];
+
+    // q_i = G(k_i^{s_i}) xor s_i.u_i
+    for (size_t i = 0; i < OT_EXT_BASE_OTS; i++) {
+        unsigned char *q_i = q + i*col_bytes;
+        prg_expand(sender_prg_[i], sender_counter_, q_i, col_bytes);
+
+        if ((s_[i >> 3] >> (i & 7)) & 1) {
+            const unsigned char *u_i = u + i*col_bytes;
+            for (size_t b = 0; b < col_bytes; b++) {
+                q_i[b] ^= u_i[b];
+            }
+        }
+    }
+    sender_counter_ += col_bytes/16;
+
+    transpose(q, col_bytes, rows, nOTs);
+
+    unsigned char hashVar[SHA1_BYTES];
+    unsigned char row_s[OT_EXT_BASE_OTS/8];
+    char *hashBufPtr = hashBuf;
+    const char *messagePtr = messages;
+
+    for (int j = 0; j < nOTs; j++) {
+        unsigned char *q_j = rows + j*row_bytes;
+        for (size_t b = 0; b < row_bytes; b++) {
+            row_s[b] = q_j[b] ^ s_[b];
+        }
+
+        hash_row(hashVar, q_j, sender_index_ + j);
+        for (int i = 0; i < block_size; i++) {
+            hashBufPtr[i] = hashVar[i] ^ messagePtr[i];
+        }
+        messagePtr += block_size;
+        hashBufPtr += block_size;
+
+        hash_row(hashVar, row_s, sender_index_ + j);
+        for (int i = 0; i < block_size; i++) {
+            hashBufPtr[i] = hashVar[i] ^ messagePtr[i];
+        }
+        messagePtr += block_size;
+        hashBufPtr += block_size;
+    }
+    sender_index_ += nOTs;
+
+    delete [] rows;
+    delete [] q;
+}
+
+void OTExtension::receiver_request(int nOTs, const int *choices, unsigned char *u, Receiver_State &state)
+{
+    assert(receiver_ready_);
+
+    size_t col_bytes = column_bytes(nOTs);
+    size_t row_bytes = OT_EXT_BASE_OTS/8;
+    unsigned char *r = new unsigned char[col_bytes];
+    unsigned char *t = new unsigned char[OT_EXT_BASE_OTS*col_bytes];
+
+    memset(r, 0, col_bytes);
+    for (int j = 0; j < nOTs; j++) {
+        if (choices[j]) {
+            r[j >> 3] |= (1 << (j & 7));
+        }
+    }
+
+    // t_i = G(k_i^0), u_i = t_i xor G(k_i^1) xor r
+    for (size_t i = 0; i < OT_EXT_BASE_OTS; i++) {
+        unsigned char *t_i = t + i*col_bytes;
+        unsigned char *u_i = u + i*col_bytes;
+        prg_expand(receiver_prg_[0][i], receiver_counter_, t_i, col_bytes);
+        prg_expand(receiver_prg_[1][i], receiver_counter_, u_i, col_bytes);
+
+        for (size_t b = 0; b < col_bytes; b++) {
+            u_i[b] ^= t_i[b] ^ r[b];
+        }
+    }
+    receiver_counter_ += col_bytes/16;
+
+    state.nOTs = nOTs;
+    state.index = receiver_index_;
+    state.rows.resize(nOTs*row_bytes);
+    state.choices.assign(choices, choices + nOTs);
+    transpose(t, col_bytes, state.rows.data(), nOTs);
+    receiver_index_ += nOTs;
+
+    delete [] t;
+    delete [] r;
+}
+
+void OTExtension::receiver_finish(const Receiver_State &state, const char *hashBuf, char *ret, uint8_t block_size)
+{
+    assert(block_size <= SHA1_BYTES);
+
+    size_t row_bytes = OT_EXT_BASE_OTS/8;
+    unsigned char hashVar[SHA1_BYTES];
+    char *retPtr = ret;
+    const char *chosenHash;
+
+    for (int j = 0; j < state.nOTs; j++) {
+        hash_row(hashVar, state.rows.data() + j*row_bytes, state.index + j);
+
+        chosenHash = hashBuf + (2*j + (state.choices[j] ? 1 : 0))*block_size;
+        for (int i = 0; i < block_size; i++) {
+            retPtr[i] = hashVar[i] ^ chosenHash[i];
+        }
+        retPtr += block_size;
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <net/channel.hh>
+#include <openssl/evp.h>
+
+#include <net/oblivious_transfer.hh>
+
+// number of Naor-Pinkas base OTs run once per connection (computational
+// security parameter of the extension)
+#define OT_EXT_BASE_OTS 128
+#define OT_EXT_SEED_BYTES 16
+
+/*
+ * IKNP OT extension (semi-honest) on top of ObliviousTransfer.
+ *
+ * The first time an OTExtension is used in a given direction, it runs
+ * OT_EXT_BASE_OTS public-key OTs with the other party (with reversed roles).
+ * Every subsequent call to sender/receiver only costs AES (to expand the base
+ * seeds) and SHA1 (to mask the messages).
+ *
+ * An extension object is bound to one channel: both parties must use their
+ * objects in the same order, so it must not be shared between threads.
+ * sender/receiver have the same message layout as the ones in
+ * ObliviousTransfer.
+ *
+ * The split-phase functions do no I/O so that pipelined protocols can carry
+ * the OT messages themselves. The base OTs have to be run beforehand with
+ * prepare_sender/prepare_receiver, and the sender must answer the requests in
+ * the order the receiver created them.
+ */
+class OTExtension {
+public:
+    OTExtension(Channel &channel);
+    ~OTExtension();
+
+    bool uses_channel(const Channel &channel) const { return &channel_ == &channel; }
+
+    bool sender(int nOTs, char *messages, uint8_t block_size = SHA1_BYTES);
+    bool receiver(int nOTs, int *choices, char *ret, uint8_t block_size = SHA1_BYTES);
+
+    /* split-phase interface */
+    struct Receiver_State {
+        int nOTs;
+        uint64_t index;
+        std::vector<unsigned char> rows;
+        std::vector<int> choices;
+    };
+
+    void prepare_sender() { if (!sender_ready_) init_sender(); }
+    void prepare_receiver() { if (!receiver_ready_) init_receiver(); }
+
+    static size_t request_size(int nOTs);
+    static size_t response_size(int nOTs, uint8_t block_size = SHA1_BYTES) { return nOTs * block_size * 2; }
+
+    void receiver_request(int nOTs, const int *choices, unsigned char *request, Receiver_State &state);
+    void receiver_finish(const Receiver_State &state, const char *response, char *ret, uint8_t block_size = SHA1_BYTES);
+    void sender_respond(int nOTs, const unsigned char *request, const char *messages, char *response, uint8_t block_size = SHA1_BYTES);
+
+protected:
+    void init_sender();
+    void init_receiver();
+
+    Channel &channel_;
+
+    /* extension sender: base OT receiver with random choices s */
+    bool sender_ready_;
+    unsigned char s_[OT_EXT_BASE_OTS/8];
+    EVP_CIPHER_CTX *sender_prg_[OT_EXT_BASE_OTS];
+    uint64_t sender_counter_;
+    uint64_t sender_index_;
+
+    /* extension receiver: base OT sender with both seeds of each pair */
+    bool receiver_ready_;
+    EVP_CIPHER_CTX *receiver_prg_[2][OT_EXT_BASE_OTS];
+    uint64_t receiver_counter_;
+    uint64_t receiver_index_;
+
+private:
+    OTExtension(const OTExtension&);
+    OTExtension& operator=(const OTExtension&);
+};
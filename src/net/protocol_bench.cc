@@ -51,7 +51,7 @@ void Bench_Client::send_test_query(enum Test_Request_Request_Type type, unsigned
     request.set_iterations(iterations);
     request.set_comparison_protocol(comparison_prot);
     request.set_argmax_elements(argmax_elements);
-    sendMessageToSocket<Test_Request>(socket_,request);
+    sendMessageToSocket<Test_Request>(channel_,request);
 }
 
 void Bench_Client::bench_lsic(size_t bit_size, unsigned int iterations)
@@ -116,7 +116,7 @@ void Bench_Client::bench_compare(size_t bit_size, unsigned int iterations)
         RESET_BENCHMARK_TIMER
         t.lap(); // reset timer
         
-        Compare_A comparator(b,bit_size,*server_paillier_,*server_gm_,rand_state_);
+        Compare_A comparator(b,bit_size,*server_dgk_,*server_gm_,rand_state_);
         run_priv_compare_A(&comparator);
         
         cpu_time += GET_BENCHMARK_TIME;
@@ -394,7 +394,7 @@ void Bench_Client::bench_ot(size_t n_elements ,unsigned int iterations)
         RESET_BENCHMARK_TIMER
         t.lap(); // reset timer
         
-        ObliviousTransfer::receiver(nOTs, choices, messages, socket_);
+        ObliviousTransfer::receiver(nOTs, choices, messages, channel_);
         
         cpu_time += GET_BENCHMARK_TIME;
         total_time += t.lap_ms();
@@ -428,7 +428,7 @@ Server_session* Bench_Server::create_new_server_session(tcp::socket &socket)
 
 enum Test_Request_Request_Type Bench_Server_session::get_test_query(unsigned int &bit_size, unsigned int &iterations, COMPARISON_PROTOCOL &comparison_prot, unsigned int &argmax_elements)
 {
-    Test_Request request = readMessageFromSocket<Test_Request>(socket_);
+    Test_Request request = readMessageFromSocket<Test_Request>(channel_);
     
     if (request.has_bit_size()) {
         bit_size = request.bit_size();
@@ -606,7 +606,7 @@ void Bench_Server_session::bench_compare(size_t bit_size, unsigned int iteration
 
         RESET_BENCHMARK_TIMER
 
-        Compare_B comparator(a,bit_size,server_->paillier(),server_->gm());
+        Compare_B comparator(a,bit_size,server_->dgk(),server_->gm());
         run_priv_compare_B(&comparator);
 
         cpu_time += GET_BENCHMARK_TIME;
@@ -726,7 +726,7 @@ void Bench_Server_session::bench_ot(size_t n_elements, unsigned int iterations)
         }
 
         RESET_BENCHMARK_TIMER
-        ObliviousTransfer::sender(nOTs, messages, socket_);
+        ObliviousTransfer::sender(nOTs, messages, channel_);
         cpu_time += GET_BENCHMARK_TIME;
     }
     cout << id_  << ": Sender OT bench for " << iterations << " iterations" << endl;
@@ -28,7 +28,7 @@ class  Bench_Server : public Server{
     
     static Key_dependencies_descriptor key_deps_descriptor()
     {
-        return Key_dependencies_descriptor(true,true,true,true,true,true);
+        return Key_dependencies_descriptor(true,true,true,true,true,true,true,true);
     }
     
 };
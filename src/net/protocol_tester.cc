@@ -50,7 +50,7 @@ void Tester_Client::send_test_query(enum Test_Request_Request_Type type)
 {
     Test_Request request;
     request.set_type(type);
-    sendMessageToSocket<Test_Request>(socket_,request);
+    sendMessageToSocket<Test_Request>(channel_,request);
 }
 
 mpz_class Tester_Client::test_lsic(const mpz_class &a, size_t l)
@@ -75,7 +75,7 @@ mpz_class Tester_Client::test_compare(const mpz_class &b, size_t l)
     // send the start message
     send_test_query(Test_Request_Request_Type_TEST_COMPARE);
     
-    Compare_A comparator(b,l,*server_paillier_,*server_gm_,rand_state_);
+    Compare_A comparator(b,l,*server_dgk_,*server_gm_,rand_state_);
     return run_priv_compare_A(&comparator);
 }
 
@@ -244,7 +244,7 @@ void Tester_Client::test_fhe()
     send_test_query(Test_Request_Request_Type_TEST_FHE);
 
     Protobuf::FHE_Ctxt m = convert_to_message(c0);
-    sendMessageToSocket<Protobuf::FHE_Ctxt>(socket_,m);
+    sendMessageToSocket<Protobuf::FHE_Ctxt>(channel_,m);
 }
 
 
@@ -267,7 +267,7 @@ void Tester_Client::test_change_es()
     
     Ctxt c_fhe = change_encryption_scheme(c_gm);
     
-    send_fhe_ctxt_to_socket(socket_, c_fhe);
+    send_fhe_ctxt_to_socket(channel_, c_fhe);
     for (size_t i = 0; i < bits_query.size(); i++) {
         cout << "[" << bits_query[i] << "]";
     }
@@ -292,7 +292,7 @@ Server_session* Tester_Server::create_new_server_session(tcp::socket &socket)
 
 enum Test_Request_Request_Type Tester_Server_session::get_test_query()
 {
-    Test_Request request = readMessageFromSocket<Test_Request>(socket_);
+    Test_Request request = readMessageFromSocket<Test_Request>(channel_);
     
     return request.type();
 }
@@ -434,7 +434,7 @@ void Tester_Server_session::test_lsic(const mpz_class &b,size_t l)
 void Tester_Server_session::test_compare(const mpz_class &a,size_t l)
 {
     cout << id_ << ": Test compare" << endl;
-    Compare_B comparator(a,l,server_->paillier(),server_->gm());
+    Compare_B comparator(a,l,server_->dgk(),server_->gm());
     run_priv_compare_B(&comparator);
 }
 
@@ -451,7 +451,7 @@ void Tester_Server_session::test_change_es()
     run_change_encryption_scheme_slots_helper();
     
     // get the encryption from the client
-    Ctxt c = read_fhe_ctxt_from_socket(socket_, server_->fhe_sk());
+    Ctxt c = read_fhe_ctxt_from_socket(channel_, server_->fhe_sk());
     
     EncryptedArray ea(server_->fhe_sk().getContext(), server_->fhe_G());
     NewPlaintextArray pp0(ea);
@@ -469,7 +469,7 @@ void Tester_Server_session::decrypt_gm(const mpz_class &c)
 
 void Tester_Server_session::decrypt_fhe()
 {
-    Protobuf::FHE_Ctxt m = readMessageFromSocket<Protobuf::FHE_Ctxt>(socket_);
+    Protobuf::FHE_Ctxt m = readMessageFromSocket<Protobuf::FHE_Ctxt>(channel_);
     Ctxt c = convert_from_message(m, server_->fhe_sk());
     
     EncryptedArray ea(server_->fhe_sk().getContext(), server_->fhe_G());
@@ -503,7 +503,7 @@ void Tester_Client::test_ot(unsigned int nOTs)
     
     send_test_query(Test_Request_Request_Type_TEST_OT);
 
-    ObliviousTransfer::receiver(nOTs, choices, (char *)messages, socket_, OT_BLOCK_SIZE);
+    ObliviousTransfer::receiver(nOTs, choices, (char *)messages, channel_, OT_BLOCK_SIZE);
     
     
     for (size_t i = 0; i < nOTs; i++) {
@@ -548,5 +548,5 @@ void Tester_Server_session::test_ot(unsigned int nOTs)
     }
     cout << (dec) << endl;
 
-    ObliviousTransfer::sender(nOTs, (char *)messages, socket_, OT_BLOCK_SIZE);
+    ObliviousTransfer::sender(nOTs, (char *)messages, channel_, OT_BLOCK_SIZE);
 }
@@ -46,7 +46,7 @@ class  Tester_Server : public Server{
     
     static Key_dependencies_descriptor key_deps_descriptor()
     {
-        return Key_dependencies_descriptor(true,true,true,true,true,true);
+        return Key_dependencies_descriptor(true,true,true,true,true,true,true,true);
     }
     
 };
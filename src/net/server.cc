@@ -18,7 +18,9 @@
  *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
  *
  */
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <boost/asio.hpp>
@@ -28,6 +30,8 @@
 #include <FHE.h>
 #include <EncryptedArray.h>
 #include <util/fhe_util.hh>
+#include <util/executor.hh>
+#include <util/threadpool.hh>
 
 #include <net/defs.hh>
 
@@ -56,16 +60,19 @@ using namespace std;
 #define OT_SECPARAM 1024
 
 Server::Server(gmp_randstate_t state, Key_dependencies_descriptor key_deps_desc, unsigned int keysize, unsigned int lambda)
-: key_deps_desc_(key_deps_desc), paillier_(NULL), gm_(NULL), fhe_context_(NULL), fhe_sk_(NULL), n_clients_(0), threads_per_session_(1), lambda_(lambda)
+: key_deps_desc_(key_deps_desc), paillier_(NULL), gm_(NULL), dgk_(NULL), fhe_context_(NULL), fhe_sk_(NULL), n_clients_(0), threads_per_session_(1), max_sessions_(0), max_pending_sessions_(MAX_PENDING_SESSIONS), admission_policy_(WAIT_WHEN_FULL), max_query_batch_(MAX_QUERY_BATCH), fixed_base_randomizers_(false), lambda_(lambda)
 {
     gmp_randinit_set(rand_state_, state);
 
     init_needed_keys(keysize);
+    prepare_key_material();
+    client_key_cache_ = Key_Cache::shared_cache();
     ObliviousTransfer::init(OT_SECPARAM);
 }
 
 Server::~Server()
 {
+    delete dgk_;
     delete fhe_sk_;
     delete fhe_context_;
 }
@@ -78,6 +85,9 @@ void Server::init_needed_keys(unsigned int keysize)
     if (key_deps_desc_.need_server_paillier) {
         init_Paillier(keysize);
     }
+    if (key_deps_desc_.need_server_dgk) {
+        init_DGK(keysize);
+    }
     if (key_deps_desc_.need_server_fhe) {
         init_FHE_context();
         init_FHE_key();
@@ -95,7 +105,7 @@ void Server::init_GM(unsigned int keysize)
     if (gm_ != NULL) {
         return;
     }
-    gm_ = new GM_priv(GM_priv::keygen(rand_state_,keysize),rand_state_);
+    gm_ = new GM_priv(stored_key("server_gm", keysize, [&]{ return GM_priv::keygen(rand_state_,keysize); }),rand_state_);
 }
 
 void Server::init_Paillier(unsigned int keysize)
@@ -104,19 +114,37 @@ void Server::init_Paillier(unsigned int keysize)
         return;
     }
     
-    paillier_ = new Paillier_priv_fast(Paillier_priv_fast::keygen(rand_state_,keysize), rand_state_);
+    paillier_ = new Paillier_priv_fast(stored_key("server_paillier", keysize, [&]{ return Paillier_priv_fast::keygen(rand_state_,keysize); }), rand_state_);
         
 }
 
+void Server::init_DGK(unsigned int keysize)
+{
+    if (dgk_ != NULL) {
+        return;
+    }
+    dgk_ = new DGK_priv(stored_key("server_dgk", keysize, [&]{ return DGK_priv::keygen(rand_state_,keysize); }));
+}
+
 void Server::init_FHE_context()
 {
     if (fhe_context_) {
         return;
     }
-    // generate a context. This one should be consisten with the server's one
-    // i.e. m, p, r must be the same
-    
-    fhe_context_ = create_FHEContext(FHE_p,FHE_r,FHE_d,FHE_c,FHE_L,FHE_s,FHE_k,FHE_m);
+    shared_ptr<Key_Store> store = Key_Store::default_store();
+    if (store) {
+        // the secret key is stored with its context
+        fhe_context_ = store->load_fhe("server_fhe", key_deps_desc_.need_server_fhe ? &fhe_sk_ : NULL);
+    }
+    if (!fhe_context_) {
+        // generate a context. This one should be consisten with the server's one
+        // i.e. m, p, r must be the same
+
+        fhe_context_ = create_FHEContext(FHE_p,FHE_r,FHE_d,FHE_c,FHE_L,FHE_s,FHE_k,FHE_m);
+        if (store && !key_deps_desc_.need_server_fhe) {
+            store->save_fhe("server_fhe", *fhe_context_, NULL);
+        }
+    }
     // we suppose d > 0
     fhe_G_ = makeIrredPoly(FHE_p, FHE_d);
 }
@@ -128,6 +156,55 @@ void Server::init_FHE_key()
 
     fhe_sk_ = new FHESecKey(*fhe_context_);
     fhe_sk_->GenSecKey(FHE_w); // A Hamming-weight-w secret key
+
+    shared_ptr<Key_Store> store = Key_Store::default_store();
+    if (store && !store->save_fhe("server_fhe", *fhe_context_, fhe_sk_)) {
+        cerr << "Unable to save the FHE key in " << store->dir() << endl;
+    }
+}
+
+void Server::prepare_key_material()
+{
+    // in the order expected by the clients
+    if (key_deps_desc_.need_server_gm) {
+        key_material_.push_back(get_pk_message(gm_).SerializeAsString());
+    }
+    if (key_deps_desc_.need_server_paillier) {
+        key_material_.push_back(get_pk_message(paillier_).SerializeAsString());
+    }
+    if (key_deps_desc_.need_server_dgk) {
+        key_material_.push_back(get_pk_message(dgk_).SerializeAsString());
+    }
+    if (key_deps_desc_.need_server_fhe || key_deps_desc_.need_client_fhe) {
+        key_material_.push_back(convert_to_message(*fhe_context_).SerializeAsString());
+    }
+    if (key_deps_desc_.need_server_fhe) {
+        const FHEPubKey& publicKey = *fhe_sk_;
+        key_material_.push_back(get_pk_message(publicKey).SerializeAsString());
+    }
+
+    for (size_t i = 0; i < key_material_.size(); ++i) {
+        key_digests_.push_back(Key_Cache::digest(key_material_[i]));
+    }
+}
+
+unsigned int Server::max_sessions() const
+{
+    if (max_sessions_ > 0) {
+        return max_sessions_;
+    }
+    unsigned int cores = Executor::global().size();
+    return max(1U, cores/threads_per_session_);
+}
+
+// the session deletes itself at the end of run_session
+static void run_bound_session(Server_session *session, unsigned int threads_per_session)
+{
+    // the session thread is one of its threads, the executor gives the others
+    Executor::Share share(threads_per_session - 1);
+    Executor::Share::Binding share_binding(share);
+    Session_Metrics::Binding binding(session->metrics());
+    session->run_session();
 }
 
 void Server::run(const unsigned int port)
@@ -140,16 +217,30 @@ void Server::run(const unsigned int port)
         tcp::endpoint endpoint(tcp::v4(), port);
         tcp::acceptor acceptor(io_service, endpoint);
         
+        ThreadPool workers(max_sessions(), max_pending_sessions_);
+        cout << "Running at most " << workers.size() << " sessions at a time" << endl;
+        
         for (;;)
         {
+            if (admission_policy_ == WAIT_WHEN_FULL) {
+                // leave the new connections in the listen backlog
+                workers.wait_for_room();
+            }
+            
             tcp::socket socket(io_service);
             acceptor.accept(socket);
             
+            if (admission_policy_ == REJECT_WHEN_FULL && workers.full()) {
+                cerr << "Too many pending sessions, connection refused" << endl;
+                socket.close();
+                continue;
+            }
+            
             Server_session *c = create_new_server_session(socket);
             
-            cout << "Start new connection: " << c->id() << endl;
-            thread t (&Server_session::run_session,c);
-            t.detach();
+            cout << "Queue new connection: " << c->id() << endl;
+            unsigned int threads = threads_per_session_;
+            workers.enqueue([c, threads]{ run_bound_session(c, threads); });
         }
     }
     catch (std::exception& e)
@@ -160,7 +251,7 @@ void Server::run(const unsigned int port)
 
 
 Server_session::Server_session(Server *server, gmp_randstate_t state, unsigned int id, tcp::socket &socket)
-: server_(server), socket_(std::move(socket)), client_gm_(NULL), client_paillier_(NULL), client_fhe_pk_(NULL), id_(id)
+: server_(server), socket_(std::move(socket)), channel_(socket_), ot_extension_(channel_), metrics_("server", id), client_gm_(NULL), client_paillier_(NULL), client_dgk_(NULL), client_fhe_pk_(NULL), id_(id)
 {
     gmp_randinit_set(rand_state_, state);
 }
@@ -170,6 +261,12 @@ Server_session::~Server_session()
     if (client_gm_) {
         delete client_gm_;
     }
+    delete client_dgk_;
+
+    metrics_.finish();
+    if (server_->metrics_sink()) {
+        server_->metrics_sink()->publish(metrics_);
+    }
 }
 
 void Server_session::send_paillier_pk()
@@ -180,7 +277,7 @@ void Server_session::send_paillier_pk()
     cout << id_ << ": Send Paillier PK" << endl;
     Protobuf::Paillier_PK pk_message = get_pk_message(&(server_->paillier()));
     
-    sendMessageToSocket<Protobuf::Paillier_PK>(socket_,pk_message);
+    sendMessageToSocket<Protobuf::Paillier_PK>(channel_,pk_message);
 }
 
 void Server_session::send_gm_pk()
@@ -191,7 +288,7 @@ void Server_session::send_gm_pk()
     cout << id_ << ": Send GM PK" << endl;
     Protobuf::GM_PK pk_message = get_pk_message(&(server_->gm()));
     
-    sendMessageToSocket<Protobuf::GM_PK>(socket_,pk_message);
+    sendMessageToSocket<Protobuf::GM_PK>(channel_,pk_message);
 }
 
 void Server_session::send_fhe_context()
@@ -200,7 +297,7 @@ void Server_session::send_fhe_context()
     cout << id_ << ": Send FHE Context" << endl;
     Protobuf::FHE_Context pk_message = convert_to_message(context);
     
-    sendMessageToSocket<Protobuf::FHE_Context>(socket_,pk_message);
+    sendMessageToSocket<Protobuf::FHE_Context>(channel_,pk_message);
 }
 
 void Server_session::send_fhe_pk()
@@ -210,7 +307,7 @@ void Server_session::send_fhe_pk()
 
     Protobuf::FHE_PK pk_message = get_pk_message(publicKey);
     
-    sendMessageToSocket<Protobuf::FHE_PK>(socket_,pk_message);
+    sendMessageToSocket<Protobuf::FHE_PK>(channel_,pk_message);
 
 }
 
@@ -220,8 +317,15 @@ void Server_session::get_client_pk_gm()
         return;
     }
 
-    Protobuf::GM_PK pk = readMessageFromSocket<Protobuf::GM_PK>(socket_);
+    Protobuf::GM_PK pk = readMessageFromSocket<Protobuf::GM_PK>(channel_);
     cout << id_ << ": Received GM PK" << endl;
+    set_client_pk_gm(pk.SerializeAsString());
+}
+
+void Server_session::set_client_pk_gm(const string &serialized_pk)
+{
+    Protobuf::GM_PK pk;
+    pk.ParseFromString(serialized_pk);
     client_gm_ = create_from_pk_message(pk,rand_state_);
 }
 
@@ -231,9 +335,27 @@ void Server_session::get_client_pk_paillier()
         return;
     }
 
-    Protobuf::Paillier_PK pk = readMessageFromSocket<Protobuf::Paillier_PK>(socket_);
+    Protobuf::Paillier_PK pk = readMessageFromSocket<Protobuf::Paillier_PK>(channel_);
     cout << id_ << ": Received Paillier PK" << endl;
+    set_client_pk_paillier(pk.SerializeAsString());
+}
+
+void Server_session::set_client_pk_paillier(const string &serialized_pk)
+{
+    Protobuf::Paillier_PK pk;
+    pk.ParseFromString(serialized_pk);
     client_paillier_ = create_from_pk_message(pk,rand_state_);
+    client_paillier_->set_batch_threads(server_->threads_per_session());
+    if (server_->fixed_base_randomizers()) {
+        client_paillier_->enable_fixed_base_randomizers();
+    }
+}
+
+void Server_session::set_client_pk_dgk(const string &serialized_pk)
+{
+    Protobuf::DGK_PK pk;
+    pk.ParseFromString(serialized_pk);
+    client_dgk_ = create_from_pk_message(pk);
 }
 
 
@@ -243,86 +365,137 @@ void Server_session::get_client_pk_fhe()
         return;
     }
     
-    Protobuf::FHE_PK pk = readMessageFromSocket<Protobuf::FHE_PK>(socket_);
+    Protobuf::FHE_PK pk = readMessageFromSocket<Protobuf::FHE_PK>(channel_);
     cout << id_ << ": Received FHE PK" << endl;
     client_fhe_pk_ = create_from_pk_message(pk,server_->fhe_context());
 }
 
 
+// the keys are announced by their digests first and only sent if the other
+// party does not have them yet: returning clients only exchange the digests
 void Server_session::exchange_keys()
 {
+    metrics_.set_phase("key_exchange");
     Key_dependencies_descriptor key_deps_desc = server_->key_deps_desc();
-    if (key_deps_desc.need_server_gm) {
-        send_gm_pk();
+    const vector<string> &material = server_->key_material();
+    const vector<string> &digests = server_->key_digests();
+
+    Protobuf::Key_Digests announce;
+    for (size_t i = 0; i < digests.size(); ++i) {
+        announce.add_digest(digests[i]);
+    }
+    sendMessageToSocket<Protobuf::Key_Digests>(channel_, announce);
+
+    Protobuf::Key_Request request = readMessageFromSocket<Protobuf::Key_Request>(channel_);
+    Protobuf::Key_Digests client_digests = readMessageFromSocket<Protobuf::Key_Digests>(channel_);
+
+    size_t n_client_keys = (key_deps_desc.need_client_gm ? 1 : 0) + (key_deps_desc.need_client_paillier ? 1 : 0)
+                         + (key_deps_desc.need_client_dgk ? 1 : 0);
+    if ((size_t)request.need_size() != material.size() || (size_t)client_digests.digest_size() != n_client_keys) {
+        throw std::runtime_error("Unexpected key exchange message");
     }
-    if (key_deps_desc.need_server_paillier) {
-        send_paillier_pk();
+
+    for (size_t i = 0; i < material.size(); ++i) {
+        if (request.need(i)) {
+            sendSerializedMessageToSocket(channel_, material[i]);
+        }
     }
+    cout << id_ << ": Sent " << count(request.need().begin(), request.need().end(), true) << " of " << material.size() << " keys" << endl;
 
+    Key_Cache &cache = server_->client_key_cache();
+    vector<string> client_material(n_client_keys);
+    Protobuf::Key_Request our_request;
+    for (size_t i = 0; i < n_client_keys; ++i) {
+        our_request.add_need(!cache.get(client_digests.digest(i), client_material[i]));
+    }
+    sendMessageToSocket<Protobuf::Key_Request>(channel_, our_request);
+
+    for (size_t i = 0; i < n_client_keys; ++i) {
+        if (our_request.need(i)) {
+            client_material[i] = readSerializedMessageFromSocket(channel_);
+            if (Key_Cache::digest(client_material[i]) != client_digests.digest(i)) {
+                throw std::runtime_error("Client key does not match its digest");
+            }
+            cache.put(client_digests.digest(i), client_material[i]);
+        }
+    }
+
+    size_t k = 0;
     if (key_deps_desc.need_client_gm) {
-        get_client_pk_gm();
+        set_client_pk_gm(client_material[k++]);
     }
     if (key_deps_desc.need_client_paillier) {
-        get_client_pk_paillier();
+        set_client_pk_paillier(client_material[k++]);
     }
-    
-    if (key_deps_desc.need_server_fhe ||
-        key_deps_desc.need_client_fhe) {
-        // if we use FHE, we need to send the context to the client before doing anything
-        send_fhe_context();
+    if (key_deps_desc.need_client_dgk) {
+        set_client_pk_dgk(client_material[k++]);
     }
 
-    if (key_deps_desc.need_server_fhe) {
-        send_fhe_pk();
-    }
+    // the client creates its FHE key in our context: it is new in every session
     if (key_deps_desc.need_client_fhe) {
         get_client_pk_fhe();
     }
-
 }
 
 
+size_t Server_session::read_query_batch(vector<vector<mpz_class> > &queries, size_t min_query_size, size_t max_query_size)
+{
+    mpz_class batch_size = readIntFromSocket(channel_);
+    if (batch_size < 0 || batch_size > server_->max_query_batch()) {
+        throw std::runtime_error("Query batch too large");
+    }
+    size_t n = batch_size.get_ui();
+    queries = vector<vector<mpz_class> >(n);
+    for (size_t q = 0; q < n; ++q) {
+        queries[q] = read_int_array_from_socket(channel_);
+        if (queries[q].size() < min_query_size || queries[q].size() > max_query_size) {
+            throw std::runtime_error("Query of unexpected size");
+        }
+    }
+    return n;
+}
+
 mpz_class Server_session::run_comparison_protocol_A(Comparison_protocol_A *comparator)
 {
-    exec_comparison_protocol_A(socket_,comparator,server_->threads_per_session());
+    exec_comparison_protocol_A(channel_,comparator,server_->threads_per_session());
     return comparator->output();
 }
 
 mpz_class Server_session::run_lsic_A(LSIC_A *lsic)
 {
-    exec_lsic_A(socket_,lsic);
+    exec_lsic_A(channel_,lsic);
     return lsic->output();
 }
 mpz_class Server_session::run_priv_compare_A(Compare_A *comparator)
 {
-    exec_priv_compare_A(socket_,comparator,server_->threads_per_session());
+    exec_priv_compare_A(channel_,comparator,server_->threads_per_session());
     return comparator->output();
 }
 
 mpz_class Server_session::run_garbled_compare_A(GC_Compare_A *comparator)
 {
-    exec_garbled_compare_A(socket_,comparator);
+    exec_garbled_compare_A(channel_,comparator);
     return comparator->output();
 }
 
 void Server_session::run_comparison_protocol_B(Comparison_protocol_B *comparator)
 {
-    exec_comparison_protocol_B(socket_,comparator,server_->threads_per_session());
+    exec_comparison_protocol_B(channel_,comparator,server_->threads_per_session());
 }
 
 void Server_session::run_lsic_B(LSIC_B *lsic)
 {
-    exec_lsic_B(socket_,lsic);
+    exec_lsic_B(channel_,lsic);
 }
 
 void Server_session::run_priv_compare_B(Compare_B *comparator)
 {
-    exec_priv_compare_B(socket_,comparator,server_->threads_per_session());
+    exec_priv_compare_B(channel_,comparator,server_->threads_per_session());
 }
 
 void Server_session::run_garbled_compare_B(GC_Compare_B *comparator)
 {
-    exec_garbled_compare_B(socket_,comparator);
+    exec_garbled_compare_B(channel_,comparator);
 }
 
 // we suppose that the client already has the server's public key for Paillier
@@ -335,7 +508,7 @@ void Server_session::rev_enc_comparison(const mpz_class &a, const mpz_class &b,
 
 void Server_session::run_rev_enc_comparison_owner(Rev_EncCompare_Owner &owner)
 {
-    exec_rev_enc_comparison_owner(socket_, owner, server_->lambda(), true, server_->threads_per_session());
+    exec_rev_enc_comparison_owner(channel_, owner, server_->lambda(), true, server_->threads_per_session());
 }
 
 bool Server_session::help_rev_enc_comparison(const size_t &l, COMPARISON_PROTOCOL comparison_prot)
@@ -346,7 +519,7 @@ bool Server_session::help_rev_enc_comparison(const size_t &l, COMPARISON_PROTOCO
 
 bool Server_session::run_rev_enc_comparison_helper(Rev_EncCompare_Helper &helper)
 {
-    exec_rev_enc_comparison_helper(socket_, helper, true, server_->threads_per_session());
+    exec_rev_enc_comparison_helper(channel_, helper, true, server_->threads_per_session());
     return helper.output();
 }
 
@@ -360,7 +533,7 @@ bool Server_session::enc_comparison(const mpz_class &a, const mpz_class &b, size
 
 bool Server_session::run_enc_comparison_owner(EncCompare_Owner &owner)
 {
-    exec_enc_comparison_owner(socket_, owner, server_->lambda(), true, server_->threads_per_session());
+    exec_enc_comparison_owner(channel_, owner, server_->lambda(), true, server_->threads_per_session());
     return owner.output();
 }
 
@@ -372,7 +545,7 @@ void Server_session::help_enc_comparison(const size_t &l, COMPARISON_PROTOCOL co
 
 void Server_session::run_enc_comparison_helper(EncCompare_Helper &helper)
 {
-    exec_enc_comparison_helper(socket_,helper, true, server_->threads_per_session());
+    exec_enc_comparison_helper(channel_,helper, true, server_->threads_per_session());
 }
 
 
@@ -381,23 +554,23 @@ void Server_session::run_enc_comparison_helper(EncCompare_Helper &helper)
 
 mpz_class Server_session::run_rev_enc_comparison_owner_enc_result(Rev_EncCompare_Owner &owner)
 {
-    exec_rev_enc_comparison_owner(socket_, owner, server_->lambda(), false, server_->threads_per_session());
+    exec_rev_enc_comparison_owner(channel_, owner, server_->lambda(), false, server_->threads_per_session());
     return owner.encrypted_output();
 }
 
 void Server_session::run_rev_enc_comparison_helper_enc_result(Rev_EncCompare_Helper &helper)
 {
-    exec_rev_enc_comparison_helper(socket_, helper, false, server_->threads_per_session());
+    exec_rev_enc_comparison_helper(channel_, helper, false, server_->threads_per_session());
 }
 
 void Server_session::run_enc_comparison_owner_enc_result(EncCompare_Owner &owner)
 {
-    exec_enc_comparison_owner(socket_, owner, server_->lambda(), false, server_->threads_per_session());
+    exec_enc_comparison_owner(channel_, owner, server_->lambda(), false, server_->threads_per_session());
 }
 
 mpz_class Server_session::run_enc_comparison_helper_enc_result(EncCompare_Helper &helper)
 {
-    exec_enc_comparison_helper(socket_,helper, false, server_->threads_per_session());
+    exec_enc_comparison_helper(channel_,helper, false, server_->threads_per_session());
     return helper.encrypted_output();
 }
 
@@ -433,6 +606,91 @@ void Server_session::help_enc_comparison_enc_result(const size_t &l, COMPARISON_
     run_rev_enc_comparison_helper_enc_result(helper);
 }
 
+vector<mpz_class> Server_session::run_garbled_comparisons_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, unsigned int window, Rev_EncCompare_Input set_input)
+{
+    assert(a.size() == b.size());
+    size_t n = a.size();
+    vector<Rev_EncCompare_Owner*> owners(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        owners[i] = new Rev_EncCompare_Owner(create_rev_enc_comparator_owner(l, GC_PROTOCOL));
+        (owners[i]->*set_input)(a[i],b[i]);
+    }
+    
+    if (window == 0) {
+        exec_rev_enc_comparison_owner_batch(channel_, owners, server_->lambda(), false);
+    }else{
+        exec_rev_enc_comparison_owner_pipelined(channel_, owners, server_->lambda(), window, false);
+    }
+    
+    vector<mpz_class> results(n);
+    for (size_t i = 0; i < n; i++) {
+        results[i] = owners[i]->encrypted_output();
+        delete owners[i];
+    }
+    
+    return results;
+}
+
+void Server_session::help_garbled_comparisons_enc_result(const size_t n, const size_t &l, bool pipelined)
+{
+    vector<Rev_EncCompare_Helper*> helpers(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        helpers[i] = new Rev_EncCompare_Helper(create_rev_enc_comparator_helper(l, GC_PROTOCOL));
+    }
+    
+    if (pipelined) {
+        exec_rev_enc_comparison_helper_pipelined(channel_, helpers, false);
+    }else{
+        exec_rev_enc_comparison_helper_batch(channel_, helpers, false);
+    }
+    
+    for (size_t i = 0; i < n; i++) {
+        delete helpers[i];
+    }
+}
+
+vector<mpz_class> Server_session::batch_enc_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l)
+{
+    return run_garbled_comparisons_enc_result(a, b, l, 0, &Rev_EncCompare_Owner::set_input);
+}
+
+void Server_session::help_batch_enc_comparison_enc_result(const size_t n, const size_t &l)
+{
+    help_garbled_comparisons_enc_result(n, l, false);
+}
+
+vector<mpz_class> Server_session::pipelined_enc_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, unsigned int window)
+{
+    assert(window > 0);
+    return run_garbled_comparisons_enc_result(a, b, l, window, &Rev_EncCompare_Owner::set_input);
+}
+
+void Server_session::help_pipelined_enc_comparison_enc_result(const size_t n, const size_t &l)
+{
+    help_garbled_comparisons_enc_result(n, l, true);
+}
+
+mpz_class Server_session::plain_comparison_enc_result(const mpz_class &a, const mpz_class &b, size_t l, COMPARISON_PROTOCOL comparison_prot)
+{
+    Rev_EncCompare_Owner owner = create_rev_enc_comparator_owner(l, comparison_prot);
+    owner.set_plain_input(a,b);
+    
+    return run_rev_enc_comparison_owner_enc_result(owner);
+}
+
+vector<mpz_class> Server_session::batch_plain_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l)
+{
+    return run_garbled_comparisons_enc_result(a, b, l, 0, &Rev_EncCompare_Owner::set_plain_input);
+}
+
+vector<mpz_class> Server_session::pipelined_plain_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, unsigned int window)
+{
+    assert(window > 0);
+    return run_garbled_comparisons_enc_result(a, b, l, window, &Rev_EncCompare_Owner::set_plain_input);
+}
+
 vector<bool> Server_session::multiple_enc_comparison(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, COMPARISON_PROTOCOL comparison_prot)
 {
     assert(a.size() == b.size());
@@ -445,7 +703,7 @@ vector<bool> Server_session::multiple_enc_comparison(const vector<mpz_class> &a,
     }
     
     unsigned int thread_per_job = ceilf(((float)server_->threads_per_session())/n);
-    multiple_exec_enc_comparison_owner(socket_, owners, server_->lambda(), true, thread_per_job, server_->port()+1);
+    multiple_exec_enc_comparison_owner(channel_, owners, server_->lambda(), true, thread_per_job);
     
     vector<bool> results(n);
     
@@ -468,7 +726,7 @@ void Server_session::multiple_help_enc_comparison(const size_t n, const size_t &
     }
     
     unsigned int thread_per_job = ceilf(((float)server_->threads_per_session())/n);
-    multiple_exec_enc_comparison_helper(socket_, helpers, true, thread_per_job, server_->port()+1);
+    multiple_exec_enc_comparison_helper(channel_, helpers, true, thread_per_job);
     
     for (size_t i = 0; i < n; i++) {
         delete helpers[i];
@@ -488,7 +746,7 @@ void Server_session::multiple_rev_enc_comparison(const vector<mpz_class> &a, con
     }
     
     unsigned int thread_per_job = ceilf(((float)server_->threads_per_session())/n);
-    multiple_exec_rev_enc_comparison_owner(socket_, owners, server_->lambda(), true, thread_per_job, server_->port()+1);
+    multiple_exec_rev_enc_comparison_owner(channel_, owners, server_->lambda(), true, thread_per_job);
     
     
     for (size_t i = 0; i < n; i++) {
@@ -508,7 +766,7 @@ vector<bool> Server_session::multiple_help_rev_enc_comparison(const size_t n, co
     }
     
     unsigned int thread_per_job = ceilf(((float)server_->threads_per_session())/n);
-    multiple_exec_rev_enc_comparison_helper(socket_, helpers, true, thread_per_job, server_->port()+1);
+    multiple_exec_rev_enc_comparison_helper(channel_, helpers, true, thread_per_job);
     
     vector<bool> results(n);
     for (size_t i = 0; i < n; i++) {
@@ -527,11 +785,11 @@ void Server_session::run_linear_enc_argmax(Linear_EncArgmax_Helper &helper, COMP
     if (comparison_prot == LSIC_PROTOCOL) {
         comparator_creator = [this,nbits](){ return new LSIC_B(0,nbits,server_->gm()); };
     }else if (comparison_prot == DGK_PROTOCOL){
-        comparator_creator = [this,nbits](){ return new Compare_B(0,nbits,server_->paillier(),server_->gm()); };
+        comparator_creator = [this,nbits](){ return new Compare_B(0,nbits,server_->dgk(),server_->gm()); };
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator_creator = [this,nbits](){ return new GC_Compare_B(0,nbits,server_->gm(), rand_state_); };
+        comparator_creator = [this,nbits](){ return new GC_Compare_B(0,nbits,server_->gm(), rand_state_, &ot_extension_); };
     }
-    exec_linear_enc_argmax(socket_, helper, comparator_creator, server_->threads_per_session());
+    exec_linear_enc_argmax(channel_, helper, comparator_creator, server_->threads_per_session());
 }
 
 void Server_session::run_tree_enc_argmax(Tree_EncArgmax_Helper &helper, COMPARISON_PROTOCOL comparison_prot)
@@ -542,49 +800,49 @@ void Server_session::run_tree_enc_argmax(Tree_EncArgmax_Helper &helper, COMPARIS
     if (comparison_prot == LSIC_PROTOCOL) {
         comparator_creator = [this,nbits](){ return new LSIC_B(0,nbits,server_->gm()); };
     }else if (comparison_prot == DGK_PROTOCOL){
-        comparator_creator = [this,nbits](){ return new Compare_B(0,nbits,server_->paillier(),server_->gm()); };
+        comparator_creator = [this,nbits](){ return new Compare_B(0,nbits,server_->dgk(),server_->gm()); };
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator_creator = [this,nbits](){ return new GC_Compare_B(0,nbits,server_->gm(), rand_state_); };
+        comparator_creator = [this,nbits](){ return new GC_Compare_B(0,nbits,server_->gm(), rand_state_, &ot_extension_); };
     }
-    exec_tree_enc_argmax(socket_, helper, comparator_creator, server_->threads_per_session(), server_->port()+1);
+    exec_tree_enc_argmax(channel_, helper, comparator_creator, server_->threads_per_session());
 }
 
 Ctxt Server_session::change_encryption_scheme(const vector<mpz_class> &c_gm)
 {
     EncryptedArray ea(server_->fhe_context(), server_->fhe_G());
     
-    return exec_change_encryption_scheme_slots(socket_, c_gm, *client_gm_ ,*client_fhe_pk_, ea, rand_state_);
+    return exec_change_encryption_scheme_slots(channel_, c_gm, *client_gm_ ,*client_fhe_pk_, ea, rand_state_);
 }
 
 
 void Server_session::run_change_encryption_scheme_slots_helper()
 {
     EncryptedArray ea(server_->fhe_context(), server_->fhe_G());
-    exec_change_encryption_scheme_slots_helper(socket_, server_->gm(), server_->fhe_sk(), ea);
+    exec_change_encryption_scheme_slots_helper(channel_, server_->gm(), server_->fhe_sk(), ea);
 }
 
 vector<mpz_class> Server_session::change_encryption_scheme_back(const Ctxt &c_fhe)
 {
     EncryptedArray ea(server_->fhe_context(), server_->fhe_G());
-    return exec_change_encryption_scheme_back_slots(socket_, c_fhe, *client_gm_ ,*client_fhe_pk_, ea, rand_state_);
+    return exec_change_encryption_scheme_back_slots(channel_, c_fhe, *client_gm_ ,*client_fhe_pk_, ea, rand_state_);
 }
 
 
 void Server_session::run_change_encryption_scheme_back_slots_helper()
 {
     EncryptedArray ea(server_->fhe_context(), server_->fhe_G());
-    exec_change_encryption_scheme_back_slots_helper(socket_, server_->gm(), server_->fhe_sk(), ea);
+    exec_change_encryption_scheme_back_slots_helper(channel_, server_->gm(), server_->fhe_sk(), ea);
 }
 
 
 mpz_class Server_session::compute_dot_product(const vector<mpz_class> &x)
 {
-    return exec_compute_dot_product(socket_, x, *client_paillier_);
+    return exec_compute_dot_product(channel_, x, *client_paillier_);
 }
 
 void Server_session::help_compute_dot_product(const vector<mpz_class> &y, bool encrypted_input)
 {
-    exec_help_compute_dot_product(socket_, y, server_->paillier(), encrypted_input);
+    exec_help_compute_dot_product(channel_, y, server_->paillier(), encrypted_input);
 }
 
 EncCompare_Owner Server_session::create_enc_comparator_owner(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
@@ -594,9 +852,9 @@ EncCompare_Owner Server_session::create_enc_comparator_owner(size_t bit_size, CO
     if (comparison_prot == LSIC_PROTOCOL) {
         comparator = new LSIC_B(0,bit_size,server_->gm());
     }else if (comparison_prot == DGK_PROTOCOL){
-        comparator = new Compare_B(0,bit_size,server_->paillier(),server_->gm());
+        comparator = new Compare_B(0,bit_size,server_->dgk(),server_->gm());
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_B(0,bit_size,server_->gm(), rand_state_);
+        comparator = new GC_Compare_B(0,bit_size,server_->gm(), rand_state_, &ot_extension_);
     }
 
     return EncCompare_Owner(0,0,bit_size,*client_paillier_,comparator,rand_state_);
@@ -610,9 +868,9 @@ EncCompare_Helper Server_session::create_enc_comparator_helper(size_t bit_size,
     if (comparison_prot == LSIC_PROTOCOL) {
         comparator = new LSIC_A(0,bit_size,*client_gm_);
     }else if (comparison_prot == DGK_PROTOCOL){
-        comparator = new Compare_A(0,bit_size,*client_paillier_,*client_gm_,rand_state_);
+        comparator = new Compare_A(0,bit_size,*client_dgk_,*client_gm_,rand_state_);
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_A(0,bit_size,*client_gm_, rand_state_);
+        comparator = new GC_Compare_A(0,bit_size,*client_gm_, rand_state_, &ot_extension_);
     }
 
     return EncCompare_Helper(bit_size,server_->paillier(),comparator);
@@ -625,9 +883,9 @@ Rev_EncCompare_Owner Server_session::create_rev_enc_comparator_owner(size_t bit_
     if (comparison_prot == LSIC_PROTOCOL) {
         comparator = new LSIC_A(0,bit_size,*client_gm_);
     }else if (comparison_prot == DGK_PROTOCOL){
-        comparator = new Compare_A(0,bit_size,*client_paillier_,*client_gm_,rand_state_);
+        comparator = new Compare_A(0,bit_size,*client_dgk_,*client_gm_,rand_state_);
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_A(0,bit_size,*client_gm_, rand_state_);
+        comparator = new GC_Compare_A(0,bit_size,*client_gm_, rand_state_, &ot_extension_);
     }
     
     return Rev_EncCompare_Owner(0,0,bit_size,*client_paillier_,comparator,rand_state_);
@@ -641,30 +899,30 @@ Rev_EncCompare_Helper Server_session::create_rev_enc_comparator_helper(size_t bi
     if (comparison_prot == LSIC_PROTOCOL) {
         comparator = new LSIC_B(0,bit_size,server_->gm());
     }else if (comparison_prot == DGK_PROTOCOL){
-        comparator = new Compare_B(0,bit_size,server_->paillier(),server_->gm());
+        comparator = new Compare_B(0,bit_size,server_->dgk(),server_->gm());
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_B(0,bit_size,server_->gm(), rand_state_);
+        comparator = new GC_Compare_B(0,bit_size,server_->gm(), rand_state_, &ot_extension_);
     }
 
     return Rev_EncCompare_Helper(bit_size,server_->paillier(),comparator);
 }
 
 vector<mpz_class> Server_session::change_encryption_scheme_gm_paillier(const vector<mpz_class> &c_gm) {
-    return exec_change_encryption_scheme_paillier_slots(socket_, c_gm, *client_gm_, *client_paillier_, rand_state_);
+    return exec_change_encryption_scheme_paillier_slots(channel_, c_gm, *client_gm_, *client_paillier_, rand_state_);
 }
 
 void Server_session::run_change_encryption_scheme_gm_paillier_slots_helper() {
-    exec_change_encryption_scheme_paillier_slots_helper(socket_, server_->gm(), server_->paillier());
+    exec_change_encryption_scheme_paillier_slots_helper(channel_, server_->gm(), server_->paillier());
 }
 
 vector<mpz_class> Server_session::change_encryption_scheme_fhe_paillier(const Ctxt &c_fhe) {
     EncryptedArray ea(server_->fhe_context(), server_->fhe_G());
-    return exec_change_encryption_scheme_fhe_paillier_slots(socket_, c_fhe, *client_paillier_ ,*client_fhe_pk_, ea, rand_state_);
+    return exec_change_encryption_scheme_fhe_paillier_slots(channel_, c_fhe, *client_paillier_ ,*client_fhe_pk_, ea, rand_state_);
 }
 
 void Server_session::run_change_encryption_scheme_fhe_paillier_slots_helper() {
     EncryptedArray ea(server_->fhe_context(), server_->fhe_G());
-    exec_change_encryption_scheme_fhe_paillier_slots_helper(socket_, server_->paillier(), server_->fhe_sk(), ea);
+    exec_change_encryption_scheme_fhe_paillier_slots_helper(channel_, server_->paillier(), server_->fhe_sk(), ea);
 }
 
 vector<mpz_class> Server_session::add_columns(const vector<vector<mpz_class> > &c_p, size_t n_slots) {
@@ -692,20 +950,20 @@ size_t Server_session::run_tree_enc_argmax(Tree_EncArgmax_Owner &owner, COMPARIS
     if (comparison_prot == LSIC_PROTOCOL) {
         comparator_creator = [this,nbits](){ return new LSIC_A(0,nbits,*client_gm_); };
     }else if (comparison_prot == DGK_PROTOCOL){
-        comparator_creator = [this,nbits](){ return new Compare_A(0,nbits,*client_paillier_,*client_gm_,rand_state_); };
+        comparator_creator = [this,nbits](){ return new Compare_A(0,nbits,*client_dgk_,*client_gm_,rand_state_); };
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator_creator = [this,nbits](){ return new GC_Compare_A(0,nbits,*client_gm_, rand_state_); };
+        comparator_creator = [this,nbits](){ return new GC_Compare_A(0,nbits,*client_gm_, rand_state_, &ot_extension_); };
     }
 
-    exec_tree_enc_argmax(socket_,owner, comparator_creator, 100, server_->threads_per_session(), server_->port()+1);
+    exec_tree_enc_argmax(channel_,owner, comparator_creator, 100, server_->threads_per_session());
 
     return owner.output();
 }
 
 void Server_session::move_paillier_to_client(vector<mpz_class> c_p) {
-    exec_move_paillier_encryption(socket_, c_p, server_->paillier(), *client_paillier_, rand_state_);
+    exec_move_paillier_encryption(channel_, c_p, server_->paillier(), *client_paillier_, rand_state_);
 }
 
 vector<mpz_class> Server_session::move_paillier_from_client() {
-    return exec_move_paillier_encryption_helper(socket_, server_->paillier(), *client_paillier_);
+    return exec_move_paillier_encryption_helper(channel_, server_->paillier(), *client_paillier_);
 }
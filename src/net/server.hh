@@ -21,7 +21,9 @@
 #pragma once
 
 #include <gmpxx.h>
+#include <cstdint>
 #include <vector>
+#include <memory>
 #include <boost/asio.hpp>
 
 #include <mpc/garbled_comparison.hh>
@@ -30,10 +32,15 @@
 
 #include <crypto/paillier.hh>
 #include <crypto/gm.hh>
+#include <crypto/dgk.hh>
 
 #include <net/key_deps_descriptor.hh>
+#include <net/key_store.hh>
+#include <net/ot_extension.hh>
 #include <net/defs.hh>
 
+#include <util/session_metrics.hh>
+
 using boost::asio::ip::tcp;
 
 using namespace std;
@@ -53,6 +60,7 @@ public:
     void init_needed_keys(unsigned int keysize);
     void init_GM(unsigned int keysize);
     void init_Paillier(unsigned int keysize);
+    void init_DGK(unsigned int keysize);
     void init_FHE_context();
     void init_FHE_key();
 
@@ -63,6 +71,7 @@ public:
     GM_priv& gm() { assert(gm_!=NULL); return *gm_; };
     vector<mpz_class> gm_pk() const { assert(gm_!=NULL); return gm_->pubkey(); }
     vector<mpz_class> gm_sk() const { assert(gm_!=NULL); return {gm_->pubkey()[0],gm_->pubkey()[1],gm_->privkey()[0],gm_->privkey()[1]}; }
+    DGK_priv& dgk() { assert(dgk_!=NULL); return *dgk_; };
     
     const FHESecKey& fhe_sk() const { return *fhe_sk_; } // I don't want anyone to modify the secret key
     const FHEcontext& fhe_context() const { return *fhe_context_; }
@@ -73,14 +82,52 @@ public:
     unsigned int lambda() const { return lambda_; }
     unsigned int port() const { return port_; }
     
+    /* threads a session keeps busy at most, its own included (see Executor::Share) */
     unsigned int threads_per_session() const { return threads_per_session_; }
     void set_threads_per_session(unsigned int n) { assert(n > 0); threads_per_session_ = n; }
 
+    /* session scheduling: at most max_sessions() sessions run at the same time
+     * (by default as many as the executor workers allow with
+     * threads_per_session() each)
+     * and max_pending_sessions() of them wait for a worker (0: no limit).
+     * When the queue is full, new connections either wait in the listen backlog
+     * or are closed right away. */
+    enum Admission_Policy { WAIT_WHEN_FULL, REJECT_WHEN_FULL };
+
+    unsigned int max_sessions() const;
+    void set_max_sessions(unsigned int n) { max_sessions_ = n; }
+    unsigned int max_pending_sessions() const { return max_pending_sessions_; }
+    void set_max_pending_sessions(unsigned int n) { max_pending_sessions_ = n; }
+    Admission_Policy admission_policy() const { return admission_policy_; }
+    void set_admission_policy(Admission_Policy p) { admission_policy_ = p; }
+
+    /* most queries a client may send in one batch */
+    size_t max_query_batch() const { return max_query_batch_; }
+    void set_max_query_batch(size_t n) { assert(n > 0); max_query_batch_ = n; }
+
+    /* encrypt under the clients' Paillier keys with fixed-base randomizers */
+    bool fixed_base_randomizers() const { return fixed_base_randomizers_; }
+    void set_fixed_base_randomizers(bool b) { fixed_base_randomizers_ = b; }
+
+    /* the metrics of every session are published to the sink when it ends */
+    shared_ptr<Metrics_Sink> metrics_sink() const { return metrics_sink_; }
+    void set_metrics_sink(shared_ptr<Metrics_Sink> sink) { metrics_sink_ = sink; }
+
+    /* public keys (and FHE context) sent in the key exchange, serialized
+     * once, and their digests */
+    const vector<string>& key_material() const { return key_material_; }
+    const vector<string>& key_digests() const { return key_digests_; }
+    /* keys of the clients, shared by the sessions */
+    Key_Cache& client_key_cache() { return *client_key_cache_; }
+
 protected:
+    void prepare_key_material();
+
     const Key_dependencies_descriptor key_deps_desc_;
 
     Paillier_priv_fast *paillier_;
     GM_priv *gm_;
+    DGK_priv *dgk_;
     FHEcontext *fhe_context_;
     FHESecKey *fhe_sk_;
     ZZX fhe_G_;
@@ -89,6 +136,16 @@ protected:
     unsigned int n_clients_;
     unsigned int threads_per_session_;
     unsigned int port_;
+    unsigned int max_sessions_;
+    unsigned int max_pending_sessions_;
+    Admission_Policy admission_policy_;
+    size_t max_query_batch_;
+    bool fixed_base_randomizers_;
+    shared_ptr<Metrics_Sink> metrics_sink_;
+
+    vector<string> key_material_;
+    vector<string> key_digests_;
+    shared_ptr<Key_Cache> client_key_cache_;
     
     /* statistical security */
     unsigned int lambda_;
@@ -100,6 +157,7 @@ public:
     virtual ~Server_session();
     
     unsigned int id() const {return id_;}
+    Session_Metrics& metrics() { return metrics_; }
 
     virtual void run_session() = 0;
     
@@ -110,8 +168,20 @@ public:
     void get_client_pk_gm();
     void get_client_pk_paillier();
     void get_client_pk_fhe();
+    /* from serialized Protobuf messages */
+    void set_client_pk_gm(const string &serialized_pk);
+    void set_client_pk_paillier(const string &serialized_pk);
+    void set_client_pk_dgk(const string &serialized_pk);
     void exchange_keys();
 
+    /* multi-query sessions: after the key exchange, the client sends its
+     * queries in batches, each preceded by its size. An empty batch ends
+     * the session. Returns the number of queries read.
+     * Throws if the batch exceeds the server's max_query_batch() or if a
+     * query has fewer than min_query_size or more than max_query_size
+     * features. */
+    size_t read_query_batch(vector<vector<mpz_class> > &queries, size_t min_query_size, size_t max_query_size = SIZE_MAX);
+
     mpz_class run_comparison_protocol_A(Comparison_protocol_A *comparator);
     mpz_class run_lsic_A(LSIC_A *lsic);
     mpz_class run_priv_compare_A(Compare_A *comparator);
@@ -139,6 +209,20 @@ public:
 
     mpz_class enc_comparison_enc_result(const mpz_class &a, const mpz_class &b, size_t l, COMPARISON_PROTOCOL comparison_prot);
     void help_enc_comparison_enc_result(const size_t &l, COMPARISON_PROTOCOL comparison_prot);
+
+    // n garbled comparisons in a single round trip (always GC_PROTOCOL)
+    vector<mpz_class> batch_enc_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l);
+    void help_batch_enc_comparison_enc_result(const size_t n, const size_t &l);
+
+    // n garbled comparisons with at most window of them in flight (always GC_PROTOCOL)
+    vector<mpz_class> pipelined_enc_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, unsigned int window);
+    void help_pipelined_enc_comparison_enc_result(const size_t n, const size_t &l);
+
+    // same as above when b is known in the clear by the server (e.g. the thresholds
+    // of a model): b is not encrypted. The client runs the help_* functions above.
+    mpz_class plain_comparison_enc_result(const mpz_class &a, const mpz_class &b, size_t l, COMPARISON_PROTOCOL comparison_prot);
+    vector<mpz_class> batch_plain_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l);
+    vector<mpz_class> pipelined_plain_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, unsigned int window);
     
     /* other protocols */
     
@@ -185,12 +269,22 @@ public:
     Rev_EncCompare_Helper create_rev_enc_comparator_helper(size_t bit_size, COMPARISON_PROTOCOL comparison_prot);
     
 protected:
+    /* n garbled comparisons of a[i] and b[i], set with set_input: in a single
+     * batch (window 0) or pipelined with window of them in flight */
+    typedef void (Rev_EncCompare_Owner::*Rev_EncCompare_Input)(const mpz_class &, const mpz_class &);
+    vector<mpz_class> run_garbled_comparisons_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, unsigned int window, Rev_EncCompare_Input set_input);
+    void help_garbled_comparisons_enc_result(const size_t n, const size_t &l, bool pipelined);
+
     Server *server_;
     tcp::socket socket_;
+    TCP_Channel channel_;
+    OTExtension ot_extension_;
     boost::asio::streambuf input_buf_;
+    Session_Metrics metrics_;
 
     GM *client_gm_;
     Paillier *client_paillier_;
+    DGK *client_dgk_;
     FHEPubKey *client_fhe_pk_;
     gmp_randstate_t rand_state_;
     
@@ -0,0 +1,924 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <crypto/paillier.hh>
+#include <crypto/gm.hh>
+#include <mpc/enc_comparison.hh>
+#include <mpc/garbled_comparison.hh>
+#include <mpc/linear_enc_argmax.hh>
+#include <mpc/lsic.hh>
+#include <mpc/private_comparison.hh>
+#include <mpc/rev_enc_comparison.hh>
+#include <mpc/tree_enc_argmax.hh>
+#include <net/channel.hh>
+#include <net/channel_mux.hh>
+#include <net/client.hh>
+#include <net/defs.hh>
+#include <net/exec_protocol.hh>
+#include <net/key_store.hh>
+#include <net/message_io.hh>
+#include <net/net_utils.hh>
+#include <net/oblivious_transfer.hh>
+#include <net/ot_extension.hh>
+#include <net/server.hh>
+#include <protobuf/protobuf_conversion.hh>
+#include <util/util.hh>
+
+#include <NTL/ZZ.h>
+
+using namespace std;
+using namespace NTL;
+
+// two connected sockets on the loopback interface, with buffers of
+// buffer_size bytes (0 for the system's default)
+static void tcp_pair(boost::asio::io_service &io, tcp::socket &a, tcp::socket &b, int buffer_size = 0)
+{
+    tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    a.open(tcp::v4());
+    if (buffer_size > 0) {
+        acceptor.set_option(boost::asio::socket_base::receive_buffer_size(buffer_size));
+        acceptor.set_option(boost::asio::socket_base::send_buffer_size(buffer_size));
+        a.set_option(boost::asio::socket_base::receive_buffer_size(buffer_size));
+        a.set_option(boost::asio::socket_base::send_buffer_size(buffer_size));
+    }
+    a.connect(acceptor.local_endpoint());
+    acceptor.accept(b);
+}
+
+// size bytes, different for each seed
+static string pattern(size_t size, unsigned int seed)
+{
+    string s(size, 0);
+    for (size_t i = 0; i < size; i++) {
+        s[i] = (char)((i*(2*seed + 1) + seed) & 0xFF);
+    }
+    return s;
+}
+
+// closes both muxes, each close waits for the other one
+static void close_muxes(Channel_Mux &a, Channel_Mux &b)
+{
+    thread t([&b]{ b.close(); });
+    a.close();
+    t.join();
+}
+
+static void test_mux_framing()
+{
+    cout << "Test multiplexed framing ..." << flush;
+    
+    auto ends = Local_Channel::create_pair();
+    Channel_Mux a(*ends.first, 4), b(*ends.second, 4);
+    
+    // empty messages, messages split in several frames, in both directions
+    // on every channel at once
+    const vector<size_t> sizes = {0, 1, 7, MUX_MAX_FRAME, MUX_MAX_FRAME + 1, 3*MUX_MAX_FRAME + 5};
+    vector<thread> threads;
+    for (unsigned int i = 0; i < a.size(); i++) {
+        for (Channel_Mux *m : {&a, &b}) {
+            Mux_Channel *out = &m->channel(i);
+            Mux_Channel *in = &(m == &a ? b : a).channel(i);
+            unsigned int seed = 2*i + (m == &a);
+            threads.push_back(thread([out, seed, &sizes]{
+                for (size_t k = 0; k < sizes.size(); k++) {
+                    out->write_message(pattern(sizes[k], seed + k));
+                }
+            }));
+            threads.push_back(thread([in, seed, &sizes]{
+                for (size_t k = 0; k < sizes.size(); k++) {
+                    assert(in->read_message() == pattern(sizes[k], seed + k));
+                }
+            }));
+        }
+    }
+    for (thread &t : threads) {
+        t.join();
+    }
+    close_muxes(a, b);
+    
+    cout << " passed" << endl;
+}
+
+static void test_mux_credit()
+{
+    cout << "Test multiplexed flow control ..." << flush;
+    
+    auto ends = Local_Channel::create_pair();
+    Channel_Mux a(*ends.first, 2), b(*ends.second, 2);
+    
+    // messages larger than the window, or than the credit left, only go
+    // through if the reader gives credit back while it reads them
+    thread writer([&a]{
+        a.channel(0).write_message(pattern(2000000, 1));
+        a.channel(1).write_message(pattern(400000, 2));
+        a.channel(1).write_message(pattern(800000, 3));
+        a.channel(0).write_message(pattern(3*MUX_WINDOW, 4));
+    });
+    assert(b.channel(0).read_message() == pattern(2000000, 1));
+    assert(b.channel(1).read_message() == pattern(400000, 2));
+    assert(b.channel(1).read_message() == pattern(800000, 3));
+    assert(b.channel(0).read_message() == pattern(3*MUX_WINDOW, 4));
+    writer.join();
+    close_muxes(a, b);
+    
+    cout << " passed" << endl;
+}
+
+static void test_mux_close()
+{
+    cout << "Test multiplexed channel close ..." << flush;
+    
+    auto ends = Local_Channel::create_pair();
+    {
+        Channel_Mux a(*ends.first, 3), b(*ends.second, 3);
+        thread writer([&a]{
+            for (unsigned int i = 0; i < a.size(); i++) {
+                a.channel(i).write_message(pattern(1000, i));
+            }
+        });
+        for (unsigned int i = 0; i < b.size(); i++) {
+            assert(b.channel(i).read_message() == pattern(1000, i));
+        }
+        writer.join();
+        close_muxes(a, b);
+        
+        // nothing goes through a closed mux
+        bool failed = false;
+        try {
+            b.channel(0).read_message();
+        } catch (runtime_error &e) {
+            failed = true;
+        }
+        assert(failed);
+    }
+    
+    // the channel is back to plain messages, in both directions
+    ends.first->write_message(pattern(100, 1));
+    ends.second->write_message(pattern(200, 2));
+    assert(ends.second->read_message() == pattern(100, 1));
+    assert(ends.first->read_message() == pattern(200, 2));
+    
+    // and can be multiplexed again
+    {
+        Channel_Mux a(*ends.first, 1), b(*ends.second, 1);
+        a.channel(0).write_message(pattern(10, 3));
+        assert(b.channel(0).read_message() == pattern(10, 3));
+        close_muxes(a, b);
+    }
+    
+    cout << " passed" << endl;
+}
+
+static void test_mux_failure()
+{
+    cout << "Test multiplexed channel failure ..." << flush;
+    
+    // the peer goes away in the middle of a message
+    {
+        auto ends = Local_Channel::create_pair();
+        Channel_Mux a(*ends.first, 2);
+        
+        vector<byte> frame(MUX_HEADER_SIZE + 5);
+        encode_mux_header(&frame[0], 0, 5);
+        ends.second->write(&frame[0], frame.size());
+        ends.second->close();
+        
+        unsigned char buf[10];
+        bool failed = false;
+        try {
+            a.channel(0).read(buf, sizeof(buf));
+        } catch (runtime_error &e) {
+            failed = true;
+        }
+        assert(failed);
+        
+        // the other channels fail too
+        failed = false;
+        try {
+            a.channel(1).read(buf, 1);
+        } catch (runtime_error &e) {
+            failed = true;
+        }
+        assert(failed);
+        failed = false;
+        try {
+            a.channel(1).write(buf, sizeof(buf));
+        } catch (runtime_error &e) {
+            failed = true;
+        }
+        assert(failed);
+    }
+    
+    // the peer sends more than its credit: nothing is read on our side, the
+    // mux fails instead of buffering the whole stream
+    {
+        auto ends = Local_Channel::create_pair();
+        Channel_Mux a(*ends.first, 1);
+        
+        vector<byte> frame(MUX_HEADER_SIZE + MUX_MAX_FRAME);
+        encode_mux_header(&frame[0], 0, MUX_MAX_FRAME);
+        for (size_t sent = 0; sent <= MUX_WINDOW; sent += MUX_MAX_FRAME) {
+            ends.second->write(&frame[0], frame.size());
+        }
+        
+        bool failed = false;
+        try {
+            a.close();
+        } catch (runtime_error &e) {
+            failed = true;
+        }
+        assert(failed);
+    }
+    
+    cout << " passed" << endl;
+}
+
+static void test_local_comparison(unsigned int l = 64)
+{
+    cout << "Test comparisons over a local channel ..." << flush;
+    
+    gmp_randstate_t owner_state, helper_state;
+    gmp_randinit_default(owner_state);
+    gmp_randseed_ui(owner_state,time(NULL));
+    gmp_randinit_default(helper_state);
+    gmp_randseed_ui(helper_state,time(NULL)+1);
+    
+    Paillier_priv_fast pp(Paillier_priv_fast::keygen(helper_state,1024),helper_state);
+    Paillier p(pp.pubkey(),owner_state);
+    GM_priv gm_priv(GM_priv::keygen(helper_state),helper_state);
+    GM gm(gm_priv.pubkey(),owner_state);
+    
+    auto ends = Local_Channel::create_pair();
+    Channel &owner_channel = *ends.first, &helper_channel = *ends.second;
+    OTExtension owner_ot(owner_channel), helper_ot(helper_channel);
+    
+    // one comparison with each protocol, both orders of the inputs
+    for (int garbled = 0; garbled < 2; garbled++) {
+        for (int k = 0; k < 2; k++) {
+            mpz_class a, b;
+            mpz_urandomb(a.get_mpz_t(),owner_state,l);
+            mpz_urandomb(b.get_mpz_t(),owner_state,l);
+            if ((a <= b) != (k == 0)) {
+                swap(a, b);
+            }
+            
+            Comparison_protocol_A *comparator_a;
+            Comparison_protocol_B *comparator_b;
+            if (garbled) {
+                comparator_a = new GC_Compare_A(0,l,gm,owner_state,&owner_ot);
+                comparator_b = new GC_Compare_B(0,l,gm_priv,helper_state,&helper_ot);
+            }else{
+                comparator_a = new LSIC_A(0,l,gm);
+                comparator_b = new LSIC_B(0,l,gm_priv);
+            }
+            Rev_EncCompare_Owner owner(0,0,l,p,comparator_a,owner_state);
+            owner.set_input(p.encrypt(a),p.encrypt(b));
+            Rev_EncCompare_Helper helper(l,pp,comparator_b);
+            
+            thread helper_thread([&]{ exec_rev_enc_comparison_helper(helper_channel, helper, true); });
+            exec_rev_enc_comparison_owner(owner_channel, owner, 100, true);
+            helper_thread.join();
+            
+            assert(helper.output() == (a <= b));
+        }
+    }
+    
+    gmp_randclear(owner_state);
+    gmp_randclear(helper_state);
+    
+    cout << " passed" << endl;
+}
+
+static void test_multiplexed_comparison(size_t n = 20, unsigned int l = 64)
+{
+    cout << "Test multiplexed comparisons over a local channel ..." << flush;
+    
+    gmp_randstate_t owner_state, helper_state;
+    gmp_randinit_default(owner_state);
+    gmp_randseed_ui(owner_state,time(NULL));
+    gmp_randinit_default(helper_state);
+    gmp_randseed_ui(helper_state,time(NULL)+1);
+    
+    Paillier_priv_fast pp(Paillier_priv_fast::keygen(helper_state,1024),helper_state);
+    Paillier p(pp.pubkey(),owner_state);
+    GM_priv gm_priv(GM_priv::keygen(helper_state),helper_state);
+    GM gm(gm_priv.pubkey(),owner_state);
+    
+    auto ends = Local_Channel::create_pair();
+    Channel &owner_channel = *ends.first, &helper_channel = *ends.second;
+    
+    vector<mpz_class> a(n), b(n);
+    vector<Rev_EncCompare_Owner*> owners(n);
+    vector<Rev_EncCompare_Helper*> helpers(n);
+    for (size_t i = 0; i < n; i++) {
+        mpz_urandomb(a[i].get_mpz_t(),owner_state,l);
+        mpz_urandomb(b[i].get_mpz_t(),owner_state,l);
+        owners[i] = new Rev_EncCompare_Owner(0,0,l,p,new LSIC_A(0,l,gm),owner_state);
+        owners[i]->set_input(p.encrypt(a[i]),p.encrypt(b[i]));
+        helpers[i] = new Rev_EncCompare_Helper(l,pp,new LSIC_B(0,l,gm_priv));
+    }
+    
+    thread helper_thread([&]{ multiple_exec_rev_enc_comparison_helper(helper_channel, helpers, true, 1); });
+    multiple_exec_rev_enc_comparison_owner(owner_channel, owners, 100, true, 1);
+    helper_thread.join();
+    
+    for (size_t i = 0; i < n; i++) {
+        assert(helpers[i]->output() == (a[i] <= b[i]));
+        delete owners[i];
+        delete helpers[i];
+    }
+    
+    // the session goes on unmultiplexed
+    sendIntToSocket(owner_channel, a[0]);
+    assert(readIntFromSocket(helper_channel) == a[0]);
+    
+    gmp_randclear(owner_state);
+    gmp_randclear(helper_state);
+    
+    cout << " passed" << endl;
+}
+
+// a new empty directory
+static string make_temp_dir()
+{
+    char path[] = "/tmp/test_net.XXXXXX";
+    assert(mkdtemp(path) != NULL);
+    return path;
+}
+
+static void remove_dir(const string &dir)
+{
+    DIR *d = opendir(dir.c_str());
+    assert(d != NULL);
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        string file = entry->d_name;
+        if (file != "." && file != "..") {
+            unlink((dir + "/" + file).c_str());
+        }
+    }
+    closedir(d);
+    rmdir(dir.c_str());
+}
+
+static void test_base_ot_seed()
+{
+    cout << "Test base OT random state ..." << flush;
+    
+    // an unseeded state would draw the same exponents in every process
+    gmp_randstate_t unseeded;
+    gmp_randinit_mt(unseeded);
+    mpz_class a, b;
+    mpz_urandomb(a.get_mpz_t(), unseeded, 256);
+    mpz_urandomb(b.get_mpz_t(), ObliviousTransfer::m_NPState.rnd_state, 256);
+    assert(a != b);
+    gmp_randclear(unseeded);
+    
+    cout << " passed" << endl;
+}
+
+static void test_key_store()
+{
+    cout << "Test key store ..." << flush;
+    
+    string dir = make_temp_dir();
+    Key_Store store(dir);
+    vector<mpz_class> sk = {12345, 0, mpz_class("123456789012345678901234567890")}, sk2 = {6789}, loaded;
+    
+    assert(!store.load_key("paillier", 1024, loaded));
+    assert(store.latest_version("paillier") == 0);
+    
+    assert(store.save_key("paillier", 1024, sk));
+    assert(store.latest_version("paillier") == 1);
+    assert(store.load_key("paillier", 1024, loaded) && loaded == sk);
+    // keys of another size or name are not used
+    assert(!store.load_key("paillier", 2048, loaded));
+    assert(!store.load_key("gm", 1024, loaded));
+    
+    // a truncated or corrupt latest version falls back to the previous one
+    assert(store.save_key("paillier", 1024, sk2));
+    assert(store.latest_version("paillier") == 2);
+    assert(store.load_key("paillier", 1024, loaded) && loaded == sk2);
+    string latest = dir + "/paillier.2";
+    assert(truncate(latest.c_str(), 20) == 0);
+    assert(store.load_key("paillier", 1024, loaded) && loaded == sk);
+    FILE *f = fopen(latest.c_str(), "wb");
+    assert(f != NULL);
+    fputs("not a key", f);
+    fclose(f);
+    assert(store.load_key("paillier", 1024, loaded) && loaded == sk);
+    
+    // only the two latest versions are kept
+    assert(store.save_key("paillier", 1024, sk2));
+    assert(store.latest_version("paillier") == 3);
+    assert(access((dir + "/paillier.1").c_str(), F_OK) != 0);
+    assert(store.load_key("paillier", 1024, loaded) && loaded == sk2);
+    
+    remove_dir(dir);
+    cout << " passed" << endl;
+}
+
+static void test_key_store_expiry()
+{
+    cout << "Test key store expiry ..." << flush;
+    
+    string dir = make_temp_dir();
+    shared_ptr<Key_Store> store = make_shared<Key_Store>(dir, 1);
+    Key_Store::set_default_store(store);
+    
+    unsigned int n_keygen = 0;
+    auto keygen = [&n_keygen]() { n_keygen++; return vector<mpz_class>(1, n_keygen); };
+    
+    assert(stored_key("gm", 512, keygen) == vector<mpz_class>(1, 1));
+    assert(stored_key("gm", 512, keygen) == vector<mpz_class>(1, 1));
+    assert(n_keygen == 1);
+    
+    // the expired key is replaced by a new version
+    sleep(2);
+    vector<mpz_class> loaded;
+    assert(!store->load_key("gm", 512, loaded));
+    assert(stored_key("gm", 512, keygen) == vector<mpz_class>(1, 2));
+    assert(n_keygen == 2 && store->latest_version("gm") == 2);
+    assert(stored_key("gm", 512, keygen) == vector<mpz_class>(1, 2));
+    assert(n_keygen == 2);
+    
+    Key_Store::set_default_store(shared_ptr<Key_Store>());
+    remove_dir(dir);
+    cout << " passed" << endl;
+}
+
+static void test_stored_key()
+{
+    cout << "Test stored keys ..." << flush;
+    
+    unsigned int n_keygen = 0;
+    auto keygen = [&n_keygen]() { n_keygen++; return vector<mpz_class>(1, n_keygen); };
+    
+    // without a store, every key is generated
+    Key_Store::set_default_store(shared_ptr<Key_Store>());
+    assert(stored_key("paillier", 1024, keygen) == vector<mpz_class>(1, 1));
+    assert(stored_key("paillier", 1024, keygen) == vector<mpz_class>(1, 2));
+    
+    // nor when the store cannot be written
+    Key_Store::set_default_store(make_shared<Key_Store>("/nonexistent/test_net"));
+    assert(stored_key("paillier", 1024, keygen) == vector<mpz_class>(1, 3));
+    assert(stored_key("paillier", 1024, keygen) == vector<mpz_class>(1, 4));
+    
+    // with a store, the first key is saved and used afterwards
+    string dir = make_temp_dir();
+    Key_Store::set_default_store(make_shared<Key_Store>(dir));
+    assert(stored_key("paillier", 1024, keygen) == vector<mpz_class>(1, 5));
+    assert(stored_key("paillier", 1024, keygen) == vector<mpz_class>(1, 5));
+    assert(stored_key("paillier", 2048, keygen) == vector<mpz_class>(1, 6));
+    assert(n_keygen == 6);
+    
+    Key_Store::set_default_store(shared_ptr<Key_Store>());
+    remove_dir(dir);
+    cout << " passed" << endl;
+}
+
+// name of the file of an entry in a Key_Cache directory
+static string key_cache_file(const string &dir, const string &digest)
+{
+    static const char hex[] = "0123456789abcdef";
+    string name;
+    for (unsigned char c : digest) {
+        name += hex[c >> 4];
+        name += hex[c & 0xF];
+    }
+    return dir + "/" + name + ".pk";
+}
+
+static void test_key_cache()
+{
+    cout << "Test key cache ..." << flush;
+    
+    vector<string> keys = {"key 0", "key 1", "key 2", "key 3"};
+    vector<string> digests;
+    for (const string &k : keys) {
+        digests.push_back(Key_Cache::digest(k));
+    }
+    assert(digests[0].size() == 32 && digests[0] != digests[1]);
+    
+    // in memory
+    Key_Cache cache("", 3);
+    string content;
+    assert(!cache.get(digests[0], content));
+    cache.put(digests[0], keys[0]);
+    assert(cache.get(digests[0], content) && content == keys[0]);
+    cache.put(digests[0], keys[0]);
+    assert(cache.size() == 1);
+    
+    // the oldest entry is evicted
+    for (size_t i = 1; i < keys.size(); i++) {
+        cache.put(digests[i], keys[i]);
+    }
+    assert(cache.size() == 3);
+    assert(!cache.get(digests[0], content));
+    for (size_t i = 1; i < keys.size(); i++) {
+        assert(cache.get(digests[i], content) && content == keys[i]);
+    }
+    
+    // on disk, the evicted entries and those of previous caches are read back
+    string dir = make_temp_dir();
+    {
+        Key_Cache disk_cache(dir, 1);
+        disk_cache.put(digests[0], keys[0]);
+        disk_cache.put(digests[1], keys[1]);
+        assert(disk_cache.size() == 1);
+        assert(disk_cache.get(digests[0], content) && content == keys[0]);
+    }
+    Key_Cache disk_cache(dir);
+    assert(disk_cache.size() == 0);
+    assert(disk_cache.get(digests[1], content) && content == keys[1]);
+    assert(disk_cache.size() == 1);
+    
+    // an entry that does not match its digest is rejected
+    FILE *f = fopen(key_cache_file(dir, digests[2]).c_str(), "wb");
+    assert(f != NULL);
+    fputs(keys[3].c_str(), f);
+    fclose(f);
+    assert(!disk_cache.get(digests[2], content));
+    assert(!Key_Cache(dir).get(digests[2], content));
+    
+    remove_dir(dir);
+    cout << " passed" << endl;
+}
+
+static Key_dependencies_descriptor exchange_key_deps()
+{
+    return Key_dependencies_descriptor(true,true,false,true,true,false);
+}
+
+class Exchange_Session : public Server_session {
+public:
+    Exchange_Session(Server *server, gmp_randstate_t state, tcp::socket &socket)
+    : Server_session(server,state,0,socket) {}
+    
+    void run_session() { exchange_keys(); }
+};
+
+class Exchange_Server : public Server {
+public:
+    Exchange_Server(gmp_randstate_t state, unsigned int keysize)
+    : Server(state,exchange_key_deps(),keysize,100) {}
+    
+    Server_session* create_new_server_session(tcp::socket &socket)
+    {
+        return new Exchange_Session(this,rand_state_,socket);
+    }
+};
+
+// runs the key exchange of a new session of server with client, returns
+// the bytes sent and received by the client
+static pair<uint64_t, uint64_t> run_key_exchange(boost::asio::io_service &io, Exchange_Server &server, Client &client)
+{
+    tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    client.socket().connect(acceptor.local_endpoint());
+    tcp::socket socket(io);
+    acceptor.accept(socket);
+    unique_ptr<Server_session> session(server.create_new_server_session(socket));
+    
+    uint64_t sent = client.metrics().bytes_sent(), received = client.metrics().bytes_received();
+    thread server_thread([&session]{
+        Session_Metrics::Binding binding(session->metrics());
+        session->run_session();
+    });
+    {
+        Session_Metrics::Binding binding(client.metrics());
+        client.exchange_keys();
+    }
+    server_thread.join();
+    
+    client.socket().close();
+    return make_pair(client.metrics().bytes_sent() - sent, client.metrics().bytes_received() - received);
+}
+
+static void test_key_exchange(unsigned int keysize = 1024)
+{
+    cout << "Test key exchange by digests ..." << flush;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    // a returning client has the same keys: they are kept in a store
+    string dir = make_temp_dir();
+    Key_Store::set_default_store(make_shared<Key_Store>(dir));
+    shared_ptr<Key_Cache> client_cache = make_shared<Key_Cache>();
+    
+    boost::asio::io_service io;
+    Exchange_Server server(randstate,keysize);
+    size_t server_material = 0;
+    for (const string &m : server.key_material()) {
+        server_material += m.size();
+    }
+    
+    // the first time, all the keys are sent
+    Client client(io,randstate,exchange_key_deps(),keysize,100);
+    client.set_key_cache(client_cache);
+    pair<uint64_t, uint64_t> first = run_key_exchange(io, server, client);
+    assert(client.has_gm_pk() && client.has_paillier_pk());
+    assert(first.second > server_material);
+    assert(client_cache->size() == server.key_material().size());
+    
+    // then only their digests
+    Client returning(io,randstate,exchange_key_deps(),keysize,100);
+    returning.set_key_cache(client_cache);
+    pair<uint64_t, uint64_t> second = run_key_exchange(io, server, returning);
+    assert(returning.has_gm_pk() && returning.has_paillier_pk());
+    assert(returning.gm_pk() == client.gm_pk());
+    assert(second.first < first.first/2 && second.second < server_material/2);
+    
+    Key_Store::set_default_store(shared_ptr<Key_Store>());
+    remove_dir(dir);
+    gmp_randclear(randstate);
+    cout << " passed" << endl;
+}
+
+class Query_Session : public Server_session {
+public:
+    Query_Session(Server *server, gmp_randstate_t state, tcp::socket &socket, size_t min_query_size)
+    : Server_session(server,state,0,socket), rejected(false), min_query_size_(min_query_size) {}
+    
+    void run_session()
+    {
+        vector<vector<mpz_class> > queries;
+        try {
+            while (read_query_batch(queries, min_query_size_) > 0) {
+                batches.push_back(queries.size());
+            }
+        } catch (const runtime_error &) {
+            rejected = true;
+        }
+    }
+    
+    vector<size_t> batches;
+    bool rejected;
+    
+protected:
+    size_t min_query_size_;
+};
+
+// sends the batches of queries of the given sizes to a new session
+static void send_query_batches(Exchange_Server &server, gmp_randstate_t state, const vector<vector<size_t> > &batches, Query_Session **result)
+{
+    boost::asio::io_service io;
+    tcp::socket client_socket(io), server_socket(io);
+    tcp_pair(io, client_socket, server_socket);
+    TCP_Channel channel(client_socket);
+    Query_Session *session = new Query_Session(&server,state,server_socket,3);
+    
+    thread server_thread([session]{ session->run_session(); });
+    for (size_t b = 0; b < batches.size(); b++) {
+        sendIntToSocket(channel, batches[b].size());
+        for (size_t q = 0; q < batches[b].size(); q++) {
+            send_int_array_to_socket(channel, vector<mpz_class>(batches[b][q], 1));
+        }
+    }
+    server_thread.join();
+    *result = session;
+}
+
+static void test_query_batch(unsigned int keysize = 1024)
+{
+    cout << "Test query batches ..." << flush;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    Exchange_Server server(randstate,keysize);
+    server.set_max_query_batch(4);
+    
+    // two batches, then an empty one ends the session
+    Query_Session *session;
+    send_query_batches(server, randstate, {{3, 5}, {3, 3, 3, 3}, {}}, &session);
+    assert(!session->rejected);
+    assert(session->batches == vector<size_t>({2, 4}));
+    delete session;
+    
+    // too many queries
+    send_query_batches(server, randstate, {{3}, {3, 3, 3, 3, 3}}, &session);
+    assert(session->rejected && session->batches.size() == 1);
+    delete session;
+    
+    // a query without the features of the model
+    send_query_batches(server, randstate, {{3, 2}}, &session);
+    assert(session->rejected && session->batches.empty());
+    delete session;
+    
+    gmp_randclear(randstate);
+    cout << " passed" << endl;
+}
+
+static void test_pipelined_comparison(size_t n = 200, unsigned int l = 64)
+{
+    cout << "Test pipelined comparisons ..." << flush;
+    
+    gmp_randstate_t owner_state, helper_state;
+    gmp_randinit_default(owner_state);
+    gmp_randseed_ui(owner_state,time(NULL));
+    gmp_randinit_default(helper_state);
+    gmp_randseed_ui(helper_state,time(NULL)+1);
+    
+    Paillier_priv_fast pp(Paillier_priv_fast::keygen(helper_state,1024),helper_state);
+    Paillier p(pp.pubkey(),owner_state);
+    GM_priv gm_priv(GM_priv::keygen(helper_state),helper_state);
+    GM gm(gm_priv.pubkey(),owner_state);
+    
+    // a real connection with small buffers: the parties block on their
+    // writes as soon as a few comparisons are in flight
+    boost::asio::io_service io;
+    tcp::socket owner_socket(io), helper_socket(io);
+    tcp_pair(io, owner_socket, helper_socket, 4*1024);
+    TCP_Channel owner_channel(owner_socket), helper_channel(helper_socket);
+    OTExtension owner_ot(owner_channel), helper_ot(helper_channel);
+    
+    vector<mpz_class> a(n), b(n);
+    vector<Rev_EncCompare_Owner*> owners(n);
+    vector<Rev_EncCompare_Helper*> helpers(n);
+    for (size_t i = 0; i < n; i++) {
+        mpz_urandomb(a[i].get_mpz_t(),owner_state,l);
+        mpz_urandomb(b[i].get_mpz_t(),owner_state,l);
+        owners[i] = new Rev_EncCompare_Owner(0,0,l,p,new GC_Compare_A(0,l,gm,owner_state,&owner_ot),owner_state);
+        owners[i]->set_input(p.encrypt(a[i]),p.encrypt(b[i]));
+        helpers[i] = new Rev_EncCompare_Helper(l,pp,new GC_Compare_B(0,l,gm_priv,helper_state,&helper_ot));
+    }
+    
+    // the whole batch in flight, far more than the socket buffers hold
+    thread helper_thread([&]{ exec_rev_enc_comparison_helper_pipelined(helper_channel, helpers, true); });
+    exec_rev_enc_comparison_owner_pipelined(owner_channel, owners, 100, n, true);
+    helper_thread.join();
+    
+    for (size_t i = 0; i < n; i++) {
+        assert(helpers[i]->output() == (a[i] <= b[i]));
+        delete owners[i];
+        delete helpers[i];
+    }
+    
+    gmp_randclear(owner_state);
+    gmp_randclear(helper_state);
+    
+    cout << " passed" << endl;
+}
+
+static Protobuf::Pipelined_Compare_Message bad_pipelined_message(Protobuf::Pipelined_Compare_Message::Message_Type type, size_t tag, size_t data_size = 0)
+{
+    Protobuf::Pipelined_Compare_Message message;
+    message.set_type(type);
+    message.set_tag(tag);
+    *message.mutable_value() = convert_to_message(mpz_class(0));
+    if (data_size > 0) {
+        message.set_data(string(data_size, 0));
+    }
+    return message;
+}
+
+static void test_pipelined_rejection(size_t n = 2, unsigned int l = 16)
+{
+    cout << "Test pipelined comparisons rejecting unexpected messages ..." << flush;
+    
+    gmp_randstate_t owner_state, helper_state;
+    gmp_randinit_default(owner_state);
+    gmp_randseed_ui(owner_state,time(NULL));
+    gmp_randinit_default(helper_state);
+    gmp_randseed_ui(helper_state,time(NULL)+1);
+    
+    Paillier_priv_fast pp(Paillier_priv_fast::keygen(helper_state,1024),helper_state);
+    Paillier p(pp.pubkey(),owner_state);
+    GM_priv gm_priv(GM_priv::keygen(helper_state),helper_state);
+    GM gm(gm_priv.pubkey(),owner_state);
+    
+    // the helper: a request before its setup, a tag out of range, a result
+    // for a comparison that was never answered
+    vector<Protobuf::Pipelined_Compare_Message> to_helper = {
+        bad_pipelined_message(Protobuf::Pipelined_Compare_Message::OT_REQUEST, 0, OTExtension::request_size(l)),
+        bad_pipelined_message(Protobuf::Pipelined_Compare_Message::SETUP, n),
+        bad_pipelined_message(Protobuf::Pipelined_Compare_Message::RESULT, 0)
+    };
+    for (size_t k = 0; k < to_helper.size(); k++) {
+        auto ends = Local_Channel::create_pair();
+        OTExtension owner_ot(*ends.first), helper_ot(*ends.second);
+        vector<Rev_EncCompare_Helper*> helpers(n);
+        for (size_t i = 0; i < n; i++) {
+            helpers[i] = new Rev_EncCompare_Helper(l,pp,new GC_Compare_B(0,l,gm_priv,helper_state,&helper_ot));
+        }
+        
+        bool rejected = false;
+        thread helper_thread([&]{
+            try {
+                exec_rev_enc_comparison_helper_pipelined(*ends.second, helpers, true);
+            } catch (const runtime_error &) {
+                rejected = true;
+            }
+        });
+        owner_ot.prepare_receiver();
+        sendMessageToSocket(*ends.first, to_helper[k]);
+        helper_thread.join();
+        assert(rejected);
+        
+        for (size_t i = 0; i < n; i++) {
+            delete helpers[i];
+        }
+    }
+    
+    // the owner: a response for a comparison that was never garbled, a tag
+    // that was never set up, a garbled circuit of the wrong size, a message
+    // only the owner sends
+    vector<Protobuf::Pipelined_Compare_Message> to_owner = {
+        bad_pipelined_message(Protobuf::Pipelined_Compare_Message::OT_RESPONSE, 0, OTExtension::response_size(l, sizeof(block))),
+        bad_pipelined_message(Protobuf::Pipelined_Compare_Message::GARBLED, n),
+        bad_pipelined_message(Protobuf::Pipelined_Compare_Message::GARBLED, 0, 1),
+        bad_pipelined_message(Protobuf::Pipelined_Compare_Message::SETUP, 0)
+    };
+    for (size_t k = 0; k < to_owner.size(); k++) {
+        auto ends = Local_Channel::create_pair();
+        OTExtension owner_ot(*ends.first), helper_ot(*ends.second);
+        vector<Rev_EncCompare_Owner*> owners(n);
+        for (size_t i = 0; i < n; i++) {
+            owners[i] = new Rev_EncCompare_Owner(0,0,l,p,new GC_Compare_A(0,l,gm,owner_state,&owner_ot),owner_state);
+            owners[i]->set_input(p.encrypt(i),p.encrypt(1));
+        }
+        
+        bool rejected = false;
+        thread owner_thread([&]{
+            try {
+                exec_rev_enc_comparison_owner_pipelined(*ends.first, owners, 100, n, true);
+            } catch (const runtime_error &) {
+                rejected = true;
+            }
+        });
+        helper_ot.prepare_sender();
+        for (size_t i = 0; i < n; i++) {
+            readMessageFromSocket<Protobuf::Pipelined_Compare_Message>(*ends.second);
+        }
+        sendMessageToSocket(*ends.second, to_owner[k]);
+        owner_thread.join();
+        assert(rejected);
+        
+        for (size_t i = 0; i < n; i++) {
+            delete owners[i];
+        }
+    }
+    
+    gmp_randclear(owner_state);
+    gmp_randclear(helper_state);
+    
+    cout << " passed" << endl;
+}
+
+int
+main(int ac, char **av)
+{
+    SetSeed(to_ZZ(time(NULL)));
+    ObliviousTransfer::init(OT_SECPARAM);
+    
+    test_base_ot_seed();
+    test_key_store();
+    test_key_store_expiry();
+    test_stored_key();
+    test_key_cache();
+    test_key_exchange();
+    test_query_batch();
+    test_mux_framing();
+    test_mux_credit();
+    test_mux_close();
+    test_mux_failure();
+    test_local_comparison();
+    test_multiplexed_comparison();
+    test_pipelined_comparison();
+    test_pipelined_rejection();
+    
+    return 0;
+}
@@ -182,6 +182,16 @@ Paillier* create_from_pk_message(const Protobuf::Paillier_PK &m_pk, gmp_randstat
     return new Paillier({n,g},state);
 }
 
+DGK* create_from_pk_message(const Protobuf::DGK_PK &m_pk)
+{
+    mpz_class n(convert_from_message(m_pk.n()));
+    mpz_class g(convert_from_message(m_pk.g()));
+    mpz_class h(convert_from_message(m_pk.h()));
+    mpz_class u(convert_from_message(m_pk.u()));
+
+    return new DGK({n,g,h,u,m_pk.t()});
+}
+
 
 Protobuf::GM_PK get_pk_message(const GM *gm)
 {
@@ -205,6 +215,20 @@ Protobuf::Paillier_PK get_pk_message(const Paillier *paillier)
     return pk_message;
 }
 
+Protobuf::DGK_PK get_pk_message(const DGK *dgk)
+{
+    std::vector<mpz_class> pk = dgk->pubkey();
+    Protobuf::DGK_PK pk_message;
+    
+    *(pk_message.mutable_n()) = convert_to_message(pk[0]);
+    *(pk_message.mutable_g()) = convert_to_message(pk[1]);
+    *(pk_message.mutable_h()) = convert_to_message(pk[2]);
+    *(pk_message.mutable_u()) = convert_to_message(pk[3]);
+    pk_message.set_t(pk[4].get_ui());
+    
+    return pk_message;
+}
+
 FHEPubKey* create_from_pk_message(const Protobuf::FHE_PK &m_pk, const FHEcontext &fhe_context)
 {
     FHEPubKey *fhe_pk = new FHEPubKey(fhe_context);
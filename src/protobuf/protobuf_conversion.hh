@@ -6,6 +6,7 @@
 
 #include <crypto/gm.hh>
 #include <crypto/paillier.hh>
+#include <crypto/dgk.hh>
 #include <mpc/lsic.hh>
 
 #include <FHE.h>
@@ -35,13 +36,15 @@ mpz_class convert_from_message(const Protobuf::Enc_Compare_Setup_Message &m);
 Protobuf::Enc_Compare_Setup_Message convert_to_message_partial(const mpz_class &c_z);
 Protobuf::Enc_Compare_Setup_Message convert_to_message(const mpz_class &c_z, size_t bit_length);
 
-/* GM and Paillier key exchanges */
+/* GM, Paillier and DGK key exchanges */
 
 GM* create_from_pk_message(const Protobuf::GM_PK &m_pk, gmp_randstate_t state);
 Paillier* create_from_pk_message(const Protobuf::Paillier_PK &m_pk, gmp_randstate_t state);
+DGK* create_from_pk_message(const Protobuf::DGK_PK &m_pk);
 
 Protobuf::GM_PK get_pk_message(const GM *gm);
 Protobuf::Paillier_PK get_pk_message(const Paillier *paillier);
+Protobuf::DGK_PK get_pk_message(const DGK *dgk);
 
 /* FHE context, key and cyphertext */
 
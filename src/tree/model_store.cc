@@ -0,0 +1,425 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <tree/model_store.hh>
+#include <tree/util_poly.hh>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define COMPILED_FOREST_MAGIC "CMFOR\0\0\1" // the last byte is the version
+
+Compiled_Forest compile_forest(const vector<Node<long>* > &trees, unsigned int n_classes, const vector<unsigned int> &n_variables,
+                               const vector<vector<pair <long,long> > > &criteria, size_t n_slots, bool slot_packing)
+{
+    assert(n_classes > 0 && n_classes <= n_slots);
+    assert(n_variables.size() == trees.size() && criteria.size() == trees.size());
+
+    Compiled_Forest f;
+    f.n_classes = n_classes;
+    f.n_slots = n_slots;
+    f.slot_packing = slot_packing;
+    f.n_variables = n_variables;
+    f.criteria = criteria;
+
+    f.tree_polys = vector<Multivariate_poly< vector<long> > >(trees.size());
+    for(size_t tj = 0; tj < trees.size(); ++tj) {
+        f.tree_polys[tj] = trees[tj]->to_polynomial_with_slots(n_slots);
+        f.tree_polys[tj] = mergeRegroup(f.tree_polys[tj]);
+    }
+
+    // the leaves only set the first n_classes slots: move each tree to its own lane
+    f.trees_per_ciphertext = slot_packing ? n_slots/n_classes : 1;
+    for (size_t first = 0; first < trees.size(); first += f.trees_per_ciphertext) {
+        Multivariate_poly< vector<long> > poly;
+        unsigned int n_vars = 0;
+        for (size_t k = 0; k < f.trees_per_ciphertext && first + k < trees.size(); ++k) {
+            if (slot_packing) {
+                poly += shiftSlots(f.tree_polys[first + k], n_classes, k*n_classes, n_slots);
+            }else{
+                poly += f.tree_polys[first + k];
+            }
+            n_vars = max(n_vars, n_variables[first + k]);
+        }
+        f.packed_polys.push_back(mergeRegroup(poly));
+        f.packed_n_variables.push_back(n_vars);
+    }
+
+    return f;
+}
+
+/*
+ * Binary format: the magic string, then 64 bits words in host byte order
+ *
+ *   n_classes n_slots slot_packing trees_per_ciphertext n_trees n_ciphertexts
+ *   for each tree: n_variables, then (feature, threshold) for each variable
+ *   for each tree, then each ciphertext, a polynomial:
+ *       n_terms, then for each term: degree, the variables, n_slots coefficients
+ *   packed_n_variables for each ciphertext
+ */
+
+static void write_word(FILE *f, int64_t w)
+{
+    fwrite(&w, sizeof(w), 1, f);
+}
+
+static void write_poly(FILE *f, const Multivariate_poly< vector<long> > &p, size_t n_slots)
+{
+    write_word(f, p.termsCount());
+    for (const Term< vector<long> > &t : p.terms()) {
+        assert(t.coefficient().size() == n_slots);
+        write_word(f, t.degree());
+        for (size_t v : t.variables()) {
+            write_word(f, v);
+        }
+        for (long c : t.coefficient()) {
+            write_word(f, c);
+        }
+    }
+}
+
+bool save_compiled_forest(const Compiled_Forest &forest, const string &path)
+{
+    string tmp_path = path + ".tmp";
+    FILE *f = fopen(tmp_path.c_str(), "wb");
+    if (f == NULL) {
+        return false;
+    }
+
+    fwrite(COMPILED_FOREST_MAGIC, 1, sizeof(COMPILED_FOREST_MAGIC) - 1, f);
+    write_word(f, forest.n_classes);
+    write_word(f, forest.n_slots);
+    write_word(f, forest.slot_packing);
+    write_word(f, forest.trees_per_ciphertext);
+    write_word(f, forest.n_trees());
+    write_word(f, forest.packed_polys.size());
+
+    for (size_t tj = 0; tj < forest.n_trees(); ++tj) {
+        write_word(f, forest.n_variables[tj]);
+        for (size_t i = 0; i < forest.n_variables[tj]; ++i) {
+            write_word(f, forest.criteria[tj][i].first);
+            write_word(f, forest.criteria[tj][i].second);
+        }
+    }
+    for (const Multivariate_poly< vector<long> > &p : forest.tree_polys) {
+        write_poly(f, p, forest.n_slots);
+    }
+    for (const Multivariate_poly< vector<long> > &p : forest.packed_polys) {
+        write_poly(f, p, forest.n_slots);
+    }
+    for (unsigned int n : forest.packed_n_variables) {
+        write_word(f, n);
+    }
+
+    bool ok = (ferror(f) == 0);
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// bounds checked reads in the mapped file
+class Mapped_Reader {
+public:
+    Mapped_Reader(const char *data, size_t size) : data_(data), size_(size), pos_(0), ok_(true) {}
+
+    bool ok() const { return ok_; }
+    bool at_end() const { return pos_ == size_; }
+
+    bool skip_magic()
+    {
+        size_t len = sizeof(COMPILED_FOREST_MAGIC) - 1;
+        ok_ = ok_ && size_ >= len && memcmp(data_, COMPILED_FOREST_MAGIC, len) == 0;
+        pos_ = len;
+        return ok_;
+    }
+
+    int64_t word()
+    {
+        int64_t w = 0;
+        if (!ok_ || size_ - pos_ < sizeof(w)) {
+            ok_ = false;
+            return 0;
+        }
+        memcpy(&w, data_ + pos_, sizeof(w));
+        pos_ += sizeof(w);
+        return w;
+    }
+
+    // a count of items of at least item_words words each, checked against the file size
+    size_t count(size_t item_words)
+    {
+        int64_t n = word();
+        if (n < 0 || (uint64_t)n > (size_ - pos_)/(item_words*sizeof(int64_t))) {
+            ok_ = false;
+            return 0;
+        }
+        return n;
+    }
+
+private:
+    const char *data_;
+    size_t size_;
+    size_t pos_;
+    bool ok_;
+};
+
+static bool read_poly(Mapped_Reader &r, size_t n_slots, Multivariate_poly< vector<long> > &p)
+{
+    size_t n_terms = r.count(1 + n_slots);
+    vector<Term< vector<long> > > terms;
+    terms.reserve(n_terms);
+    for (size_t k = 0; k < n_terms && r.ok(); ++k) {
+        size_t degree = r.count(1);
+        vector<size_t> vars(degree);
+        for (size_t i = 0; i < degree; ++i) {
+            vars[i] = r.word();
+        }
+        vector<long> coeffs(n_slots);
+        for (size_t s = 0; s < n_slots; ++s) {
+            coeffs[s] = r.word();
+        }
+        terms.push_back(Term< vector<long> >(coeffs, vars));
+    }
+    p = Multivariate_poly< vector<long> >(terms);
+    return r.ok();
+}
+
+// every variable of p is below n_variables
+static bool check_poly_variables(const Multivariate_poly< vector<long> > &p, size_t n_variables)
+{
+    for (const Term< vector<long> > &t : p.terms()) {
+        for (size_t v : t.variables()) {
+            if (v >= n_variables) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// the variables must match the criteria: the server indexes its comparisons
+// and conversions with them
+static bool check_variables(const Compiled_Forest &f)
+{
+    for (size_t tj = 0; tj < f.n_trees(); ++tj) {
+        if (f.n_variables[tj] < 1 || !check_poly_variables(f.tree_polys[tj], f.n_variables[tj])) {
+            return false;
+        }
+    }
+    for (size_t c = 0; c < f.packed_polys.size(); ++c) {
+        unsigned int n_vars = 0;
+        for (size_t tj = c*f.trees_per_ciphertext; tj < min<size_t>((c + 1)*f.trees_per_ciphertext, f.n_trees()); ++tj) {
+            n_vars = max(n_vars, f.n_variables[tj]);
+        }
+        if (f.packed_n_variables[c] != n_vars || !check_poly_variables(f.packed_polys[c], n_vars)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool load_compiled_forest(Compiled_Forest &forest, const string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    Compiled_Forest f;
+    Mapped_Reader r((const char *)data, size);
+    r.skip_magic();
+    f.n_classes = r.word();
+    f.n_slots = r.word();
+    f.slot_packing = r.word();
+    f.trees_per_ciphertext = r.word();
+    size_t n_trees = r.count(1);
+    size_t n_ctxts = r.count(1);
+    if (r.ok() && (f.n_classes == 0 || f.n_classes > f.n_slots || f.trees_per_ciphertext == 0
+                   || n_ctxts != (n_trees + f.trees_per_ciphertext - 1)/f.trees_per_ciphertext)) {
+        munmap(data, size);
+        return false;
+    }
+
+    f.n_variables = vector<unsigned int>(n_trees);
+    f.criteria = vector<vector<pair <long,long> > >(n_trees);
+    for (size_t tj = 0; tj < n_trees && r.ok(); ++tj) {
+        f.n_variables[tj] = r.count(2);
+        f.criteria[tj] = vector<pair <long,long> >(f.n_variables[tj]);
+        for (size_t i = 0; i < f.n_variables[tj]; ++i) {
+            f.criteria[tj][i].first = r.word();
+            f.criteria[tj][i].second = r.word();
+        }
+    }
+    f.tree_polys = vector<Multivariate_poly< vector<long> > >(n_trees);
+    for (size_t tj = 0; tj < n_trees && r.ok(); ++tj) {
+        read_poly(r, f.n_slots, f.tree_polys[tj]);
+    }
+    f.packed_polys = vector<Multivariate_poly< vector<long> > >(n_ctxts);
+    for (size_t c = 0; c < n_ctxts && r.ok(); ++c) {
+        read_poly(r, f.n_slots, f.packed_polys[c]);
+    }
+    f.packed_n_variables = vector<unsigned int>(n_ctxts);
+    for (size_t c = 0; c < n_ctxts; ++c) {
+        f.packed_n_variables[c] = r.word();
+    }
+
+    bool ok = r.ok() && r.at_end() && check_variables(f);
+    munmap(data, size);
+    if (ok) {
+        forest = f;
+    }
+    return ok;
+}
+
+// builds the subtree rooted at node, numbering the inner nodes in preorder
+static Tree<long>* build_tree(const vector<vector<long> > &nodes, size_t node, vector<pair <long,long> > &criteria)
+{
+    const vector<long> &n = nodes[node];
+    if (n[0] < 0) {
+        return new Leaf<long>(n[4]);
+    }
+    size_t index = criteria.size();
+    criteria.push_back(make_pair(n[2], n[3]));
+    Tree<long> *left = build_tree(nodes, n[0], criteria);
+    Tree<long> *right = build_tree(nodes, n[1], criteria);
+    return new Node<long>(index, left, right);
+}
+
+// checks that the nodes form a tree rooted at node 0
+static bool check_tree(const vector<vector<long> > &nodes, unsigned int n_classes)
+{
+    vector<bool> seen(nodes.size(), false);
+    vector<size_t> stack(1, 0);
+    while (!stack.empty()) {
+        size_t k = stack.back();
+        stack.pop_back();
+        if (seen[k]) {
+            return false;
+        }
+        seen[k] = true;
+        const vector<long> &n = nodes[k];
+        if (n[0] < 0) {
+            if (n[4] < 0 || n[4] >= (long)n_classes) {
+                return false;
+            }
+            continue;
+        }
+        if (n[1] < 0 || (size_t)n[0] >= nodes.size() || (size_t)n[1] >= nodes.size() || n[2] < 0) {
+            return false;
+        }
+        stack.push_back(n[0]);
+        stack.push_back(n[1]);
+    }
+    return true;
+}
+
+bool read_forest_text(const string &path, vector<Node<long>* > &trees, unsigned int &n_classes,
+                      vector<unsigned int> &n_variables, vector<vector<pair <long,long> > > &criteria)
+{
+    ifstream in(path.c_str());
+    if (!in) {
+        return false;
+    }
+
+    // skip the comments
+    stringstream content;
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] != '#') {
+            content << line << "\n";
+        }
+    }
+
+    string keyword;
+    size_t n_trees;
+    if (!(content >> keyword >> n_trees >> n_classes) || keyword != "forest" || n_classes == 0) {
+        return false;
+    }
+
+    vector<Node<long>* > t;
+    vector<unsigned int> n_vars;
+    vector<vector<pair <long,long> > > crit;
+    bool ok = true;
+    for (size_t tj = 0; tj < n_trees && ok; ++tj) {
+        size_t n_nodes;
+        if (!(content >> keyword >> n_nodes) || keyword != "tree" || n_nodes == 0) {
+            ok = false;
+            break;
+        }
+        vector<vector<long> > nodes(n_nodes, vector<long>(5));
+        for (size_t k = 0; k < n_nodes && ok; ++k) {
+            for (size_t j = 0; j < 5; ++j) {
+                ok = ok && (content >> nodes[k][j]);
+            }
+        }
+        if (!ok || !check_tree(nodes, n_classes)) {
+            ok = false;
+            break;
+        }
+
+        vector<pair <long,long> > c;
+        Tree<long> *root = build_tree(nodes, 0, c);
+        if (root->isLeaf()) {
+            // a tree without any split: both branches of a dummy node give its class
+            long value = static_cast<Leaf<long>*>(root)->value();
+            delete root;
+            root = new Node<long>(0, new Leaf<long>(value), new Leaf<long>(value));
+            c.push_back(make_pair(0L, 0L));
+        }
+        t.push_back(static_cast<Node<long>*>(root));
+        n_vars.push_back(c.size());
+        crit.push_back(c);
+    }
+
+    if (!ok) {
+        for (Node<long> *n : t) {
+            delete n;
+        }
+        return false;
+    }
+
+    trees = t;
+    n_variables = n_vars;
+    criteria = crit;
+    return true;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <tree/tree.hh>
+#include <tree/m_variate_poly.hh>
+
+using namespace std;
+
+/*
+ * A random forest compiled for a given number of FHE slots: the regrouped
+ * polynomial of every tree, the criteria of its nodes and the layout of the
+ * trees in the ciphertexts.
+ *
+ * Compiling large forests (to_polynomial_with_slots and mergeRegroup) takes
+ * much longer than reading the result back: servers load the compiled model
+ * from disk at startup (see the compile_forest tool).
+ */
+struct Compiled_Forest {
+    unsigned int n_classes;
+    unsigned int n_slots;
+    bool slot_packing;
+    // trees are split in lanes of n_classes slots with slot packing, 1 otherwise
+    unsigned int trees_per_ciphertext;
+
+    vector<unsigned int> n_variables;
+    vector<vector<pair <long,long> > > criteria; // (feature, threshold) for each node
+    vector<Multivariate_poly< vector<long> > > tree_polys;
+
+    // one polynomial per ciphertext and its number of variables (the maximum over its trees)
+    vector<Multivariate_poly< vector<long> > > packed_polys;
+    vector<unsigned int> packed_n_variables;
+
+    size_t n_trees() const { return tree_polys.size(); }
+};
+
+Compiled_Forest compile_forest(const vector<Node<long>* > &trees, unsigned int n_classes, const vector<unsigned int> &n_variables,
+                               const vector<vector<pair <long,long> > > &criteria, size_t n_slots, bool slot_packing);
+
+/* Binary store, mapped in memory when loading. save writes to a temporary
+ * file renamed afterwards, so that a server never reads a partial model.
+ * Both return false on I/O errors, load also if the file is not a compiled
+ * forest of this version or if its variables do not match its criteria. */
+bool save_compiled_forest(const Compiled_Forest &forest, const string &path);
+bool load_compiled_forest(Compiled_Forest &forest, const string &path);
+
+/* Text export of trained forests (see ml/forest.py):
+ *
+ *   forest <n_trees> <n_classes>
+ *   tree <n_nodes>
+ *   <left> <right> <feature> <threshold> <class>
+ *   ...
+ *
+ * one line per node, the root first. Children are node indices, -1 for the
+ * children of a leaf. A node goes left when its feature is at most the
+ * threshold. Lines starting with # are ignored.
+ * Returns false if the file cannot be read or is malformed.
+ */
+bool read_forest_text(const string &path, vector<Node<long>* > &trees, unsigned int &n_classes,
+                      vector<unsigned int> &n_variables, vector<vector<pair <long,long> > > &criteria);
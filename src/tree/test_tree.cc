@@ -22,11 +22,14 @@
 #include <iostream>
 #include <cassert>
 #include <cstdlib>
+#include <fstream>
+#include <unistd.h>
 
 #include <tree/tree.hh>
 #include <tree/m_variate_poly.hh>
 #include <tree/util.hh>
 #include <tree/util_poly.hh>
+#include <tree/model_store.hh>
 
 #include <FHE.h>
 #include <EncryptedArray.h>
@@ -89,6 +92,154 @@ static void test_poly()
 }
 
 
+// plaintext evaluation of a polynomial, slot by slot: vals[v][s] is the value of
+// variable v in slot s
+static vector<long> evalPoly_slots(const Multivariate_poly< vector<long> > &p, const vector< vector<long> > &vals, size_t n_slots)
+{
+    vector<long> res(n_slots, 0);
+    for (size_t i = 0; i < p.terms().size(); i++) {
+        const Term< vector<long> > &term = p.terms()[i];
+        for (size_t s = 0; s < n_slots; s++) {
+            long v = term.coefficient()[s];
+            for (size_t j = 0; j < term.variables().size(); j++) {
+                v *= vals[term.variables()[j]][s];
+            }
+            res[s] += v;
+        }
+    }
+    return res;
+}
+
+static void test_slot_packing()
+{
+    size_t n_slots = 10, n_classes = 3;
+    
+    // trees with different shapes and numbers of variables, 3 lanes per ciphertext
+    vector<Tree<long>*> trees;
+    trees.push_back(new Node<long>(0, new Leaf<long>(1), new Leaf<long>(2)));
+    trees.push_back(new Node<long>(0, new Node<long>(1, new Leaf<long>(0), new Leaf<long>(2)), new Leaf<long>(1)));
+    trees.push_back(new Node<long>(1, new Leaf<long>(2), new Node<long>(0, new Leaf<long>(1), new Leaf<long>(0))));
+    size_t n_vars = 2;
+    
+    Multivariate_poly< vector<long> > packed;
+    for (size_t k = 0; k < trees.size(); k++) {
+        packed += shiftSlots(trees[k]->to_polynomial_with_slots(n_slots), n_classes, k*n_classes, n_slots);
+    }
+    packed = mergeRegroup(packed);
+    
+    for (unsigned int x = 0; x < (1u << (n_vars*trees.size())); x++) {
+        // bits of tree k in lane k
+        vector< vector<bool> > b(trees.size(), vector<bool>(n_vars));
+        vector< vector<long> > vals(n_vars, vector<long>(n_slots, 0));
+        for (size_t k = 0; k < trees.size(); k++) {
+            for (size_t v = 0; v < n_vars; v++) {
+                b[k][v] = (x >> (k*n_vars + v)) & 1;
+                for (size_t s = k*n_classes; s < (k+1)*n_classes; s++) {
+                    vals[v][s] = b[k][v];
+                }
+            }
+        }
+        
+        vector<long> res = evalPoly_slots(packed, vals, n_slots);
+        for (size_t k = 0; k < trees.size(); k++) {
+            vector<long> lane(res.begin() + k*n_classes, res.begin() + (k+1)*n_classes);
+            assert(bitSet_inv(lane) == trees[k]->decision(b[k]));
+        }
+        // the remaining slot is not used
+        assert(res[n_slots-1] == 0);
+    }
+    
+    for (size_t k = 0; k < trees.size(); k++) {
+        delete trees[k];
+    }
+    cout << "Slot packing: passed" << endl;
+}
+
+static void test_model_store()
+{
+    size_t n_slots = 10;
+    string text_path = "/tmp/test_tree_forest.txt";
+    string model_path = "/tmp/test_tree_forest.cfm";
+    
+    {
+        ofstream out(text_path.c_str());
+        out << "# feature 0 at most 5, then feature 2 at most -3\n";
+        out << "forest 3 3\n";
+        out << "tree 5\n1 2 0 5 0\n-1 -1 0 0 1\n3 4 2 -3 0\n-1 -1 0 0 0\n-1 -1 0 0 2\n";
+        out << "tree 3\n1 2 1 7 0\n-1 -1 0 0 2\n-1 -1 0 0 1\n";
+        out << "tree 1\n-1 -1 0 0 1\n";
+    }
+    
+    vector<Node<long>*> trees;
+    unsigned int n_classes;
+    vector<unsigned int> n_variables;
+    vector<vector<pair <long,long> > > criteria;
+    assert(read_forest_text(text_path, trees, n_classes, n_variables, criteria));
+    assert(trees.size() == 3 && n_classes == 3);
+    assert(n_variables[0] == 2 && n_variables[1] == 1 && n_variables[2] == 1);
+    assert(criteria[0][0] == make_pair(0L, 5L) && criteria[0][1] == make_pair(2L, -3L));
+    
+    Compiled_Forest compiled = compile_forest(trees, n_classes, n_variables, criteria, n_slots, true);
+    assert(compiled.trees_per_ciphertext == 3 && compiled.packed_polys.size() == 1);
+    assert(save_compiled_forest(compiled, model_path));
+    
+    Compiled_Forest loaded;
+    assert(load_compiled_forest(loaded, model_path));
+    assert(loaded.n_classes == n_classes && loaded.n_slots == n_slots && loaded.slot_packing);
+    assert(loaded.criteria == criteria && loaded.n_variables == n_variables);
+    assert(loaded.packed_n_variables == compiled.packed_n_variables);
+    
+    for (unsigned int x = 0; x < 4; x++) {
+        vector<bool> b = {(bool)(x & 1), (bool)(x & 2)};
+        vector< vector<long> > vals(2, vector<long>(n_slots));
+        for (size_t v = 0; v < 2; v++) {
+            vals[v] = vector<long>(n_slots, b[v]);
+        }
+        for (size_t tj = 0; tj < trees.size(); tj++) {
+            vector<long> res = evalPoly_slots(loaded.tree_polys[tj], vals, n_slots);
+            assert(bitSet_inv(res) == trees[tj]->decision(b));
+        }
+        assert(evalPoly_slots(loaded.packed_polys[0], vals, n_slots) == evalPoly_slots(compiled.packed_polys[0], vals, n_slots));
+    }
+    
+    // forests whose variables do not match their criteria are rejected
+    {
+        Compiled_Forest bad = compiled;
+        bad.packed_polys[0] += Term< vector<long> >(vector<long>(n_slots, 1), {bad.packed_n_variables[0]});
+        assert(save_compiled_forest(bad, model_path));
+        assert(!load_compiled_forest(loaded, model_path));
+        
+        bad = compiled;
+        bad.tree_polys[1] += Term< vector<long> >(vector<long>(n_slots, 1), {1});
+        assert(save_compiled_forest(bad, model_path));
+        assert(!load_compiled_forest(loaded, model_path));
+        
+        bad = compiled;
+        bad.n_variables[2] = 0;
+        bad.criteria[2].clear();
+        assert(save_compiled_forest(bad, model_path));
+        assert(!load_compiled_forest(loaded, model_path));
+        
+        bad = compiled;
+        bad.packed_n_variables[0]++;
+        assert(save_compiled_forest(bad, model_path));
+        assert(!load_compiled_forest(loaded, model_path));
+    }
+    
+    // truncated files are rejected
+    assert(save_compiled_forest(compiled, model_path));
+    assert(truncate(model_path.c_str(), 100) == 0);
+    assert(!load_compiled_forest(loaded, model_path));
+    
+    unlink(text_path.c_str());
+    unlink(model_path.c_str());
+    for (size_t k = 0; k < trees.size(); k++) {
+        delete trees[k];
+    }
+    cout << "Model store: passed" << endl;
+}
+
+
 struct configuration {
     long p;
     long r;
@@ -456,6 +607,8 @@ main(int argc, char **argv)
 //    test_tree();
 //    test_poly();
 //    fun_with_fhe();
+    test_slot_packing();
+    test_model_store();
     
     cout << "Test selector with polynomial" << endl;
     test_selector(n,shallow);
@@ -22,6 +22,7 @@
 
 #include <tree/m_variate_poly.hh>
 #include <vector>
+#include <cassert>
 using namespace std;
 
 // lexicographic order
@@ -91,4 +92,26 @@ template <typename T> vector<Term <T> > mergeRegroup(const vector<Term <T> > &p)
 template <typename T> inline Multivariate_poly<T> mergeRegroup(const Multivariate_poly<T> &p)
 {
     return Multivariate_poly<T>(mergeRegroup(p.terms()));
-}
\ No newline at end of file
+}
+
+// moves the first width slots of each coefficient to the slots [offset, offset+width)
+// of a vector of n_slots slots, the others being 0. Added together, such polynomials
+// evaluate several trees at once, each on its own range of slots.
+template <typename T> Multivariate_poly< vector<T> > shiftSlots(const Multivariate_poly< vector<T> > &p, size_t width, size_t offset, size_t n_slots)
+{
+    assert(offset + width <= n_slots);
+    
+    vector<Term< vector<T> > > terms;
+    terms.reserve(p.terms().size());
+    
+    for (size_t i = 0; i < p.terms().size(); i++) {
+        const vector<T> &c = p.terms()[i].coefficient();
+        vector<T> shifted(n_slots, 0);
+        for (size_t j = 0; j < width && j < c.size(); j++) {
+            shifted[offset + j] = c[j];
+        }
+        terms.push_back(Term< vector<T> >(shifted, p.terms()[i].variables()));
+    }
+    
+    return Multivariate_poly< vector<T> >(terms);
+}
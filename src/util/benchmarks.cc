@@ -22,6 +22,6 @@
 
 #ifdef BENCHMARK
 BenchTimer* BenchTimer::shared_instance__ = NULL;
-unsigned long IOBenchmark::byte_count__ = 0;
-unsigned long IOBenchmark::interaction_count__ = 0;
+std::atomic<unsigned long> IOBenchmark::byte_count__(0);
+std::atomic<unsigned long> IOBenchmark::interaction_count__(0);
 #endif
\ No newline at end of file
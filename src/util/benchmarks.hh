@@ -22,6 +22,8 @@
 
 #ifdef BENCHMARK
 
+#include <atomic>
+
 #include <util/util.hh>
 
 
@@ -49,10 +51,12 @@ protected:
     
 };
 
+// process-wide totals: use Session_Metrics (util/session_metrics.hh) to get the
+// numbers of a single session when several of them run concurrently
 class IOBenchmark {
 private:
-    static unsigned long byte_count__;
-    static unsigned long interaction_count__;
+    static std::atomic<unsigned long> byte_count__;
+    static std::atomic<unsigned long> interaction_count__;
     
 public:
     static void reset()
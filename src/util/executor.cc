@@ -0,0 +1,430 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <util/executor.hh>
+#include <util/session_metrics.hh>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace std;
+
+// idle threads for the blocking tasks exit after this delay
+#define EXECUTOR_BLOCKING_IDLE_SECONDS 60
+
+// index of the calling thread in the workers of executor_, if it is one
+static thread_local Executor *executor_ = NULL;
+static thread_local unsigned int worker_index_ = 0;
+
+thread_local Executor::Share* Executor::Share::current_ = NULL;
+
+bool Executor::Share::try_acquire()
+{
+    unsigned int busy = busy_;
+    while (busy < max_workers_) {
+        if (busy_.compare_exchange_weak(busy, busy + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Executor::Share* Executor::Share::current()
+{
+    return current_;
+}
+
+// CPUs the process may run on
+static vector<int> allowed_cpus()
+{
+    vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &set)) {
+                cpus.push_back(c);
+            }
+        }
+    }
+    return cpus;
+}
+
+// parses a sysfs cpu list, e.g. "0-3,8-11"
+static vector<int> parse_cpu_list(const char *path)
+{
+    vector<int> cpus;
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return cpus;
+    }
+    int first, last;
+    char sep;
+    while (fscanf(f, "%d", &first) == 1) {
+        last = first;
+        sep = fgetc(f);
+        if (sep == '-') {
+            if (fscanf(f, "%d", &last) != 1) {
+                break;
+            }
+            sep = fgetc(f);
+        }
+        for (int c = first; c <= last; c++) {
+            cpus.push_back(c);
+        }
+        if (sep != ',') {
+            break;
+        }
+    }
+    fclose(f);
+    return cpus;
+}
+
+// allowed CPUs of each NUMA node, a single node if there is no NUMA information
+static vector<vector<int> > cpus_by_node()
+{
+    vector<int> allowed = allowed_cpus();
+    vector<vector<int> > nodes;
+
+    for (int n = 0; ; n++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", n);
+        vector<int> cpus = parse_cpu_list(path);
+        if (cpus.empty()) {
+            break;
+        }
+        vector<int> node;
+        for (int c : cpus) {
+            if (find(allowed.begin(), allowed.end(), c) != allowed.end()) {
+                node.push_back(c);
+            }
+        }
+        if (!node.empty()) {
+            nodes.push_back(node);
+        }
+    }
+
+    if (nodes.empty()) {
+        nodes.push_back(allowed);
+    }
+    return nodes;
+}
+
+unsigned int Executor::default_size()
+{
+    const char *env = getenv("CIPHERMED_THREADS");
+    if (env != NULL && atoi(env) > 0) {
+        return atoi(env);
+    }
+
+    size_t n = allowed_cpus().size();
+    if (n == 0) {
+        n = thread::hardware_concurrency();
+    }
+    return max<size_t>(n, 1);
+}
+
+Executor& Executor::global()
+{
+    // never destroyed: tasks may still be running when static objects go
+    static Executor *executor = new Executor(default_size());
+    return *executor;
+}
+
+Executor::Executor(unsigned int n_workers)
+: n_nodes_(1), next_(0), queued_(0), stop_(false), idle_blocking_(0), live_blocking_(0)
+{
+    assert(n_workers > 0);
+
+    vector<vector<int> > nodes = cpus_by_node();
+    n_nodes_ = nodes.size();
+
+    // the workers are spread over the nodes like the CPUs are
+    vector<unsigned int> cpu_nodes;
+    for (size_t n = 0; n < nodes.size(); n++) {
+        cpu_nodes.insert(cpu_nodes.end(), nodes[n].size(), n);
+    }
+    if (cpu_nodes.empty()) {
+        cpu_nodes.push_back(0);
+    }
+
+    for (unsigned int i = 0; i < n_workers; i++) {
+        workers_.push_back(unique_ptr<Worker>(new Worker()));
+        workers_[i]->node = cpu_nodes[i % cpu_nodes.size()];
+    }
+    for (unsigned int i = 0; i < n_workers; i++) {
+        // no pinning on a single node: leave the placement to the scheduler
+        vector<int> cpus;
+        if (n_nodes_ > 1) {
+            cpus = nodes[workers_[i]->node];
+        }
+        workers_[i]->thread = thread(&Executor::worker_loop, this, i, cpus);
+    }
+}
+
+Executor::~Executor()
+{
+    {
+        lock_guard<mutex> lock(mtx_);
+        stop_ = true;
+    }
+    work_available_.notify_all();
+    blocking_available_.notify_all();
+
+    for (size_t i = 0; i < workers_.size(); i++) {
+        workers_[i]->thread.join();
+    }
+
+    unique_lock<mutex> lock(mtx_);
+    blocking_done_.wait(lock, [this]{ return live_blocking_ == 0; });
+}
+
+void Executor::notify_work()
+{
+    {
+        // queued_ is changed with mtx_ held so that no wakeup is lost
+        lock_guard<mutex> lock(mtx_);
+        queued_++;
+    }
+    work_available_.notify_one();
+}
+
+void Executor::submit(Task t)
+{
+    // the workers keep what they submit, the others spread it
+    unsigned int i = (executor_ == this) ? worker_index_ : (next_++ % workers_.size());
+    {
+        lock_guard<mutex> lock(workers_[i]->mtx);
+        workers_[i]->tasks.push_back(move(t));
+    }
+    notify_work();
+}
+
+bool Executor::pop(unsigned int i, Task &t)
+{
+    lock_guard<mutex> lock(workers_[i]->mtx);
+    if (workers_[i]->tasks.empty()) {
+        return false;
+    }
+    t = move(workers_[i]->tasks.back());
+    workers_[i]->tasks.pop_back();
+    queued_--;
+    return true;
+}
+
+bool Executor::steal(unsigned int thief, Task &t)
+{
+    unsigned int n = workers_.size();
+    unsigned int node = workers_[thief]->node;
+
+    // the workers of the same node first, then the others
+    for (int pass = 0; pass < 2; pass++) {
+        for (unsigned int k = 1; k <= n; k++) {
+            unsigned int i = (thief + k) % n;
+            if ((workers_[i]->node == node) != (pass == 0)) {
+                continue;
+            }
+            lock_guard<mutex> lock(workers_[i]->mtx);
+            if (!workers_[i]->tasks.empty()) {
+                t = move(workers_[i]->tasks.front());
+                workers_[i]->tasks.pop_front();
+                queued_--;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Executor::run_one()
+{
+    Task t;
+    if (executor_ == this) {
+        if (!pop(worker_index_, t) && !steal(worker_index_, t)) {
+            return false;
+        }
+    } else if (queued_ == 0 || !steal(next_++ % workers_.size(), t)) {
+        return false;
+    }
+    t();
+    return true;
+}
+
+void Executor::worker_loop(unsigned int i, vector<int> cpus)
+{
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int c : cpus) {
+            CPU_SET(c, &set);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    executor_ = this;
+    worker_index_ = i;
+
+    for (;;) {
+        Task t;
+        if (pop(i, t) || steal(i, t)) {
+            t();
+            continue;
+        }
+
+        unique_lock<mutex> lock(mtx_);
+        work_available_.wait(lock, [this]{ return stop_ || queued_ > 0; });
+        if (stop_ && queued_ == 0) {
+            return;
+        }
+    }
+}
+
+void Executor::run_blocking(Task t)
+{
+    bool spawn;
+    {
+        lock_guard<mutex> lock(mtx_);
+        blocking_tasks_.push_back(move(t));
+        // every queued task needs an idle thread of its own
+        spawn = blocking_tasks_.size() > idle_blocking_;
+        if (spawn) {
+            live_blocking_++;
+        }
+    }
+
+    if (spawn) {
+        thread(&Executor::blocking_loop, this).detach();
+    } else {
+        blocking_available_.notify_one();
+    }
+}
+
+void Executor::blocking_loop()
+{
+    unique_lock<mutex> lock(mtx_);
+    for (;;) {
+        if (blocking_tasks_.empty()) {
+            idle_blocking_++;
+            bool woken = blocking_available_.wait_for(lock, chrono::seconds(EXECUTOR_BLOCKING_IDLE_SECONDS),
+                                                      [this]{ return stop_ || !blocking_tasks_.empty(); });
+            idle_blocking_--;
+            if (!woken || blocking_tasks_.empty()) {
+                break;
+            }
+        }
+
+        Task t = move(blocking_tasks_.front());
+        blocking_tasks_.pop_front();
+        lock.unlock();
+        t();
+        lock.lock();
+    }
+
+    live_blocking_--;
+    blocking_done_.notify_all();
+}
+
+Task_Group::Task_Group(Executor &executor)
+: executor_(executor), share_(Executor::Share::current()), metrics_(Session_Metrics::current()), pending_(0)
+{
+}
+
+Task_Group::~Task_Group()
+{
+    join();
+}
+
+Executor::Task Task_Group::wrap(Executor::Task t, bool release_share)
+{
+    pending_++;
+
+    return [this, t, release_share]() {
+        exception_ptr e;
+        {
+            Executor::Share::Binding share_binding(share_);
+            Session_Metrics::Binding metrics_binding(metrics_);
+            try {
+                t();
+            } catch (...) {
+                e = current_exception();
+            }
+        }
+        if (release_share) {
+            share_->release();
+        }
+        done(e);
+    };
+}
+
+void Task_Group::done(exception_ptr e)
+{
+    // notify with the lock held: the group may be destroyed as soon as it is released
+    lock_guard<mutex> lock(mtx_);
+    if (e && !error_) {
+        error_ = e;
+    }
+    if (--pending_ == 0) {
+        all_done_.notify_all();
+    }
+}
+
+void Task_Group::run(Executor::Task t)
+{
+    if (share_ == NULL) {
+        executor_.submit(wrap(t, false));
+    } else if (share_->try_acquire()) {
+        executor_.submit(wrap(t, true));
+    } else {
+        // the session already uses all its workers
+        wrap(t, false)();
+    }
+}
+
+void Task_Group::run_blocking(Executor::Task t)
+{
+    executor_.run_blocking(wrap(t, false));
+}
+
+void Task_Group::join()
+{
+    // help instead of sleeping while tasks are queued
+    while (pending_ > 0 && executor_.run_one()) {
+    }
+
+    unique_lock<mutex> lock(mtx_);
+    all_done_.wait(lock, [this]{ return pending_ == 0; });
+}
+
+void Task_Group::wait()
+{
+    join();
+
+    lock_guard<mutex> lock(mtx_);
+    if (error_) {
+        exception_ptr e = error_;
+        error_ = nullptr;
+        rethrow_exception(e);
+    }
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Session_Metrics;
+
+/*
+ * Process-wide work-stealing executor for the parallel loops of the
+ * protocols.
+ *
+ * There is one worker per CPU the process may run on (CIPHERMED_THREADS
+ * overrides it). On NUMA machines, the workers are bound to the CPUs of
+ * their node and steal from the workers of the same node first.
+ * Each worker has its own deque: the tasks submitted by a worker go to its
+ * own deque, the others are spread between the workers.
+ *
+ * Tasks are submitted through a Task_Group (see below), never directly.
+ * Tasks blocking on the network must not run on the workers, as they could
+ * wait for tasks queued behind them: Task_Group::run_blocking gives them a
+ * thread of their own, taken from a cache of idle threads.
+ */
+class Executor {
+public:
+    typedef std::function<void()> Task;
+
+    explicit Executor(unsigned int n_workers);
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor &operator=(const Executor &) = delete;
+
+    /* the process-wide instance, created on first use and never destroyed */
+    static Executor& global();
+    /* default number of workers: CPUs we may run on, or CIPHERMED_THREADS */
+    static unsigned int default_size();
+
+    unsigned int size() const { return workers_.size(); }
+    unsigned int numa_nodes() const { return n_nodes_; }
+
+    /*
+     * Limits the number of workers a session keeps busy at the same time.
+     * The task groups created by a thread bound to a share (and by the tasks
+     * of these groups) count against it; when it is exhausted, the tasks run
+     * in the thread submitting them.
+     */
+    class Share {
+    public:
+        Share(unsigned int max_workers) : max_workers_(max_workers), busy_(0) {}
+
+        unsigned int max_workers() const { return max_workers_; }
+
+        bool try_acquire();
+        void release() { busy_--; }
+
+        static Share* current();
+
+        class Binding {
+        public:
+            Binding(Share *s) : previous_(current_) { current_ = s; }
+            Binding(Share &s) : previous_(current_) { current_ = &s; }
+            ~Binding() { current_ = previous_; }
+
+            Binding(const Binding&) = delete;
+            Binding &operator=(const Binding &) = delete;
+        private:
+            Share *previous_;
+        };
+
+    private:
+        const unsigned int max_workers_;
+        std::atomic<unsigned int> busy_;
+
+        static thread_local Share *current_;
+    };
+
+protected:
+    friend class Task_Group;
+
+    struct Worker {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+        unsigned int node;
+        std::thread thread;
+    };
+
+    void submit(Task t);
+    /* runs one queued task in the calling thread, false if there is none */
+    bool run_one();
+    void run_blocking(Task t);
+
+    bool pop(unsigned int i, Task &t);
+    bool steal(unsigned int thief, Task &t);
+    void worker_loop(unsigned int i, std::vector<int> cpus);
+    void blocking_loop();
+    void notify_work();
+
+    std::vector<std::unique_ptr<Worker> > workers_;
+    unsigned int n_nodes_;
+    std::atomic<unsigned int> next_;
+    std::atomic<size_t> queued_;
+    bool stop_;
+
+    std::mutex mtx_;
+    std::condition_variable work_available_;
+
+    // threads for the blocking tasks
+    std::deque<Task> blocking_tasks_;
+    unsigned int idle_blocking_;
+    unsigned int live_blocking_;
+    std::condition_variable blocking_available_;
+    std::condition_variable blocking_done_;
+};
+
+/*
+ * A set of tasks that are waited for together.
+ *
+ * The tasks run with the share and the session metrics of the thread that
+ * created the group. While waiting, the thread runs queued tasks itself:
+ * tasks can create groups and wait for them.
+ * The first exception thrown by a task is rethrown by wait.
+ */
+class Task_Group {
+public:
+    Task_Group(Executor &executor = Executor::global());
+    ~Task_Group();
+
+    Task_Group(const Task_Group&) = delete;
+    Task_Group &operator=(const Task_Group &) = delete;
+
+    void run(Executor::Task t);
+    /* for tasks blocking on I/O: always started right away, on their own thread */
+    void run_blocking(Executor::Task t);
+    void wait();
+
+protected:
+    Executor::Task wrap(Executor::Task t, bool release_share);
+    void done(std::exception_ptr e);
+    /* wait, without rethrowing */
+    void join();
+
+    Executor &executor_;
+    Executor::Share *share_;
+    Session_Metrics *metrics_;
+
+    std::atomic<size_t> pending_;
+    std::exception_ptr error_;
+    std::mutex mtx_;
+    std::condition_variable all_done_;
+};
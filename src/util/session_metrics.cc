@@ -0,0 +1,193 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <util/session_metrics.hh>
+
+#include <sstream>
+
+thread_local Session_Metrics* Session_Metrics::current_ = NULL;
+
+Session_Metrics::Session_Metrics(const std::string &role, unsigned int id)
+: role_(role), id_(id), bytes_sent_(0), bytes_received_(0), messages_sent_(0), messages_received_(0), round_trips_(0), last_direction_(-1), phase_open_(false)
+{
+    set_phase("session");
+}
+
+Session_Metrics* Session_Metrics::current()
+{
+    return current_;
+}
+
+// must be called with phases_mtx_ held
+void Session_Metrics::close_phase()
+{
+    if (phase_open_) {
+        phases_.back().wall_ms += phase_timer_.lap_ms();
+        phase_open_ = false;
+    }
+}
+
+void Session_Metrics::set_phase(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(phases_mtx_);
+    close_phase();
+
+    // drop the implicit first phase if no message was exchanged in it
+    if (phases_.size() == 1 && phases_[0].messages == 0) {
+        phases_.pop_back();
+    }
+
+    Phase p = {name, 0., 0., 0, 0};
+    phases_.push_back(p);
+    phase_open_ = true;
+    phase_timer_.lap();
+}
+
+void Session_Metrics::finish()
+{
+    std::lock_guard<std::mutex> lock(phases_mtx_);
+    close_phase();
+}
+
+void Session_Metrics::record_io(Direction d, uint64_t bytes, double net_ms)
+{
+    if (d == SENT) {
+        bytes_sent_ += bytes;
+        messages_sent_++;
+    } else {
+        bytes_received_ += bytes;
+        messages_received_++;
+    }
+
+    // a round trip is completed each time we read an answer to what we sent
+    int previous = last_direction_.exchange(d);
+    if (previous == SENT && d == RECEIVED) {
+        round_trips_++;
+    }
+
+    std::lock_guard<std::mutex> lock(phases_mtx_);
+    Phase &p = phases_.back();
+    p.net_ms += net_ms;
+    p.bytes += bytes;
+    p.messages++;
+}
+
+std::vector<Session_Metrics::Phase> Session_Metrics::phases() const
+{
+    std::lock_guard<std::mutex> lock(phases_mtx_);
+    return phases_;
+}
+
+double Session_Metrics::net_time_ms() const
+{
+    double t = 0;
+    for (const Phase &p : phases()) {
+        t += p.net_ms;
+    }
+    return t;
+}
+
+double Session_Metrics::comp_time_ms() const
+{
+    double t = 0;
+    for (const Phase &p : phases()) {
+        t += p.comp_ms();
+    }
+    return t;
+}
+
+void Session_Metrics::add_query_latency(double ms)
+{
+    std::lock_guard<std::mutex> lock(phases_mtx_);
+    query_latencies_.push_back(ms);
+}
+
+std::vector<double> Session_Metrics::query_latencies_ms() const
+{
+    std::lock_guard<std::mutex> lock(phases_mtx_);
+    return query_latencies_;
+}
+
+static std::string json_escape(const std::string &s)
+{
+    std::string ret;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            ret += '\\';
+        }
+        ret += c;
+    }
+    return ret;
+}
+
+std::string Session_Metrics::to_json() const
+{
+    std::vector<Phase> ph = phases();
+    std::ostringstream out;
+
+    out << "{\"role\":\"" << json_escape(role_) << "\",\"session\":" << id_;
+    out << ",\"bytes_sent\":" << bytes_sent_ << ",\"bytes_received\":" << bytes_received_;
+    out << ",\"messages_sent\":" << messages_sent_ << ",\"messages_received\":" << messages_received_;
+    out << ",\"round_trips\":" << round_trips_;
+    out << ",\"comp_ms\":" << comp_time_ms() << ",\"net_ms\":" << net_time_ms();
+    out << ",\"phases\":[";
+    for (size_t i = 0; i < ph.size(); i++) {
+        if (i > 0) {
+            out << ",";
+        }
+        out << "{\"name\":\"" << json_escape(ph[i].name) << "\",\"comp_ms\":" << ph[i].comp_ms();
+        out << ",\"net_ms\":" << ph[i].net_ms << ",\"bytes\":" << ph[i].bytes;
+        out << ",\"messages\":" << ph[i].messages << "}";
+    }
+    out << "]";
+
+    std::vector<double> latencies = query_latencies_ms();
+    if (!latencies.empty()) {
+        out << ",\"queries\":" << latencies.size() << ",\"query_ms\":[";
+        for (size_t i = 0; i < latencies.size(); i++) {
+            out << ((i > 0) ? "," : "") << latencies[i];
+        }
+        out << "]";
+    }
+    out << "}";
+
+    return out.str();
+}
+
+JSON_Lines_Metrics_Sink::JSON_Lines_Metrics_Sink(const std::string &path)
+: file_(path.c_str(), std::ios::app), out_(file_)
+{
+    if (!file_) {
+        throw std::runtime_error("Unable to open metrics file " + path);
+    }
+}
+
+JSON_Lines_Metrics_Sink::JSON_Lines_Metrics_Sink(std::ostream &out)
+: out_(out)
+{
+}
+
+void JSON_Lines_Metrics_Sink::publish(const Session_Metrics &m)
+{
+    std::string line = m.to_json();
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    out_ << line << std::endl;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ * Copyright 2016-2017 Pascal Berrang
+ *
+ * This file is part of ciphermed-forests.
+
+ *  ciphermed-forests is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed-forests is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed-forests.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <util/util.hh>
+
+/*
+ * Per-session instrumentation: bytes, messages and round trips on the wire,
+ * and computation/network time for each protocol phase.
+ *
+ * A session binds its metrics to the thread running it (Session_Metrics::Binding);
+ * the message I/O functions then account for the traffic of the session that is
+ * bound to the calling thread. Threads spawned by a session have to bind the
+ * same object (task groups do it for their tasks, see util/executor.hh).
+ * Counters are atomic, phases are protected by a mutex.
+ */
+class Session_Metrics {
+public:
+    struct Phase {
+        std::string name;
+        double wall_ms;
+        double net_ms;
+        uint64_t bytes;
+        uint64_t messages;
+
+        double comp_ms() const { return (wall_ms > net_ms) ? wall_ms - net_ms : 0.; }
+    };
+
+    enum Direction { SENT, RECEIVED };
+
+    Session_Metrics(const std::string &role, unsigned int id = 0);
+
+    Session_Metrics(const Session_Metrics&) = delete;
+    Session_Metrics &operator=(const Session_Metrics &) = delete;
+
+    const std::string& role() const { return role_; }
+    unsigned int id() const { return id_; }
+    void set_id(unsigned int id) { id_ = id; }
+
+    /* subsequent traffic and time are accounted to phase name */
+    void set_phase(const std::string &name);
+    /* closes the current phase */
+    void finish();
+
+    void record_io(Direction d, uint64_t bytes, double net_ms);
+
+    uint64_t bytes_sent() const { return bytes_sent_; }
+    uint64_t bytes_received() const { return bytes_received_; }
+    uint64_t messages_sent() const { return messages_sent_; }
+    uint64_t messages_received() const { return messages_received_; }
+    uint64_t round_trips() const { return round_trips_; }
+
+    std::vector<Phase> phases() const;
+    double net_time_ms() const;
+    double comp_time_ms() const;
+
+    /* multi-query sessions: latency of each query, from the start of its
+     * batch to its result */
+    void add_query_latency(double ms);
+    std::vector<double> query_latencies_ms() const;
+
+    /* one JSON object on a single line */
+    std::string to_json() const;
+
+    /* metrics bound to the calling thread, NULL if none */
+    static Session_Metrics* current();
+
+    class Binding {
+    public:
+        Binding(Session_Metrics *m) : previous_(current_) { current_ = m; }
+        Binding(Session_Metrics &m) : previous_(current_) { current_ = &m; }
+        ~Binding() { current_ = previous_; }
+
+        Binding(const Binding&) = delete;
+        Binding &operator=(const Binding &) = delete;
+    private:
+        Session_Metrics *previous_;
+    };
+
+    /* times a blocking socket operation for the bound session, if any */
+    class IO_Scope {
+    public:
+        IO_Scope(Direction d, uint64_t bytes = 0) : m_(current_), d_(d), bytes_(bytes) {}
+        ~IO_Scope() { done(); }
+
+        void add_bytes(uint64_t n) { bytes_ += n; }
+        /* records the operation now instead of at the end of the scope */
+        void done() { if (m_) m_->record_io(d_, bytes_, t_.lap_ms()); m_ = NULL; }
+
+        IO_Scope(const IO_Scope&) = delete;
+        IO_Scope &operator=(const IO_Scope &) = delete;
+    private:
+        Session_Metrics *m_;
+        Direction d_;
+        uint64_t bytes_;
+        Timer t_;
+    };
+
+protected:
+    void close_phase();
+
+    std::string role_;
+    unsigned int id_;
+
+    std::atomic<uint64_t> bytes_sent_;
+    std::atomic<uint64_t> bytes_received_;
+    std::atomic<uint64_t> messages_sent_;
+    std::atomic<uint64_t> messages_received_;
+    std::atomic<uint64_t> round_trips_;
+    std::atomic<int> last_direction_;
+
+    mutable std::mutex phases_mtx_;
+    std::vector<Phase> phases_;
+    std::vector<double> query_latencies_;
+    bool phase_open_;
+    Timer phase_timer_;
+
+    static thread_local Session_Metrics *current_;
+};
+
+/* where the metrics of finished sessions go */
+class Metrics_Sink {
+public:
+    virtual ~Metrics_Sink() {}
+    virtual void publish(const Session_Metrics &m) = 0;
+};
+
+/* one JSON object per line, safe to share between sessions */
+class JSON_Lines_Metrics_Sink : public Metrics_Sink {
+public:
+    JSON_Lines_Metrics_Sink(const std::string &path);
+    JSON_Lines_Metrics_Sink(std::ostream &out);
+
+    void publish(const Session_Metrics &m);
+
+protected:
+    std::ofstream file_;
+    std::ostream &out_;
+    std::mutex mtx_;
+};
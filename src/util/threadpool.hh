@@ -18,52 +18,138 @@
  *
  */
 
-#include <boost/thread/thread.hpp>
-#include <boost/asio.hpp>
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed size thread pool with a bounded queue.
+ *
+ * enqueue blocks while the queue is full, try_enqueue fails instead.
+ * max_queue == 0 means an unbounded queue.
+ * The destructor runs the queued tasks and then joins the workers.
+ */
+class ThreadPool {
+public:
+    ThreadPool(size_t threads, size_t max_queue = 0)
+    : max_queue_(max_queue), active_(0), stop_(false)
+    {
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.push_back(std::thread(&ThreadPool::worker_loop, this));
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        not_empty_.notify_all();
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            workers_[i].join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
 
-// the actual thread pool
-struct ThreadPool {
-    ThreadPool(std::size_t);
     template<class F>
-    void enqueue(F f);
-    ~ThreadPool();
-    private:
-    // the io_service we are wrapping
-    boost::asio::io_service service;
-//    using asio_worker = std::unique_ptr<boost::asio::io_service::work>;
-    std::unique_ptr<boost::asio::io_service::work> working;
-    // need to keep track of threads so we can join them
-    std::vector<std::unique_ptr<boost::thread>> workers;
-};
+    void enqueue(F f)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        not_full_.wait(lock, [this]{ return !is_full(); });
+        tasks_.push(std::function<void()>(f));
+        lock.unlock();
+        not_empty_.notify_one();
+    }
+
+    template<class F>
+    bool try_enqueue(F f)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (is_full()) {
+            return false;
+        }
+        tasks_.push(std::function<void()>(f));
+        lock.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    /* blocks until a task can be enqueued without waiting */
+    void wait_for_room()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        not_full_.wait(lock, [this]{ return !is_full(); });
+    }
+
+    size_t size() const { return workers_.size(); }
+    size_t max_queue() const { return max_queue_; }
+
+    size_t queued() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return tasks_.size();
+    }
+
+    size_t active() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return active_;
+    }
+
+    bool full() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return is_full();
+    }
 
-// the constructor just launches some amount of workers
-ThreadPool::ThreadPool(size_t threads)
-:service()
-,working(new std::unique_ptr<boost::asio::io_service::work>::element_type(service))
-{
-    for ( std::size_t i = 0; i < threads; ++i ) {
-        workers.push_back(
-                          std::unique_ptr<boost::thread>(
-                                                         new boost::thread([this]
-                                                                           {
-                                                                               service.run();
-                                                                           })
-                                                         )
-                          );
+private:
+    // at most size() running tasks and max_queue() waiting ones
+    bool is_full() const
+    {
+        return max_queue_ > 0 && tasks_.size() + active_ >= workers_.size() + max_queue_;
     }
-}
-
-// add new work item to the pool
-template<class F>
-void ThreadPool::enqueue(F f) {
-    service.post(f);
-}
-
-// the destructor joins all threads
-ThreadPool::~ThreadPool() {
-    //service.stop();
-    //for ( std::size_t i = 0; i < workers.size(); ++i )
-    //   workers[i]->join();
-    working.reset();
-    service.run();
-}
+
+    void worker_loop()
+    {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                not_empty_.wait(lock, [this]{ return stop_ || !tasks_.empty(); });
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop();
+                active_++;
+            }
+            not_full_.notify_one();
+
+            task();
+
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                active_--;
+            }
+            not_full_.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()> > tasks_;
+    size_t max_queue_;
+    size_t active_;
+    bool stop_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};